@@ -9,6 +9,7 @@
 #include "ofc/core.h"
 #include "ofc/types.h"
 #include "ofc/handle.h"
+#include "ofc/queue.h"
 
 /**
  * \defgroup app Event Driven Application Handling
@@ -162,6 +163,95 @@ ofc_app_get_data(OFC_HANDLE hApp);
  */
 OFC_CORE_LIB OFC_VOID
 ofc_app_set_wait(OFC_HANDLE hApp, OFC_HANDLE hNotify);
+/**
+ * \protected
+ * Return the link the scheduler uses to queue the app
+ *
+ * NOTE: This is called only by the applications scheduler
+ *
+ * \param hApp
+ * Handle to the app
+ *
+ * \returns
+ * Pointer to the link embedded in the app or OFC_NULL
+ */
+OFC_CORE_LIB OFC_IQUEUE_LINK *
+ofc_app_sched_link(OFC_HANDLE hApp);
+/**
+ * \protected
+ * Return the app that owns a scheduler link
+ *
+ * NOTE: This is called only by the applications scheduler
+ *
+ * \param link
+ * Link returned by \ref ofc_app_sched_link, or OFC_NULL
+ *
+ * \returns
+ * Handle to the app or OFC_HANDLE_NULL
+ */
+OFC_CORE_LIB OFC_HANDLE
+ofc_app_from_sched_link(OFC_IQUEUE_LINK *link);
+/**
+ * \protected
+ * Return the scheduler currently running the app
+ *
+ * This is the scheduler the app was created on unless that is a pool,
+ * in which case it is the pool worker that owns the app.
+ *
+ * NOTE: This is called only by the applications scheduler
+ *
+ * \param hApp
+ * Handle to the app
+ *
+ * \returns
+ * Handle to the scheduler
+ */
+OFC_CORE_LIB OFC_HANDLE
+ofc_app_get_worker(OFC_HANDLE hApp);
+/**
+ * \protected
+ * Set the scheduler running the app
+ *
+ * NOTE: This is called only by the applications scheduler
+ *
+ * \param hApp
+ * Handle to the app
+ *
+ * \param hWorker
+ * Scheduler that now owns the app
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_app_set_worker(OFC_HANDLE hApp, OFC_HANDLE hWorker);
+#if defined(OFC_SCHED_INCREMENTAL)
+/**
+ * \protected
+ * Return the link the scheduler uses to queue the app for preselect
+ *
+ * NOTE: This is called only by the applications scheduler
+ *
+ * \param hApp
+ * Handle to the app
+ *
+ * \returns
+ * Pointer to the ready link embedded in the app or OFC_NULL
+ */
+OFC_CORE_LIB OFC_IQUEUE_LINK *
+ofc_app_ready_link(OFC_HANDLE hApp);
+/**
+ * \protected
+ * Return the app that owns a ready link
+ *
+ * NOTE: This is called only by the applications scheduler
+ *
+ * \param link
+ * Link returned by \ref ofc_app_ready_link, or OFC_NULL
+ *
+ * \returns
+ * Handle to the app or OFC_HANDLE_NULL
+ */
+OFC_CORE_LIB OFC_HANDLE
+ofc_app_from_ready_link(OFC_IQUEUE_LINK *link);
+#endif
 
 #if defined(OFC_APP_DEBUG)
 /**
@@ -0,0 +1,209 @@
+/* Copyright (c) 2021 Connected Way, LLC. All rights reserved.
+ * Use of this source code is governed by a Creative Commons
+ * Attribution-NoDerivatives 4.0 International license that can be
+ * found in the LICENSE file.
+ */
+#if !defined(__OFC_ATOMIC_H__)
+#define __OFC_ATOMIC_H__
+
+#include "ofc/core.h"
+#include "ofc/types.h"
+
+/**
+ * \{
+ * \defgroup atomic Open Files Atomic Operations
+ *
+ * Open Files uses a small set of atomic primitives for the hot paths
+ * that would otherwise serialize on a platform lock (handle reference
+ * counts, lock free queues, per thread statistics).  The primitives are
+ * mapped onto the compiler intrinsics so no port specific code is
+ * required.  All operations are sequentially consistent unless the
+ * name indicates otherwise.
+ *
+ * Macro | Description
+ * ------|------------
+ * \ref OFC_ATOMIC_LOAD | Atomically load a value
+ * \ref OFC_ATOMIC_STORE | Atomically store a value
+ * \ref OFC_ATOMIC_CAS | Compare and swap a value
+ * \ref OFC_ATOMIC_XCHG | Exchange a value
+ * \ref OFC_ATOMIC_ADD | Add to a value and return the result
+ * \ref OFC_ATOMIC_SUB | Subtract from a value and return the result
+ * \ref OFC_ATOMIC_PAUSE | Spin loop hint
+ * \ref OFC_ATOMIC_FENCE_RELEASE | Order earlier accesses before later stores
+ * \ref OFC_ATOMIC_FENCE_ACQUIRE | Order earlier loads before later accesses
+ * \ref OFC_THREAD_LOCAL | Thread local storage class
+ */
+
+#if defined(__GNUC__) || defined(__clang__)
+/**
+ * Atomically load a value
+ *
+ * \param p
+ * Pointer to the value to load
+ */
+#define OFC_ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+/**
+ * Atomically store a value
+ *
+ * \param p
+ * Pointer to the value to store to
+ *
+ * \param v
+ * Value to store
+ */
+#define OFC_ATOMIC_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+/**
+ * Compare and swap
+ *
+ * \param p
+ * Pointer to the value to swap
+ *
+ * \param e
+ * Pointer to the expected value.  Updated with the current value on failure
+ *
+ * \param v
+ * Desired value
+ *
+ * \returns
+ * OFC_TRUE if the swap occurred, OFC_FALSE otherwise
+ */
+#define OFC_ATOMIC_CAS(p, e, v) \
+  __atomic_compare_exchange_n((p), (e), (v), 0, \
+                              __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+/**
+ * Exchange a value
+ *
+ * \returns
+ * The previous value
+ */
+#define OFC_ATOMIC_XCHG(p, v) __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+/**
+ * Add to a value
+ *
+ * \returns
+ * The resulting value
+ */
+#define OFC_ATOMIC_ADD(p, v) __atomic_add_fetch((p), (v), __ATOMIC_ACQ_REL)
+/**
+ * Subtract from a value
+ *
+ * \returns
+ * The resulting value
+ */
+#define OFC_ATOMIC_SUB(p, v) __atomic_sub_fetch((p), (v), __ATOMIC_ACQ_REL)
+/**
+ * Add to a value with no ordering constraints.  Used for statistics.
+ */
+#define OFC_ATOMIC_ADD_RELAXED(p, v) \
+  __atomic_add_fetch((p), (v), __ATOMIC_RELAXED)
+/**
+ * Keep earlier loads and stores from moving past later stores
+ */
+#define OFC_ATOMIC_FENCE_RELEASE() __atomic_thread_fence(__ATOMIC_RELEASE)
+/**
+ * Keep earlier loads from moving past later loads and stores
+ */
+#define OFC_ATOMIC_FENCE_ACQUIRE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#if defined(__i386__) || defined(__x86_64__)
+/**
+ * Spin loop hint
+ */
+#define OFC_ATOMIC_PAUSE() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define OFC_ATOMIC_PAUSE() __asm__ __volatile__("yield")
+#else
+#define OFC_ATOMIC_PAUSE()
+#endif
+/**
+ * Thread local storage class
+ */
+#define OFC_THREAD_LOCAL __thread
+
+#elif defined(_WIN32)
+#include <intrin.h>
+
+#define OFC_ATOMIC_LOAD(p) \
+  (sizeof(*(p)) == 8 ? \
+   _InterlockedCompareExchange64((volatile __int64 *)(p), 0, 0) : \
+   _InterlockedCompareExchange((volatile long *)(p), 0, 0))
+#define OFC_ATOMIC_STORE(p, v) \
+  (sizeof(*(p)) == 8 ? \
+   _InterlockedExchange64((volatile __int64 *)(p), (__int64)(v)) : \
+   _InterlockedExchange((volatile long *)(p), (long)(v)))
+#define OFC_ATOMIC_XCHG(p, v) \
+  (sizeof(*(p)) == 8 ? \
+   _InterlockedExchange64((volatile __int64 *)(p), (__int64)(v)) : \
+   _InterlockedExchange((volatile long *)(p), (long)(v)))
+#define OFC_ATOMIC_ADD(p, v) \
+  (sizeof(*(p)) == 8 ? \
+   _InterlockedExchangeAdd64((volatile __int64 *)(p), (__int64)(v)) + (v) : \
+   _InterlockedExchangeAdd((volatile long *)(p), (long)(v)) + (v))
+#define OFC_ATOMIC_SUB(p, v) OFC_ATOMIC_ADD(p, -(v))
+#define OFC_ATOMIC_ADD_RELAXED(p, v) OFC_ATOMIC_ADD(p, v)
+#define OFC_ATOMIC_FENCE_RELEASE() _ReadWriteBarrier()
+#define OFC_ATOMIC_FENCE_ACQUIRE() _ReadWriteBarrier()
+#define OFC_ATOMIC_PAUSE() _mm_pause()
+#define OFC_THREAD_LOCAL __declspec(thread)
+
+static __inline OFC_BOOL
+ofc_atomic_cas_win32(volatile OFC_VOID *p, OFC_VOID *e,
+                     __int64 v, OFC_SIZET size) {
+    __int64 prev;
+    __int64 expected;
+
+    if (size == 8) {
+        expected = *(__int64 *) e;
+        prev = _InterlockedCompareExchange64((volatile __int64 *) p,
+                                             v, expected);
+        if (prev == expected)
+            return (OFC_TRUE);
+        *(__int64 *) e = prev;
+    } else {
+        expected = *(long *) e;
+        prev = _InterlockedCompareExchange((volatile long *) p,
+                                           (long) v, (long) expected);
+        if (prev == expected)
+            return (OFC_TRUE);
+        *(long *) e = (long) prev;
+    }
+    return (OFC_FALSE);
+}
+
+#define OFC_ATOMIC_CAS(p, e, v) \
+  ofc_atomic_cas_win32((p), (e), (__int64)(v), sizeof(*(p)))
+#else
+#error "Open Files atomics require a GCC compatible or Windows compiler"
+#endif
+
+/**
+ * A simple spin lock built on the atomic primitives.
+ *
+ * Used only where the critical section is a handful of instructions and
+ * where a platform lock cannot be used (for instance before the lock
+ * facility has been initialized).  Statically initialize to 0.
+ */
+typedef volatile OFC_INT OFC_SPINLOCK;
+
+/**
+ * Obtain a spin lock
+ *
+ * \param lock
+ * Pointer to the spin lock
+ */
+#define OFC_SPINLOCK_LOCK(lock) \
+  do { \
+    while (OFC_ATOMIC_XCHG((lock), 1) != 0) \
+      while (OFC_ATOMIC_LOAD(lock) != 0) \
+        OFC_ATOMIC_PAUSE(); \
+  } while (0)
+
+/**
+ * Release a spin lock
+ *
+ * \param lock
+ * Pointer to the spin lock
+ */
+#define OFC_SPINLOCK_UNLOCK(lock) OFC_ATOMIC_STORE((lock), 0)
+
+/** \} */
+#endif
@@ -0,0 +1,150 @@
+/* Copyright (c) 2021 Connected Way, LLC. All rights reserved.
+ * Use of this source code is governed by a Creative Commons
+ * Attribution-NoDerivatives 4.0 International license that can be
+ * found in the LICENSE file.
+ */
+#if !defined(__OFC_BUFFER_H__)
+#define __OFC_BUFFER_H__
+
+#include "ofc/core.h"
+#include "ofc/types.h"
+
+/**
+ * \{
+ * \defgroup buffer Open Files Buffer Pool
+ *
+ * Message data buffers are large, short lived and allocated on every
+ * request and response.  Rather than returning them to the heap, the
+ * buffer pool keeps a bounded number of free buffers in each of three
+ * size classes matched to the sizes SMB negotiates:
+ *
+ * Class | Size
+ * ------|-----
+ * Small | 4 KB
+ * Medium | 64 KB
+ * Large | 1 MB
+ *
+ * Each class also takes requests up to OFC_BUFFER_SLACK bytes over its
+ * size, so a full payload with its protocol header still fits.  A
+ * request is served from the smallest class that fits, if it is more
+ * than half the class.  Smaller and larger requests are allocated from
+ * the heap at their own size and freed when released.  A pooled buffer
+ * is allocated at the size first asked for and is reused for any later
+ * request in its class that it is big enough for.
+ *
+ * Buffers are reference counted so one buffer can be part of several
+ * messages at once (for instance file data read once and attached to a
+ * response).  The buffer returns to the pool when the last reference is
+ * released.
+ *
+ * Function | Description
+ * ---------|-------------
+ * \ref ofc_buffer_alloc | Allocate a buffer
+ * \ref ofc_buffer_ref | Take another reference to a buffer
+ * \ref ofc_buffer_shared | Test if a buffer has other references
+ * \ref ofc_buffer_release | Release a reference to a buffer
+ * \ref ofc_buffer_size | Get the usable size of a buffer
+ * \ref ofc_buffer_pool_flush | Return all free pooled buffers to the heap
+ * \ref ofc_buffer_pool_dump_stats | Print pool statistics
+ */
+
+/**
+ * Number of free buffers kept in the 4 KB class
+ */
+#if !defined(OFC_BUFFER_POOL_SMALL)
+#define OFC_BUFFER_POOL_SMALL 256
+#endif
+/**
+ * Number of free buffers kept in the 64 KB class
+ */
+#if !defined(OFC_BUFFER_POOL_MEDIUM)
+#define OFC_BUFFER_POOL_MEDIUM 32
+#endif
+/**
+ * Number of free buffers kept in the 1 MB class
+ */
+#if !defined(OFC_BUFFER_POOL_LARGE)
+#define OFC_BUFFER_POOL_LARGE 4
+#endif
+/**
+ * Bytes over its size a class takes, for protocol headers
+ */
+#if !defined(OFC_BUFFER_SLACK)
+#define OFC_BUFFER_SLACK 1024
+#endif
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+/**
+ * Allocate a buffer
+ *
+ * \param size
+ * Number of bytes needed
+ *
+ * \returns
+ * Pointer to the buffer, holding one reference.  The buffer may be
+ * larger than requested.
+ */
+OFC_CORE_LIB OFC_UCHAR *
+ofc_buffer_alloc(OFC_SIZET size);
+/**
+ * Take another reference to a buffer
+ *
+ * \param buffer
+ * Buffer returned by \ref ofc_buffer_alloc
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_buffer_ref(OFC_UCHAR *buffer);
+/**
+ * Test whether a buffer has more than one reference
+ *
+ * \param buffer
+ * Buffer returned by \ref ofc_buffer_alloc
+ *
+ * \returns
+ * OFC_TRUE if another holder may see changes to the buffer
+ */
+OFC_CORE_LIB OFC_BOOL
+ofc_buffer_shared(OFC_UCHAR *buffer);
+/**
+ * Release a reference to a buffer
+ *
+ * When the last reference is released the buffer returns to its pool,
+ * or to the heap if the pool is full.
+ *
+ * \param buffer
+ * Buffer returned by \ref ofc_buffer_alloc
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_buffer_release(OFC_UCHAR *buffer);
+/**
+ * Get the usable size of a buffer
+ *
+ * \param buffer
+ * Buffer returned by \ref ofc_buffer_alloc
+ *
+ * \returns
+ * Number of bytes in the buffer
+ */
+OFC_CORE_LIB OFC_SIZET
+ofc_buffer_size(OFC_UCHAR *buffer);
+/**
+ * Return all free pooled buffers to the heap
+ *
+ * Buffers still referenced are not affected.
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_buffer_pool_flush(OFC_VOID);
+/**
+ * Print the hit and miss counts of each class
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_buffer_pool_dump_stats(OFC_VOID);
+
+#if defined(__cplusplus)
+}
+#endif
+/** \} */
+#endif
@@ -0,0 +1,218 @@
+/* Copyright (c) 2021 Connected Way, LLC. All rights reserved.
+ * Use of this source code is governed by a Creative Commons
+ * Attribution-NoDerivatives 4.0 International license that can be
+ * found in the LICENSE file.
+ */
+#if !defined(__OFC_BYTEORDER_H__)
+#define __OFC_BYTEORDER_H__
+
+#include "ofc/core.h"
+#include "ofc/types.h"
+
+/**
+ * \{
+ * \defgroup byteorder Open Files Unaligned Byte Order Access
+ *
+ * Inline loads and stores of big and little endian integers at any
+ * alignment.  With a GCC compatible compiler each access is a single
+ * unaligned move plus, when the wire order differs from the host order,
+ * a byte swap instruction.  Other compilers get a portable byte at a
+ * time version.
+ *
+ * These are the building blocks for encoding protocol headers directly
+ * into a window returned by \ref ofc_message_window.
+ *
+ * Function | Description
+ * ---------|-------------
+ * \ref ofc_load_be16 | Load a big endian 16 bit value
+ * \ref ofc_load_le16 | Load a little endian 16 bit value
+ * \ref ofc_store_be16 | Store a big endian 16 bit value
+ * \ref ofc_store_le16 | Store a little endian 16 bit value
+ *
+ * along with the matching 32 and 64 bit variants.
+ */
+
+#if defined(__GNUC__) || defined(__clang__)
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define OFC_HOST_BIG_ENDIAN
+#endif
+#define OFC_BSWAP16(v) __builtin_bswap16(v)
+#define OFC_BSWAP32(v) __builtin_bswap32(v)
+#define OFC_BSWAP64(v) __builtin_bswap64(v)
+#define OFC_UNALIGNED_COPY(d, s, n) __builtin_memcpy((d), (s), (n))
+#else
+#define OFC_BSWAP16(v) ((OFC_UINT16) ((((v) >> 8) & 0xFF) | ((v) << 8)))
+#define OFC_BSWAP32(v) \
+  ((((v) >> 24) & 0xFF) | (((v) >> 8) & 0xFF00) | \
+   (((v) & 0xFF00) << 8) | ((v) << 24))
+#define OFC_BSWAP64(v) \
+  (((OFC_UINT64) OFC_BSWAP32((OFC_UINT32) (v)) << 32) | \
+   OFC_BSWAP32((OFC_UINT32) ((v) >> 32)))
+
+static __inline OFC_VOID
+ofc_unaligned_copy(OFC_VOID *dst, const OFC_VOID *src, OFC_SIZET len) {
+    OFC_UINT8 *d = (OFC_UINT8 *) dst;
+    const OFC_UINT8 *s = (const OFC_UINT8 *) src;
+
+    while (len--)
+        *d++ = *s++;
+}
+
+#define OFC_UNALIGNED_COPY(d, s, n) ofc_unaligned_copy((d), (s), (n))
+#endif
+
+/*
+ * Convert between host order and wire order.  Each is its own inverse.
+ */
+#if defined(OFC_HOST_BIG_ENDIAN)
+#define OFC_BE16(v) (v)
+#define OFC_BE32(v) (v)
+#define OFC_BE64(v) (v)
+#define OFC_LE16(v) OFC_BSWAP16(v)
+#define OFC_LE32(v) OFC_BSWAP32(v)
+#define OFC_LE64(v) OFC_BSWAP64(v)
+#else
+#define OFC_BE16(v) OFC_BSWAP16(v)
+#define OFC_BE32(v) OFC_BSWAP32(v)
+#define OFC_BE64(v) OFC_BSWAP64(v)
+#define OFC_LE16(v) (v)
+#define OFC_LE32(v) (v)
+#define OFC_LE64(v) (v)
+#endif
+
+/**
+ * Load a big endian 16 bit value
+ *
+ * \param p
+ * Pointer to the value.  Need not be aligned.
+ *
+ * \returns
+ * The value in host order
+ */
+static __inline OFC_UINT16
+ofc_load_be16(const OFC_VOID *p) {
+    OFC_UINT16 v;
+
+    OFC_UNALIGNED_COPY(&v, p, sizeof(v));
+    return (OFC_BE16(v));
+}
+
+/**
+ * Load a little endian 16 bit value
+ */
+static __inline OFC_UINT16
+ofc_load_le16(const OFC_VOID *p) {
+    OFC_UINT16 v;
+
+    OFC_UNALIGNED_COPY(&v, p, sizeof(v));
+    return (OFC_LE16(v));
+}
+
+/**
+ * Load a big endian 32 bit value
+ */
+static __inline OFC_UINT32
+ofc_load_be32(const OFC_VOID *p) {
+    OFC_UINT32 v;
+
+    OFC_UNALIGNED_COPY(&v, p, sizeof(v));
+    return (OFC_BE32(v));
+}
+
+/**
+ * Load a little endian 32 bit value
+ */
+static __inline OFC_UINT32
+ofc_load_le32(const OFC_VOID *p) {
+    OFC_UINT32 v;
+
+    OFC_UNALIGNED_COPY(&v, p, sizeof(v));
+    return (OFC_LE32(v));
+}
+
+/**
+ * Store a big endian 16 bit value
+ *
+ * \param p
+ * Where to store the value.  Need not be aligned.
+ *
+ * \param v
+ * Value in host order
+ */
+static __inline OFC_VOID
+ofc_store_be16(OFC_VOID *p, OFC_UINT16 v) {
+    v = OFC_BE16(v);
+    OFC_UNALIGNED_COPY(p, &v, sizeof(v));
+}
+
+/**
+ * Store a little endian 16 bit value
+ */
+static __inline OFC_VOID
+ofc_store_le16(OFC_VOID *p, OFC_UINT16 v) {
+    v = OFC_LE16(v);
+    OFC_UNALIGNED_COPY(p, &v, sizeof(v));
+}
+
+/**
+ * Store a big endian 32 bit value
+ */
+static __inline OFC_VOID
+ofc_store_be32(OFC_VOID *p, OFC_UINT32 v) {
+    v = OFC_BE32(v);
+    OFC_UNALIGNED_COPY(p, &v, sizeof(v));
+}
+
+/**
+ * Store a little endian 32 bit value
+ */
+static __inline OFC_VOID
+ofc_store_le32(OFC_VOID *p, OFC_UINT32 v) {
+    v = OFC_LE32(v);
+    OFC_UNALIGNED_COPY(p, &v, sizeof(v));
+}
+
+#if defined(OFC_64BIT_INTEGER)
+/**
+ * Load a big endian 64 bit value
+ */
+static __inline OFC_UINT64
+ofc_load_be64(const OFC_VOID *p) {
+    OFC_UINT64 v;
+
+    OFC_UNALIGNED_COPY(&v, p, sizeof(v));
+    return (OFC_BE64(v));
+}
+
+/**
+ * Load a little endian 64 bit value
+ */
+static __inline OFC_UINT64
+ofc_load_le64(const OFC_VOID *p) {
+    OFC_UINT64 v;
+
+    OFC_UNALIGNED_COPY(&v, p, sizeof(v));
+    return (OFC_LE64(v));
+}
+
+/**
+ * Store a big endian 64 bit value
+ */
+static __inline OFC_VOID
+ofc_store_be64(OFC_VOID *p, OFC_UINT64 v) {
+    v = OFC_BE64(v);
+    OFC_UNALIGNED_COPY(p, &v, sizeof(v));
+}
+
+/**
+ * Store a little endian 64 bit value
+ */
+static __inline OFC_VOID
+ofc_store_le64(OFC_VOID *p, OFC_UINT64 v) {
+    v = OFC_LE64(v);
+    OFC_UNALIGNED_COPY(p, &v, sizeof(v));
+}
+#endif
+
+/** \} */
+#endif
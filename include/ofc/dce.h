@@ -52,6 +52,29 @@
 #define DCE_HDR_AUTH_LENGTH 10
 #define DCE_HDR_CALL_ID 12
 #define DCE_HDR_SIZE 16
+/**
+ * DCE Bind Header
+ */
+#define DCE_BIND_XMIT_FRAG 0
+#define DCE_BIND_RECV_FRAG 2
+#define DCE_BIND_ASSOC_GROUP 4
+#define DCE_BIND_SIZE 8
+/**
+ * DCE Request Header
+ */
+#define DCE_REQ_ALLOC_HINT 0
+#define DCE_REQ_CONTEXT_ID 4
+#define DCE_REQ_OPNUM 6
+#define DCE_REQ_SIZE 8
+/**
+ * DCE Bind Ack Result
+ */
+#define DCE_RESULT_RESULT 0
+#define DCE_RESULT_REASON 2
+#define DCE_RESULT_UUID 4
+#define DCE_RESULT_VERSION 20
+#define DCE_RESULT_VERSION_MINOR 22
+#define DCE_RESULT_SIZE 24
 /**
  * DCE Versions
  */
@@ -11,6 +11,7 @@
 #include "ofc/config.h"
 #include "ofc/handle.h"
 #include "ofc/fstype.h"
+#include "ofc/message.h"
 
 /**
  * \{
@@ -90,6 +91,10 @@
  * \ref OfcSetFileInformationByHandle | Set File Attributes by Handle
  * \ref OfcSetFilePointer | Set File Pointer
  * \ref OfcWriteFile | Write File Buffer
+ * \ref OfcReadFileScatter | Read from a File into a List of Buffers
+ * \ref OfcWriteFileGather | Write to a File from a List of Buffers
+ * \ref OfcReadFileMessage | Read from a File into a Message
+ * \ref OfcWriteFileMessage | Write to a File from a Message
  * \ref OfcTransactNamedPipe | Perform Named Pipe Transaction
  * \ref OfcGetLastFileError | Get Last File Error on Handle
  * \ref OfcGetLastError | Get Last Error on Process
@@ -107,10 +112,49 @@
  * \ref OfcLockFileEx | Lock a file
  * \ref OfcFileGetOverlappedEvent | Get Event for Overlapped Handle
  * \ref OfcFileGetOverlappedWaitQ | Get WaitQ of Overlapped Handle
+ * \ref OfcFileGetDescriptor | Get Platform Descriptor of a Local File
+ * \ref OfcFileGetCacheStats | Get File Cache Statistics
  * \ref OfcDismountW | Dismount a share (Wide)
  * \ref OfcDismountA | Dismount a share (Normal)
  * \ref OfcDismount  | Dismount a share (Default)
  * \ref OfcDeviceIoControl | Issue ioctl
+ *
+ * When built with OFC_FILE_CACHE, synchronous reads and writes on a file
+ * are cached per handle, which saves round trips on remote and slow file
+ * systems:
+ *
+ * - A read that follows on from the last one starts read-ahead.  The
+ *   window doubles with each sequential read that misses, up to
+ *   OFC_FILE_CACHE_READ_MAX, and is dropped on a random read.
+ * - A write that follows on from the last one is held in a write-behind
+ *   buffer and coalesced with the writes after it.  The buffer is
+ *   written out when it fills, when the file is read, sought to the end,
+ *   truncated, locked or flushed, and when the handle is closed.  An
+ *   error writing it is returned from that call.
+ * - All handles share a budget of OFC_FILE_CACHE_BUDGET bytes.  A handle
+ *   that cannot get a buffer goes straight to the file system.
+ *
+ * Handles opened for overlapped I/O, with OFC_FILE_FLAG_NO_BUFFERING or
+ * OFC_FILE_FLAG_WRITE_THROUGH, or sharing write access are not cached,
+ * and neither are pipes, mailslots or browsers.
+ * OFC_FILE_FLAG_SEQUENTIAL_SCAN starts read-ahead on the first read and
+ * OFC_FILE_FLAG_RANDOM_ACCESS turns it off.  Hits, misses, bytes read
+ * ahead, writes coalesced and buffer flushes are counted, returned by
+ * \ref OfcFileGetCacheStats, and passed to the perf module when it is
+ * measuring.
+ *
+ * Metadata of names under a map for which \ref ofc_path_set_map_cacheW
+ * is enabled is kept for OFC_FILE_META_TTL milliseconds, keyed on the
+ * mapped name.  OfcGetFileAttributesEx, OfcFindFirstFile and
+ * OfcFindNextFile, and OfcGetFileInformationByHandleEx for the basic,
+ * standard, network open and attribute tag classes, are served from it.
+ * A name that was not found is remembered too.  A listing is kept once
+ * it has been read to the end, if it has no more than
+ * OFC_FILE_META_LISTING entries.  Creating, deleting, writing,
+ * truncating or setting the attributes of a file forgets the file and
+ * listings of its directory.  Moving a file or removing a directory
+ * forgets everything.  At most OFC_FILE_META_CACHE entries are kept.
+ * Lookups served and missed are counted like the file cache's.
  */
 
 /**
@@ -118,6 +162,64 @@
  */
 #define OFC_MAX_PATH 260
 
+#if !defined(OFC_FILE_IOVEC_MAX)
+/**
+ * Buffers of a message moved by one OfcReadFileMessage or
+ * OfcWriteFileMessage
+ */
+#define OFC_FILE_IOVEC_MAX 16
+#endif
+
+#if !defined(OFC_FILE_CACHE_BUDGET)
+/**
+ * Memory the read-ahead and write-behind buffers of all handles may use
+ */
+#define OFC_FILE_CACHE_BUDGET (8*1024*1024)
+#endif
+#if !defined(OFC_FILE_CACHE_READ_MIN)
+/**
+ * Read-ahead window when read-ahead starts
+ */
+#define OFC_FILE_CACHE_READ_MIN (64*1024)
+#endif
+#if !defined(OFC_FILE_CACHE_READ_MAX)
+/**
+ * Largest read-ahead window
+ */
+#define OFC_FILE_CACHE_READ_MAX (1024*1024)
+#endif
+#if !defined(OFC_FILE_CACHE_WRITE)
+/**
+ * Size of a handle's write-behind buffer
+ */
+#define OFC_FILE_CACHE_WRITE (256*1024)
+#endif
+
+#if !defined(OFC_FILE_META_CACHE)
+/**
+ * Names whose metadata is cached, 0 for none
+ */
+#define OFC_FILE_META_CACHE 128
+#endif
+#if !defined(OFC_FILE_META_TTL)
+/**
+ * Milliseconds cached metadata is used for
+ */
+#define OFC_FILE_META_TTL 2000
+#endif
+#if !defined(OFC_FILE_META_LISTING)
+/**
+ * Most entries in a directory listing that is cached
+ */
+#define OFC_FILE_META_LISTING 128
+#endif
+#if !defined(OFC_FILE_META_LISTINGS)
+/**
+ * Most directory listings cached at once
+ */
+#define OFC_FILE_META_LISTINGS 8
+#endif
+
 /**
  * \struct _OFC_FILETIME
  *
@@ -740,6 +842,7 @@ typedef struct _OFC_OVERLAPPED {
     OFC_BOOL status;
     OFC_HANDLE hFile;
     OFC_DWORD dwLen;
+    OFC_DWORD dwError;         /* Error of a failed I/O */
     OFC_OFFT offset;
     OFC_HANDLE hContext;
     OFC_HANDLE response_queue;
@@ -1501,6 +1604,19 @@ enum {
  */
 #define OFC_INVALID_SET_FILE_POINTER ((OFC_DWORD)-1)
 
+/**
+ * File cache statistics
+ */
+typedef struct {
+    OFC_ULONG hits;        /**< Reads satisfied from read-ahead */
+    OFC_ULONG misses;      /**< Reads that went to the file system */
+    OFC_ULONG read_ahead;  /**< Bytes read beyond what was asked for */
+    OFC_ULONG coalesced;   /**< Writes held in a write-behind buffer */
+    OFC_ULONG flushes;     /**< Write-behind buffers written out */
+    OFC_ULONG meta_hits;   /**< Metadata lookups served from the cache */
+    OFC_ULONG meta_misses; /**< Metadata lookups passed to the file system */
+} OFC_FILE_CACHE_STATS;
+
 /**
  * Error Codes that can be returned by File APIs
  */
@@ -2131,6 +2247,138 @@ OfcWriteFile(OFC_HANDLE hFile,
              OFC_DWORD nNumberOfBytesToWrite,
              OFC_LPDWORD lpNumberOfBytesWritten,
              OFC_HANDLE hOverlapped);
+/**
+ * Reads data from a file into a list of buffers
+ *
+ * The buffers are filled in order, as if by one OfcReadFile into a
+ * buffer as long as all of them.  The file system handler may do it in
+ * one call to the platform.  If it cannot, the read is done a buffer at
+ * a time, and an overlapped read is then only possible into a single
+ * buffer (OFC_ERROR_NOT_SUPPORTED otherwise).
+ *
+ * \param hFile
+ * A Handle to the file to be read
+ *
+ * \param iovec
+ * The buffers to fill.  The buffers must remain valid until an
+ * overlapped read completes.  The array need not.
+ *
+ * \param veclen
+ * Number of buffers
+ *
+ * \param lpNumberOfBytesRead
+ * A pointer to a variable to receive the number of bytes read
+ *
+ * \param hOverlapped
+ * Handle to the overlapped structure
+ *
+ * \returns
+ * OFC_FALSE if the function fails, OFC_TRUE otherwise
+ */
+OFC_CORE_LIB OFC_BOOL
+OfcReadFileScatter(OFC_HANDLE hFile,
+                   OFC_IOVEC *iovec,
+                   OFC_INT veclen,
+                   OFC_LPDWORD lpNumberOfBytesRead,
+                   OFC_HANDLE hOverlapped);
+/**
+ * Writes data to a file from a list of buffers
+ *
+ * The counterpart of \ref OfcReadFileScatter
+ *
+ * \param hFile
+ * Handle to the file
+ *
+ * \param iovec
+ * The buffers to write, in order
+ *
+ * \param veclen
+ * Number of buffers
+ *
+ * \param lpNumberOfBytesWritten
+ * A pointer to a variable to receive the number of bytes written
+ *
+ * \param hOverlapped
+ * Handle to the overlapped structure for asynchronous I/O
+ *
+ * \returns
+ * OFC_TRUE if success, OFC_FALSE if failed
+ */
+OFC_CORE_LIB OFC_BOOL
+OfcWriteFileGather(OFC_HANDLE hFile,
+                   OFC_IOVEC *iovec,
+                   OFC_INT veclen,
+                   OFC_LPDWORD lpNumberOfBytesWritten,
+                   OFC_HANDLE hOverlapped);
+/**
+ * Reads data from a file straight into a range of a message
+ *
+ * The range must already be backed by the message's buffers.  It is
+ * read in place with \ref OfcReadFileScatter.  A range spread over more
+ * than OFC_FILE_IOVEC_MAX buffers is read short, so check the count
+ * returned.
+ *
+ * \param hFile
+ * A Handle to the file to be read
+ *
+ * \param msg
+ * The message to read into
+ *
+ * \param offset
+ * Offset of the range, relative to the message base
+ *
+ * \param nNumberOfBytesToRead
+ * Length of the range
+ *
+ * \param lpNumberOfBytesRead
+ * A pointer to a variable to receive the number of bytes read
+ *
+ * \param hOverlapped
+ * Handle to the overlapped structure
+ *
+ * \returns
+ * OFC_FALSE if the function fails, OFC_TRUE otherwise
+ */
+OFC_CORE_LIB OFC_BOOL
+OfcReadFileMessage(OFC_HANDLE hFile,
+                   OFC_MESSAGE *msg,
+                   OFC_INT offset,
+                   OFC_DWORD nNumberOfBytesToRead,
+                   OFC_LPDWORD lpNumberOfBytesRead,
+                   OFC_HANDLE hOverlapped);
+/**
+ * Writes a range of a message straight to a file
+ *
+ * The counterpart of \ref OfcReadFileMessage
+ *
+ * \param hFile
+ * Handle to the file
+ *
+ * \param msg
+ * The message to write from
+ *
+ * \param offset
+ * Offset of the range, relative to the message base
+ *
+ * \param nNumberOfBytesToWrite
+ * Length of the range
+ *
+ * \param lpNumberOfBytesWritten
+ * A pointer to a variable to receive the number of bytes written
+ *
+ * \param hOverlapped
+ * Handle to the overlapped structure for asynchronous I/O
+ *
+ * \returns
+ * OFC_TRUE if success, OFC_FALSE if failed
+ */
+OFC_CORE_LIB OFC_BOOL
+OfcWriteFileMessage(OFC_HANDLE hFile,
+                    OFC_MESSAGE *msg,
+                    OFC_INT offset,
+                    OFC_DWORD nNumberOfBytesToWrite,
+                    OFC_LPDWORD lpNumberOfBytesWritten,
+                    OFC_HANDLE hOverlapped);
 /**
  * Perform a transaction on a named pipe
  *
@@ -2406,6 +2654,31 @@ OfcFileGetOverlappedEvent(OFC_HANDLE hOverlapped);
  */
 OFC_CORE_LIB OFC_HANDLE
 OfcFileGetOverlappedWaitQ(OFC_HANDLE hOverlapped);
+/**
+ * Get the platform descriptor of a local file
+ *
+ * Only file systems that keep one, such as the posix ones, return it.
+ * The descriptor belongs to the file and is closed with it.
+ *
+ * \param hFile
+ * The file
+ *
+ * \returns
+ * The descriptor, or -1 if the file has none
+ */
+OFC_CORE_LIB OFC_INT
+OfcFileGetDescriptor(OFC_HANDLE hFile);
+/**
+ * Get file cache statistics
+ *
+ * The counts are since the file module was initialized, and are zero
+ * for a cache the build leaves out.
+ *
+ * \param stats
+ * Structure to fill in
+ */
+OFC_CORE_LIB OFC_VOID
+OfcFileGetCacheStats(OFC_FILE_CACHE_STATS *stats);
 /**
  * Dismount an SMB client connection
  *
@@ -633,6 +633,83 @@ typedef struct {
                                 OFC_DWORD nOutBufferSize,
                                 OFC_LPDWORD lpBytesReturned,
                                 OFC_HANDLE hOverlapped);
+
+    /**
+     * Read from a file into a list of buffers
+     *
+     * Optional.  A handler that leaves this OFC_NULL has the read done
+     * with a ReadFile per buffer.  The buffers must stay valid until an
+     * overlapped read completes, but the array describing them need not,
+     * so a handler that reads asynchronously copies it.
+     *
+     * \param hFile
+     * Handle of file to read
+     *
+     * \param iovec
+     * The buffers to fill, in order
+     *
+     * \param veclen
+     * Number of buffers
+     *
+     * \param lpNumberOfBytesRead
+     * Where to return the number of bytes read
+     *
+     * \param hOverlapped
+     * Overlapped context, or OFC_HANDLE_NULL
+     *
+     * \returns
+     * OFC_TRUE if successful, OFC_FALSE otherwise
+     */
+    OFC_BOOL (*ReadFileScatter)(OFC_HANDLE hFile,
+                                OFC_IOVEC *iovec,
+                                OFC_INT veclen,
+                                OFC_LPDWORD lpNumberOfBytesRead,
+                                OFC_HANDLE hOverlapped);
+
+    /**
+     * Write to a file from a list of buffers
+     *
+     * Optional.  A handler that leaves this OFC_NULL has the write done
+     * with a WriteFile per buffer.  As with ReadFileScatter, only the
+     * buffers need to outlive the call.
+     *
+     * \param hFile
+     * Handle of file to write
+     *
+     * \param iovec
+     * The buffers to write, in order
+     *
+     * \param veclen
+     * Number of buffers
+     *
+     * \param lpNumberOfBytesWritten
+     * Where to return the number of bytes written
+     *
+     * \param hOverlapped
+     * Overlapped context, or OFC_HANDLE_NULL
+     *
+     * \returns
+     * OFC_TRUE if successful, OFC_FALSE otherwise
+     */
+    OFC_BOOL (*WriteFileGather)(OFC_HANDLE hFile,
+                                OFC_IOVEC *iovec,
+                                OFC_INT veclen,
+                                OFC_LPDWORD lpNumberOfBytesWritten,
+                                OFC_HANDLE hOverlapped);
+
+    /**
+     * Get the platform descriptor of a local file
+     *
+     * Optional.  Lets the core hand the file to the platform, for
+     * instance to send it on a socket without copying it.
+     *
+     * \param hFile
+     * Handle of the file
+     *
+     * \returns
+     * The descriptor, or -1 if the file has none
+     */
+    OFC_INT (*GetFileDescriptor)(OFC_HANDLE hFile);
 } OFC_FILE_FSINFO;
 
 #if defined(__cplusplus)
@@ -766,6 +843,22 @@ OFC_BOOL OfcFSReadFile(OFC_FST_TYPE fsType,
                        OFC_LPDWORD lpNumberOfBytesRead,
                        OFC_HANDLE hOverlapped);
 
+OFC_BOOL OfcFSReadFileScatter(OFC_FST_TYPE fsType,
+                              OFC_HANDLE hFile,
+                              OFC_IOVEC *iovec,
+                              OFC_INT veclen,
+                              OFC_LPDWORD lpNumberOfBytesRead,
+                              OFC_HANDLE hOverlapped);
+
+OFC_BOOL OfcFSWriteFileGather(OFC_FST_TYPE fsType,
+                              OFC_HANDLE hFile,
+                              OFC_IOVEC *iovec,
+                              OFC_INT veclen,
+                              OFC_LPDWORD lpNumberOfBytesWritten,
+                              OFC_HANDLE hOverlapped);
+
+OFC_INT OfcFSGetFileDescriptor(OFC_FST_TYPE fsType, OFC_HANDLE hFile);
+
 OFC_BOOL OfcFSTransactNamedPipe(OFC_FST_TYPE fsType,
                                 OFC_HANDLE hFile,
                                 OFC_LPVOID lpInBuffer,
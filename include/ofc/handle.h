@@ -39,6 +39,11 @@
 
 /**
  * The definition of the 32 bit handle
+ *
+ * A handle encodes an index into the handle table along with the
+ * generation of the table slot.  Once a handle has been destroyed and
+ * its last reference released, the handle no longer resolves, so
+ * locking a stale handle returns OFC_NULL rather than a reused context.
  */
 typedef OFC_DWORD_PTR OFC_HANDLE;
 /**
@@ -308,7 +313,7 @@ ofc_handle16_unlock(OFC_HANDLE16 hHandle);
    * \cond
    */
 OFC_CORE_LIB OFC_VOID ofc_handle_measure (OFC_HANDLE hHandle) ;
-OFC_CORE_LIB OFC_MSTIME ofc_handle_get_avg_interval (OFC_HANDLE hHandle,
+OFC_CORE_LIB OFC_NSTIME ofc_handle_get_avg_interval (OFC_HANDLE hHandle,
                             OFC_UINT32 *count,
                             OFC_HANDLE_TYPE *type) ;
 OFC_CORE_LIB OFC_VOID ofc_handle_print_interval_header (OFC_VOID) ;
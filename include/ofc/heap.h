@@ -8,6 +8,7 @@
 
 #include "ofc/core.h"
 #include "ofc/types.h"
+#include "ofc/atomic.h"
 
 /** 
  * \{
@@ -35,7 +36,81 @@
  * \ref ofc_heap_dump_stats | Dump Heap Statistics
  * \ref ofc_heap_dump | Dump info all all allocated chunks
  * \ref ofc_heap_snap | Mark currently allocated memory as valid
+ * \ref ofc_slab_alloc | Allocate an object from a slab cache
+ * \ref ofc_slab_free | Return an object to a slab cache
+ * \ref ofc_slab_flush | Return the calling thread's cached objects
+ * \ref ofc_heap_thread_exit | Release the calling thread's heap state
+ *
+ * Heap Accounting:
+ *
+ * Allocation statistics are kept per thread so that ofc_malloc and
+ * ofc_free do not serialize on a lock.  Each thread's byte count is
+ * folded into the global total in batches, and the remaining counters
+ * (allocation counts, a power of two size class histogram and the bytes
+ * outstanding per calling site) are merged when \ref ofc_heap_dump_stats
+ * is called.  Accounting is always enabled.
+ *
+ * Slab Caches:
+ *
+ * Small fixed size objects that are created and destroyed on the hot
+ * path (queue links, messages, iovec maps, timers, apps) are allocated
+ * from typed slab caches rather than from the general heap.  Each thread
+ * keeps a small magazine of free objects per cache so most allocations
+ * and frees touch no shared state.  Magazines are refilled from, and
+ * drained to, a global depot in batches.  The depot carves new objects
+ * out of large chunks obtained from \ref ofc_malloc.
+ *
+ * A cache is declared statically with \ref OFC_SLAB_INIT and registers
+ * itself on first use.  When the heap is built with OFC_HEAP_DEBUG (or
+ * OFC_SLAB_BYPASS is defined) the caches pass through to ofc_malloc so
+ * that leak tracing remains per object.
+ */
+
+/**
+ * Maximum number of slab caches
+ */
+#define OFC_SLAB_MAX 16
+/**
+ * Number of free objects each thread caches per slab
+ */
+#define OFC_SLAB_MAGAZINE 32
+/**
+ * Number of objects carved out of the heap at a time
+ */
+#define OFC_SLAB_CHUNK 128
+
+/**
+ * A Slab Cache
+ *
+ * Declare with \ref OFC_SLAB_INIT.  The fields are private to the heap.
+ */
+typedef struct _OFC_SLAB {
+    OFC_CCHAR *name;        /**< Name of the cache for statistics */
+    OFC_SIZET size;        /**< Size of each object */
+    volatile OFC_INT index;    /**< Registration index, -1 if not yet used */
+    OFC_SPINLOCK lock;        /**< Protects the depot and chunk list */
+    OFC_VOID *depot;        /**< List of free objects in the depot */
+    OFC_UINT32 depot_count;    /**< Number of objects in the depot */
+    OFC_VOID *chunks;        /**< List of chunks carved by this cache */
+    OFC_UINT32 epoch;        /**< Incremented when the cache is reset */
+    OFC_UINT32 objects;        /**< Number of objects carved */
+    OFC_UINT32 refills;        /**< Magazine refills from the depot */
+    OFC_UINT32 drains;        /**< Magazine drains to the depot */
+    volatile OFC_UINT32 bypass_allocs; /**< Allocations when bypassed */
+    volatile OFC_UINT32 bypass_frees; /**< Frees when bypassed */
+    struct _OFC_SLAB *next;    /**< Next registered cache */
+} OFC_SLAB;
+
+/**
+ * Static initializer for a slab cache
+ *
+ * \param name
+ * Name of the cache
+ *
+ * \param size
+ * Size of objects in the cache
  */
+#define OFC_SLAB_INIT(name, size) { (name), (size), -1 }
 
 #if defined(__cplusplus)
 extern "C"
@@ -134,7 +209,9 @@ ofc_realloc(OFC_LPVOID ptr, OFC_SIZET size);
  * Dump Heap Stats Usuage
  *
  * This will print to the console the number of bytes used as well as the
- * maximum number of bytes that had been used
+ * maximum number of bytes that had been used, the allocation size class
+ * histogram, the call sites holding the most memory and the slab cache
+ * statistics.
  */
 OFC_CORE_LIB OFC_VOID
 ofc_heap_dump_stats(OFC_VOID);
@@ -155,6 +232,43 @@ ofc_heap_dump(OFC_VOID);
  */
 OFC_CORE_LIB OFC_VOID
 ofc_heap_snap(OFC_VOID);
+/**
+ * Allocate an object from a slab cache
+ *
+ * \param slab
+ * The cache to allocate from
+ *
+ * \returns
+ * Pointer to the object.  The object is not initialized.
+ */
+OFC_CORE_LIB OFC_LPVOID
+ofc_slab_alloc(OFC_SLAB *slab);
+/**
+ * Return an object to a slab cache
+ *
+ * \param slab
+ * The cache the object was allocated from
+ *
+ * \param mem
+ * The object to free
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_slab_free(OFC_SLAB *slab, OFC_LPVOID mem);
+/**
+ * Return the calling thread's cached objects to the depots
+ *
+ * Called when a thread exits so its magazines are not stranded.
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_slab_flush(OFC_VOID);
+/**
+ * Release the calling thread's heap state
+ *
+ * Flushes the thread's slab magazines and releases its accounting slot
+ * for reuse.  Called when a thread exits.
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_heap_thread_exit(OFC_VOID);
 
 #if defined(__cplusplus)
 }
@@ -253,6 +253,74 @@ ofc_socket_impl_sendto(OFC_HANDLE hSocket, const OFC_VOID *buf,
                        const OFC_IPADDR *ip,
                        OFC_UINT16 port);
 
+#if defined(OFC_SOCKET_SENDV)
+/**
+ * Send a vector of buffers on a socket
+ *
+ * Similar to sendmsg() or writev().  The platform defines OFC_SOCKET_SENDV
+ * when it provides this call.  The core then sends every segment of a
+ * message with one call rather than one segment per call.  The core may
+ * reuse or free the buffers as soon as the call returns, so the platform
+ * must be done with them by then.  Asynchronous sends such as Linux's
+ * MSG_ZEROCOPY do not qualify.
+ *
+ * \param hSocket
+ * Socket to send data on
+ *
+ * \param iovec
+ * Array of buffers to send, in order
+ *
+ * \param veclen
+ * Number of entries in the array
+ *
+ * \param ip
+ * ip address to send data to, or OFC_NULL for a connected socket
+ *
+ * \param port
+ * port to send data to.  Ignored when ip is OFC_NULL.
+ *
+ * \returns
+ * Number of bytes sent, or -1 if error.  A datagram is sent whole or not
+ * at all.
+ */
+OFC_SIZET
+ofc_socket_impl_sendv(OFC_HANDLE hSocket, const OFC_IOVEC *iovec,
+                      OFC_INT veclen,
+                      const OFC_IPADDR *ip,
+                      OFC_UINT16 port);
+#endif
+
+#if defined(OFC_SOCKET_SENDFILE)
+/**
+ * Send part of a file on a stream socket
+ *
+ * Similar to sendfile() or splice().  The platform defines
+ * OFC_SOCKET_SENDFILE when it provides this call.  The core then sends
+ * a local file without reading it into a buffer first.
+ *
+ * Must not block, and must not move the file's position.
+ *
+ * \param hSocket
+ * Socket to send data on
+ *
+ * \param fd
+ * Platform descriptor of the file, from OfcFileGetDescriptor
+ *
+ * \param offset
+ * Offset in the file of the first byte to send
+ *
+ * \param len
+ * Most bytes to send
+ *
+ * \returns
+ * Number of bytes sent, 0 if the socket can take nothing now, or -1 if
+ * error.  Reaching the end of the file is an error.
+ */
+OFC_SIZET
+ofc_socket_impl_sendfile(OFC_HANDLE hSocket, OFC_INT fd, OFC_OFFT offset,
+                         OFC_SIZET len);
+#endif
+
 /**
  * Receive data from a socket
  *
@@ -275,6 +343,78 @@ ofc_socket_impl_recv(OFC_HANDLE hSocket,
                      OFC_VOID *buf,
                      OFC_SIZET len);
 
+#if defined(OFC_SOCKET_RECVV)
+/**
+ * Receive data from a socket into a vector of buffers
+ *
+ * Similar to recvmsg() or readv().  The platform defines OFC_SOCKET_RECVV
+ * when it provides this call.  The core then receives into every unfilled
+ * segment of a message at once.
+ *
+ * \param hSocket
+ * Socket to read data from
+ *
+ * \param iovec
+ * Buffers to fill, in order
+ *
+ * \param veclen
+ * Number of buffers
+ *
+ * \param ip
+ * Where to store the ip the data was received from, or OFC_NULL for a
+ * connected socket
+ *
+ * \param port
+ * Where to store the port the data was received from, or OFC_NULL
+ *
+ * \returns
+ * Number of bytes read, or -1 if error.
+ */
+OFC_SIZET
+ofc_socket_impl_recvv(OFC_HANDLE hSocket,
+                      OFC_IOVEC *iovec,
+                      OFC_INT veclen,
+                      OFC_IPADDR *ip,
+                      OFC_UINT16 *port);
+#endif
+
+#if defined(OFC_SOCKET_RECV_BATCH)
+/**
+ * One datagram of a batched receive
+ */
+typedef struct {
+  OFC_IOVEC *iovec;		/*!< Buffers to receive the datagram into */
+  OFC_INT veclen;		/*!< Number of buffers */
+  OFC_SIZET len;		/*!< Returned length of the datagram */
+  OFC_IPADDR ip;		/*!< Returned source address */
+  OFC_UINT16 port;		/*!< Returned source port */
+} OFC_SOCKET_DATAGRAM;
+
+/**
+ * Receive several datagrams with one call
+ *
+ * Similar to recvmmsg().  The platform defines OFC_SOCKET_RECV_BATCH when
+ * it provides this call.  The call must not block once at least one
+ * datagram has been received.
+ *
+ * \param hSocket
+ * Datagram socket to receive from
+ *
+ * \param dgrams
+ * Array of datagram descriptors.  Filled from the front.
+ *
+ * \param count
+ * Number of descriptors
+ *
+ * \returns
+ * Number of datagrams received, or -1 if error.
+ */
+OFC_INT
+ofc_socket_impl_recv_batch(OFC_HANDLE hSocket,
+                           OFC_SOCKET_DATAGRAM *dgrams,
+                           OFC_INT count);
+#endif
+
 /**
  * Receive data from a datagram socket
  *
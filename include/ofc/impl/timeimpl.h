@@ -33,6 +33,21 @@ extern "C"
  */
 OFC_MSTIME ofc_time_get_now_impl(OFC_VOID);
 
+#if defined(OFC_TIME_NS_IMPL)
+/**
+ * Return a monotonic nanosecond tick count
+ *
+ * Optional.  A platform defines OFC_TIME_NS_IMPL when it provides a
+ * clock better than the default.  Otherwise the core uses
+ * CLOCK_MONOTONIC where it exists and the millisecond tick count
+ * everywhere else.
+ *
+ * \returns
+ * A Nanosecond Tick Count
+ */
+OFC_NSTIME ofc_time_get_ns_impl(OFC_VOID);
+#endif
+
 /**
  * Get Time of Day in OFC_FILETIME format
  *
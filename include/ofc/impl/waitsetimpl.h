@@ -30,6 +30,16 @@ extern "C"
 /**
  * Wait on a Wait Set
  *
+ * Timers in the set need not be scanned.  The wait should be bounded by
+ * \ref ofc_waitset_next_timeout and the timers to report found with
+ * \ref ofc_waitset_expired.  Both are O(1) in the number of timers.
+ *
+ * Without OFC_SCHED_INCREMENTAL the events to wait on are the ones in
+ * the wait set's hHandleQueue.  With it, hHandleQueue is always empty
+ * and the platform waits on the events it has been given through
+ * \ref ofc_waitset_add_impl and not yet through
+ * \ref ofc_waitset_remove_impl.
+ *
  * \param handle
  * Implementation Specific Wait Set Handle
  *
@@ -38,6 +48,30 @@ extern "C"
  */
 OFC_HANDLE ofc_waitset_wait_impl(OFC_HANDLE handle);
 
+#if defined(OFC_WAITSET_WAIT_MANY)
+/**
+ * Wait on a Wait Set and return all ready members
+ *
+ * Only used when the platform defines OFC_WAITSET_WAIT_MANY.  A platform
+ * whose poll primitive reports several ready descriptors at once (epoll,
+ * kqueue, poll) should return all of them rather than one per call.
+ *
+ * \param handle
+ * Implementation Specific Wait Set Handle
+ *
+ * \param ready
+ * Array to receive the handles of the ready members
+ *
+ * \param max
+ * Number of entries in the ready array
+ *
+ * \returns
+ * Number of handles returned.  0 if woken by a wake call.
+ */
+OFC_INT ofc_waitset_wait_many_impl(OFC_HANDLE handle, OFC_HANDLE *ready,
+                                   OFC_INT max);
+#endif
+
 /**
  * Wake up a Wait Set on behalf of an event
  *
@@ -71,6 +105,10 @@ OFC_VOID ofc_waitset_wake_impl(OFC_HANDLE handle);
  * are specified as handles.  Multiple events can be added and a subsequent
  * wait will wait for any one of the events to be triggered.
  *
+ * pWaitSet->uring is already set.  If it is not OFC_NULL, the platform
+ * should include the descriptor from ofc_uring_fd in what it waits on
+ * so overlapped file I/O completing wakes the set.
+ *
  * \param pWaitSet
  * Pointer to wait set abstraction that is returned
  */
@@ -79,6 +117,11 @@ OFC_VOID ofc_waitset_create_impl(WAIT_SET *pWaitSet);
 /**
  * Destroy a wait set
  *
+ * Without OFC_SCHED_INCREMENTAL the platform may walk hHandleQueue to
+ * release what it holds for each event.  With it, hHandleQueue is empty
+ * and every event has already been passed to
+ * \ref ofc_waitset_remove_impl, so only the set's own state is left.
+ *
  * \param pWaitSet
  * Pointer to wait set context to destroy
  */
@@ -100,6 +143,31 @@ OFC_VOID
 ofc_waitset_add_impl(OFC_HANDLE handle, OFC_HANDLE hApp,
                      OFC_HANDLE hEvent);
 
+#if defined(OFC_SCHED_INCREMENTAL)
+/**
+ * Remove an event from the wait set
+ *
+ * Only used when built with OFC_SCHED_INCREMENTAL, and then every
+ * platform must provide it.  In that mode an event is passed to
+ * \ref ofc_waitset_add_impl once when interest in it starts and to this
+ * routine once when interest ends, rather than on every scheduler pass.
+ * The wait set keeps its members on a private list and hHandleQueue
+ * stays empty, so these two calls are the only record of membership
+ * the platform gets.  A platform can keep a persistent kernel poll set
+ * (epoll_ctl ADD and DEL on Linux) instead of rebuilding one inside
+ * \ref ofc_waitset_wait_impl.  A platform without one must still drop
+ * the event from what \ref ofc_waitset_wait_impl waits on.
+ *
+ * \param handle
+ * Handle to the wait set
+ *
+ * \param hEvent
+ * Handle to the event to remove
+ */
+OFC_VOID
+ofc_waitset_remove_impl(OFC_HANDLE handle, OFC_HANDLE hEvent);
+#endif
+
 #if defined(__cplusplus)
 }
 #endif
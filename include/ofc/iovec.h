@@ -23,6 +23,11 @@ typedef enum {
      * No content
      */
     IOVEC_ALLOC_NONE,
+    /**
+     * Content is in a reference counted pool buffer.  The reference is
+     * released when the map is destroyed.
+     */
+    IOVEC_ALLOC_POOL,
       
 } IOVEC_ALLOC_TYPE;
 
@@ -36,10 +41,13 @@ struct iovec_entry {
   IOVEC_ALLOC_TYPE type;
   OFC_UCHAR *data;
   OFC_SIZET length;
+  OFC_UCHAR *buffer;		/* Pool buffer holding data, if any */
 };
 
 struct iovec_list {
   OFC_UINT num_vecs;
+  OFC_UINT capacity;		/* Allocated vectors */
+  OFC_UINT cursor;		/* Vector of the last lookup */
   OFC_OFFT end_offset;
   struct iovec_entry *iovecs;
 };
@@ -52,6 +60,13 @@ extern "C"
   OFC_UCHAR * ofc_iovec_insert(OFC_IOMAP list, OFC_OFFT offset,
                                IOVEC_ALLOC_TYPE alloc_type,
                                OFC_UCHAR *data, OFC_SIZET length);
+  /*
+   * Insert length bytes of a pool buffer, starting skip bytes into it.
+   * The map takes its own reference to the buffer.
+   */
+  OFC_UCHAR * ofc_iovec_attach(OFC_IOMAP list, OFC_OFFT offset,
+                               OFC_UCHAR *buffer, OFC_SIZET skip,
+                               OFC_SIZET length);
   OFC_UCHAR * ofc_iovec_append(OFC_IOMAP list,
                                IOVEC_ALLOC_TYPE alloc_type,
                                OFC_UCHAR *data, OFC_SIZET length);
@@ -73,6 +88,17 @@ extern "C"
                          OFC_INT last_offset,
                          OFC_IOVEC **iovec,
                          OFC_INT *veclen);
+  /*
+   * Like ofc_iovec_get but fills a caller supplied array of at most max
+   * entries instead of allocating one.  Returns the number of entries
+   * filled.  If the range needs more than max entries, only the first
+   * max are described.
+   */
+  OFC_INT ofc_iovec_fill(OFC_IOMAP inp,
+                         OFC_OFFT offset,
+                         OFC_OFFT last_offset,
+                         OFC_IOVEC *iovec,
+                         OFC_INT max);
 
   OFC_VOID ofc_iovec_check(OFC_IOMAP list);
 #if defined(__cplusplus)
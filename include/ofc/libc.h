@@ -823,41 +823,114 @@ ofc_snprintf(OFC_CHAR *str, OFC_SIZET count, OFC_CCHAR *fmt, ...);
 OFC_CORE_LIB OFC_VOID
 ofc_printf(OFC_CCHAR *fmt, ...);
 
+/**
+ * Log a message
+ *
+ * \param level
+ * Criticality of the message
+ *
+ * \param fmt
+ * The format string
+ *
+ * \remark
+ * The message is queued for the log writer thread.  \see log.h
+ */
 OFC_CORE_LIB OFC_VOID
 ofc_log(OFC_LOG_LEVEL level, OFC_CCHAR *fmt, ...);
+/**
+ * \internal
+ * The least critical level logged.  Set with ofc_log_set_threshold.
+ */
+extern OFC_CORE_LIB volatile OFC_UINT ofc_log_threshold;
+/**
+ * Is a log level enabled
+ */
+#define OFC_LOG_ENABLED(level) ((OFC_UINT) (level) <= ofc_log_threshold)
+/*
+ * Check the level inline so a disabled message is never formatted
+ */
+#define ofc_log(level, ...) \
+  do { \
+    if (OFC_LOG_ENABLED(level)) \
+      (ofc_log)((level), __VA_ARGS__); \
+  } while (0)
 
 OFC_CORE_LIB OFC_CHAR *
 ofc_saprintf(OFC_CCHAR *fmt, ...);
+/*
+ * Binary Trace
+ *
+ * ofc_trace does not format anything.  Each thread owns a ring of
+ * OFC_TRACE_RECORDS fixed size records and appends the format string
+ * pointer, a timestamp and the raw arguments to it without taking a
+ * lock.  Formatting is deferred to ofc_dump_trace, which merges the
+ * rings of all threads in time order.  Tracing is cheap enough to leave
+ * on under load.  Define OFC_NO_TRACE to compile it out.
+ *
+ * The format string must be a literal, since only its address is kept.
+ * At most OFC_TRACE_ARGS arguments are recorded.  String arguments
+ * (%s, %S and %A) are copied, narrowed and truncated, into
+ * OFC_TRACE_TEXT bytes of the record shared by all of its strings.
+ * %n is ignored.
+ *
+ * Threads beyond OFC_TRACE_THREADS live at once are not traced.  Their
+ * records are counted as dropped.
+ */
+#if !defined(OFC_TRACE_RECORDS)
+#define OFC_TRACE_RECORDS 1024    /* Records per thread, a power of 2 */
+#endif
+#if !defined(OFC_TRACE_THREADS)
+#define OFC_TRACE_THREADS 64
+#endif
+#define OFC_TRACE_ARGS 8
+#define OFC_TRACE_TEXT 40
+
+#if !defined(OFC_NO_TRACE)
 /**
- * Perform formated output to a trace buffer
+ * Initialize the trace facility
+ *
+ * Called when the core is loaded
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_trace_init(OFC_VOID);
+/**
+ * Free the trace rings
+ *
+ * Called when the core is unloaded
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_trace_destroy(OFC_VOID);
+/**
+ * Release the calling thread's trace ring
+ *
+ * The ring's records are kept for ofc_dump_trace and the ring is reused
+ * by the next thread that traces.  Called when a thread exits.
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_trace_thread_exit(OFC_VOID);
+/**
+ * Record an event in the calling thread's trace ring
  *
  * \param fmt
- * The format string
+ * The format string.  Must be a literal.
  *
  * \remark
  * This call takes any number of arguments each related to the respective
  * format character in the format string. \see ofc_vsnprintf.  This
- * call is a lot like ofc_printf but the output goes to a trace buffer
- * instead.
+ * call is a lot like ofc_printf but the arguments are saved in a trace
+ * ring and formatted when the trace is dumped.
  */
-#if 0
+OFC_CORE_LIB OFC_VOID
+ofc_trace(OFC_CCHAR *fmt, ...);
 /**
- * Initialize the C Runtime Library
- *
- * The routine is called by the system startup code to initialize the
- * C runtime.  This should only be called from within ofc_init
+ * Format and print the trace records of all threads in time order
  */
 OFC_CORE_LIB OFC_VOID
-ofc_trace_init (OFC_VOID) ;
-OFC_CORE_LIB OFC_VOID
-ofc_trace_destroy (OFC_VOID);
-OFC_CORE_LIB OFC_VOID
-ofc_trace (OFC_CCHAR *fmt,...) ;
-OFC_CORE_LIB OFC_VOID
-ofc_dump_trace(OFC_VOID) ;
+ofc_dump_trace(OFC_VOID);
 #else
 #define ofc_trace_init()
 #define ofc_trace_destroy()
+#define ofc_trace_thread_exit()
 #define ofc_trace(fmt, ...)
 #define ofc_dump_trace()
 #endif
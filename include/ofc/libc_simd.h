@@ -0,0 +1,111 @@
+/* Copyright (c) 2021 Connected Way, LLC. All rights reserved.
+ * Use of this source code is governed by a Creative Commons
+ * Attribution-NoDerivatives 4.0 International license that can be
+ * found in the LICENSE file.
+ */
+#if !defined(__OFC_LIBC_SIMD_H__)
+#define __OFC_LIBC_SIMD_H__
+
+#include "ofc/core.h"
+#include "ofc/types.h"
+
+/**
+ * \{
+ * \defgroup libc_simd Open Files Vectorized String Primitives
+ *
+ * The string and memory primitives that sit on the path parsing and
+ * name compare paths are dispatched through a table of kernels.  The
+ * table is chosen once, when the core is loaded, from the best
+ * implementation the CPU supports:
+ *
+ * Implementation | Kernels
+ * ---------------|--------
+ * AVX2 | 32 byte memcmp, memcpy, strnlen and tstrlen, SSE2 for the rest
+ * SSE2 | 16 byte versions of every kernel
+ * NEON | 16 byte memcmp, memcpy, strnlen and tstrlen, scalar for the rest
+ * Scalar | The portable C loops
+ *
+ * Until the core is loaded, and on targets without vector support, the
+ * scalar kernels are used.  Define OFC_LIBC_NO_SIMD to build only the
+ * scalar kernels.
+ *
+ * The kernels never see a NULL pointer.  The public wrappers in libc.c
+ * handle NULL before dispatching.
+ *
+ * Function | Description
+ * ---------|-------------
+ * \ref ofc_libc_simd_init | Select the kernels for this CPU
+ * \ref ofc_libc_get_ops | Get a particular kernel table
+ */
+
+/**
+ * Kernel implementations
+ */
+typedef enum {
+    OFC_LIBC_SCALAR,
+    OFC_LIBC_SSE2,
+    OFC_LIBC_AVX2,
+    OFC_LIBC_NEON,
+    OFC_LIBC_IMPL_MAX
+} OFC_LIBC_IMPL;
+
+/**
+ * A table of string kernels
+ */
+typedef struct {
+    /** Name of the implementation */
+    OFC_CCHAR *name;
+    OFC_INT (*mem_compare)(OFC_LPCVOID a, OFC_LPCVOID b, OFC_SIZET size);
+    OFC_VOID (*mem_copy)(OFC_LPVOID out, OFC_LPCVOID in, OFC_SIZET size);
+    OFC_SIZET (*str_nlen)(OFC_CCHAR *str, OFC_SIZET len);
+    OFC_SIZET (*tstr_len)(OFC_LPCTSTR str);
+    OFC_INT (*tstr_casecmp)(OFC_LPCTSTR astr, OFC_LPCTSTR bstr);
+    OFC_VOID (*tstr_nupr)(OFC_TCHAR *str, OFC_SIZET len);
+    /** Narrow len wide characters.  Does not terminate dst */
+    OFC_VOID (*tstr_narrow)(OFC_CHAR *dst, OFC_LPCTSTR src, OFC_SIZET len);
+    /** Widen len characters.  Does not terminate dst */
+    OFC_VOID (*cstr_widen)(OFC_TCHAR *dst, OFC_CCHAR *src, OFC_SIZET len);
+} OFC_LIBC_OPS;
+
+/**
+ * \internal
+ * The portable kernels, defined in libc.c
+ */
+extern const OFC_LIBC_OPS ofc_libc_scalar_ops;
+/**
+ * \internal
+ * The kernels in use
+ */
+extern const OFC_LIBC_OPS *ofc_libc_active;
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+/**
+ * Select the best kernels for this CPU
+ *
+ * Called when the core is loaded.  Safe to call more than once.
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_libc_simd_init(OFC_VOID);
+/**
+ * Get a kernel table
+ *
+ * Used to compare implementations against each other.
+ *
+ * \param impl
+ * Implementation wanted
+ *
+ * \returns
+ * The table, or OFC_NULL if the implementation is not built in or not
+ * supported by this CPU
+ */
+OFC_CORE_LIB const OFC_LIBC_OPS *
+ofc_libc_get_ops(OFC_LIBC_IMPL impl);
+
+#if defined(__cplusplus)
+}
+#endif
+/** \} */
+#endif
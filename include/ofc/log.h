@@ -0,0 +1,121 @@
+/* Copyright (c) 2021 Connected Way, LLC. All rights reserved.
+ * Use of this source code is governed by a Creative Commons
+ * Attribution-NoDerivatives 4.0 International license that can be
+ * found in the LICENSE file.
+ */
+#if !defined(__OFC_LOG_H__)
+#define __OFC_LOG_H__
+
+#include "ofc/core.h"
+#include "ofc/types.h"
+
+/**
+ * \{
+ * \defgroup log Open Files Asynchronous Logging
+ *
+ * ofc_log does not write on the calling thread.  The message is
+ * formatted straight into a slot of a bounded multi producer queue and
+ * a dedicated writer thread passes it to ofc_write_log and, if console
+ * logging is on, to ofc_write_stdout.  A scheduler that logs never
+ * blocks on console or syslog I/O.
+ *
+ * - When the queue is full the message is dropped and counted.
+ * - Each call site, identified by its format string, may log at most
+ *   OFC_LOG_RATE messages a second.  The excess is counted and a
+ *   summary is logged when the site is next allowed through.
+ * - Fatal messages skip the rate limit and are written synchronously so
+ *   they are not lost if the process goes down.
+ * - Messages are truncated to OFC_LOG_LINE bytes.
+ *
+ * Until the core is loaded, and when built with OFC_LOG_SYNC, messages
+ * are written synchronously.
+ *
+ * The level check is inline in the ofc_log macro, so a message above
+ * the configured level costs a compare and no formatting.
+ *
+ * Function | Description
+ * ---------|-------------
+ * \ref ofc_log_init | Start the writer thread
+ * \ref ofc_log_destroy | Write what is queued and stop the writer thread
+ * \ref ofc_log_flush | Wait for the queued messages to be written
+ * \ref ofc_log_set_threshold | Set the level below which messages are kept
+ * \ref ofc_log_get_stats | Get the logger's counters
+ * \ref ofc_log_dump_stats | Print the logger's counters
+ */
+
+#if !defined(OFC_LOG_QUEUE)
+#define OFC_LOG_QUEUE 256        /* Queued messages, a power of 2 */
+#endif
+#if !defined(OFC_LOG_LINE)
+#define OFC_LOG_LINE 256
+#endif
+#if !defined(OFC_LOG_RATE)
+#define OFC_LOG_RATE 20          /* Messages per second per call site */
+#endif
+#if !defined(OFC_LOG_SITES)
+#define OFC_LOG_SITES 64         /* Call sites rate limited, a power of 2 */
+#endif
+
+/**
+ * Logger counters
+ */
+typedef struct {
+    OFC_UINT32 queued;        /**< Messages queued for the writer */
+    OFC_UINT32 written;        /**< Messages written */
+    OFC_UINT32 dropped;        /**< Messages lost to a full queue */
+    OFC_UINT32 suppressed;    /**< Messages over a call site's rate */
+} OFC_LOG_STATS;
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+/**
+ * Start the writer thread
+ *
+ * Called when the core is loaded
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_log_init(OFC_VOID);
+/**
+ * Write what is queued and stop the writer thread
+ *
+ * Called when the core is unloaded.  Messages logged afterwards are
+ * written synchronously.
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_log_destroy(OFC_VOID);
+/**
+ * Wait until every message queued so far has been written
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_log_flush(OFC_VOID);
+/**
+ * Set the least critical level that is logged
+ *
+ * Called by the configuration whenever the log level changes.
+ *
+ * \param level
+ * Messages with a level above this are discarded by the ofc_log macro
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_log_set_threshold(OFC_UINT level);
+/**
+ * Get the logger's counters
+ *
+ * \param stats
+ * Where to return the counters
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_log_get_stats(OFC_LOG_STATS *stats);
+/**
+ * Print the logger's counters to the console
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_log_dump_stats(OFC_VOID);
+
+#if defined(__cplusplus)
+}
+#endif
+/** \} */
+#endif
@@ -11,6 +11,7 @@
 #include "ofc/config.h"
 #include "ofc/net.h"
 #include "ofc/iovec.h"
+#include "ofc/byteorder.h"
 
 /**
  * \defgroup message Open Files Message Handling Facility
@@ -234,6 +235,31 @@ ofc_datagram_create(MSG_ALLOC_TYPE msgType,
                     OFC_CHAR *msgData,
                     OFC_IPADDR *ip,
                     OFC_UINT16 port);
+/**
+ * Creates a message made of a header segment and a payload segment
+ *
+ * A receive into the message scatters the first header_len bytes into a
+ * small heap buffer and the rest directly into the payload buffer, so a
+ * protocol can receive bulk data into a buffer of its choosing (for
+ * instance a page aligned one) without copying it out of the header.
+ *
+ * \param header_len
+ * Length of the header segment
+ *
+ * \param payload_len
+ * Length of the payload segment
+ *
+ * \param payload
+ * Payload buffer owned by the caller, or OFC_NULL to allocate one from
+ * the heap along with the message
+ *
+ * \returns
+ * Pointer to message header
+ */
+OFC_CORE_LIB OFC_MESSAGE *
+ofc_message_create_scatter(OFC_SIZET header_len,
+                           OFC_SIZET payload_len,
+                           OFC_VOID *payload);
 /**
  * Destroy a message
  *
@@ -292,6 +318,40 @@ ofc_message_get_pointer(OFC_MESSAGE *msg, OFC_INT offset);
 OFC_CORE_LIB OFC_VOID *
 ofc_message_get_pointer_length(OFC_MESSAGE *msg, OFC_INT offset,
                                OFC_SIZET len);
+/**
+ * Resolve a contiguous window of a message
+ *
+ * The window is looked up once.  Fields inside it can then be encoded
+ * or decoded directly with the \ref byteorder accessors rather than
+ * through one ofc_message_put or ofc_message_get call per field.  For
+ * instance a header can be written as:
+ *
+ * \code
+ * OFC_UCHAR *hdr = ofc_message_window(msg, 0, HDR_SIZE);
+ * if (hdr != OFC_NULL)
+ *   {
+ *     ofc_store_le16(hdr + HDR_FLAGS, flags);
+ *     ofc_store_le32(hdr + HDR_LENGTH, length);
+ *   }
+ * \endcode
+ *
+ * \param msg
+ * Message to get the window into
+ *
+ * \param offset
+ * Offset of the window, relative to the message base
+ *
+ * \param len
+ * Number of bytes in the window
+ *
+ * \returns
+ * Pointer to the window, or OFC_NULL if the range is outside the message
+ * or spans more than one segment.
+ */
+static __inline OFC_UCHAR *
+ofc_message_window(OFC_MESSAGE *msg, OFC_INT offset, OFC_SIZET len) {
+    return (ofc_iovec_lookup(msg->map, offset + msg->base, len));
+}
 /**
  * Return the offset of the current byte pointer
  *
@@ -1338,6 +1398,31 @@ OFC_VOID ofc_message_put_indirect(OFC_MESSAGE *msg,
                                   OFC_INT offset,
                                   OFC_VOID *buffer,
                                   OFC_SIZET size);
+/**
+ * Attach part of a pool buffer to a message without copying
+ *
+ * The message takes its own reference to the buffer, so the caller may
+ * release its reference as soon as this returns.  The buffer goes back
+ * to the pool when the last message referencing it is destroyed.
+ *
+ * \param msg
+ * Message to attach the buffer to
+ *
+ * \param offset
+ * Offset in the message to insert the data at
+ *
+ * \param buffer
+ * Buffer returned by \ref ofc_buffer_alloc
+ *
+ * \param skip
+ * Offset of the data within the buffer
+ *
+ * \param size
+ * Number of bytes to attach
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_message_attach(OFC_MESSAGE *msg, OFC_INT offset,
+                   OFC_UCHAR *buffer, OFC_SIZET skip, OFC_SIZET size);
 OFC_VOID ofc_message_get_map(OFC_MESSAGE *msg,
                              OFC_SIZET total,
                              OFC_IOVEC **iovec,
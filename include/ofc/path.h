@@ -111,8 +111,23 @@ SHARES:\\server
  * \ref ofc_path_map_deviceA | Return Map for a device (normal)
  * \ref ofc_path_map_device | Return Map for a device (default)
  * \ref ofc_path_is_wild | Is the path a wildcard path
+ * \ref ofc_path_lookupW | Map a path through the cache (wide)
+ * \ref ofc_path_get_cache_stats | Get the map cache counters
+ * \ref ofc_path_set_map_cacheW | Cache file metadata under a map (wide)
+ * \ref ofc_path_set_map_cacheA | Cache file metadata under a map (normal)
+ * \ref ofc_path_set_map_cache | Cache file metadata under a map (default)
+ *
+ * Device maps are found through a case folded hash of the device name.
+ * The results of ofc_path_mapW are kept in a least recently used cache
+ * of OFC_PATH_CACHE names so a name that is opened or queried over and
+ * over is not parsed and printed each time.  The cache is flushed
+ * whenever a map is added or deleted or its credentials change.
  */
 
+#if !defined(OFC_PATH_CACHE)
+#define OFC_PATH_CACHE 64        /* Mapped names cached, 0 for none */
+#endif
+
 /**
  * The Internal Represenation of a Path
  *
@@ -354,6 +369,43 @@ ofc_path_mapW(OFC_LPCTSTR lpFileName, OFC_LPTSTR *lppMappedName,
 OFC_CORE_LIB OFC_VOID
 ofc_path_mapA(OFC_LPCSTR lpFileName, OFC_LPSTR *lppMappedName,
               OFC_FST_TYPE *filesystem);
+/**
+ * Map a local path to a target path and say whether it is remote
+ *
+ * The same as ofc_path_mapW.  A remote target may name a workgroup,
+ * server or share to browse, which only the parsed path can tell.
+ *
+ * \param lpFileName
+ * The local path
+ *
+ * \param lppMappedName
+ * The target path.  Free with ofc_free.
+ *
+ * \param filesystem
+ * file system type
+ *
+ * \param remote
+ * Set if the target path is a remote path
+ *
+ * \param meta_cache
+ * Set if the target's metadata may be cached, because the name was
+ * mapped through a map with \ref ofc_path_set_map_cacheW enabled
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_path_lookupW(OFC_LPCTSTR lpFileName, OFC_LPTSTR *lppMappedName,
+                 OFC_FST_TYPE *filesystem, OFC_BOOL *remote,
+                 OFC_BOOL *meta_cache);
+/**
+ * Get the map cache counters
+ *
+ * \param hits
+ * Lookups served from the cache
+ *
+ * \param misses
+ * Lookups that parsed the name
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_path_get_cache_stats(OFC_UINT32 *hits, OFC_UINT32 *misses);
 
 #if 0
 /**
@@ -391,6 +443,31 @@ ofc_path_delete_mapW(OFC_LPCTSTR lpVirtual);
    */
 OFC_CORE_LIB OFC_VOID
 ofc_path_delete_mapA(OFC_LPCSTR lpVirtual);
+/**
+ * Enable or disable caching of file metadata under a map
+ *
+ * Attributes, file information and directory listings of names mapped
+ * through the device are kept for OFC_FILE_META_TTL milliseconds.
+ * Changes made through this process are seen at once.  Changes made by
+ * others may not be seen until the entry expires.  Off when the map is
+ * added.
+ *
+ * \param lpDevice
+ * The device of the map
+ *
+ * \param enable
+ * OFC_TRUE to cache, OFC_FALSE not to
+ *
+ * \returns
+ * OFC_TRUE if the map exists, OFC_FALSE otherwise
+ */
+OFC_CORE_LIB OFC_BOOL
+ofc_path_set_map_cacheW(OFC_LPCTSTR lpDevice, OFC_BOOL enable);
+  /**
+   * \see ofc_path_set_map_cacheW
+   */
+OFC_CORE_LIB OFC_BOOL
+ofc_path_set_map_cacheA(OFC_LPCSTR lpDevice, OFC_BOOL enable);
 /**
  * Find a map for a path
  *
@@ -479,6 +556,10 @@ OFC_CORE_LIB OFC_BOOL ofc_path_remote(OFC_PATH *path);
   /**
    * \private
    */
+OFC_CORE_LIB OFC_BOOL ofc_path_meta_cache(OFC_PATH *path);
+  /**
+   * \private
+   */
 OFC_CORE_LIB OFC_BOOL ofc_path_hidden(OFC_PATH *path);
 
   /**
@@ -774,6 +855,13 @@ OFC_CORE_LIB OFC_BOOL lookup_workgroup(OFC_LPCTSTR workgroup);
  * \see ofc_path_map_deviceA
  */
 #define ofc_path_map_device ofc_path_map_deviceW
+/**
+ * Cache file metadata under a map
+ *
+ * \see ofc_path_set_map_cacheW
+ * \see ofc_path_set_map_cacheA
+ */
+#define ofc_path_set_map_cache ofc_path_set_map_cacheW
 /**
  * Update a path with credentials
  *
@@ -828,6 +916,13 @@ OFC_CORE_LIB OFC_BOOL lookup_workgroup(OFC_LPCTSTR workgroup);
  * \see ofc_path_map_deviceA
  */
 #define ofc_path_map_device ofc_path_map_deviceA
+/**
+ * Cache file metadata under a map
+ *
+ * \see ofc_path_set_map_cacheW
+ * \see ofc_path_set_map_cacheA
+ */
+#define ofc_path_set_map_cache ofc_path_set_map_cacheA
 /**
  * Update a path with credentials
  *
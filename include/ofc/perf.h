@@ -10,17 +10,20 @@
 #include "ofc/types.h"
 #include "ofc/handle.h"
 #include "ofc/lock.h"
+#include "ofc/queue.h"
 
 /** \{ */
 
 struct perf_measurement {
-  OFC_MSTIME start_stamp;
-  OFC_MSTIME stop_stamp;
+  OFC_NSTIME start_stamp;
+  OFC_NSTIME stop_stamp;
   OFC_BOOL stop;
   OFC_INT nqueues;
   OFC_INT nrts;
-  OFC_HANDLE queues;
-  OFC_HANDLE rts;
+  OFC_INT ncounters;
+  OFC_IQUEUE queues;
+  OFC_IQUEUE rts;
+  OFC_IQUEUE counters;
   OFC_HANDLE notify;
   OFC_HANDLE hThread;
   OFC_UINT instance;
@@ -28,7 +31,7 @@ struct perf_measurement {
 } ;
   
 struct perf_queue {
-  OFC_MSTIME basis;
+  OFC_NSTIME basis;
   OFC_ULONG num_requests;
   OFC_ULONG total_byte_count;
   OFC_UINT depth ;
@@ -37,6 +40,7 @@ struct perf_queue {
   OFC_CTCHAR *description;
   OFC_INT instance;
   OFC_LOCK lock;
+  OFC_IQUEUE_LINK link;
 };
 
 struct perf_rt {
@@ -44,6 +48,17 @@ struct perf_rt {
   OFC_INT instance;
   OFC_MSTIME total;
   OFC_MSTIME start;
+  OFC_IQUEUE_LINK link;
+};
+
+/*
+ * An event count, such as cache hits.  Bumped without a lock.
+ */
+struct perf_counter {
+  OFC_CTCHAR *description;
+  OFC_INT instance;
+  volatile OFC_ULONG count;
+  OFC_IQUEUE_LINK link;
 };
 
 struct perf_statistics {
@@ -55,9 +70,9 @@ struct perf_statistics {
   OFC_LONG avg_packet_size;
   OFC_LONG request_throughput;
   OFC_LONG average_depth_x1000;
-  OFC_LONG basis;
+  OFC_LONG basis;		/* us */
   OFC_LONG depth_samples;
-  OFC_LONG lead_x1000;
+  OFC_LONG lead_x1000;		/* us */
   OFC_LONG total_depth;
 };
 
@@ -104,6 +119,15 @@ extern "C"
   OFC_VOID perf_rt_reset(struct perf_rt *rt);
   OFC_VOID perf_rt_start(struct perf_rt *rt);
   OFC_VOID perf_rt_stop(struct perf_rt *rt);
+  struct perf_counter *
+  perf_counter_create (struct perf_measurement *measurement,
+		       OFC_CTCHAR *description,
+		       OFC_INT instance);
+  OFC_VOID perf_counter_destroy(struct perf_measurement *measurement,
+				struct perf_counter *counter);
+  OFC_VOID perf_counter_reset(struct perf_counter *counter);
+  OFC_VOID perf_counter_add(struct perf_counter *counter, OFC_ULONG count);
+  OFC_ULONG perf_counter_get(struct perf_counter *counter);
   struct perf_queue *
   perf_queue_create (struct perf_measurement *measurement,
 		     OFC_CTCHAR *description,
@@ -27,7 +27,70 @@
  * \ref ofc_queue_next | Return the next element after an element
  * \ref ofc_queue_unlink | Remove an element from within the queue
  * \ref ofc_queue_clear | Remove all elements from the queue
+ *
+ * Intrusive Queues:
+ *
+ * The queues above allocate a link for every element and search the
+ * queue on every enqueue, unlink and next.  For hot lists whose
+ * elements are structures owned by the caller, an intrusive queue can
+ * be used instead.  The element embeds an \ref OFC_IQUEUE_LINK and the
+ * queue head is an \ref OFC_IQUEUE embedded in the owner.  All
+ * operations are constant time and nothing is allocated.  Like the
+ * handle based queues, intrusive queues are not locked.
+ *
+ * When built with OFC_QUEUE_DEBUG, enqueue and unlink verify that the
+ * link is not, or is, on the queue.
+ *
+ * Function | Description
+ * ---------|-------------
+ * \ref ofc_iqueue_init | Initialize an intrusive queue
+ * \ref ofc_iqueue_link_init | Initialize an intrusive link
+ * \ref ofc_iqueue_enqueue | Enqueue a link to the end of a queue
+ * \ref ofc_iqueue_dequeue | Dequeue a link from the head of a queue
+ * \ref ofc_iqueue_empty | Test if an intrusive queue is empty
+ * \ref ofc_iqueue_first | Return the head of an intrusive queue
+ * \ref ofc_iqueue_next | Return the link after a link
+ * \ref ofc_iqueue_unlink | Remove a link from within the queue
+ * \ref ofc_iqueue_linked | Test if a link is on a queue
+ * \ref OFC_IQUEUE_ENTRY | Get the element containing a link
+ */
+
+/**
+ * A link embedded in an element of an intrusive queue
+ *
+ * A link must be initialized with \ref ofc_iqueue_link_init (or zeroed)
+ * before it is first enqueued.  A link can be on one queue at a time.
+ */
+typedef struct _OFC_IQUEUE_LINK {
+    struct _OFC_IQUEUE_LINK *next;    /**< Next link or the head */
+    struct _OFC_IQUEUE_LINK *prev;    /**< Previous link or the head */
+} OFC_IQUEUE_LINK;
+
+/**
+ * The head of an intrusive queue
+ */
+typedef struct {
+    OFC_IQUEUE_LINK head;    /**< Sentinel link */
+} OFC_IQUEUE;
+
+/**
+ * Get the element containing an intrusive link
+ *
+ * \param link
+ * Pointer to the link
+ *
+ * \param type
+ * Type of the containing element
+ *
+ * \param member
+ * Name of the link member within the element
+ *
+ * \returns
+ * Pointer to the element or OFC_NULL if link is OFC_NULL
  */
+#define OFC_IQUEUE_ENTRY(link, type, member) \
+  ((type *) ofc_iqueue_entry((link), \
+                             (OFC_SIZET) &((type *) OFC_NULL)->member))
 
 #if defined(__cplusplus)
 extern "C"
@@ -133,6 +196,117 @@ ofc_queue_unlink(OFC_HANDLE qHead, OFC_VOID *qElement);
  */
 OFC_CORE_LIB OFC_VOID
 ofc_queue_clear(OFC_HANDLE qHandle);
+/**
+ * Initialize an intrusive queue
+ *
+ * \param queue
+ * Pointer to the queue head
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_iqueue_init(OFC_IQUEUE *queue);
+/**
+ * Initialize an intrusive link
+ *
+ * \param link
+ * Pointer to the link
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_iqueue_link_init(OFC_IQUEUE_LINK *link);
+/**
+ * Add a link to the end of an intrusive queue
+ *
+ * \param queue
+ * Pointer to the queue head
+ *
+ * \param link
+ * Pointer to the link to add.  It must not be on a queue.
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_iqueue_enqueue(OFC_IQUEUE *queue, OFC_IQUEUE_LINK *link);
+/**
+ * Remove the link at the front of an intrusive queue
+ *
+ * \param queue
+ * Pointer to the queue head
+ *
+ * \returns
+ * The link that was at the front or OFC_NULL
+ */
+OFC_CORE_LIB OFC_IQUEUE_LINK *
+ofc_iqueue_dequeue(OFC_IQUEUE *queue);
+/**
+ * See if an intrusive queue is empty
+ *
+ * \param queue
+ * Pointer to the queue head
+ *
+ * \returns
+ * OFC_TRUE if empty, OFC_FALSE otherwise
+ */
+OFC_CORE_LIB OFC_BOOL
+ofc_iqueue_empty(OFC_IQUEUE *queue);
+/**
+ * Return the link at the front of an intrusive queue
+ *
+ * \param queue
+ * Pointer to the queue head
+ *
+ * \returns
+ * The first link or OFC_NULL
+ */
+OFC_CORE_LIB OFC_IQUEUE_LINK *
+ofc_iqueue_first(OFC_IQUEUE *queue);
+/**
+ * Return the link following a link
+ *
+ * \param queue
+ * Pointer to the queue head
+ *
+ * \param link
+ * Pointer to the current link
+ *
+ * \returns
+ * The next link or OFC_NULL at the end of the queue
+ */
+OFC_CORE_LIB OFC_IQUEUE_LINK *
+ofc_iqueue_next(OFC_IQUEUE *queue, OFC_IQUEUE_LINK *link);
+/**
+ * Remove a link from an intrusive queue
+ *
+ * \param queue
+ * Pointer to the queue head
+ *
+ * \param link
+ * Pointer to the link to remove.  It must be on the queue.
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_iqueue_unlink(OFC_IQUEUE *queue, OFC_IQUEUE_LINK *link);
+/**
+ * See if a link is on a queue
+ *
+ * \param link
+ * Pointer to the link
+ *
+ * \returns
+ * OFC_TRUE if the link is on a queue
+ */
+OFC_CORE_LIB OFC_BOOL
+ofc_iqueue_linked(OFC_IQUEUE_LINK *link);
+/**
+ * \protected
+ * Return the element containing a link.  Use \ref OFC_IQUEUE_ENTRY.
+ *
+ * \param link
+ * Pointer to the link or OFC_NULL
+ *
+ * \param offset
+ * Offset of the link within the element
+ *
+ * \returns
+ * Pointer to the element or OFC_NULL
+ */
+OFC_CORE_LIB OFC_VOID *
+ofc_iqueue_entry(OFC_IQUEUE_LINK *link, OFC_SIZET offset);
 
 #if defined(__cplusplus)
 }
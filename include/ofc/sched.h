@@ -20,6 +20,13 @@
  *
  * There are two constructs to the scheduler.  The scheduler itself, and
  * the applications that are managed by the scheduler.
+ *
+ * A scheduler pool spreads applications over several scheduler threads.
+ * The pool handle is used wherever a scheduler handle is.  Each app is
+ * owned by exactly one worker at a time, so its preselect and postselect
+ * routines are never run concurrently.  A worker that is about to block
+ * asks the busiest worker for one of its apps, which is handed over
+ * between passes.
  */
 
 /** \{ */
@@ -36,6 +43,17 @@ extern "C"
  */
 OFC_CORE_LIB OFC_HANDLE
 ofc_sched_create(OFC_VOID);
+/**
+ * Create a pool of application schedulers
+ *
+ * \param num_workers
+ * Number of scheduler threads in the pool
+ *
+ * \returns
+ * Handle to the pool.  It can be passed anywhere a scheduler handle is.
+ */
+OFC_CORE_LIB OFC_HANDLE
+ofc_sched_pool_create(OFC_INT num_workers);
 /**
  * Cause a scheduler to quit
  *
@@ -101,6 +119,22 @@ ofc_sched_add(OFC_HANDLE scheduler, OFC_HANDLE hApp);
  */
 OFC_CORE_LIB OFC_VOID
 ofc_sched_significant_event(OFC_HANDLE scheduler);
+/**
+ * Trigger a significant event on behalf of one app
+ *
+ * When built with OFC_SCHED_INCREMENTAL, only the apps that signalled
+ * an event are run through preselect.  The events of all other apps stay
+ * registered with the wait set.  Otherwise this is the same as
+ * \ref ofc_sched_significant_event.
+ *
+ * \param scheduler
+ * Scheduler to signal
+ *
+ * \param hApp
+ * App that has a significant event
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_sched_app_event(OFC_HANDLE scheduler, OFC_HANDLE hApp);
 /**
  * Wake a scheduler
  *
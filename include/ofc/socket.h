@@ -31,6 +31,14 @@
 
 /** \{ */
 
+#if !defined(OFC_SOCKET_SENDFILE_CHUNK)
+/**
+ * Most bytes of a file sent by one call of \ref ofc_socket_sendfile,
+ * and the size of the buffer used when the file must be copied
+ */
+#define OFC_SOCKET_SENDFILE_CHUNK (64*1024)
+#endif
+
 /**
 * Socket Types Supported by Open Files.
 */
@@ -107,6 +115,20 @@ typedef enum {
     OFC_SOCKET_EVENT_WRITE = 0x40,
 } OFC_SOCKET_EVENT_TYPE;
 
+/**
+ * A part of a file being sent on a socket
+ */
+typedef struct {
+    OFC_HANDLE hFile;        /**< File being sent */
+    OFC_OFFT offset;        /**< Offset in the file of the next byte to send */
+    OFC_SIZET count;        /**< Bytes left to send */
+    OFC_BOOL failed;        /**< Transfer ended by an error */
+    OFC_INT fd;            /**< Platform descriptor of the file, or -1 */
+    OFC_CHAR *buffer;        /**< Buffer when the file is copied */
+    OFC_SIZET buffered;        /**< Bytes in the buffer */
+    OFC_SIZET sent;        /**< Bytes of the buffer already sent */
+} OFC_SENDFILE;
+
 #if defined(__cplusplus)
 extern "C"
 {
@@ -228,6 +250,59 @@ ofc_socket_destroy(OFC_HANDLE hSock);
  */
 OFC_CORE_LIB OFC_BOOL
 ofc_socket_write(OFC_HANDLE hSocket, OFC_MESSAGE *msg);
+/**
+ * Create a transfer of part of a file to a stream socket
+ *
+ * The transfer is made by calling \ref ofc_socket_sendfile each time the
+ * socket is writable, as a message is sent with ofc_socket_write.  When
+ * the platform can send the file directly (OFC_SOCKET_SENDFILE) and the
+ * file has a platform descriptor, the bytes go from the file to the
+ * socket without being copied through the core.  Otherwise the file is
+ * read a chunk at a time into a buffer of the transfer and sent from
+ * there.  That needs the file opened for synchronous reads.
+ *
+ * \param hFile
+ * The file to send.  It must stay open until the transfer is destroyed.
+ *
+ * \param offset
+ * Offset in the file of the first byte to send
+ *
+ * \param count
+ * Number of bytes to send
+ *
+ * \returns
+ * The transfer
+ */
+OFC_CORE_LIB OFC_SENDFILE *
+ofc_socket_sendfile_create(OFC_HANDLE hFile, OFC_OFFT offset,
+                           OFC_SIZET count);
+/**
+ * Send more of a file on a socket
+ *
+ * Sends what the socket will take without blocking, up to
+ * OFC_SOCKET_SENDFILE_CHUNK bytes.  The offset and count of the transfer
+ * are advanced past what was sent.  The transfer is complete when count
+ * reaches zero.  On an error count is set to zero and failed is set.
+ *
+ * \param hSocket
+ * Stream socket to send on
+ *
+ * \param xfer
+ * The transfer
+ *
+ * \returns
+ * True if we made progress on the transfer, false otherwise
+ */
+OFC_CORE_LIB OFC_BOOL
+ofc_socket_sendfile(OFC_HANDLE hSocket, OFC_SENDFILE *xfer);
+/**
+ * Destroy a file transfer
+ *
+ * \param xfer
+ * The transfer to destroy
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_socket_sendfile_destroy(OFC_SENDFILE *xfer);
 /**
  * Read Data from a socket
  *
@@ -246,6 +321,29 @@ ofc_socket_write(OFC_HANDLE hSocket, OFC_MESSAGE *msg);
  */
 OFC_CORE_LIB OFC_BOOL
 ofc_socket_read(OFC_HANDLE hSocket, OFC_MESSAGE *msg);
+/**
+ * Read several datagrams from a socket
+ *
+ * Each message receives at most one datagram.  Where the platform
+ * supports it (recvmmsg), all of them are received with one call.
+ * Otherwise the messages are read one at a time until the socket has no
+ * more data.
+ *
+ * \param hSocket
+ * Datagram socket to read data from
+ *
+ * \param msgs
+ * Array of messages to receive data into
+ *
+ * \param count
+ * Number of messages in the array
+ *
+ * \returns
+ * Number of messages, from the start of the array, that received a
+ * datagram, or -1 if the receive failed.  0 if no datagram was waiting.
+ */
+OFC_CORE_LIB OFC_INT
+ofc_socket_read_batch(OFC_HANDLE hSocket, OFC_MESSAGE **msgs, OFC_INT count);
 /**
  * Test if a socket is connected or not
  *
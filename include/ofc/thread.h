@@ -49,6 +49,7 @@
 #define OFC_THREAD_SCHED         "BLSKED"
 #define OFC_THREAD_SOCKET        "BLSOCK"
 #define OFC_THREAD_MEASUREMENT_PERF "OFPERF"
+#define OFC_THREAD_LOG           "OFLOG"
 
 /**
  * The detach states
@@ -21,6 +21,9 @@
  * \ref epoch_time_to_file_time | Convert epoch time to file time
  * \ref file_time_to_epoch_time | Convert a file time to epoch time
  * \ref ofc_time_get_now | Get current milliseconds since boot
+ * \ref ofc_time_get_ns | Get current monotonic nanoseconds
+ * \ref ofc_time_get_coarse_ns | Get the cached nanoseconds of this thread
+ * \ref ofc_time_update_coarse_ns | Refresh the cached nanoseconds
  * \ref ofc_time_get_file_time | Get time of day as a filetime
  * \ref ofc_time_get_time_zone | Get the timezone (minutes from UTC)
  * \ref ofc_file_time_to_dos_date_time | Convert filetime to a dos datetime.
@@ -30,6 +33,19 @@
  * \ref ofc_get_runtime | Get runtime of current process
  */
 
+/**
+ * Nanoseconds in a microsecond
+ */
+#define OFC_NS_PER_US 1000
+/**
+ * Nanoseconds in a millisecond
+ */
+#define OFC_NS_PER_MS (1000 * OFC_NS_PER_US)
+/**
+ * Nanoseconds in a second
+ */
+#define OFC_NS_PER_SEC (1000 * OFC_NS_PER_MS)
+
 /**
  * Definition for DOS Day Field in DOS Day Word
  */
@@ -136,6 +152,39 @@ OFC_VOID file_time_to_epoch_time(const OFC_FILETIME *filetime,
  */
 OFC_CORE_LIB OFC_MSTIME
 ofc_time_get_now(OFC_VOID);
+/**
+ * Get a monotonic nanosecond count
+ *
+ * The count has no defined origin and is only meaningful when compared
+ * with another value returned by this function or by the coarse
+ * variants.  It never goes backwards.
+ *
+ * \returns
+ * A Nanosecond Tick Count
+ */
+OFC_CORE_LIB OFC_NSTIME
+ofc_time_get_ns(OFC_VOID);
+/**
+ * Get the cached nanosecond count of the calling thread
+ *
+ * Reading the clock is cheap but not free.  Code on a hot path that can
+ * tolerate a timestamp as old as the current pass of its scheduler loop
+ * should use this instead of \ref ofc_time_get_ns.  The scheduler
+ * refreshes the cache once per loop and after every wait.
+ *
+ * \returns
+ * The nanosecond count at the last refresh
+ */
+OFC_CORE_LIB OFC_NSTIME
+ofc_time_get_coarse_ns(OFC_VOID);
+/**
+ * Refresh the cached nanosecond count of the calling thread
+ *
+ * \returns
+ * The refreshed nanosecond count
+ */
+OFC_CORE_LIB OFC_NSTIME
+ofc_time_update_coarse_ns(OFC_VOID);
 /**
  * Get Time of Day in OFC_FILETIME format
  *
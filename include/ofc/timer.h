@@ -63,6 +63,97 @@ ofc_timer_destroy(OFC_HANDLE hTimer);
 
 OFC_CORE_LIB OFC_CCHAR *ofc_timer_id(OFC_HANDLE hTimer);
 
+/**
+ * A timing wheel
+ *
+ * Each wait set keeps the timers that are members of it on a wheel.  The
+ * wheel finds the next expiry and the expired timers without looking at
+ * every timer.
+ */
+typedef struct ofc_timer_wheel OFC_TIMER_WHEEL;
+
+/**
+ * Create a timing wheel
+ *
+ * \returns
+ * Pointer to the wheel
+ */
+OFC_CORE_LIB OFC_TIMER_WHEEL *
+ofc_timer_wheel_create(OFC_VOID);
+/**
+ * Destroy a timing wheel
+ *
+ * Any timers still armed on the wheel are disarmed.  Timers associated
+ * with the wheel keep its memory until they are next set, canceled or
+ * destroyed, when they let go of it.
+ *
+ * \param wheel
+ * The wheel to destroy
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_timer_wheel_destroy(OFC_TIMER_WHEEL *wheel);
+/**
+ * Arm a timer on a wheel
+ *
+ * The timer stays associated with the wheel until canceled, and
+ * \ref ofc_timer_set rearms it.
+ *
+ * \param wheel
+ * The wheel
+ *
+ * \param hTimer
+ * The timer to arm at its current expiration time
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_timer_wheel_arm(OFC_TIMER_WHEEL *wheel, OFC_HANDLE hTimer);
+/**
+ * Remove a timer from a wheel
+ *
+ * \param wheel
+ * The wheel
+ *
+ * \param hTimer
+ * The timer to remove
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_timer_wheel_cancel(OFC_TIMER_WHEEL *wheel, OFC_HANDLE hTimer);
+/**
+ * Return the time until the next timer on a wheel may expire
+ *
+ * The result never exceeds the time to the earliest timer but may be
+ * shorter for timers far in the future.  Waking early is harmless.
+ *
+ * \param wheel
+ * The wheel
+ *
+ * \returns
+ * Milliseconds to wait, 0 if a timer has expired, or OFC_INFINITE if no
+ * timers are armed
+ */
+OFC_CORE_LIB OFC_MSTIME
+ofc_timer_wheel_next(OFC_TIMER_WHEEL *wheel);
+/**
+ * Collect the expired timers on a wheel
+ *
+ * Expired timers are disarmed but remain associated with the wheel.
+ *
+ * \param wheel
+ * The wheel
+ *
+ * \param expired
+ * Array to receive the handles of the expired timers
+ *
+ * \param max
+ * Size of the expired array.  Timers beyond this are returned by the
+ * next call.
+ *
+ * \returns
+ * Number of timers returned
+ */
+OFC_CORE_LIB OFC_INT
+ofc_timer_wheel_expire(OFC_TIMER_WHEEL *wheel, OFC_HANDLE *expired,
+                       OFC_INT max);
+
 #if defined(__cplusplus)
 }
 #endif
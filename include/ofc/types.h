@@ -504,6 +504,17 @@ typedef const OFC_TACHAR *OFC_LPCTASTR;
  * Represents a Millisecond time value
  */
 typedef OFC_INT32 OFC_MSTIME;
+/**
+ * Represents a Nanosecond monotonic time value
+ *
+ * Without 64 bit integer support the value wraps every four seconds and
+ * is only useful for measuring short intervals.
+ */
+#if defined(OFC_64BIT_INTEGER)
+typedef OFC_UINT64 OFC_NSTIME;
+#else
+typedef OFC_UINT32 OFC_NSTIME;
+#endif
 
 /**
  * A wide character backslash
@@ -0,0 +1,201 @@
+/* Copyright (c) 2021 Connected Way, LLC. All rights reserved.
+ * Use of this source code is governed by a Creative Commons
+ * Attribution-NoDerivatives 4.0 International license that can be
+ * found in the LICENSE file.
+ */
+#if !defined(__OFC_URING_H__)
+#define __OFC_URING_H__
+
+#include "ofc/core.h"
+#include "ofc/types.h"
+#include "ofc/handle.h"
+
+/**
+ * \{
+ * \defgroup uring Open Files io_uring Overlapped I/O
+ *
+ * On Linux, overlapped reads and writes can be issued through an
+ * io_uring rather than handed to the pool of overlapped I/O threads.
+ * Each wait set owns a ring.  An I/O goes to the ring of the wait set
+ * its overlapped handle has been added to, so it is submitted and
+ * completed on the scheduler thread that waits on that set, with no
+ * thread per I/O in flight and no handoff between threads.
+ *
+ * A file system handler uses the engine from its ReadFile and WriteFile:
+ *
+ * - Call \ref ofc_uring_read or \ref ofc_uring_write with the file's
+ *   descriptor.  The offset is taken from the overlapped structure.
+ * - If the call returns OFC_TRUE the I/O is in flight.  Fail the read
+ *   or write with OFC_ERROR_IO_PENDING.
+ * - If it returns OFC_FALSE the engine cannot take the I/O, because
+ *   there is no ring, the overlapped handle is not in a wait set, or
+ *   the ring is full.  Use the I/O threads as before.
+ *
+ * When the I/O completes, the status and dwLen of the overlapped
+ * structure are set and the overlapped handle is queued to its
+ * response_queue, as the I/O threads do.  A failed I/O also sets
+ * dwError to the OfcLastError the handler should report, so a failure
+ * is told apart from a short transfer.
+ *
+ * Submissions are passed to the kernel in one call when the wait set
+ * next waits, and completions are reaped at the same time.  Queuing an
+ * I/O on a ring with nothing waiting to be submitted wakes the wait
+ * set, so a wait already in progress doesn't hold it back.  The
+ * platform wait set layer should add the ring's descriptor, from
+ * \ref ofc_uring_fd, to its poll set so that a completion wakes the
+ * wait.  A platform that does not will still see completions, because
+ * a wait set with I/O in flight bounds its wait to OFC_URING_POLL
+ * milliseconds.
+ *
+ * Built when OFC_FILE_URING is defined.  Elsewhere, or when the kernel
+ * does not allow io_uring, no ring is created and every I/O is left to
+ * the I/O threads.
+ *
+ * Function | Description
+ * ---------|-------------
+ * \ref ofc_uring_create | Create a ring
+ * \ref ofc_uring_destroy | Destroy a ring
+ * \ref ofc_uring_fd | Get a ring's descriptor
+ * \ref ofc_uring_read | Queue an overlapped read
+ * \ref ofc_uring_write | Queue an overlapped write
+ * \ref ofc_uring_service | Submit queued I/O and complete finished I/O
+ * \ref ofc_uring_drain | Wait for all I/O on a ring to complete
+ * \ref ofc_uring_inflight | Get the number of I/Os in flight
+ */
+
+#if !defined(OFC_URING_ENTRIES)
+#define OFC_URING_ENTRIES 128    /* I/Os in flight per wait set */
+#endif
+#if !defined(OFC_URING_POLL)
+#define OFC_URING_POLL 1        /* ms between reaps without fd polling */
+#endif
+
+/**
+ * An io_uring and its mapped queues
+ */
+typedef struct ofc_uring OFC_URING;
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+/**
+ * Create a ring
+ *
+ * Called when a wait set is created
+ *
+ * \returns
+ * The ring, or OFC_NULL if io_uring is not available
+ */
+OFC_CORE_LIB OFC_URING *
+ofc_uring_create(OFC_VOID);
+/**
+ * Destroy a ring
+ *
+ * I/O still in flight is cancelled and not completed.
+ *
+ * \param ring
+ * The ring to destroy
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_uring_destroy(OFC_URING *ring);
+/**
+ * Get a ring's descriptor
+ *
+ * The descriptor is readable while completions are waiting to be reaped
+ *
+ * \param ring
+ * The ring
+ *
+ * \returns
+ * The descriptor, or -1 if there is no ring
+ */
+OFC_CORE_LIB OFC_INT
+ofc_uring_fd(OFC_URING *ring);
+/**
+ * Queue an overlapped read
+ *
+ * \param hOverlapped
+ * The overlapped handle, added to the wait set of the app doing the I/O
+ *
+ * \param fd
+ * Descriptor of the file to read
+ *
+ * \param lpBuffer
+ * Buffer to read into.  Must stay valid until the I/O completes.
+ *
+ * \param nNumberOfBytesToRead
+ * Number of bytes to read
+ *
+ * \returns
+ * OFC_TRUE if the read is in flight, OFC_FALSE if the caller should
+ * issue it some other way
+ */
+OFC_CORE_LIB OFC_BOOL
+ofc_uring_read(OFC_HANDLE hOverlapped, OFC_INT fd, OFC_LPVOID lpBuffer,
+               OFC_DWORD nNumberOfBytesToRead);
+/**
+ * Queue an overlapped write
+ *
+ * \param hOverlapped
+ * The overlapped handle, added to the wait set of the app doing the I/O
+ *
+ * \param fd
+ * Descriptor of the file to write
+ *
+ * \param lpBuffer
+ * Buffer to write from.  Must stay valid until the I/O completes.
+ *
+ * \param nNumberOfBytesToWrite
+ * Number of bytes to write
+ *
+ * \returns
+ * OFC_TRUE if the write is in flight, OFC_FALSE if the caller should
+ * issue it some other way
+ */
+OFC_CORE_LIB OFC_BOOL
+ofc_uring_write(OFC_HANDLE hOverlapped, OFC_INT fd, OFC_LPCVOID lpBuffer,
+                OFC_DWORD nNumberOfBytesToWrite);
+/**
+ * Submit queued I/O and complete finished I/O
+ *
+ * Called by the wait set before it waits.  Does not block.
+ *
+ * \param ring
+ * The ring to service
+ *
+ * \returns
+ * Number of I/Os completed
+ */
+OFC_CORE_LIB OFC_INT
+ofc_uring_service(OFC_URING *ring);
+/**
+ * Wait for all I/O on a ring to complete
+ *
+ * Submits what is queued and blocks until the kernel has finished with
+ * every I/O in flight, completing each as \ref ofc_uring_service does.
+ * Called by the wait set before it destroys the ring, since the kernel
+ * may still be using the buffers of an I/O it has not completed.
+ *
+ * \param ring
+ * The ring to drain
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_uring_drain(OFC_URING *ring);
+/**
+ * Get the number of I/Os queued or in flight on a ring
+ *
+ * \param ring
+ * The ring
+ *
+ * \returns
+ * Number of I/Os not yet completed
+ */
+OFC_CORE_LIB OFC_UINT
+ofc_uring_inflight(OFC_URING *ring);
+
+#if defined(__cplusplus)
+}
+#endif
+/** \} */
+#endif
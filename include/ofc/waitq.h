@@ -12,6 +12,17 @@
 
 /**
  * \defgroup waitq Wait Queue Facility
+ *
+ * A wait queue is a queue with an event that is set while the queue is
+ * not empty, so a scheduler or thread can wait for elements to arrive.
+ *
+ * A wait queue is either locked or multi producer, single consumer
+ * (MPSC).  A locked queue serializes every operation on a lock.  An MPSC
+ * queue is lock free: any thread may enqueue, but only one thread, the
+ * owner, may dequeue, block, or use first, next, unlink and clear.  The
+ * event of an MPSC queue is set only when the queue goes from empty to
+ * not empty.  \ref ofc_waitq_create returns a locked queue unless the
+ * stack is configured with OFC_WAITQ_MPSC.
  */
 
 /** \{ */
@@ -28,6 +39,17 @@ extern "C"
  */
 OFC_CORE_LIB OFC_HANDLE
 ofc_waitq_create(OFC_VOID);
+/**
+ * Create a multi producer, single consumer wait queue
+ *
+ * Any thread may enqueue to the queue.  Only the owning thread may
+ * dequeue from it or walk it.
+ *
+ * \returns
+ * Handle to the wait queue
+ */
+OFC_CORE_LIB OFC_HANDLE
+ofc_waitq_create_mpsc(OFC_VOID);
 /**
  * Destroy a queue
  *
@@ -39,6 +61,8 @@ ofc_waitq_destroy(OFC_HANDLE qHead);
 /**
  * Add an element to the end of the list
  *
+ * An MPSC queue ignores an element of OFC_NULL.
+ *
  * \param qHead
  * Pointer to list header
  *
@@ -9,6 +9,7 @@
 #include "ofc/core.h"
 #include "ofc/types.h"
 #include "ofc/handle.h"
+#include "ofc/timer.h"
 
 /**
  * \{
@@ -26,11 +27,15 @@
  * \ref ofc_waitset_create | Create a waitset
  * \ref ofc_waitset_destroy | Destroy a waitset
  * \ref ofc_waitset_wait | Wait for an even within waitset
+ * \ref ofc_waitset_wait_many | Wait for one or more events within waitset
  * \ref ofc_waitset_wake | Force wakeup of a waitset
  * \ref ofc_waitset_add | Add a waitable resource to a waitset
  * \ref ofc_waitset_remove | Remove a waitable resource from a waitset
  * \ref ofc_waitset_clear | Remove all events from a waitset
  * \ref ofc_waitset_clear_app | Disassociate an app from all events in set
+ * \ref ofc_waitset_clear_app_deferred | Release an app's events at next wait
+ * \ref ofc_waitset_next_timeout | Time until the next timer in the set
+ * \ref ofc_waitset_expired | Return the expired timers in the set
  */
 
 /**
@@ -39,8 +44,11 @@
  * Used by platform scheduling code
  */
 typedef struct {
-    OFC_HANDLE hHandleQueue;    /**< List of events in wait set  */
+    OFC_HANDLE hHandleQueue;    /**< Events in the set, empty if incremental */
     OFC_VOID *impl;        /**< Pointer to implementation info  */
+    OFC_VOID *registry;        /**< Persistent registrations (incremental) */
+    OFC_TIMER_WHEEL *wheel;    /**< Timers in the set */
+    OFC_VOID *uring;        /**< Ring for overlapped file I/O, if any */
 } WAIT_SET;
 
 #if defined(__cplusplus)
@@ -79,6 +87,27 @@ ofc_waitset_destroy(OFC_HANDLE handle);
  */
 OFC_CORE_LIB OFC_HANDLE
 ofc_waitset_wait(OFC_HANDLE handle);
+/**
+ * Wait for one or more events in a wait set to be ready
+ *
+ * Returns every event that was found ready on a single wake up so the
+ * caller can dispatch them all before waiting again.  Platforms that can
+ * only report one event per wait return at most one.
+ *
+ * \param handle
+ * Handle of the wait set to wait on
+ *
+ * \param ready
+ * Array to receive the handles of the ready events
+ *
+ * \param max
+ * Number of entries in the ready array
+ *
+ * \returns
+ * Number of handles returned.  0 if woken by a wake call.
+ */
+OFC_CORE_LIB OFC_INT
+ofc_waitset_wait_many(OFC_HANDLE handle, OFC_HANDLE *ready, OFC_INT max);
 /**
  * Wake up a wait set that is currently waiting.
  *
@@ -131,6 +160,56 @@ ofc_waitset_clear(OFC_HANDLE handle);
    */
 OFC_CORE_LIB OFC_VOID
 ofc_waitset_clear_app(OFC_HANDLE handle, OFC_HANDLE hApp);
+  /**
+   * Release an app's events at the next wait
+   *
+   * When built with OFC_SCHED_INCREMENTAL the events are only marked
+   * stale.  Any the app adds again before the next \ref ofc_waitset_wait
+   * keep their platform registration, the rest are removed.  Otherwise
+   * this is the same as \ref ofc_waitset_clear_app.
+   *
+   * \param handle
+   * Handle to the waitset
+   *
+   * \param hApp
+   * App whose events are released
+   */
+OFC_CORE_LIB OFC_VOID
+ofc_waitset_clear_app_deferred(OFC_HANDLE handle, OFC_HANDLE hApp);
+  /**
+   * Return the time until the next timer in the set expires
+   *
+   * Timers added to a wait set are kept on the set's timing wheel, so
+   * this does not look at each timer.  It may return less than the time
+   * to the earliest timer but never more.
+   *
+   * \param handle
+   * Handle to the waitset
+   *
+   * \returns
+   * Milliseconds to wait, 0 if a timer has expired, or OFC_INFINITE if
+   * there are no timers in the set
+   */
+OFC_CORE_LIB OFC_MSTIME
+ofc_waitset_next_timeout(OFC_HANDLE handle);
+  /**
+   * Return the expired timers in the set
+   *
+   * \param handle
+   * Handle to the waitset
+   *
+   * \param expired
+   * Array to receive the handles of expired timers
+   *
+   * \param max
+   * Size of the array.  Further expired timers are returned by the next
+   * call.
+   *
+   * \returns
+   * The number of timers returned
+   */
+OFC_CORE_LIB OFC_INT
+ofc_waitset_expired(OFC_HANDLE handle, OFC_HANDLE *expired, OFC_INT max);
 
 #if defined(OFC_HANDLE_DEBUG)
   /**
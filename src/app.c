@@ -12,6 +12,7 @@
 #include "ofc/sched.h"
 #include "ofc/app.h"
 #include "ofc/event.h"
+#include "ofc/atomic.h"
 
 #include "ofc/heap.h"
 
@@ -24,8 +25,16 @@ typedef struct _OFC_APP {
     OFC_BOOL destroy;        /* Flag to destroy app */
     OFC_VOID *app_data;
     OFC_HANDLE hNotify;
+    OFC_HANDLE hApp;        /* Our own handle */
+    OFC_HANDLE worker;        /* Scheduler currently running the app */
+    OFC_IQUEUE_LINK link;    /* Link on the scheduler's app queue */
+#if defined(OFC_SCHED_INCREMENTAL)
+    OFC_IQUEUE_LINK ready_link;    /* Link on the scheduler's ready queue */
+#endif
 } OFC_APP;
 
+static OFC_SLAB ofc_app_slab = OFC_SLAB_INIT("Application", sizeof(OFC_APP));
+
 /*
  * STATE_create - Create an application
  * 
@@ -45,7 +54,7 @@ ofc_app_create(OFC_HANDLE scheduler, OFC_APP_TEMPLATE *templatep,
     /*
      * Allocate structure for app
      */
-    app = ofc_malloc(sizeof(OFC_APP));
+    app = ofc_slab_alloc(&ofc_app_slab);
 
     /*
      * Initialize the application
@@ -55,8 +64,14 @@ ofc_app_create(OFC_HANDLE scheduler, OFC_APP_TEMPLATE *templatep,
     app->destroy = OFC_FALSE;
     app->app_data = app_data;
     app->hNotify = OFC_HANDLE_NULL;
+    app->worker = scheduler;
+    ofc_iqueue_link_init(&app->link);
+#if defined(OFC_SCHED_INCREMENTAL)
+    ofc_iqueue_link_init(&app->ready_link);
+#endif
 
     hApp = ofc_handle_create(OFC_HANDLE_APP, app);
+    app->hApp = hApp;
     /*
      * Application was initialized, add to scheduler
      */
@@ -109,6 +124,85 @@ ofc_app_set_wait(OFC_HANDLE hApp, OFC_HANDLE hNotify) {
     }
 }
 
+OFC_CORE_LIB OFC_IQUEUE_LINK *
+ofc_app_sched_link(OFC_HANDLE hApp) {
+    OFC_APP *app;
+    OFC_IQUEUE_LINK *link;
+
+    link = OFC_NULL;
+    app = ofc_handle_lock(hApp);
+    if (app != OFC_NULL) {
+        link = &app->link;
+        ofc_handle_unlock(hApp);
+    }
+    return (link);
+}
+
+OFC_CORE_LIB OFC_HANDLE
+ofc_app_from_sched_link(OFC_IQUEUE_LINK *link) {
+    OFC_APP *app;
+    OFC_HANDLE hApp;
+
+    hApp = OFC_HANDLE_NULL;
+    app = OFC_IQUEUE_ENTRY(link, OFC_APP, link);
+    if (app != OFC_NULL)
+        hApp = app->hApp;
+    return (hApp);
+}
+
+OFC_CORE_LIB OFC_HANDLE
+ofc_app_get_worker(OFC_HANDLE hApp) {
+    OFC_APP *app;
+    OFC_HANDLE hWorker;
+
+    hWorker = OFC_HANDLE_NULL;
+    app = ofc_handle_lock(hApp);
+    if (app != OFC_NULL) {
+        hWorker = OFC_ATOMIC_LOAD(&app->worker);
+        ofc_handle_unlock(hApp);
+    }
+    return (hWorker);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_app_set_worker(OFC_HANDLE hApp, OFC_HANDLE hWorker) {
+    OFC_APP *app;
+
+    app = ofc_handle_lock(hApp);
+    if (app != OFC_NULL) {
+        OFC_ATOMIC_STORE(&app->worker, hWorker);
+        ofc_handle_unlock(hApp);
+    }
+}
+
+#if defined(OFC_SCHED_INCREMENTAL)
+OFC_CORE_LIB OFC_IQUEUE_LINK *
+ofc_app_ready_link(OFC_HANDLE hApp) {
+    OFC_APP *app;
+    OFC_IQUEUE_LINK *link;
+
+    link = OFC_NULL;
+    app = ofc_handle_lock(hApp);
+    if (app != OFC_NULL) {
+        link = &app->ready_link;
+        ofc_handle_unlock(hApp);
+    }
+    return (link);
+}
+
+OFC_CORE_LIB OFC_HANDLE
+ofc_app_from_ready_link(OFC_IQUEUE_LINK *link) {
+    OFC_APP *app;
+    OFC_HANDLE hApp;
+
+    hApp = OFC_HANDLE_NULL;
+    app = OFC_IQUEUE_ENTRY(link, OFC_APP, ready_link);
+    if (app != OFC_NULL)
+        hApp = app->hApp;
+    return (hApp);
+}
+#endif
+
 /*
  * STATE_destroy - Destroy an application
  *
@@ -133,7 +227,7 @@ ofc_app_destroy(OFC_HANDLE hApp) {
 
         ofc_handle_destroy(hApp);
         ofc_handle_unlock(hApp);
-        ofc_free(app);
+        ofc_slab_free(&ofc_app_slab, app);
     }
 }
 
@@ -193,7 +287,11 @@ ofc_app_sig_event(OFC_HANDLE hApp) {
         /*
          * Pass the significant event on to the scheduler
          */
+#if defined(OFC_SCHED_INCREMENTAL)
+        ofc_sched_app_event(app->scheduler, hApp);
+#else
         ofc_sched_significant_event(app->scheduler);
+#endif
         ofc_handle_unlock(hApp);
     }
 }
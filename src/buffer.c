@@ -0,0 +1,198 @@
+/* Copyright (c) 2021 Connected Way, LLC. All rights reserved.
+ * Use of this source code is governed by a Creative Commons
+ * Attribution-NoDerivatives 4.0 International license that can be
+ * found in the LICENSE file.
+ */
+#define __OFC_CORE_DLL__
+
+#include "ofc/core.h"
+#include "ofc/types.h"
+#include "ofc/libc.h"
+#include "ofc/console.h"
+#include "ofc/heap.h"
+#include "ofc/atomic.h"
+#include "ofc/process.h"
+#include "ofc/buffer.h"
+
+/*
+ * Every buffer is preceded by a header.  The header is padded so the
+ * data that follows keeps the heap's alignment.
+ */
+struct buffer_header {
+    volatile OFC_INT refcount;
+    OFC_INT index;        /* Size class, or -1 if not pooled */
+    OFC_SIZET size;        /* Usable size */
+    struct buffer_header *next;    /* Link on the free list */
+};
+
+#define BUFFER_HEADER_SIZE \
+  ((sizeof(struct buffer_header) + 2 * sizeof(OFC_VOID *) - 1) & \
+   ~(2 * sizeof(OFC_VOID *) - 1))
+#define BUFFER_HEADER(buffer) \
+  ((struct buffer_header *) ((OFC_UCHAR *) (buffer) - BUFFER_HEADER_SIZE))
+#define BUFFER_DATA(header) \
+  ((OFC_UCHAR *) (header) + BUFFER_HEADER_SIZE)
+
+#define BUFFER_CLASSES 3
+
+struct buffer_class {
+    OFC_SPINLOCK lock;
+    OFC_SIZET size;
+    OFC_INT max;        /* Most free buffers kept */
+    OFC_INT count;        /* Free buffers kept */
+    struct buffer_header *free;
+    volatile OFC_UINT32 hits;    /* Allocations served from the pool */
+    volatile OFC_UINT32 misses;    /* Allocations that went to the heap */
+};
+
+static struct buffer_class ofc_buffer_classes[BUFFER_CLASSES] =
+        {
+                {0, 4 * 1024, OFC_BUFFER_POOL_SMALL},
+                {0, 64 * 1024, OFC_BUFFER_POOL_MEDIUM},
+                {0, 1024 * 1024, OFC_BUFFER_POOL_LARGE}
+        };
+
+/*
+ * A request belongs to a class if it is no bigger than the class plus the
+ * slack for protocol headers, and more than half of it.  Anything
+ * smaller would waste most of a pooled buffer, so it comes from the heap
+ * at its own size.
+ */
+static OFC_INT
+ofc_buffer_class(OFC_SIZET size) {
+    OFC_INT index;
+
+    for (index = 0;
+         index < BUFFER_CLASSES &&
+         ofc_buffer_classes[index].size + OFC_BUFFER_SLACK < size;
+         index++);
+    if (index < BUFFER_CLASSES && size <= ofc_buffer_classes[index].size / 2)
+        index = -1;
+    return (index < BUFFER_CLASSES ? index : -1);
+}
+
+OFC_CORE_LIB OFC_UCHAR *
+ofc_buffer_alloc(OFC_SIZET size) {
+    struct buffer_class *pool;
+    struct buffer_header *header;
+    OFC_INT index;
+
+    index = ofc_buffer_class(size);
+
+    header = OFC_NULL;
+    if (index >= 0) {
+        /*
+         * The free buffers of a class are whatever sizes in it were
+         * asked for.  Take the first if it's big enough.
+         */
+        pool = &ofc_buffer_classes[index];
+        OFC_SPINLOCK_LOCK(&pool->lock);
+        header = pool->free;
+        if (header != OFC_NULL && header->size >= size) {
+            pool->free = header->next;
+            pool->count--;
+        } else
+            header = OFC_NULL;
+        OFC_SPINLOCK_UNLOCK(&pool->lock);
+
+        if (header != OFC_NULL)
+            OFC_ATOMIC_ADD_RELAXED(&pool->hits, 1);
+        else {
+            OFC_ATOMIC_ADD_RELAXED(&pool->misses, 1);
+            header = ofc_malloc(BUFFER_HEADER_SIZE + size);
+            header->index = index;
+            header->size = size;
+        }
+    } else {
+        header = ofc_malloc(BUFFER_HEADER_SIZE + size);
+        header->index = -1;
+        header->size = size;
+    }
+    header->refcount = 1;
+    header->next = OFC_NULL;
+    return (BUFFER_DATA(header));
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_buffer_ref(OFC_UCHAR *buffer) {
+    OFC_ATOMIC_ADD(&BUFFER_HEADER(buffer)->refcount, 1);
+}
+
+OFC_CORE_LIB OFC_BOOL
+ofc_buffer_shared(OFC_UCHAR *buffer) {
+    return (OFC_ATOMIC_LOAD(&BUFFER_HEADER(buffer)->refcount) > 1);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_buffer_release(OFC_UCHAR *buffer) {
+    struct buffer_header *header;
+    struct buffer_class *pool;
+    OFC_INT refcount;
+
+    if (buffer != OFC_NULL) {
+        header = BUFFER_HEADER(buffer);
+        refcount = OFC_ATOMIC_SUB(&header->refcount, 1);
+        if (refcount < 0)
+            ofc_process_crash("Buffer released too many times\n");
+        else if (refcount == 0) {
+            if (header->index >= 0) {
+                pool = &ofc_buffer_classes[header->index];
+                OFC_SPINLOCK_LOCK(&pool->lock);
+                if (pool->count < pool->max) {
+                    header->next = pool->free;
+                    pool->free = header;
+                    pool->count++;
+                    header = OFC_NULL;
+                }
+                OFC_SPINLOCK_UNLOCK(&pool->lock);
+            }
+            if (header != OFC_NULL)
+                ofc_free(header);
+        }
+    }
+}
+
+OFC_CORE_LIB OFC_SIZET
+ofc_buffer_size(OFC_UCHAR *buffer) {
+    return (BUFFER_HEADER(buffer)->size);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_buffer_pool_flush(OFC_VOID) {
+    struct buffer_class *pool;
+    struct buffer_header *header;
+    struct buffer_header *next;
+    OFC_INT index;
+
+    for (index = 0; index < BUFFER_CLASSES; index++) {
+        pool = &ofc_buffer_classes[index];
+        OFC_SPINLOCK_LOCK(&pool->lock);
+        header = pool->free;
+        pool->free = OFC_NULL;
+        pool->count = 0;
+        OFC_SPINLOCK_UNLOCK(&pool->lock);
+
+        for (; header != OFC_NULL; header = next) {
+            next = header->next;
+            ofc_free(header);
+        }
+    }
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_buffer_pool_dump_stats(OFC_VOID) {
+    struct buffer_class *pool;
+    OFC_CHAR obuf[80];
+    OFC_INT index;
+
+    ofc_snprintf(obuf, sizeof(obuf), "%-16s %10s %10s %10s\n",
+                 "Buffer Pool", "Free", "Hits", "Misses");
+    ofc_write_console(obuf);
+    for (index = 0; index < BUFFER_CLASSES; index++) {
+        pool = &ofc_buffer_classes[index];
+        ofc_snprintf(obuf, sizeof(obuf), "%-16d %10d %10u %10u\n",
+                     (OFC_INT) pool->size, pool->count,
+                     pool->hits, pool->misses);
+        ofc_write_console(obuf);
+    }
+}
@@ -24,7 +24,10 @@
 #endif
 
 #include "ofc/heap.h"
+#include "ofc/buffer.h"
+#include "ofc/libc_simd.h"
 #include "ofc/persist.h"
+#include "ofc/log.h"
 /**
  * \defgroup init Initialization
  * \ingroup Applications
@@ -42,6 +45,7 @@ ofc_core_load(OFC_VOID)
 {
   if (!core_loaded)
     {
+      ofc_libc_simd_init();
       ofc_heap_load();
       ofc_handle16_init();
       ofc_thread_init();
@@ -54,6 +58,7 @@ ofc_core_load(OFC_VOID)
       ofc_fs_init();
       OfcFileInit();
       ofc_persist_init();
+      ofc_log_init();
       core_loaded = OFC_TRUE;
     }
 }
@@ -63,6 +68,7 @@ ofc_core_unload(OFC_VOID)
 {
   if (core_loaded)
     {
+      ofc_log_destroy();
       ofc_persist_unload();
       OfcFileDestroy();
 
@@ -82,6 +88,8 @@ ofc_core_unload(OFC_VOID)
 
       ofc_handle16_free();
 
+      ofc_buffer_pool_flush();
+
       ofc_heap_unload();
       core_loaded = OFC_FALSE;
     }
@@ -12,44 +12,137 @@
 #include "ofc/file.h"
 #include "ofc/dce.h"
 
+/*
+ * Claim a fixed size block at the fifo so a header can be encoded or
+ * decoded with direct loads and stores.  DCE messages are always little
+ * endian.  When the block spans segments the header goes through
+ * scratch instead, copied in a byte at a time when popping and out by
+ * of_dce_fifo_store when pushing.  Returns OFC_NULL if the fifo doesn't
+ * have room.
+ */
+static OFC_UCHAR *
+of_dce_fifo_claim (OFC_MESSAGE *dceMessage, OFC_SIZET size, OFC_BOOL pop,
+		   OFC_UCHAR *scratch, OFC_INT *offset)
+{
+  OFC_UCHAR *window ;
+  OFC_SIZET i ;
+
+  *offset = ofc_message_fifo_get (dceMessage) ;
+  window = ofc_message_window (dceMessage, *offset, size) ;
+  if (pop)
+    ofc_message_fifo_pop (dceMessage, size) ;
+  else
+    ofc_message_fifo_push (dceMessage, size) ;
+
+  if (ofc_message_fifo_get (dceMessage) == *offset)
+    window = OFC_NULL ;
+  else if (window == OFC_NULL)
+    {
+      window = scratch ;
+      if (pop)
+	{
+	  for (i = 0 ; i < size ; i++)
+	    scratch[i] = ofc_message_get_u8 (dceMessage, 
+					     *offset + (OFC_INT) i) ;
+	}
+    }
+  return (window) ;
+}
+
+static OFC_VOID
+of_dce_fifo_store (OFC_MESSAGE *dceMessage, OFC_UCHAR *window, 
+		   OFC_UCHAR *scratch, OFC_INT offset, OFC_SIZET size)
+{
+  OFC_SIZET i ;
+
+  if (window == scratch)
+    {
+      for (i = 0 ; i < size ; i++)
+	ofc_message_put_u8 (dceMessage, offset + (OFC_INT) i, scratch[i]) ;
+    }
+}
+
 OFC_CORE_LIB OFC_VOID 
 of_dce_push_result(OFC_MESSAGE *dceMessage, OFC_UINT16 result,
 		   OFC_UINT16 reason, OFC_UUID *uuid,
 		   OFC_UINT16 version) 
 {
-  ofc_message_fifo_push_u16 (dceMessage, result) ;
-  ofc_message_fifo_push_u16 (dceMessage, reason) ;
-  ofc_memcpy (ofc_message_fifo_push (dceMessage, OFC_UUID_LEN), 
-	       uuid, OFC_UUID_LEN) ;
-  ofc_message_fifo_push_u16 (dceMessage, version) ;
-  ofc_message_fifo_push_u16 (dceMessage, DCE_INTERFACE_VERSION_MINOR) ;
+  OFC_UCHAR *res ;
+  OFC_UCHAR scratch[DCE_RESULT_SIZE] ;
+  OFC_INT offset ;
+
+  res = of_dce_fifo_claim (dceMessage, DCE_RESULT_SIZE, OFC_FALSE,
+			   scratch, &offset) ;
+  if (res != OFC_NULL)
+    {
+      ofc_store_le16 (res + DCE_RESULT_RESULT, result) ;
+      ofc_store_le16 (res + DCE_RESULT_REASON, reason) ;
+      ofc_memcpy (res + DCE_RESULT_UUID, uuid, OFC_UUID_LEN) ;
+      ofc_store_le16 (res + DCE_RESULT_VERSION, version) ;
+      ofc_store_le16 (res + DCE_RESULT_VERSION_MINOR, 
+		      DCE_INTERFACE_VERSION_MINOR) ;
+      of_dce_fifo_store (dceMessage, res, scratch, offset, 
+			 DCE_RESULT_SIZE) ;
+    }
 }
 
 OFC_CORE_LIB OFC_VOID 
 of_dce_push_bind_header(OFC_MESSAGE *dceMessage, OFC_UINT16 xmit_frag,
 		       OFC_UINT16 recv_frag, OFC_UINT32 group_id)
 {
-  ofc_message_fifo_push_u16 (dceMessage, xmit_frag) ;
-  ofc_message_fifo_push_u16 (dceMessage, recv_frag) ;
-  ofc_message_fifo_push_u32 (dceMessage, group_id) ;
+  OFC_UCHAR *hdr ;
+  OFC_UCHAR scratch[DCE_BIND_SIZE] ;
+  OFC_INT offset ;
+
+  hdr = of_dce_fifo_claim (dceMessage, DCE_BIND_SIZE, OFC_FALSE,
+			   scratch, &offset) ;
+  if (hdr != OFC_NULL)
+    {
+      ofc_store_le16 (hdr + DCE_BIND_XMIT_FRAG, xmit_frag) ;
+      ofc_store_le16 (hdr + DCE_BIND_RECV_FRAG, recv_frag) ;
+      ofc_store_le32 (hdr + DCE_BIND_ASSOC_GROUP, group_id) ;
+      of_dce_fifo_store (dceMessage, hdr, scratch, offset, DCE_BIND_SIZE) ;
+    }
 }
 
 OFC_CORE_LIB OFC_VOID 
 of_dce_pop_request_header(OFC_MESSAGE *dceMessage, OFC_UINT32 *alloc_hint,
 			 OFC_UINT16 *context_id, OFC_UINT16 *opnum)
 {
-  *alloc_hint = ofc_message_fifo_pop_u32 (dceMessage) ;
-  *context_id = ofc_message_fifo_pop_u16 (dceMessage) ;
-  *opnum = ofc_message_fifo_pop_u16 (dceMessage) ;
+  OFC_UCHAR *hdr ;
+  OFC_UCHAR scratch[DCE_REQ_SIZE] ;
+  OFC_INT offset ;
+
+  *alloc_hint = 0 ;
+  *context_id = 0 ;
+  *opnum = 0 ;
+  hdr = of_dce_fifo_claim (dceMessage, DCE_REQ_SIZE, OFC_TRUE,
+			   scratch, &offset) ;
+  if (hdr != OFC_NULL)
+    {
+      *alloc_hint = ofc_load_le32 (hdr + DCE_REQ_ALLOC_HINT) ;
+      *context_id = ofc_load_le16 (hdr + DCE_REQ_CONTEXT_ID) ;
+      *opnum = ofc_load_le16 (hdr + DCE_REQ_OPNUM) ;
+    }
 }
 
 OFC_CORE_LIB OFC_VOID 
 of_dce_push_request_header(OFC_MESSAGE *dceMessage, OFC_UINT32 alloc_hint,
 			  OFC_UINT16 context_id, OFC_UINT16 opnum)
 {
-  ofc_message_fifo_push_u32 (dceMessage, alloc_hint) ;
-  ofc_message_fifo_push_u16 (dceMessage, context_id) ;
-  ofc_message_fifo_push_u16 (dceMessage, opnum) ;
+  OFC_UCHAR *hdr ;
+  OFC_UCHAR scratch[DCE_REQ_SIZE] ;
+  OFC_INT offset ;
+
+  hdr = of_dce_fifo_claim (dceMessage, DCE_REQ_SIZE, OFC_FALSE,
+			   scratch, &offset) ;
+  if (hdr != OFC_NULL)
+    {
+      ofc_store_le32 (hdr + DCE_REQ_ALLOC_HINT, alloc_hint) ;
+      ofc_store_le16 (hdr + DCE_REQ_CONTEXT_ID, context_id) ;
+      ofc_store_le16 (hdr + DCE_REQ_OPNUM, opnum) ;
+      of_dce_fifo_store (dceMessage, hdr, scratch, offset, DCE_REQ_SIZE) ;
+    }
 }
 
 OFC_CORE_LIB OFC_LPTSTR 
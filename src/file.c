@@ -15,11 +15,54 @@
 #include "ofc/path.h"
 #include "ofc/lock.h"
 #include "ofc/thread.h"
+#include "ofc/atomic.h"
+#include "ofc/perf.h"
+#include "ofc/time.h"
 
 #include "ofc/file.h"
 #include "ofc/fs.h"
 #include "ofc/heap.h"
 
+#if defined(OFC_FILE_CACHE)
+/*
+ * Per handle read-ahead and write-behind.  pos is the caller's file
+ * pointer.  The file system's may differ, since reads can be satisfied
+ * from the read-ahead buffer and writes held in the write-behind
+ * buffer, so fs_pos tracks it and the cache seeks before going to the
+ * file system.  fs_pos is -1 when it isn't known.
+ */
+typedef struct {
+    OFC_LOCK lock;
+    OFC_OFFT pos;
+    OFC_OFFT fs_pos;
+    OFC_OFFT read_next;        /* Where a sequential read would start */
+    OFC_OFFT write_next;       /* Where a sequential write would start */
+    OFC_BOOL random;
+    OFC_BOOL write_behind;     /* Off when other openers may read */
+    OFC_DWORD window;          /* Read-ahead, 0 when not reading ahead */
+    OFC_CHAR *rbuf;
+    OFC_DWORD rsize;
+    OFC_OFFT roff;
+    OFC_DWORD rlen;
+    OFC_CHAR *wbuf;
+    OFC_OFFT woff;
+    OFC_DWORD wlen;
+} OFC_FILE_CACHE_CONTEXT;
+#endif
+
+#if (OFC_FILE_META_CACHE > 0)
+/*
+ * A directory listing held by the metadata cache.  It is shared with
+ * the searches reading it and freed when the last lets go.
+ */
+typedef struct {
+    volatile OFC_INT refs;
+    OFC_INT count;
+    OFC_INT size;              /* Entries allocated */
+    OFC_WIN32_FIND_DATAW find[1];
+} OFC_FILE_META_LIST;
+#endif
+
 typedef struct _OFC_FILE_CONTEXT {
     OFC_HANDLE fsHandle;
     OFC_FST_TYPE fsType;
@@ -36,10 +79,38 @@ typedef struct _OFC_FILE_CONTEXT {
 #endif
 #endif
     OFC_HANDLE overlappedList;
+#if defined(OFC_FILE_CACHE)
+    OFC_FILE_CACHE_CONTEXT *cache;
+#endif
+#if (OFC_FILE_META_CACHE > 0)
+    OFC_LPTSTR lpMetaName;     /* Mapped name */
+    OFC_BOOL metaCache;        /* If its metadata may be cached */
+    OFC_UINT32 metaInserted;   /* Entries inserted when last forgotten */
+    OFC_FILE_META_LIST *listing;
+    OFC_INT listingNext;       /* Next entry to return, -1 if recording */
+    OFC_UINT32 listingGeneration;
+#endif
 } OFC_FILE_CONTEXT;
 
 OFC_DWORD OfcLastError;
 
+/*
+ * Cache statistics are always counted here, and also passed on to the
+ * perf module when it is measuring
+ */
+typedef struct {
+    OFC_ULONG count;
+    struct perf_counter *perf;
+} OFC_FILE_COUNTER;
+
+static OFC_FILE_COUNTER ofc_file_cache_hits;
+static OFC_FILE_COUNTER ofc_file_cache_misses;
+static OFC_FILE_COUNTER ofc_file_cache_read_ahead;
+static OFC_FILE_COUNTER ofc_file_cache_coalesced;
+static OFC_FILE_COUNTER ofc_file_cache_flushes;
+static OFC_FILE_COUNTER ofc_file_meta_hits;
+static OFC_FILE_COUNTER ofc_file_meta_misses;
+
 #if defined(OFC_FILE_DEBUG)
 typedef struct
 {
@@ -129,6 +200,1093 @@ ofc_file_debug_dump (OFC_VOID)
 }
 #endif
 
+#if defined(OFC_FILE_CACHE) || (OFC_FILE_META_CACHE > 0)
+static OFC_VOID ofc_file_count(OFC_FILE_COUNTER *counter,
+                               OFC_ULONG count) {
+    OFC_ATOMIC_ADD_RELAXED(&counter->count, count);
+    if (counter->perf != OFC_NULL)
+        perf_counter_add(counter->perf, count);
+}
+
+static OFC_VOID ofc_file_count_create(OFC_FILE_COUNTER *counter,
+                                      OFC_CTCHAR *name) {
+    counter->count = 0;
+    counter->perf = OFC_NULL;
+    if (g_measurement != OFC_NULL)
+        counter->perf = perf_counter_create(g_measurement, name, 0);
+}
+
+static OFC_VOID ofc_file_count_destroy(OFC_FILE_COUNTER *counter) {
+    if (g_measurement != OFC_NULL && counter->perf != OFC_NULL)
+        perf_counter_destroy(g_measurement, counter->perf);
+    counter->perf = OFC_NULL;
+}
+#endif
+
+#if (OFC_FILE_META_CACHE > 0)
+/*
+ * Metadata of mapped names.  An entry holds the attributes of a name,
+ * one class of information about it, or the listing of a search
+ * pattern, and is used until it expires.  A key's entry is in one of
+ * the FILE_META_WAYS slots from the one its hash selects.  A name that
+ * wasn't found is kept with the error.  generation changes whenever
+ * entries are forgotten, so a lookup that went to the file system while
+ * something changed doesn't insert what it found.  inserted lets a
+ * handle that writes skip forgetting when nothing was added since it
+ * last did.
+ */
+#define FILE_META_WAYS 4
+#define FILE_META_LISTING_FIRST 16
+
+typedef enum {
+    FILE_META_FREE = 0,
+    FILE_META_ATTRIBUTES,
+    FILE_META_INFO,
+    FILE_META_LISTING
+} FILE_META_KIND;
+
+typedef struct {
+    FILE_META_KIND kind;
+    OFC_FST_TYPE fsType;
+    OFC_LPTSTR lpName;
+    OFC_SIZET len;
+    OFC_INT infoClass;
+    OFC_UINT32 hash;
+    OFC_UINT32 dir;            /* Hash of the name's directory */
+    OFC_MSTIME expires;
+    OFC_DWORD error;           /* OFC_ERROR_SUCCESS if the name was found */
+    union {
+        OFC_WIN32_FILE_ATTRIBUTE_DATA attributes;
+        OFC_FILE_BASIC_INFO basic;
+        OFC_FILE_STANDARD_INFO standard;
+        OFC_FILE_NETWORK_OPEN_INFO network;
+        OFC_FILE_ATTRIBUTE_TAG_INFO tag;
+        OFC_FILE_META_LIST *listing;
+    } u;
+} FILE_META_ENTRY;
+
+static FILE_META_ENTRY ofc_file_meta[OFC_FILE_META_CACHE];
+static OFC_LOCK ofc_file_meta_lock;
+static OFC_INT ofc_file_meta_listings;
+static OFC_UINT32 ofc_file_meta_generation;
+static volatile OFC_UINT32 ofc_file_meta_inserted;
+
+static OFC_UINT32 ofc_file_meta_hash(OFC_FST_TYPE fsType,
+                                     OFC_LPCTSTR lpName, OFC_SIZET len) {
+    OFC_UINT32 hash;
+    OFC_SIZET i;
+
+    hash = 2166136261U ^ (OFC_UINT32) fsType;
+    for (i = 0; i < len; i++) {
+        hash ^= (OFC_UINT32) lpName[i];
+        hash *= 16777619U;
+    }
+    return (hash);
+}
+
+/*
+ * Length of the directory part of a name, without the separator
+ */
+static OFC_SIZET ofc_file_meta_dir(OFC_LPCTSTR lpName, OFC_SIZET len) {
+    while (len > 0 && lpName[len - 1] != TCHAR_SLASH &&
+           lpName[len - 1] != TCHAR_BACKSLASH)
+        len--;
+    if (len > 0)
+        len--;
+    return (len);
+}
+
+static OFC_BOOL ofc_file_meta_expired(FILE_META_ENTRY *entry,
+                                      OFC_MSTIME now) {
+    return ((OFC_INT32) ((OFC_UINT32) entry->expires -
+                         (OFC_UINT32) now) <= 0);
+}
+
+static OFC_BOOL ofc_file_meta_match(FILE_META_ENTRY *entry,
+                                    OFC_FST_TYPE fsType,
+                                    OFC_LPCTSTR lpName, OFC_SIZET len,
+                                    OFC_UINT32 hash) {
+    return (entry->kind != FILE_META_FREE && entry->hash == hash &&
+            entry->fsType == fsType && entry->len == len &&
+            ofc_memcmp(entry->lpName, lpName,
+                       len * sizeof(OFC_TCHAR)) == 0);
+}
+
+static OFC_VOID ofc_file_meta_release(OFC_FILE_META_LIST *listing) {
+    if (OFC_ATOMIC_SUB(&listing->refs, 1) == 0)
+        ofc_free(listing);
+}
+
+/*
+ * Entry functions are called with the lock held
+ */
+static OFC_VOID ofc_file_meta_clear(FILE_META_ENTRY *entry) {
+    if (entry->kind == FILE_META_LISTING) {
+        ofc_file_meta_release(entry->u.listing);
+        ofc_file_meta_listings--;
+    }
+    if (entry->kind != FILE_META_FREE)
+        ofc_free(entry->lpName);
+    entry->kind = FILE_META_FREE;
+    entry->lpName = OFC_NULL;
+}
+
+static FILE_META_ENTRY *
+ofc_file_meta_find(FILE_META_KIND kind, OFC_FST_TYPE fsType,
+                   OFC_LPCTSTR lpName, OFC_SIZET len, OFC_UINT32 hash,
+                   OFC_INT infoClass, OFC_MSTIME now) {
+    FILE_META_ENTRY *entry;
+    FILE_META_ENTRY *ret;
+    OFC_INT i;
+
+    ret = OFC_NULL;
+    for (i = 0; i < FILE_META_WAYS && ret == OFC_NULL; i++) {
+        entry = &ofc_file_meta[(hash + i) % OFC_FILE_META_CACHE];
+        if (entry->kind != FILE_META_FREE &&
+            ofc_file_meta_expired(entry, now))
+            ofc_file_meta_clear(entry);
+        else if (entry->kind == kind && entry->infoClass == infoClass &&
+                 ofc_file_meta_match(entry, fsType, lpName, len, hash))
+            ret = entry;
+    }
+    return (ret);
+}
+
+/*
+ * Make an entry for a key, replacing the key's old entry, else a free
+ * one, else the one that expires first.  The caller fills in the rest.
+ */
+static FILE_META_ENTRY *
+ofc_file_meta_insert(FILE_META_KIND kind, OFC_FST_TYPE fsType,
+                     OFC_LPCTSTR lpName, OFC_SIZET len, OFC_UINT32 hash,
+                     OFC_INT infoClass, OFC_MSTIME now) {
+    FILE_META_ENTRY *entry;
+    FILE_META_ENTRY *victim;
+    OFC_INT i;
+
+    victim = ofc_file_meta_find(kind, fsType, lpName, len, hash,
+                                infoClass, now);
+    for (i = 0; i < FILE_META_WAYS && victim == OFC_NULL; i++) {
+        entry = &ofc_file_meta[(hash + i) % OFC_FILE_META_CACHE];
+        if (entry->kind == FILE_META_FREE)
+            victim = entry;
+    }
+    for (i = 0; i < FILE_META_WAYS && victim == OFC_NULL; i++) {
+        entry = &ofc_file_meta[(hash + i) % OFC_FILE_META_CACHE];
+        if (i == 0 || (OFC_INT32) ((OFC_UINT32) entry->expires -
+                                   (OFC_UINT32) victim->expires) < 0)
+            victim = entry;
+    }
+    ofc_file_meta_clear(victim);
+
+    if (kind == FILE_META_LISTING) {
+        /*
+         * Listings are large, so fewer are kept
+         */
+        if (ofc_file_meta_listings >= OFC_FILE_META_LISTINGS) {
+            entry = OFC_NULL;
+            for (i = 0; i < OFC_FILE_META_CACHE; i++) {
+                if (ofc_file_meta[i].kind == FILE_META_LISTING &&
+                    (entry == OFC_NULL ||
+                     (OFC_INT32) ((OFC_UINT32) ofc_file_meta[i].expires -
+                                  (OFC_UINT32) entry->expires) < 0))
+                    entry = &ofc_file_meta[i];
+            }
+            if (entry != OFC_NULL)
+                ofc_file_meta_clear(entry);
+        }
+        ofc_file_meta_listings++;
+    }
+
+    victim->kind = kind;
+    victim->fsType = fsType;
+    victim->lpName = ofc_malloc((len + 1) * sizeof(OFC_TCHAR));
+    ofc_memcpy(victim->lpName, lpName, len * sizeof(OFC_TCHAR));
+    victim->lpName[len] = TCHAR_EOS;
+    victim->len = len;
+    victim->infoClass = infoClass;
+    victim->hash = hash;
+    victim->dir = ofc_file_meta_hash(fsType, lpName,
+                                     ofc_file_meta_dir(lpName, len));
+    victim->expires = now + OFC_FILE_META_TTL;
+    victim->error = OFC_ERROR_SUCCESS;
+    ofc_file_meta_inserted++;
+    return (victim);
+}
+
+static OFC_VOID ofc_file_meta_drop(OFC_FST_TYPE fsType, OFC_LPCTSTR lpName,
+                                   OFC_SIZET len) {
+    FILE_META_ENTRY *entry;
+    OFC_UINT32 hash;
+    OFC_INT i;
+
+    hash = ofc_file_meta_hash(fsType, lpName, len);
+    for (i = 0; i < FILE_META_WAYS; i++) {
+        entry = &ofc_file_meta[(hash + i) % OFC_FILE_META_CACHE];
+        if (ofc_file_meta_match(entry, fsType, lpName, len, hash))
+            ofc_file_meta_clear(entry);
+    }
+}
+
+/*
+ * Only a missing name is worth remembering.  Other errors may not last.
+ */
+static OFC_BOOL ofc_file_meta_negative(OFC_DWORD error) {
+    return (error == OFC_ERROR_FILE_NOT_FOUND ||
+            error == OFC_ERROR_PATH_NOT_FOUND);
+}
+
+static OFC_SIZET
+ofc_file_meta_info_size(OFC_FILE_INFO_BY_HANDLE_CLASS infoClass) {
+    OFC_SIZET size;
+
+    switch (infoClass) {
+        case OfcFileBasicInfo:
+            size = sizeof(OFC_FILE_BASIC_INFO);
+            break;
+        case OfcFileStandardInfo:
+            size = sizeof(OFC_FILE_STANDARD_INFO);
+            break;
+        case OfcFileNetworkOpenInfo:
+            size = sizeof(OFC_FILE_NETWORK_OPEN_INFO);
+            break;
+        case OfcFileAttributeTagInfo:
+            size = sizeof(OFC_FILE_ATTRIBUTE_TAG_INFO);
+            break;
+        default:
+            /* Variable length, or not worth keeping */
+            size = 0;
+            break;
+    }
+    return (size);
+}
+
+/*
+ * Hand a recorded listing to the cache, or drop it if something changed
+ * while it was read
+ */
+static OFC_VOID ofc_file_meta_install(OFC_FILE_CONTEXT *fileContext) {
+    FILE_META_ENTRY *entry;
+    OFC_SIZET len;
+
+    len = ofc_tstrlen(fileContext->lpMetaName);
+    ofc_lock(ofc_file_meta_lock);
+    if (fileContext->listingGeneration == ofc_file_meta_generation) {
+        entry = ofc_file_meta_insert(FILE_META_LISTING, fileContext->fsType,
+                                     fileContext->lpMetaName, len,
+                                     ofc_file_meta_hash(fileContext->fsType,
+                                                        fileContext->lpMetaName,
+                                                        len),
+                                     0, ofc_time_get_now());
+        entry->u.listing = fileContext->listing;
+    } else
+        ofc_file_meta_release(fileContext->listing);
+    ofc_unlock(ofc_file_meta_lock);
+    fileContext->listing = OFC_NULL;
+}
+
+static OFC_VOID ofc_file_meta_abandon(OFC_FILE_CONTEXT *fileContext) {
+    if (fileContext->listing != OFC_NULL) {
+        ofc_file_meta_release(fileContext->listing);
+        fileContext->listing = OFC_NULL;
+    }
+}
+#endif
+
+static OFC_VOID ofc_file_meta_open(OFC_FILE_CONTEXT *fileContext,
+                                   OFC_BOOL cacheable,
+                                   OFC_LPCTSTR lpMappedName) {
+#if (OFC_FILE_META_CACHE > 0)
+    fileContext->lpMetaName = OFC_NULL;
+    if (lpMappedName != OFC_NULL)
+        fileContext->lpMetaName = ofc_tstrdup(lpMappedName);
+    fileContext->metaCache = cacheable;
+    fileContext->metaInserted = OFC_ATOMIC_LOAD(&ofc_file_meta_inserted) - 1;
+    fileContext->listing = OFC_NULL;
+    fileContext->listingNext = -1;
+#endif
+}
+
+static OFC_VOID ofc_file_meta_close(OFC_FILE_CONTEXT *fileContext) {
+#if (OFC_FILE_META_CACHE > 0)
+    ofc_file_meta_abandon(fileContext);
+    if (fileContext->lpMetaName != OFC_NULL)
+        ofc_free(fileContext->lpMetaName);
+    fileContext->lpMetaName = OFC_NULL;
+#endif
+}
+
+/*
+ * Forget a name that has changed, and the listings of its directory.
+ * The directory itself has changed if the name was created or removed.
+ */
+static OFC_VOID ofc_file_meta_forget(OFC_FST_TYPE fsType,
+                                     OFC_LPCTSTR lpName) {
+#if (OFC_FILE_META_CACHE > 0)
+    OFC_SIZET len;
+    OFC_SIZET dirlen;
+    OFC_UINT32 dir;
+    OFC_INT i;
+
+    if (lpName != OFC_NULL) {
+        len = ofc_tstrlen(lpName);
+        dirlen = ofc_file_meta_dir(lpName, len);
+        dir = ofc_file_meta_hash(fsType, lpName, dirlen);
+
+        ofc_lock(ofc_file_meta_lock);
+        ofc_file_meta_generation++;
+        ofc_file_meta_drop(fsType, lpName, len);
+        ofc_file_meta_drop(fsType, lpName, dirlen);
+        for (i = 0; i < OFC_FILE_META_CACHE && ofc_file_meta_listings > 0;
+             i++) {
+            if (ofc_file_meta[i].kind == FILE_META_LISTING &&
+                ofc_file_meta[i].fsType == fsType &&
+                ofc_file_meta[i].dir == dir)
+                ofc_file_meta_clear(&ofc_file_meta[i]);
+        }
+        ofc_unlock(ofc_file_meta_lock);
+    }
+#endif
+}
+
+/*
+ * Forget everything, when a change may reach below a directory
+ */
+static OFC_VOID ofc_file_meta_flush(OFC_VOID) {
+#if (OFC_FILE_META_CACHE > 0)
+    OFC_INT i;
+
+    ofc_lock(ofc_file_meta_lock);
+    ofc_file_meta_generation++;
+    for (i = 0; i < OFC_FILE_META_CACHE; i++)
+        ofc_file_meta_clear(&ofc_file_meta[i]);
+    ofc_unlock(ofc_file_meta_lock);
+#endif
+}
+
+/*
+ * The file open on a handle has changed
+ */
+static OFC_VOID ofc_file_meta_changed(OFC_FILE_CONTEXT *fileContext) {
+#if (OFC_FILE_META_CACHE > 0)
+    OFC_UINT32 inserted;
+
+    inserted = OFC_ATOMIC_LOAD(&ofc_file_meta_inserted);
+    if (fileContext->lpMetaName != OFC_NULL &&
+        fileContext->metaInserted != inserted) {
+        ofc_file_meta_forget(fileContext->fsType, fileContext->lpMetaName);
+        fileContext->metaInserted = inserted;
+    }
+#endif
+}
+
+static OFC_BOOL
+ofc_file_meta_attributes(OFC_FST_TYPE fsType, OFC_BOOL cacheable,
+                         OFC_LPCTSTR lpName,
+                         OFC_GET_FILEEX_INFO_LEVELS fInfoLevelId,
+                         OFC_LPVOID lpFileInformation) {
+    OFC_BOOL ret;
+#if (OFC_FILE_META_CACHE > 0)
+    FILE_META_ENTRY *entry;
+    OFC_SIZET len;
+    OFC_UINT32 hash;
+    OFC_UINT32 generation;
+    OFC_MSTIME now;
+    OFC_DWORD error;
+    OFC_BOOL hit;
+
+    if (cacheable && lpName != OFC_NULL &&
+        fInfoLevelId == OfcGetFileExInfoStandard) {
+        len = ofc_tstrlen(lpName);
+        hash = ofc_file_meta_hash(fsType, lpName, len);
+        now = ofc_time_get_now();
+        error = OFC_ERROR_SUCCESS;
+
+        ofc_lock(ofc_file_meta_lock);
+        entry = ofc_file_meta_find(FILE_META_ATTRIBUTES, fsType, lpName,
+                                   len, hash, 0, now);
+        hit = (entry != OFC_NULL);
+        if (hit) {
+            error = entry->error;
+            if (error == OFC_ERROR_SUCCESS)
+                ofc_memcpy(lpFileInformation, &entry->u.attributes,
+                           sizeof(OFC_WIN32_FILE_ATTRIBUTE_DATA));
+        }
+        generation = ofc_file_meta_generation;
+        ofc_unlock(ofc_file_meta_lock);
+
+        if (hit) {
+            ofc_file_count(&ofc_file_meta_hits, 1);
+            ret = (error == OFC_ERROR_SUCCESS);
+            if (!ret)
+                ofc_thread_set_variable(OfcLastError,
+                                        (OFC_DWORD_PTR) error);
+        } else {
+            ofc_file_count(&ofc_file_meta_misses, 1);
+            ret = OfcFSGetFileAttributesEx(fsType, lpName, fInfoLevelId,
+                                           lpFileInformation);
+            if (!ret)
+                error = OfcGetLastError();
+            if (ret || ofc_file_meta_negative(error)) {
+                ofc_lock(ofc_file_meta_lock);
+                if (generation == ofc_file_meta_generation) {
+                    entry = ofc_file_meta_insert(FILE_META_ATTRIBUTES,
+                                                 fsType, lpName, len, hash,
+                                                 0, now);
+                    entry->error = error;
+                    if (ret)
+                        ofc_memcpy(&entry->u.attributes, lpFileInformation,
+                                   sizeof(OFC_WIN32_FILE_ATTRIBUTE_DATA));
+                }
+                ofc_unlock(ofc_file_meta_lock);
+            }
+        }
+    } else
+#endif
+        ret = OfcFSGetFileAttributesEx(fsType, lpName, fInfoLevelId,
+                                       lpFileInformation);
+    return (ret);
+}
+
+static OFC_BOOL
+ofc_file_meta_info(OFC_FILE_CONTEXT *fileContext,
+                   OFC_FILE_INFO_BY_HANDLE_CLASS FileInformationClass,
+                   OFC_LPVOID lpFileInformation, OFC_DWORD dwBufferSize) {
+    OFC_BOOL ret;
+#if (OFC_FILE_META_CACHE > 0)
+    FILE_META_ENTRY *entry;
+    OFC_SIZET size;
+    OFC_SIZET len;
+    OFC_UINT32 hash;
+    OFC_UINT32 generation;
+    OFC_MSTIME now;
+    OFC_BOOL hit;
+
+    size = ofc_file_meta_info_size(FileInformationClass);
+    if (fileContext->metaCache && fileContext->lpMetaName != OFC_NULL &&
+        size > 0 && dwBufferSize >= size && lpFileInformation != OFC_NULL) {
+        len = ofc_tstrlen(fileContext->lpMetaName);
+        hash = ofc_file_meta_hash(fileContext->fsType,
+                                  fileContext->lpMetaName, len);
+        now = ofc_time_get_now();
+
+        ofc_lock(ofc_file_meta_lock);
+        entry = ofc_file_meta_find(FILE_META_INFO, fileContext->fsType,
+                                   fileContext->lpMetaName, len, hash,
+                                   FileInformationClass, now);
+        hit = (entry != OFC_NULL);
+        if (hit)
+            ofc_memcpy(lpFileInformation, &entry->u, size);
+        generation = ofc_file_meta_generation;
+        ofc_unlock(ofc_file_meta_lock);
+
+        if (hit) {
+            ofc_file_count(&ofc_file_meta_hits, 1);
+            ret = OFC_TRUE;
+        } else {
+            ofc_file_count(&ofc_file_meta_misses, 1);
+            ret = OfcFSGetFileInformationByHandleEx(fileContext->fsType,
+                                                    fileContext->fsHandle,
+                                                    FileInformationClass,
+                                                    lpFileInformation,
+                                                    dwBufferSize);
+            if (ret) {
+                ofc_lock(ofc_file_meta_lock);
+                if (generation == ofc_file_meta_generation) {
+                    entry = ofc_file_meta_insert(FILE_META_INFO,
+                                                 fileContext->fsType,
+                                                 fileContext->lpMetaName,
+                                                 len, hash,
+                                                 FileInformationClass, now);
+                    ofc_memcpy(&entry->u, lpFileInformation, size);
+                }
+                ofc_unlock(ofc_file_meta_lock);
+            }
+        }
+    } else
+#endif
+        ret = OfcFSGetFileInformationByHandleEx(fileContext->fsType,
+                                                fileContext->fsHandle,
+                                                FileInformationClass,
+                                                lpFileInformation,
+                                                dwBufferSize);
+    return (ret);
+}
+
+/*
+ * Return the next entry of a listing read from the cache.  Returns
+ * OFC_FALSE if the search isn't reading one.
+ */
+static OFC_BOOL ofc_file_meta_find_next(OFC_FILE_CONTEXT *fileContext,
+                                        OFC_LPWIN32_FIND_DATAW lpFindFileData,
+                                        OFC_BOOL *more, OFC_BOOL *ret) {
+    OFC_BOOL served;
+
+    served = OFC_FALSE;
+#if (OFC_FILE_META_CACHE > 0)
+    if (fileContext->listing != OFC_NULL && fileContext->listingNext >= 0) {
+        served = OFC_TRUE;
+        if (fileContext->listingNext < fileContext->listing->count) {
+            ofc_memcpy(lpFindFileData,
+                       &fileContext->listing->find[fileContext->listingNext],
+                       sizeof(OFC_WIN32_FIND_DATAW));
+            fileContext->listingNext++;
+            *ret = OFC_TRUE;
+        } else {
+            ofc_thread_set_variable(OfcLastError,
+                                    (OFC_DWORD_PTR) OFC_ERROR_NO_MORE_FILES);
+            *ret = OFC_FALSE;
+        }
+        *more = (fileContext->listingNext < fileContext->listing->count);
+    }
+#endif
+    return (served);
+}
+
+/*
+ * Start a search from a cached listing.  On a miss, start recording
+ * the listing the file system returns.  Returns OFC_TRUE if the first
+ * entry came from the cache.
+ */
+static OFC_BOOL ofc_file_meta_find_first(OFC_FILE_CONTEXT *fileContext,
+                                         OFC_LPWIN32_FIND_DATAW
+                                         lpFindFileData,
+                                         OFC_BOOL *more) {
+    OFC_BOOL served;
+#if (OFC_FILE_META_CACHE > 0)
+    FILE_META_ENTRY *entry;
+    OFC_FILE_META_LIST *listing;
+    OFC_SIZET len;
+    OFC_BOOL ret;
+#endif
+
+    served = OFC_FALSE;
+#if (OFC_FILE_META_CACHE > 0)
+    if (fileContext->metaCache && fileContext->lpMetaName != OFC_NULL) {
+        len = ofc_tstrlen(fileContext->lpMetaName);
+        listing = OFC_NULL;
+
+        ofc_lock(ofc_file_meta_lock);
+        entry = ofc_file_meta_find(FILE_META_LISTING, fileContext->fsType,
+                                   fileContext->lpMetaName, len,
+                                   ofc_file_meta_hash(fileContext->fsType,
+                                                      fileContext->lpMetaName,
+                                                      len),
+                                   0, ofc_time_get_now());
+        if (entry != OFC_NULL) {
+            listing = entry->u.listing;
+            OFC_ATOMIC_ADD(&listing->refs, 1);
+        }
+        fileContext->listingGeneration = ofc_file_meta_generation;
+        ofc_unlock(ofc_file_meta_lock);
+
+        if (listing != OFC_NULL) {
+            ofc_file_count(&ofc_file_meta_hits, 1);
+            fileContext->listing = listing;
+            fileContext->listingNext = 0;
+            served = ofc_file_meta_find_next(fileContext, lpFindFileData,
+                                             more, &ret);
+        } else {
+            ofc_file_count(&ofc_file_meta_misses, 1);
+            listing = ofc_malloc(sizeof(OFC_FILE_META_LIST) +
+                                 (FILE_META_LISTING_FIRST - 1) *
+                                 sizeof(OFC_WIN32_FIND_DATAW));
+            if (listing != OFC_NULL) {
+                listing->refs = 1;
+                listing->count = 0;
+                listing->size = FILE_META_LISTING_FIRST;
+            }
+            fileContext->listing = listing;
+            fileContext->listingNext = -1;
+        }
+    }
+#endif
+    return (served);
+}
+
+/*
+ * Add what the file system returned to the listing being recorded, and
+ * cache it once the search reaches the end
+ */
+static OFC_VOID ofc_file_meta_record(OFC_FILE_CONTEXT *fileContext,
+                                     OFC_BOOL ret,
+                                     OFC_LPWIN32_FIND_DATAW lpFindFileData,
+                                     OFC_BOOL *more) {
+#if (OFC_FILE_META_CACHE > 0)
+    OFC_FILE_META_LIST *listing;
+    OFC_INT size;
+
+    listing = fileContext->listing;
+    if (listing != OFC_NULL && fileContext->listingNext < 0) {
+        if (ret) {
+            if (listing->count == listing->size) {
+                size = OFC_MIN(listing->size * 2, OFC_FILE_META_LISTING);
+                listing = OFC_NULL;
+                if (size > fileContext->listing->size)
+                    listing = ofc_realloc(fileContext->listing,
+                                          sizeof(OFC_FILE_META_LIST) +
+                                          (size - 1) *
+                                          sizeof(OFC_WIN32_FIND_DATAW));
+                if (listing == OFC_NULL)
+                    ofc_file_meta_abandon(fileContext);
+                else {
+                    listing->size = size;
+                    fileContext->listing = listing;
+                }
+            }
+            if (listing != OFC_NULL) {
+                ofc_memcpy(&listing->find[listing->count], lpFindFileData,
+                           sizeof(OFC_WIN32_FIND_DATAW));
+                listing->count++;
+                if (!*more)
+                    ofc_file_meta_install(fileContext);
+            }
+        } else if (listing->count > 0 &&
+                   OfcGetLastError() == OFC_ERROR_NO_MORE_FILES)
+            ofc_file_meta_install(fileContext);
+        else
+            ofc_file_meta_abandon(fileContext);
+    }
+#endif
+}
+#if defined(OFC_FILE_CACHE)
+static volatile OFC_SIZET ofc_file_cache_used;
+
+/*
+ * Take a buffer out of the global budget
+ */
+static OFC_CHAR *ofc_file_cache_alloc(OFC_DWORD size) {
+    OFC_CHAR *buf;
+
+    buf = OFC_NULL;
+    if (OFC_ATOMIC_ADD(&ofc_file_cache_used, (OFC_SIZET) size) <=
+        OFC_FILE_CACHE_BUDGET)
+        buf = ofc_malloc(size);
+    if (buf == OFC_NULL)
+        OFC_ATOMIC_SUB(&ofc_file_cache_used, (OFC_SIZET) size);
+    return (buf);
+}
+
+static OFC_VOID ofc_file_cache_free(OFC_CHAR *buf, OFC_DWORD size) {
+    if (buf != OFC_NULL) {
+        ofc_free(buf);
+        OFC_ATOMIC_SUB(&ofc_file_cache_used, (OFC_SIZET) size);
+    }
+}
+
+/*
+ * A handle that shares write access gets no cache.  One that shares
+ * read access keeps read-ahead but not write-behind, so another opener
+ * sees each write as soon as it returns.
+ */
+static OFC_BOOL ofc_file_cache_wanted(OFC_FST_TYPE fsType,
+                                      OFC_DWORD dwShareMode,
+                                      OFC_DWORD dwFlagsAndAttributes) {
+    OFC_BOOL ret;
+
+    ret = OFC_TRUE;
+    if (dwShareMode & OFC_FILE_SHARE_WRITE)
+        ret = OFC_FALSE;
+    if (dwFlagsAndAttributes & (OFC_FILE_FLAG_OVERLAPPED |
+                                OFC_FILE_FLAG_NO_BUFFERING |
+                                OFC_FILE_FLAG_WRITE_THROUGH))
+        ret = OFC_FALSE;
+    switch (fsType) {
+        case OFC_FST_PIPE:
+        case OFC_FST_MAILSLOT:
+        case OFC_FST_BROWSE_WORKGROUPS:
+        case OFC_FST_BROWSE_SERVERS:
+        case OFC_FST_BROWSE_SHARES:
+        case OFC_FST_BOOKMARKS:
+            ret = OFC_FALSE;
+            break;
+        default:
+            break;
+    }
+    return (ret);
+}
+
+static OFC_FILE_CACHE_CONTEXT *
+ofc_file_cache_create(OFC_DWORD dwShareMode,
+                      OFC_DWORD dwFlagsAndAttributes) {
+    OFC_FILE_CACHE_CONTEXT *cache;
+
+    cache = ofc_malloc(sizeof(OFC_FILE_CACHE_CONTEXT));
+    if (cache != OFC_NULL) {
+        cache->lock = ofc_lock_init();
+        cache->pos = 0;
+        cache->fs_pos = 0;
+        cache->read_next = 0;
+        cache->write_next = -1;
+        cache->random = (dwFlagsAndAttributes &
+                         OFC_FILE_FLAG_RANDOM_ACCESS) ? OFC_TRUE : OFC_FALSE;
+        cache->write_behind = (dwShareMode & OFC_FILE_SHARE_READ) ?
+                              OFC_FALSE : OFC_TRUE;
+        cache->window = 0;
+        if (dwFlagsAndAttributes & OFC_FILE_FLAG_SEQUENTIAL_SCAN &&
+            !cache->random)
+            cache->window = OFC_FILE_CACHE_READ_MIN;
+        cache->rbuf = OFC_NULL;
+        cache->rsize = 0;
+        cache->roff = 0;
+        cache->rlen = 0;
+        cache->wbuf = OFC_NULL;
+        cache->woff = 0;
+        cache->wlen = 0;
+    }
+    return (cache);
+}
+
+static OFC_VOID ofc_file_cache_destroy(OFC_FILE_CACHE_CONTEXT *cache) {
+    ofc_file_cache_free(cache->rbuf, cache->rsize);
+    ofc_file_cache_free(cache->wbuf, OFC_FILE_CACHE_WRITE);
+    ofc_lock_destroy(cache->lock);
+    ofc_free(cache);
+}
+
+/*
+ * Move the file system's file pointer to an offset
+ */
+static OFC_BOOL ofc_file_cache_seek(OFC_FILE_CONTEXT *fileContext,
+                                    OFC_OFFT offset) {
+    OFC_FILE_CACHE_CONTEXT *cache;
+    OFC_LONG high;
+    OFC_DWORD low;
+    OFC_BOOL ret;
+
+    cache = fileContext->cache;
+    ret = OFC_TRUE;
+    if (cache->fs_pos != offset) {
+        high = (OFC_LONG) (offset >> 32);
+        low = OfcFSSetFilePointer(fileContext->fsType, fileContext->fsHandle,
+                                  (OFC_LONG) (offset & 0xFFFFFFFF), &high,
+                                  OFC_FILE_BEGIN);
+        if (low == OFC_INVALID_SET_FILE_POINTER &&
+            OfcGetLastError() != OFC_ERROR_SUCCESS) {
+            cache->fs_pos = -1;
+            ret = OFC_FALSE;
+        } else
+            cache->fs_pos = offset;
+    }
+    return (ret);
+}
+
+/*
+ * Write out the write-behind buffer.  The buffer is emptied even if the
+ * write fails, so the error is reported once.
+ */
+static OFC_BOOL ofc_file_cache_flush(OFC_FILE_CONTEXT *fileContext) {
+    OFC_FILE_CACHE_CONTEXT *cache;
+    OFC_DWORD written;
+    OFC_BOOL ret;
+
+    cache = fileContext->cache;
+    ret = OFC_TRUE;
+    if (cache->wlen > 0) {
+        written = 0;
+        ret = ofc_file_cache_seek(fileContext, cache->woff);
+        if (ret)
+            ret = OfcFSWriteFile(fileContext->fsType, fileContext->fsHandle,
+                                 cache->wbuf, cache->wlen, &written,
+                                 OFC_HANDLE_NULL);
+        if (ret) {
+            cache->fs_pos += written;
+            if (written < cache->wlen) {
+                ofc_thread_set_variable(OfcLastError,
+                                        (OFC_DWORD_PTR)
+                                                OFC_ERROR_HANDLE_DISK_FULL);
+                ret = OFC_FALSE;
+            }
+        } else
+            cache->fs_pos = -1;
+        cache->wlen = 0;
+        ofc_file_count(&ofc_file_cache_flushes, 1);
+        ofc_file_meta_changed(fileContext);
+    }
+    return (ret);
+}
+
+/*
+ * Bring the file system up to date with the cache before an operation
+ * the cache doesn't handle.  The file system's file pointer is left at
+ * the caller's.
+ */
+static OFC_BOOL ofc_file_cache_sync(OFC_FILE_CONTEXT *fileContext,
+                                    OFC_BOOL invalidate) {
+    OFC_BOOL ret;
+
+    ret = ofc_file_cache_flush(fileContext);
+    if (invalidate)
+        fileContext->cache->rlen = 0;
+    if (ret)
+        ret = ofc_file_cache_seek(fileContext, fileContext->cache->pos);
+    return (ret);
+}
+
+/*
+ * Read at the file system's file pointer, which has been moved to pos
+ */
+static OFC_BOOL ofc_file_cache_fill(OFC_FILE_CONTEXT *fileContext,
+                                    OFC_CHAR *buf, OFC_DWORD len,
+                                    OFC_DWORD *got) {
+    OFC_FILE_CACHE_CONTEXT *cache;
+    OFC_BOOL ret;
+
+    cache = fileContext->cache;
+    *got = 0;
+    ret = ofc_file_cache_seek(fileContext, cache->pos);
+    if (ret)
+        ret = OfcFSReadFile(fileContext->fsType, fileContext->fsHandle,
+                            buf, len, got, OFC_HANDLE_NULL);
+    if (ret)
+        cache->fs_pos += *got;
+    else
+        cache->fs_pos = -1;
+    return (ret);
+}
+
+static OFC_BOOL ofc_file_cache_read(OFC_FILE_CONTEXT *fileContext,
+                                    OFC_CHAR *buf, OFC_DWORD len,
+                                    OFC_DWORD *read) {
+    OFC_FILE_CACHE_CONTEXT *cache;
+    OFC_BOOL sequential;
+    OFC_DWORD done;
+    OFC_DWORD remaining;
+    OFC_DWORD fetch;
+    OFC_DWORD got;
+    OFC_DWORD n;
+    OFC_BOOL ret;
+
+    cache = fileContext->cache;
+    done = 0;
+    sequential = cache->pos == cache->read_next;
+
+    ret = ofc_file_cache_flush(fileContext);
+
+    if (ret && cache->rlen > 0 && cache->pos >= cache->roff &&
+        cache->pos < cache->roff + cache->rlen) {
+        n = (OFC_DWORD) (cache->roff + cache->rlen - cache->pos);
+        n = OFC_MIN(n, len);
+        ofc_memcpy(buf, cache->rbuf + (cache->pos - cache->roff), n);
+        cache->pos += n;
+        done = n;
+    }
+
+    if (ret && done == len)
+        ofc_file_count(&ofc_file_cache_hits, 1);
+    else if (ret) {
+        ofc_file_count(&ofc_file_cache_misses, 1);
+        remaining = len - done;
+        cache->rlen = 0;
+
+        if (cache->random)
+            cache->window = 0;
+        else if (!sequential) {
+            /*
+             * Give the buffer back until reading is sequential again
+             */
+            cache->window = 0;
+            ofc_file_cache_free(cache->rbuf, cache->rsize);
+            cache->rbuf = OFC_NULL;
+            cache->rsize = 0;
+        } else if (cache->window == 0)
+            cache->window = OFC_FILE_CACHE_READ_MIN;
+        else if (cache->window < OFC_FILE_CACHE_READ_MAX)
+            cache->window *= 2;
+
+        fetch = cache->window;
+        if (fetch > remaining && cache->rsize < fetch) {
+            ofc_file_cache_free(cache->rbuf, cache->rsize);
+            cache->rsize = 0;
+            cache->rbuf = ofc_file_cache_alloc(fetch);
+            if (cache->rbuf != OFC_NULL)
+                cache->rsize = fetch;
+        }
+        fetch = OFC_MIN(fetch, cache->rsize);
+
+        if (fetch > remaining) {
+            ret = ofc_file_cache_fill(fileContext, cache->rbuf, fetch, &got);
+            if (ret) {
+                cache->roff = cache->pos;
+                cache->rlen = got;
+                n = OFC_MIN(got, remaining);
+                ofc_memcpy(buf + done, cache->rbuf, n);
+                ofc_file_count(&ofc_file_cache_read_ahead, got - n);
+                cache->pos += n;
+                done += n;
+            }
+        } else {
+            ret = ofc_file_cache_fill(fileContext, buf + done, remaining,
+                                      &got);
+            if (ret) {
+                cache->pos += got;
+                done += got;
+            }
+        }
+        /*
+         * What was read before a failure is still returned
+         */
+        if (done > 0)
+            ret = OFC_TRUE;
+    }
+    cache->read_next = cache->pos;
+    if (read != OFC_NULL)
+        *read = done;
+    return (ret);
+}
+
+static OFC_BOOL ofc_file_cache_write(OFC_FILE_CONTEXT *fileContext,
+                                     OFC_LPCVOID buf, OFC_DWORD len,
+                                     OFC_DWORD *written) {
+    OFC_FILE_CACHE_CONTEXT *cache;
+    OFC_DWORD done;
+    OFC_BOOL ret;
+
+    cache = fileContext->cache;
+    done = 0;
+    ret = OFC_TRUE;
+
+    if (cache->rlen > 0 && cache->pos < cache->roff + cache->rlen &&
+        cache->pos + len > cache->roff)
+        cache->rlen = 0;
+
+    if (cache->wlen > 0 && cache->pos == cache->woff + cache->wlen &&
+        len <= OFC_FILE_CACHE_WRITE - cache->wlen) {
+        ofc_memcpy(cache->wbuf + cache->wlen, buf, len);
+        cache->wlen += len;
+        ofc_file_count(&ofc_file_cache_coalesced, 1);
+        done = len;
+    } else {
+        ret = ofc_file_cache_flush(fileContext);
+        /*
+         * Only a write that follows a successful one is held, so an
+         * error such as a handle without write access is seen at once
+         */
+        if (ret && cache->write_behind && cache->pos == cache->write_next &&
+            len < OFC_FILE_CACHE_WRITE) {
+            if (cache->wbuf == OFC_NULL)
+                cache->wbuf = ofc_file_cache_alloc(OFC_FILE_CACHE_WRITE);
+            if (cache->wbuf != OFC_NULL) {
+                ofc_memcpy(cache->wbuf, buf, len);
+                cache->woff = cache->pos;
+                cache->wlen = len;
+                ofc_file_count(&ofc_file_cache_coalesced, 1);
+                done = len;
+            }
+        }
+        if (ret && done == 0 && len > 0) {
+            ret = ofc_file_cache_seek(fileContext, cache->pos);
+            if (ret)
+                ret = OfcFSWriteFile(fileContext->fsType,
+                                     fileContext->fsHandle,
+                                     buf, len, &done, OFC_HANDLE_NULL);
+            if (ret)
+                cache->fs_pos += done;
+            else {
+                cache->fs_pos = -1;
+                done = 0;
+            }
+        }
+    }
+    cache->pos += done;
+    if (ret)
+        cache->write_next = cache->pos;
+    if (written != OFC_NULL)
+        *written = done;
+    return (ret);
+}
+
+/*
+ * Position the caller's file pointer.  Only a move from the end needs
+ * the file system.
+ */
+static OFC_DWORD ofc_file_cache_set_pointer(OFC_FILE_CONTEXT *fileContext,
+                                            OFC_LONG lDistanceToMove,
+                                            OFC_PLONG lpDistanceToMoveHigh,
+                                            OFC_DWORD dwMoveMethod) {
+    OFC_FILE_CACHE_CONTEXT *cache;
+    OFC_OFFT distance;
+    OFC_OFFT pos;
+    OFC_DWORD ret;
+
+    cache = fileContext->cache;
+    ret = OFC_INVALID_SET_FILE_POINTER;
+    if (lpDistanceToMoveHigh != OFC_NULL)
+        distance = ((OFC_OFFT) *lpDistanceToMoveHigh << 32) |
+                   (OFC_DWORD) lDistanceToMove;
+    else
+        distance = lDistanceToMove;
+
+    if (dwMoveMethod == OFC_FILE_BEGIN || dwMoveMethod == OFC_FILE_CURRENT) {
+        pos = distance;
+        if (dwMoveMethod == OFC_FILE_CURRENT)
+            pos += cache->pos;
+        if (pos < 0)
+            ofc_thread_set_variable(OfcLastError,
+                                    (OFC_DWORD_PTR) OFC_ERROR_NEGATIVE_SEEK);
+        else {
+            cache->pos = pos;
+            ofc_thread_set_variable(OfcLastError,
+                                    (OFC_DWORD_PTR) OFC_ERROR_SUCCESS);
+            ret = (OFC_DWORD) (pos & 0xFFFFFFFF);
+            if (lpDistanceToMoveHigh != OFC_NULL)
+                *lpDistanceToMoveHigh = (OFC_LONG) (pos >> 32);
+        }
+    } else if (ofc_file_cache_flush(fileContext)) {
+        ret = OfcFSSetFilePointer(fileContext->fsType, fileContext->fsHandle,
+                                  lDistanceToMove, lpDistanceToMoveHigh,
+                                  dwMoveMethod);
+        if (ret == OFC_INVALID_SET_FILE_POINTER &&
+            OfcGetLastError() != OFC_ERROR_SUCCESS)
+            cache->fs_pos = -1;
+        else {
+            pos = ret;
+            if (lpDistanceToMoveHigh != OFC_NULL)
+                pos |= (OFC_OFFT) *lpDistanceToMoveHigh << 32;
+            cache->pos = pos;
+            cache->fs_pos = pos;
+        }
+    }
+    return (ret);
+}
+#endif
+
+/*
+ * Around an operation the cache doesn't handle.  The write-behind
+ * buffer is written out and the file system's file pointer put where
+ * the caller expects it.  invalidate drops the read-ahead, for an
+ * operation that may change the file.  moved is how far the operation
+ * moved the file pointer.
+ */
+static OFC_BOOL ofc_file_cache_enter(OFC_FILE_CONTEXT *fileContext,
+                                     OFC_BOOL invalidate) {
+    OFC_BOOL ret;
+
+    ret = OFC_TRUE;
+#if defined(OFC_FILE_CACHE)
+    if (fileContext->cache != OFC_NULL) {
+        ofc_lock(fileContext->cache->lock);
+        ret = ofc_file_cache_sync(fileContext, invalidate);
+    }
+#endif
+    return (ret);
+}
+
+static OFC_VOID ofc_file_cache_leave(OFC_FILE_CONTEXT *fileContext,
+                                     OFC_DWORD moved) {
+#if defined(OFC_FILE_CACHE)
+    OFC_FILE_CACHE_CONTEXT *cache;
+
+    cache = fileContext->cache;
+    if (cache != OFC_NULL) {
+        cache->pos += moved;
+        if (cache->fs_pos >= 0)
+            cache->fs_pos += moved;
+        ofc_unlock(cache->lock);
+    }
+#endif
+}
+
 static OFC_FST_TYPE MapType(OFC_PATH *path) {
     OFC_FST_TYPE fstype;
     OFC_LPCTSTR server;
@@ -192,6 +1350,28 @@ static OFC_FST_TYPE MapType(OFC_PATH *path) {
     return (fstype);
 }
 
+/*
+ * Map a name through the path cache.  Only a remote name needs the
+ * parsed path, to tell browsing from file access.  The path is returned
+ * if it was parsed.  cacheable is set if the name's metadata may be
+ * cached.
+ */
+static OFC_FST_TYPE MapName(OFC_LPCTSTR lpFileName,
+                            OFC_LPTSTR *lppMappedName,
+                            OFC_PATH **path, OFC_BOOL *cacheable) {
+    OFC_FST_TYPE fstype;
+    OFC_BOOL remote;
+
+    *path = OFC_NULL;
+    ofc_path_lookupW(lpFileName, lppMappedName, &fstype, &remote,
+                     cacheable);
+    if (remote) {
+        *path = ofc_map_path(lpFileName, OFC_NULL);
+        fstype = MapType(*path);
+    }
+    return (fstype);
+}
+
 OFC_CORE_LIB OFC_HANDLE
 OfcCreateFileW(OFC_LPCTSTR lpFileName,
                OFC_DWORD dwDesiredAccess,
@@ -204,6 +1384,7 @@ OfcCreateFileW(OFC_LPCTSTR lpFileName,
     OFC_FILE_CONTEXT *fileContext;
     OFC_HANDLE retHandle;
     OFC_HANDLE hMappedTemplateHandle;
+    OFC_BOOL cacheable;
 
     fileContext = ofc_malloc(sizeof(OFC_FILE_CONTEXT));
 
@@ -212,7 +1393,8 @@ OfcCreateFileW(OFC_LPCTSTR lpFileName,
 #if defined(OFC_FILE_DEBUG)
     ofc_file_debug_alloc (fileContext, RETURN_ADDRESS()) ;
 #endif
-    ofc_path_mapW(lpFileName, &lpMappedFileName, &fileContext->fsType);
+    ofc_path_lookupW(lpFileName, &lpMappedFileName, &fileContext->fsType,
+                     OFC_NULL, &cacheable);
 
     hMappedTemplateHandle = OFC_HANDLE_NULL;
     if (hTemplateFile != OFC_HANDLE_NULL) {
@@ -242,8 +1424,19 @@ OfcCreateFileW(OFC_LPCTSTR lpFileName,
         ofc_file_debug_free (fileContext) ;
 #endif
         ofc_free(fileContext);
-    } else
+    } else {
+#if defined(OFC_FILE_CACHE)
+        fileContext->cache = OFC_NULL;
+        if (ofc_file_cache_wanted(fileContext->fsType, dwShareMode,
+                                  dwFlagsAndAttributes))
+            fileContext->cache = ofc_file_cache_create(dwShareMode,
+                                                       dwFlagsAndAttributes);
+#endif
+        ofc_file_meta_open(fileContext, cacheable, lpMappedFileName);
+        if (dwCreationDisposition != OFC_OPEN_EXISTING)
+            ofc_file_meta_forget(fileContext->fsType, lpMappedFileName);
         retHandle = ofc_handle_create(OFC_HANDLE_FILE, fileContext);
+    }
 
     ofc_free(lpMappedFileName);
 
@@ -279,6 +1472,8 @@ OfcCreateDirectoryW(OFC_LPCTSTR lpPathName,
     ofc_path_mapW(lpPathName, &lpMappedPathName, &type);
 
     ret = OfcFSCreateDirectory(type, lpMappedPathName, lpSecurityAttr);
+    if (ret)
+        ofc_file_meta_forget(type, lpMappedPathName);
 
     ofc_free(lpMappedPathName);
 
@@ -308,12 +1503,61 @@ OfcWriteFile(OFC_HANDLE hFile,
 
     fileContext = ofc_handle_lock(hFile);
     if (fileContext != OFC_NULL) {
-        ret = OfcFSWriteFile(fileContext->fsType,
-                             fileContext->fsHandle,
-                             lpBuffer,
-                             nNumberOfBytesToWrite,
-                             lpNumberOfBytesWritten,
-                             hOverlapped);
+#if defined(OFC_FILE_CACHE)
+        if (fileContext->cache != OFC_NULL &&
+            hOverlapped == OFC_HANDLE_NULL) {
+            ofc_lock(fileContext->cache->lock);
+            ret = ofc_file_cache_write(fileContext, lpBuffer,
+                                       nNumberOfBytesToWrite,
+                                       lpNumberOfBytesWritten);
+            ofc_unlock(fileContext->cache->lock);
+        } else
+#endif
+        {
+            ret = ofc_file_cache_enter(fileContext, OFC_TRUE);
+            if (ret)
+                ret = OfcFSWriteFile(fileContext->fsType,
+                                     fileContext->fsHandle,
+                                     lpBuffer,
+                                     nNumberOfBytesToWrite,
+                                     lpNumberOfBytesWritten,
+                                     hOverlapped);
+            ofc_file_cache_leave(fileContext, 0);
+        }
+        ofc_file_meta_changed(fileContext);
+        ofc_handle_unlock(hFile);
+    } else
+        ret = OFC_FALSE;
+
+    return (ret);
+}
+
+OFC_CORE_LIB OFC_BOOL
+OfcWriteFileGather(OFC_HANDLE hFile,
+                   OFC_IOVEC *iovec,
+                   OFC_INT veclen,
+                   OFC_LPDWORD lpNumberOfBytesWritten,
+                   OFC_HANDLE hOverlapped) {
+    OFC_FILE_CONTEXT *fileContext;
+    OFC_DWORD moved;
+    OFC_BOOL ret;
+
+    fileContext = ofc_handle_lock(hFile);
+    if (fileContext != OFC_NULL) {
+        moved = 0;
+        ret = ofc_file_cache_enter(fileContext, OFC_TRUE);
+        if (ret)
+            ret = OfcFSWriteFileGather(fileContext->fsType,
+                                       fileContext->fsHandle,
+                                       iovec,
+                                       veclen,
+                                       lpNumberOfBytesWritten,
+                                       hOverlapped);
+        if (ret && hOverlapped == OFC_HANDLE_NULL &&
+            lpNumberOfBytesWritten != OFC_NULL)
+            moved = *lpNumberOfBytesWritten;
+        ofc_file_cache_leave(fileContext, moved);
+        ofc_file_meta_changed(fileContext);
         ofc_handle_unlock(hFile);
     } else
         ret = OFC_FALSE;
@@ -321,6 +1565,34 @@ OfcWriteFile(OFC_HANDLE hFile,
     return (ret);
 }
 
+OFC_CORE_LIB OFC_BOOL
+OfcWriteFileMessage(OFC_HANDLE hFile,
+                    OFC_MESSAGE *msg,
+                    OFC_INT offset,
+                    OFC_DWORD nNumberOfBytesToWrite,
+                    OFC_LPDWORD lpNumberOfBytesWritten,
+                    OFC_HANDLE hOverlapped) {
+    OFC_IOVEC iovec[OFC_FILE_IOVEC_MAX];
+    OFC_INT veclen;
+    OFC_BOOL ret;
+
+    offset += msg->base;
+    veclen = ofc_iovec_fill(msg->map, offset,
+                            offset + nNumberOfBytesToWrite,
+                            iovec, OFC_FILE_IOVEC_MAX);
+    /*
+     * Nothing mapped at offset, so the range is outside the message
+     */
+    if (veclen == 0 && nNumberOfBytesToWrite > 0) {
+        ofc_thread_set_variable(OfcLastError,
+                                (OFC_DWORD_PTR) OFC_ERROR_INVALID_PARAMETER);
+        ret = OFC_FALSE;
+    } else
+        ret = OfcWriteFileGather(hFile, iovec, veclen,
+                                 lpNumberOfBytesWritten, hOverlapped);
+    return (ret);
+}
+
 OFC_CORE_LIB OFC_BOOL
 OfcTransactNamedPipe(OFC_HANDLE hFile,
                      OFC_LPVOID lpInBuffer,
@@ -353,12 +1625,23 @@ OFC_CORE_LIB OFC_BOOL
 OfcCloseHandle(OFC_HANDLE hObject) {
     OFC_FILE_CONTEXT *fileContext;
     OFC_BOOL ret;
+    OFC_BOOL flushed;
     OFC_HANDLE hOverlapped;
 
     fileContext = ofc_handle_lock(hObject);
     if (fileContext != OFC_NULL) {
+        /*
+         * The handle is closed even if the write-behind can't be written
+         */
+        flushed = ofc_file_cache_enter(fileContext, OFC_FALSE);
+        ofc_file_cache_leave(fileContext, 0);
         ret = OfcFSCloseHandle(fileContext->fsType,
-                               fileContext->fsHandle);
+                               fileContext->fsHandle) && flushed;
+        /*
+         * Closing may set times, or delete the file
+         */
+        ofc_file_meta_changed(fileContext);
+        ofc_file_meta_close(fileContext);
         for (hOverlapped =
                      (OFC_HANDLE) ofc_queue_first(fileContext->overlappedList);
              hOverlapped != OFC_HANDLE_NULL;
@@ -371,6 +1654,10 @@ OfcCloseHandle(OFC_HANDLE hObject) {
             OfcDestroyOverlapped(hObject, hOverlapped);
         }
         ofc_queue_destroy(fileContext->overlappedList);
+#if defined(OFC_FILE_CACHE)
+        if (fileContext->cache != OFC_NULL)
+            ofc_file_cache_destroy(fileContext->cache);
+#endif
         ofc_handle_unlock(hObject);
         ofc_handle_destroy(hObject);
 #if defined(OFC_FILE_DEBUG)
@@ -394,12 +1681,59 @@ OfcReadFile(OFC_HANDLE hFile,
 
     fileContext = ofc_handle_lock(hFile);
     if (fileContext != OFC_NULL) {
-        ret = OfcFSReadFile(fileContext->fsType,
-                            fileContext->fsHandle,
-                            lpBuffer,
-                            nNumberOfBytesToRead,
-                            lpNumberOfBytesRead,
-                            hOverlapped);
+#if defined(OFC_FILE_CACHE)
+        if (fileContext->cache != OFC_NULL &&
+            hOverlapped == OFC_HANDLE_NULL) {
+            ofc_lock(fileContext->cache->lock);
+            ret = ofc_file_cache_read(fileContext, lpBuffer,
+                                      nNumberOfBytesToRead,
+                                      lpNumberOfBytesRead);
+            ofc_unlock(fileContext->cache->lock);
+        } else
+#endif
+        {
+            ret = ofc_file_cache_enter(fileContext, OFC_FALSE);
+            if (ret)
+                ret = OfcFSReadFile(fileContext->fsType,
+                                    fileContext->fsHandle,
+                                    lpBuffer,
+                                    nNumberOfBytesToRead,
+                                    lpNumberOfBytesRead,
+                                    hOverlapped);
+            ofc_file_cache_leave(fileContext, 0);
+        }
+        ofc_handle_unlock(hFile);
+    } else
+        ret = OFC_FALSE;
+
+    return (ret);
+}
+
+OFC_CORE_LIB OFC_BOOL
+OfcReadFileScatter(OFC_HANDLE hFile,
+                   OFC_IOVEC *iovec,
+                   OFC_INT veclen,
+                   OFC_LPDWORD lpNumberOfBytesRead,
+                   OFC_HANDLE hOverlapped) {
+    OFC_FILE_CONTEXT *fileContext;
+    OFC_DWORD moved;
+    OFC_BOOL ret;
+
+    fileContext = ofc_handle_lock(hFile);
+    if (fileContext != OFC_NULL) {
+        moved = 0;
+        ret = ofc_file_cache_enter(fileContext, OFC_FALSE);
+        if (ret)
+            ret = OfcFSReadFileScatter(fileContext->fsType,
+                                       fileContext->fsHandle,
+                                       iovec,
+                                       veclen,
+                                       lpNumberOfBytesRead,
+                                       hOverlapped);
+        if (ret && hOverlapped == OFC_HANDLE_NULL &&
+            lpNumberOfBytesRead != OFC_NULL)
+            moved = *lpNumberOfBytesRead;
+        ofc_file_cache_leave(fileContext, moved);
         ofc_handle_unlock(hFile);
     } else
         ret = OFC_FALSE;
@@ -407,6 +1741,31 @@ OfcReadFile(OFC_HANDLE hFile,
     return (ret);
 }
 
+OFC_CORE_LIB OFC_BOOL
+OfcReadFileMessage(OFC_HANDLE hFile,
+                   OFC_MESSAGE *msg,
+                   OFC_INT offset,
+                   OFC_DWORD nNumberOfBytesToRead,
+                   OFC_LPDWORD lpNumberOfBytesRead,
+                   OFC_HANDLE hOverlapped) {
+    OFC_IOVEC iovec[OFC_FILE_IOVEC_MAX];
+    OFC_INT veclen;
+    OFC_BOOL ret;
+
+    offset += msg->base;
+    veclen = ofc_iovec_fill(msg->map, offset,
+                            offset + nNumberOfBytesToRead,
+                            iovec, OFC_FILE_IOVEC_MAX);
+    if (veclen == 0 && nNumberOfBytesToRead > 0) {
+        ofc_thread_set_variable(OfcLastError,
+                                (OFC_DWORD_PTR) OFC_ERROR_INVALID_PARAMETER);
+        ret = OFC_FALSE;
+    } else
+        ret = OfcReadFileScatter(hFile, iovec, veclen,
+                                 lpNumberOfBytesRead, hOverlapped);
+    return (ret);
+}
+
 OFC_CORE_LIB OFC_HANDLE
 OfcCreateOverlapped(OFC_HANDLE hFile) {
     OFC_FILE_CONTEXT *fileContext;
@@ -480,6 +1839,8 @@ OfcDeleteFileW(OFC_LPCTSTR lpFileName) {
     ofc_path_mapW(lpFileName, &lpMappedFileName, &type);
 
     ret = OfcFSDeleteFile(type, lpMappedFileName);
+    if (ret)
+        ofc_file_meta_forget(type, lpMappedFileName);
 
     ofc_free(lpMappedFileName);
 
@@ -506,6 +1867,8 @@ OfcRemoveDirectoryW(OFC_LPCTSTR lpPathName) {
     ofc_path_mapW(lpPathName, &lpMappedPathName, &type);
 
     ret = OfcFSRemoveDirectory(type, lpMappedPathName);
+    if (ret)
+        ofc_file_meta_flush();
 
     ofc_free(lpMappedPathName);
 
@@ -531,6 +1894,8 @@ OfcFindFirstFileW(OFC_LPCTSTR lpFileName,
     OFC_FILE_CONTEXT *fileContext;
     OFC_HANDLE retHandle;
     OFC_PATH *path;
+    OFC_BOOL cacheable;
+    OFC_BOOL cached;
 
 
     retHandle = OFC_INVALID_HANDLE_VALUE;
@@ -539,21 +1904,40 @@ OfcFindFirstFileW(OFC_LPCTSTR lpFileName,
 #if defined(OFC_FILE_DEBUG)
         ofc_file_debug_alloc (fileContext, RETURN_ADDRESS()) ;
 #endif
-        path = ofc_map_path(lpFileName, &lpMappedFileName);
-
-        fileContext->fsType = MapType(path);
+        fileContext->fsType = MapName(lpFileName, &lpMappedFileName, &path,
+                                      &cacheable);
+        fileContext->overlappedList = OFC_HANDLE_NULL;
+#if defined(OFC_FILE_CACHE)
+        fileContext->cache = OFC_NULL;
+#endif
+        ofc_file_meta_open(fileContext, cacheable, lpMappedFileName);
 
-        fileContext->fsHandle = OfcFSFindFirstFile(fileContext->fsType,
-                                                   lpMappedFileName,
-                                                   lpFindFileData,
-                                                   more);
-        if (fileContext->fsHandle == OFC_HANDLE_NULL ||
-            fileContext->fsHandle == OFC_INVALID_HANDLE_VALUE) {
+        /*
+         * A search served from the metadata cache has no file system
+         * handle
+         */
+        fileContext->fsHandle = OFC_HANDLE_NULL;
+        cached = ofc_file_meta_find_first(fileContext, lpFindFileData, more);
+        if (!cached) {
+            fileContext->fsHandle = OfcFSFindFirstFile(fileContext->fsType,
+                                                       lpMappedFileName,
+                                                       lpFindFileData,
+                                                       more);
+            ofc_file_meta_record(fileContext,
+                                 fileContext->fsHandle != OFC_HANDLE_NULL &&
+                                 fileContext->fsHandle !=
+                                 OFC_INVALID_HANDLE_VALUE,
+                                 lpFindFileData, more);
+        }
+        if (!cached &&
+            (fileContext->fsHandle == OFC_HANDLE_NULL ||
+             fileContext->fsHandle == OFC_INVALID_HANDLE_VALUE)) {
             if (fileContext->fsType == OFC_FST_BROWSE_SERVERS &&
-                ofc_path_server(path) != OFC_NULL)
+                path != OFC_NULL && ofc_path_server(path) != OFC_NULL)
                 remove_workgroup(ofc_path_server(path));
 
             retHandle = fileContext->fsHandle;
+            ofc_file_meta_close(fileContext);
 #if defined(OFC_FILE_DEBUG)
             ofc_file_debug_free (fileContext) ;
 #endif
@@ -564,7 +1948,8 @@ OfcFindFirstFileW(OFC_LPCTSTR lpFileName,
                 update_workgroup(lpFindFileData->cFileName);
         }
         ofc_free(lpMappedFileName);
-        ofc_path_delete(path);
+        if (path != OFC_NULL)
+            ofc_path_delete(path);
     }
     return (retHandle);
 }
@@ -625,10 +2010,14 @@ OfcFindNextFileW(OFC_HANDLE hFindFile,
     ret = OFC_FALSE;
     fileContext = ofc_handle_lock(hFindFile);
     if (fileContext != OFC_NULL) {
-        ret = OfcFSFindNextFile(fileContext->fsType,
-                                fileContext->fsHandle,
-                                lpFindFileData,
-                                more);
+        if (!ofc_file_meta_find_next(fileContext, lpFindFileData,
+                                     more, &ret)) {
+            ret = OfcFSFindNextFile(fileContext->fsType,
+                                    fileContext->fsHandle,
+                                    lpFindFileData,
+                                    more);
+            ofc_file_meta_record(fileContext, ret, lpFindFileData, more);
+        }
 
         if (ret == OFC_TRUE && fileContext->fsType == OFC_FST_BROWSE_WORKGROUPS)
             update_workgroup(lpFindFileData->cFileName);
@@ -660,8 +2049,13 @@ OfcFindClose(OFC_HANDLE hFindFile) {
     ret = OFC_FALSE;
     fileContext = ofc_handle_lock(hFindFile);
     if (fileContext != OFC_NULL) {
-        ret = OfcFSFindClose(fileContext->fsType,
-                             fileContext->fsHandle);
+        if (fileContext->fsHandle == OFC_HANDLE_NULL)
+            /* Served from the metadata cache */
+            ret = OFC_TRUE;
+        else
+            ret = OfcFSFindClose(fileContext->fsType,
+                                 fileContext->fsHandle);
+        ofc_file_meta_close(fileContext);
         ofc_handle_unlock(hFindFile);
         ofc_handle_destroy(hFindFile);
 #if defined(OFC_FILE_DEBUG)
@@ -681,8 +2075,11 @@ OfcFlushFileBuffers(OFC_HANDLE hFile) {
     ret = OFC_FALSE;
     fileContext = ofc_handle_lock(hFile);
     if (fileContext != OFC_NULL) {
-        ret = OfcFSFlushFileBuffers(fileContext->fsType,
-                                    fileContext->fsHandle);
+        ret = ofc_file_cache_enter(fileContext, OFC_FALSE);
+        if (ret)
+            ret = OfcFSFlushFileBuffers(fileContext->fsType,
+                                        fileContext->fsHandle);
+        ofc_file_cache_leave(fileContext, 0);
         ofc_handle_unlock(hFile);
     }
 
@@ -697,18 +2094,19 @@ OfcGetFileAttributesExW(OFC_LPCTSTR lpFileName,
     OFC_FST_TYPE type;
     OFC_BOOL ret;
     OFC_PATH *path;
+    OFC_BOOL cacheable;
 
     if (lpFileInformation == OFC_NULL) {
         ret = OFC_FALSE;
         ofc_thread_set_variable(OfcLastError,
                                 (OFC_DWORD_PTR) OFC_ERROR_BAD_ARGUMENTS);
     } else {
-        path = ofc_map_path(lpFileName, &lpMappedFileName);
-        type = MapType(path);
+        type = MapName(lpFileName, &lpMappedFileName, &path, &cacheable);
 
-        ret = OfcFSGetFileAttributesEx(type, lpMappedFileName,
+        ret = ofc_file_meta_attributes(type, cacheable, lpMappedFileName,
                                        fInfoLevelId, lpFileInformation);
-        ofc_path_delete(path);
+        if (path != OFC_NULL)
+            ofc_path_delete(path);
         ofc_free(lpMappedFileName);
     }
     return (ret);
@@ -740,11 +2138,11 @@ OfcGetFileInformationByHandleEx(OFC_HANDLE hFile,
     ret = OFC_FALSE;
     fileContext = ofc_handle_lock(hFile);
     if (fileContext != OFC_NULL) {
-        ret = OfcFSGetFileInformationByHandleEx(fileContext->fsType,
-                                                fileContext->fsHandle,
-                                                FileInformationClass,
-                                                lpFileInformation,
-                                                dwBufferSize);
+        ret = ofc_file_cache_enter(fileContext, OFC_FALSE);
+        if (ret)
+            ret = ofc_file_meta_info(fileContext, FileInformationClass,
+                                     lpFileInformation, dwBufferSize);
+        ofc_file_cache_leave(fileContext, 0);
         ofc_handle_unlock(hFile);
     }
 
@@ -771,6 +2169,11 @@ OfcMoveFileW(OFC_LPCTSTR lpExistingFileName,
     ret = OfcFSMoveFile(existingType,
                         lpExistingMappedFileName,
                         lpNewMappedFileName);
+    /*
+     * A directory may have moved, taking everything under it
+     */
+    if (ret)
+        ofc_file_meta_flush();
 
     ofc_free(lpExistingMappedFileName);
     ofc_free(lpNewMappedFileName);
@@ -800,8 +2203,12 @@ OfcSetEndOfFile(OFC_HANDLE hFile) {
     ret = OFC_FALSE;
     fileContext = ofc_handle_lock(hFile);
     if (fileContext != OFC_NULL) {
-        ret = OfcFSSetEndOfFile(fileContext->fsType,
-                                fileContext->fsHandle);
+        ret = ofc_file_cache_enter(fileContext, OFC_TRUE);
+        if (ret)
+            ret = OfcFSSetEndOfFile(fileContext->fsType,
+                                    fileContext->fsHandle);
+        ofc_file_cache_leave(fileContext, 0);
+        ofc_file_meta_changed(fileContext);
         ofc_handle_unlock(hFile);
     }
     return (ret);
@@ -817,6 +2224,8 @@ OfcSetFileAttributesW(OFC_LPCTSTR lpFileName,
     ofc_path_mapW(lpFileName, &lpMappedFileName, &type);
 
     ret = OfcFSSetFileAttributes(type, lpMappedFileName, dwFileAttributes);
+    if (ret)
+        ofc_file_meta_forget(type, lpMappedFileName);
 
     ofc_free(lpMappedFileName);
     return (ret);
@@ -846,11 +2255,15 @@ OfcSetFileInformationByHandle(OFC_HANDLE hFile,
     ret = OFC_FALSE;
     fileContext = ofc_handle_lock(hFile);
     if (fileContext != OFC_NULL) {
-        ret = OfcFSSetFileInformationByHandle(fileContext->fsType,
-                                              fileContext->fsHandle,
-                                              FileInformationClass,
-                                              lpFileInformation,
-                                              dwBufferSize);
+        ret = ofc_file_cache_enter(fileContext, OFC_TRUE);
+        if (ret)
+            ret = OfcFSSetFileInformationByHandle(fileContext->fsType,
+                                                  fileContext->fsHandle,
+                                                  FileInformationClass,
+                                                  lpFileInformation,
+                                                  dwBufferSize);
+        ofc_file_cache_leave(fileContext, 0);
+        ofc_file_meta_changed(fileContext);
         ofc_handle_unlock(hFile);
     }
 
@@ -868,6 +2281,15 @@ OfcSetFilePointer(OFC_HANDLE hFile,
     ret = OFC_INVALID_SET_FILE_POINTER;
     fileContext = ofc_handle_lock(hFile);
     if (fileContext != OFC_NULL) {
+#if defined(OFC_FILE_CACHE)
+        if (fileContext->cache != OFC_NULL) {
+            ofc_lock(fileContext->cache->lock);
+            ret = ofc_file_cache_set_pointer(fileContext, lDistanceToMove,
+                                             lpDistanceToMoveHigh,
+                                             dwMoveMethod);
+            ofc_unlock(fileContext->cache->lock);
+        } else
+#endif
         ret = OfcFSSetFilePointer(fileContext->fsType,
                                   fileContext->fsHandle,
                                   lDistanceToMove,
@@ -1192,9 +2614,12 @@ OfcUnlockFileEx(OFC_HANDLE hFile,
     ret = OFC_FALSE;
     fileContext = ofc_handle_lock(hFile);
     if (fileContext != OFC_NULL) {
-        ret = OfcFSUnlockFileEx(fileContext->fsType,
-                                fileContext->fsHandle,
-                                length_low, length_high, hOverlapped);
+        ret = ofc_file_cache_enter(fileContext, OFC_TRUE);
+        if (ret)
+            ret = OfcFSUnlockFileEx(fileContext->fsType,
+                                    fileContext->fsHandle,
+                                    length_low, length_high, hOverlapped);
+        ofc_file_cache_leave(fileContext, 0);
 
         ofc_handle_unlock(hFile);
     }
@@ -1232,9 +2657,12 @@ OfcLockFileEx(OFC_HANDLE hFile, OFC_DWORD flags,
     ret = OFC_FALSE;
     fileContext = ofc_handle_lock(hFile);
     if (fileContext != OFC_NULL) {
-        ret = OfcFSLockFileEx(fileContext->fsType,
-                              fileContext->fsHandle, flags,
-                              length_low, length_high, hOverlapped);
+        ret = ofc_file_cache_enter(fileContext, OFC_TRUE);
+        if (ret)
+            ret = OfcFSLockFileEx(fileContext->fsType,
+                                  fileContext->fsHandle, flags,
+                                  length_low, length_high, hOverlapped);
+        ofc_file_cache_leave(fileContext, 0);
 
         ofc_handle_unlock(hFile);
     }
@@ -1355,6 +2783,41 @@ OfcFileGetOverlappedWaitQ(OFC_HANDLE hOverlapped) {
     return (ret);
 }
 
+OFC_CORE_LIB OFC_INT
+OfcFileGetDescriptor(OFC_HANDLE hFile) {
+    OFC_FILE_CONTEXT *fileContext;
+    OFC_INT ret;
+
+    ret = -1;
+    fileContext = ofc_handle_lock(hFile);
+    if (fileContext != OFC_NULL) {
+        /*
+         * Whoever uses the descriptor should see what's been written
+         */
+        ofc_file_cache_enter(fileContext, OFC_FALSE);
+        ofc_file_cache_leave(fileContext, 0);
+        ret = OfcFSGetFileDescriptor(fileContext->fsType,
+                                     fileContext->fsHandle);
+        ofc_handle_unlock(hFile);
+    }
+    return (ret);
+}
+
+static OFC_ULONG ofc_file_count_get(OFC_FILE_COUNTER *counter) {
+    return (OFC_ATOMIC_LOAD(&counter->count));
+}
+
+OFC_CORE_LIB OFC_VOID
+OfcFileGetCacheStats(OFC_FILE_CACHE_STATS *stats) {
+    stats->hits = ofc_file_count_get(&ofc_file_cache_hits);
+    stats->misses = ofc_file_count_get(&ofc_file_cache_misses);
+    stats->read_ahead = ofc_file_count_get(&ofc_file_cache_read_ahead);
+    stats->coalesced = ofc_file_count_get(&ofc_file_cache_coalesced);
+    stats->flushes = ofc_file_count_get(&ofc_file_cache_flushes);
+    stats->meta_hits = ofc_file_count_get(&ofc_file_meta_hits);
+    stats->meta_misses = ofc_file_count_get(&ofc_file_meta_misses);
+}
+
 OFC_CORE_LIB OFC_VOID
 OfcFileInit(OFC_VOID) {
     OfcLastError = ofc_thread_create_variable();
@@ -1366,10 +2829,35 @@ OfcFileInit(OFC_VOID) {
     ofc_file_debug.Allocated = OFC_NULL ;
     ofc_file_lock = ofc_lock_init () ;
 #endif
+#if defined(OFC_FILE_CACHE)
+    ofc_file_count_create(&ofc_file_cache_hits, TSTR("Cache Hit"));
+    ofc_file_count_create(&ofc_file_cache_misses, TSTR("Cache Miss"));
+    ofc_file_count_create(&ofc_file_cache_read_ahead, TSTR("Read Ahead"));
+    ofc_file_count_create(&ofc_file_cache_coalesced, TSTR("Coalesced"));
+    ofc_file_count_create(&ofc_file_cache_flushes, TSTR("WB Flush"));
+#endif
+#if (OFC_FILE_META_CACHE > 0)
+    ofc_file_meta_lock = ofc_lock_init();
+    ofc_file_count_create(&ofc_file_meta_hits, TSTR("Meta Hit"));
+    ofc_file_count_create(&ofc_file_meta_misses, TSTR("Meta Miss"));
+#endif
 }
 
 OFC_CORE_LIB OFC_VOID
 OfcFileDestroy(OFC_VOID) {
+#if defined(OFC_FILE_CACHE)
+    ofc_file_count_destroy(&ofc_file_cache_hits);
+    ofc_file_count_destroy(&ofc_file_cache_misses);
+    ofc_file_count_destroy(&ofc_file_cache_read_ahead);
+    ofc_file_count_destroy(&ofc_file_cache_coalesced);
+    ofc_file_count_destroy(&ofc_file_cache_flushes);
+#endif
+#if (OFC_FILE_META_CACHE > 0)
+    ofc_file_meta_flush();
+    ofc_lock_destroy(ofc_file_meta_lock);
+    ofc_file_count_destroy(&ofc_file_meta_hits);
+    ofc_file_count_destroy(&ofc_file_meta_misses);
+#endif
 #if defined(OFC_FILE_DEBUG)
     ofc_lock_destroy(ofc_file_lock) ;
 #endif
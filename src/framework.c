@@ -65,7 +65,11 @@ OFC_CORE_LIB OFC_VOID
 ofc_framework_startup(OFC_VOID) {
     OFC_HANDLE hScheduler;
 
+#if defined(OFC_SCHED_WORKERS) && (OFC_SCHED_WORKERS > 1)
+    hScheduler = ofc_sched_pool_create(OFC_SCHED_WORKERS);
+#else
     hScheduler = ofc_sched_create();
+#endif
     ofc_framework_startup_ev(hScheduler, OFC_HANDLE_NULL);
 }
 
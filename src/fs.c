@@ -416,6 +416,106 @@ OFC_BOOL OfcFSReadFile(OFC_FST_TYPE fsType,
     return (ret);
 }
 
+/*
+ * For handlers without scatter/gather.  A synchronous transfer is done a
+ * buffer at a time, stopping at the first short one.  An overlapped
+ * transfer completes asynchronously, so it can only be passed through
+ * when there is a single buffer.
+ */
+static OFC_BOOL ofc_fs_scatter_emulate(OFC_FST_TYPE fsType,
+                                       OFC_HANDLE hFile,
+                                       OFC_BOOL write,
+                                       OFC_IOVEC *iovec,
+                                       OFC_INT veclen,
+                                       OFC_LPDWORD lpNumberOfBytes,
+                                       OFC_HANDLE hOverlapped) {
+    OFC_BOOL ret;
+    OFC_DWORD total;
+    OFC_DWORD len;
+    OFC_INT i;
+
+    if (hOverlapped != OFC_HANDLE_NULL && veclen != 1) {
+        ofc_thread_set_variable(OfcLastError,
+                                (OFC_DWORD_PTR) OFC_ERROR_NOT_SUPPORTED);
+        return (OFC_FALSE);
+    }
+
+    ret = OFC_TRUE;
+    total = 0;
+    for (i = 0; i < veclen && ret; i++) {
+        len = 0;
+        if (write)
+            ret = OfcFSWriteFile(fsType, hFile, iovec[i].iov_base,
+                                 (OFC_DWORD) iovec[i].iov_len, &len,
+                                 hOverlapped);
+        else
+            ret = OfcFSReadFile(fsType, hFile, iovec[i].iov_base,
+                                (OFC_DWORD) iovec[i].iov_len, &len,
+                                hOverlapped);
+        if (ret) {
+            total += len;
+            if (len < (OFC_DWORD) iovec[i].iov_len)
+                break;
+        } else if (total > 0)
+            /*
+             * Report what was transferred.  The error shows on the
+             * next call.
+             */
+            ret = OFC_TRUE;
+    }
+
+    if (lpNumberOfBytes != OFC_NULL && hOverlapped == OFC_HANDLE_NULL)
+        *lpNumberOfBytes = total;
+    return (ret);
+}
+
+OFC_BOOL OfcFSReadFileScatter(OFC_FST_TYPE fsType,
+                              OFC_HANDLE hFile,
+                              OFC_IOVEC *iovec,
+                              OFC_INT veclen,
+                              OFC_LPDWORD lpNumberOfBytesRead,
+                              OFC_HANDLE hOverlapped) {
+    OFC_BOOL ret;
+
+    if (ofc_fs_table[fsType]->ReadFileScatter != OFC_NULL)
+        ret = ofc_fs_table[fsType]->ReadFileScatter(hFile, iovec, veclen,
+                                                    lpNumberOfBytesRead,
+                                                    hOverlapped);
+    else
+        ret = ofc_fs_scatter_emulate(fsType, hFile, OFC_FALSE,
+                                     iovec, veclen,
+                                     lpNumberOfBytesRead, hOverlapped);
+    return (ret);
+}
+
+OFC_BOOL OfcFSWriteFileGather(OFC_FST_TYPE fsType,
+                              OFC_HANDLE hFile,
+                              OFC_IOVEC *iovec,
+                              OFC_INT veclen,
+                              OFC_LPDWORD lpNumberOfBytesWritten,
+                              OFC_HANDLE hOverlapped) {
+    OFC_BOOL ret;
+
+    if (ofc_fs_table[fsType]->WriteFileGather != OFC_NULL)
+        ret = ofc_fs_table[fsType]->WriteFileGather(hFile, iovec, veclen,
+                                                    lpNumberOfBytesWritten,
+                                                    hOverlapped);
+    else
+        ret = ofc_fs_scatter_emulate(fsType, hFile, OFC_TRUE,
+                                     iovec, veclen,
+                                     lpNumberOfBytesWritten, hOverlapped);
+    return (ret);
+}
+
+OFC_INT OfcFSGetFileDescriptor(OFC_FST_TYPE fsType, OFC_HANDLE hFile) {
+    OFC_INT ret;
+
+    ret = -1;
+    if (ofc_fs_table[fsType]->GetFileDescriptor != OFC_NULL)
+        ret = ofc_fs_table[fsType]->GetFileDescriptor(hFile);
+    return (ret);
+}
+
 OFC_BOOL OfcFSCloseHandle(OFC_FST_TYPE fsType,
                           OFC_HANDLE hFile) {
     OFC_BOOL ret;
@@ -19,41 +19,76 @@
 #include "ofc/impl/waitsetimpl.h"
 
 #include "ofc/heap.h"
+#include "ofc/atomic.h"
+
+/*
+ * Handles are indices into a segmented handle table rather than raw
+ * pointers to the handle context.  A handle carries the index of its
+ * slot along with the generation of the slot when the handle was
+ * created.  When a slot is released, its generation is advanced so any
+ * stale copies of the handle will fail to resolve rather than
+ * referencing a reused context.
+ *
+ * The table is a fixed directory of segments.  Segments are allocated
+ * on demand and are never released until the handle facility is
+ * unloaded, so resolving a handle to its slot requires no lock.
+ *
+ * The reference count, the destroy flag and the generation of a slot
+ * are packed into a single 64 bit state word that is only modified with
+ * compare and swap.  Locking and unlocking a handle is therefore wait
+ * free in the absence of contention on the same handle and never takes
+ * a process wide lock.
+ *
+ * Free slots are kept on a number of shards, each with its own lock, so
+ * concurrent creates and destroys rarely contend.  Segment n belongs to
+ * shard n % OFC_HANDLE_SHARDS.  A shard grows by adding the next segment
+ * it owns, and a slot is always returned to the shard that owns its
+ * segment.
+ */
+#if !defined(OFC_HANDLE_SHARDS)
+#define OFC_HANDLE_SHARDS 8
+#endif
 
-#if defined(DISABLED)
-typedef enum
-  {
-    HANDLE_EVENT_LOCK,
-    HANDLE_EVENT_UNLOCK,
-    HANDLE_EVENT_DESTROY
-  } OFC_HANDLE_TRACE_EVENT ;
+#define HANDLE_SEGMENT_SHIFT 8
+#define HANDLE_SEGMENT_SIZE (1 << HANDLE_SEGMENT_SHIFT)
+#define HANDLE_SEGMENT_MASK (HANDLE_SEGMENT_SIZE - 1)
+#define HANDLE_MAX_SEGMENTS 4096
 
-typedef struct _STACK
-{
-  OFC_HANDLE_TRACE_EVENT event ;
-  OFC_INT reference ;
-  OFC_BOOL destroy ;
-  OFC_VOID *caller1 ;
-  OFC_VOID *caller2 ;
-  OFC_VOID *caller3 ;
-  OFC_VOID *caller4 ;
-} STACK ;
+#if defined(OFC_64BIT_POINTER)
+#define HANDLE_INDEX_BITS 32
+#define HANDLE_GEN_MASK 0xFFFFFFFFUL
+#else
+#define HANDLE_INDEX_BITS 20
+#define HANDLE_GEN_MASK 0x00000FFFUL
 #endif
+#define HANDLE_INDEX_MASK ((((OFC_HANDLE) 1) << HANDLE_INDEX_BITS) - 1)
+
+#define HANDLE_MAKE(ix, gen) \
+  ((OFC_HANDLE) (((OFC_HANDLE) ((gen) & HANDLE_GEN_MASK) << \
+                  HANDLE_INDEX_BITS) | (ix)))
+#define HANDLE_INDEX(h) ((OFC_UINT32) ((h) & HANDLE_INDEX_MASK))
+#define HANDLE_GEN(h) ((OFC_UINT32) (((h) >> HANDLE_INDEX_BITS) & \
+                                     HANDLE_GEN_MASK))
+
+#define STATE_DESTROY ((OFC_UINT64) 0x80000000UL)
+#define STATE_REF_MASK ((OFC_UINT64) 0x7FFFFFFFUL)
+#define STATE_MAKE(gen, flags) (((OFC_UINT64) (gen) << 32) | (flags))
+#define STATE_GEN(s) ((OFC_UINT32) ((s) >> 32))
+#define STATE_REF(s) ((OFC_INT) ((s) & STATE_REF_MASK))
+#define STATE_DESTROYED(s) (((s) & STATE_DESTROY) != 0)
+#define STATE_MATCH(s, h) \
+  ((STATE_GEN(s) & HANDLE_GEN_MASK) == HANDLE_GEN(h))
 
 typedef struct _HANDLE_CONTEXT {
+    volatile OFC_UINT64 state;
     OFC_HANDLE_TYPE type;
-    OFC_INT reference;
-    OFC_BOOL destroy;
     OFC_VOID *context;
     OFC_HANDLE wait_app;
     OFC_HANDLE wait_set;
-#if defined(DISABLED)
-    STACK trace[10] ;
-    OFC_INT trace_idx ;
-#endif
+    OFC_UINT32 next_free;
 #if defined(OFC_HANDLE_PERF)
-    OFC_MSTIME last_triggered ;
-    OFC_MSTIME avg_interval ;
+    OFC_NSTIME last_triggered ;
+    OFC_NSTIME avg_interval ;
     OFC_UINT32 avg_count ;
 #endif
 #if defined(OFC_HANDLE_DEBUG)
@@ -66,6 +101,16 @@ typedef struct _HANDLE_CONTEXT {
 #endif
 } HANDLE_CONTEXT;
 
+typedef struct {
+    OFC_LOCK lock;
+    OFC_UINT32 free;
+    OFC_UINT32 segments;    /* Number of segments the shard owns */
+} HANDLE_SHARD;
+
+static HANDLE_CONTEXT *volatile HandleSegments[HANDLE_MAX_SEGMENTS];
+static HANDLE_SHARD HandleShards[OFC_HANDLE_SHARDS];
+static volatile OFC_UINT32 HandleShardNext;
+
 typedef struct _HANDLE16_CONTEXT {
     OFC_UCHAR id;
     OFC_UCHAR instance;
@@ -241,18 +286,147 @@ OFC_VOID OfcHandle16DebugDump (OFC_VOID)
 
 #endif
 
+/*
+ * Resolve a handle to its slot in the handle table.
+ *
+ * This does not validate the generation of the slot.  Callers must
+ * check the generation against the state word.
+ */
+static HANDLE_CONTEXT *
+ofc_handle_slot(OFC_HANDLE handle) {
+    OFC_UINT32 index;
+    HANDLE_CONTEXT *segment;
+    HANDLE_CONTEXT *handle_context;
+
+    handle_context = OFC_NULL;
+    if (handle != OFC_HANDLE_NULL && handle != OFC_INVALID_HANDLE_VALUE) {
+        index = HANDLE_INDEX(handle);
+        if ((index >> HANDLE_SEGMENT_SHIFT) < HANDLE_MAX_SEGMENTS) {
+            segment = OFC_ATOMIC_LOAD(&HandleSegments[index >>
+                                                      HANDLE_SEGMENT_SHIFT]);
+            if (segment != OFC_NULL)
+                handle_context = &segment[index & HANDLE_SEGMENT_MASK];
+        }
+    }
+    return (handle_context);
+}
+
+/*
+ * Resolve a handle to its slot and verify the handle is current
+ */
+static HANDLE_CONTEXT *
+ofc_handle_resolve(OFC_HANDLE handle) {
+    HANDLE_CONTEXT *handle_context;
+    OFC_UINT64 state;
+
+    handle_context = ofc_handle_slot(handle);
+    if (handle_context != OFC_NULL) {
+        state = OFC_ATOMIC_LOAD(&handle_context->state);
+        if (!STATE_MATCH(state, handle))
+            handle_context = OFC_NULL;
+    }
+    return (handle_context);
+}
+
+/*
+ * Add the shard's next segment to the table.  Called with the shard lock
+ * held.
+ */
+static OFC_VOID
+ofc_handle_grow(HANDLE_SHARD *shard) {
+    OFC_UINT32 segno;
+    OFC_UINT32 base;
+    OFC_INT i;
+    HANDLE_CONTEXT *segment;
+
+    segno = shard->segments * OFC_HANDLE_SHARDS +
+            (OFC_UINT32) (shard - HandleShards);
+    if (segno >= HANDLE_MAX_SEGMENTS)
+        ofc_process_crash("Handle Table Exhausted\n");
+    shard->segments++;
+
+    segment = ofc_malloc(sizeof(HANDLE_CONTEXT) * HANDLE_SEGMENT_SIZE);
+    ofc_memset(segment, '\0', sizeof(HANDLE_CONTEXT) * HANDLE_SEGMENT_SIZE);
+
+    /*
+     * Chain the new slots onto the shards free list.  Slots start out
+     * marked destroyed so they can not be locked until allocated.
+     * Index 0 is reserved so that no handle encodes as OFC_HANDLE_NULL,
+     * and the all ones index is reserved so that no handle encodes as
+     * OFC_INVALID_HANDLE_VALUE.
+     */
+    base = segno << HANDLE_SEGMENT_SHIFT;
+    for (i = HANDLE_SEGMENT_SIZE - 1; i >= 0; i--) {
+        segment[i].state = STATE_MAKE(1, STATE_DESTROY);
+        if (base + i != 0 && base + i != HANDLE_INDEX_MASK) {
+            segment[i].next_free = shard->free;
+            shard->free = base + i;
+        }
+    }
+
+    OFC_ATOMIC_STORE(&HandleSegments[segno], segment);
+}
+
+/*
+ * Return a slot to its shard.  Called once the last reference to a
+ * destroyed handle has been released.
+ */
+static OFC_VOID
+ofc_handle_release(HANDLE_CONTEXT *handle_context, OFC_UINT32 index) {
+    HANDLE_SHARD *shard;
+    OFC_UINT32 gen;
+
+#if defined(OFC_HANDLE_DEBUG)
+    ofc_handle_debug_free(handle_context) ;
+#endif
+#if defined(OFC_HANDLE_PERF)
+    ofc_handle_print_interval("Handle: ",
+                              HANDLE_MAKE(index,
+                                          STATE_GEN(handle_context->state))) ;
+#endif
+    handle_context->context = OFC_NULL;
+    handle_context->wait_app = OFC_HANDLE_NULL;
+    handle_context->wait_set = OFC_HANDLE_NULL;
+    /*
+     * Advance the generation so stale handles no longer resolve.
+     * Generation 0 is skipped so that no handle encodes as
+     * OFC_HANDLE_NULL, and the all ones generation so that no handle
+     * encodes as OFC_INVALID_HANDLE_VALUE.
+     */
+    gen = (STATE_GEN(handle_context->state) + 1) & HANDLE_GEN_MASK;
+    if (gen == 0 || gen == HANDLE_GEN_MASK)
+        gen = 1;
+    OFC_ATOMIC_STORE(&handle_context->state, STATE_MAKE(gen, STATE_DESTROY));
+
+    shard = &HandleShards[(index >> HANDLE_SEGMENT_SHIFT) %
+                          OFC_HANDLE_SHARDS];
+    ofc_lock(shard->lock);
+    handle_context->next_free = shard->free;
+    shard->free = index;
+    ofc_unlock(shard->lock);
+}
+
 OFC_CORE_LIB OFC_HANDLE
 ofc_handle_create(OFC_HANDLE_TYPE hType, OFC_VOID *context) {
     HANDLE_CONTEXT *handle_context;
-
-    handle_context = ofc_malloc(sizeof(HANDLE_CONTEXT));
-    handle_context->reference = 0;
-    handle_context->destroy = OFC_FALSE;
+    HANDLE_SHARD *shard;
+    OFC_UINT32 index;
+    OFC_UINT32 gen;
+
+    shard = &HandleShards[OFC_ATOMIC_ADD_RELAXED(&HandleShardNext, 1) %
+                          OFC_HANDLE_SHARDS];
+
+    ofc_lock(shard->lock);
+    if (shard->free == 0)
+        ofc_handle_grow(shard);
+    index = shard->free;
+    handle_context = ofc_handle_slot(HANDLE_MAKE(index, 1));
+    shard->free = handle_context->next_free;
+    ofc_unlock(shard->lock);
+
+    handle_context->next_free = 0;
     handle_context->type = hType;
     handle_context->context = context;
-#if defined(DISABLED)
-    handle_context->trace_idx = 0 ;
-#endif
 
     handle_context->wait_set = OFC_HANDLE_NULL;
     handle_context->wait_app = OFC_HANDLE_NULL;
@@ -267,7 +441,14 @@ ofc_handle_create(OFC_HANDLE_TYPE hType, OFC_VOID *context) {
     OfcHandleDebugAlloc (handle_context, RETURN_ADDRESS()) ;
 #endif
 
-    return ((OFC_HANDLE) handle_context);
+    /*
+     * Publish the slot.  Clearing the destroy flag makes the handle
+     * lockable.
+     */
+    gen = STATE_GEN(handle_context->state);
+    OFC_ATOMIC_STORE(&handle_context->state, STATE_MAKE(gen, 0));
+
+    return (HANDLE_MAKE(index, gen));
 }
 
 OFC_CORE_LIB OFC_HANDLE_TYPE ofc_handle_get_type(OFC_HANDLE hHandle) {
@@ -275,7 +456,7 @@ OFC_CORE_LIB OFC_HANDLE_TYPE ofc_handle_get_type(OFC_HANDLE hHandle) {
     OFC_HANDLE_TYPE type;
 
     type = OFC_HANDLE_UNKNOWN;
-    handle = (HANDLE_CONTEXT *) hHandle;
+    handle = ofc_handle_resolve(hHandle);
     if (handle != OFC_NULL) {
         type = handle->type;
     }
@@ -284,36 +465,24 @@ OFC_CORE_LIB OFC_HANDLE_TYPE ofc_handle_get_type(OFC_HANDLE hHandle) {
 
 OFC_CORE_LIB OFC_VOID *ofc_handle_lock(OFC_HANDLE handle) {
     HANDLE_CONTEXT *handle_context;
+    OFC_UINT64 state;
     OFC_VOID *ret;
 
-    handle_context = (HANDLE_CONTEXT *) handle;
     ret = OFC_NULL;
-
-    ofc_lock(HandleLock);
-#if defined(DISABLED)
-    handle_context->trace[handle_context->trace_idx].event =
-      HANDLE_EVENT_LOCK ;
-    handle_context->trace[handle_context->trace_idx].reference =
-      handle_context->reference ;
-    handle_context->trace[handle_context->trace_idx].destroy =
-      handle_context->destroy ;
-    handle_context->trace[handle_context->trace_idx].caller1 =
-      __builtin_return_address(1) ;
-    handle_context->trace[handle_context->trace_idx].caller2 =
-      __builtin_return_address(2) ;
-    handle_context->trace[handle_context->trace_idx].caller3 =
-      __builtin_return_address(3) ;
-    handle_context->trace[handle_context->trace_idx].caller4 =
-      __builtin_return_address(4) ;
-    handle_context->trace_idx = (handle_context->trace_idx+1) % 10 ;
-#endif
-
-    if (!handle_context->destroy) {
-        handle_context->reference++;
-        ret = handle_context->context;
+    handle_context = ofc_handle_slot(handle);
+    if (handle_context != OFC_NULL) {
+        state = OFC_ATOMIC_LOAD(&handle_context->state);
+        /*
+         * Take a reference as long as the handle is current and not
+         * being destroyed.  A failed compare and swap refreshes state.
+         */
+        while (STATE_MATCH(state, handle) && !STATE_DESTROYED(state)) {
+            if (OFC_ATOMIC_CAS(&handle_context->state, &state, state + 1)) {
+                ret = handle_context->context;
+                break;
+            }
+        }
     }
-    ofc_unlock(HandleLock);
-
     return (ret);
 }
 
@@ -331,99 +500,58 @@ ofc_handle_lock_ex(OFC_HANDLE handle, OFC_HANDLE_TYPE type) {
 
 OFC_CORE_LIB OFC_VOID ofc_handle_unlock(OFC_HANDLE handle) {
     HANDLE_CONTEXT *handle_context;
+    OFC_UINT64 state;
+    OFC_UINT64 newstate;
+
+    handle_context = ofc_handle_slot(handle);
+    if (handle_context != OFC_NULL) {
+        state = OFC_ATOMIC_LOAD(&handle_context->state);
+        do {
+            if (!STATE_MATCH(state, handle)) {
+                ofc_process_crash("Unlock of stale handle\n");
+                return;
+            }
+            ofc_assert(STATE_REF(state) > 0,
+                       "Invalid handle reference count");
+            newstate = state - 1;
+        } while (!OFC_ATOMIC_CAS(&handle_context->state, &state, newstate));
 
-    handle_context = (HANDLE_CONTEXT *) handle;
-    ofc_lock(HandleLock);
-
-    handle_context->reference--;
-    ofc_assert(handle_context->reference >= 0,
-	       "Invalid handle reference count");
-
-#if defined(DISABLED)
-    handle_context->trace[handle_context->trace_idx].event =
-      HANDLE_EVENT_UNLOCK ;
-    handle_context->trace[handle_context->trace_idx].reference =
-      handle_context->reference ;
-    handle_context->trace[handle_context->trace_idx].destroy =
-      handle_context->destroy ;
-    handle_context->trace[handle_context->trace_idx].caller1 =
-      __builtin_return_address(1) ;
-    handle_context->trace[handle_context->trace_idx].caller2 =
-      __builtin_return_address(2) ;
-    handle_context->trace[handle_context->trace_idx].caller3 =
-      __builtin_return_address(3) ;
-    handle_context->trace[handle_context->trace_idx].caller4 =
-      __builtin_return_address(4) ;
-    handle_context->trace_idx = (handle_context->trace_idx+1) % 100 ;
-#endif
-
-    if (handle_context->destroy && handle_context->reference == 0)
-      {
-	ofc_unlock(HandleLock);
-#if defined(OFC_HANDLE_DEBUG)
-        ofc_handle_debug_free(handle_context) ;
-#endif
-#if defined(OFC_HANDLE_PERF)
-        ofc_handle_print_interval("Handle: ", handle) ;
-#endif
-        ofc_free(handle_context);
+        if (STATE_DESTROYED(newstate) && STATE_REF(newstate) == 0)
+            ofc_handle_release(handle_context, HANDLE_INDEX(handle));
     }
-    else
-      ofc_unlock(HandleLock);
 }
 
 OFC_CORE_LIB OFC_VOID ofc_handle_destroy(OFC_HANDLE handle) {
     HANDLE_CONTEXT *handle_context;
+    OFC_UINT64 state;
+    OFC_UINT64 newstate;
 
-    handle_context = (HANDLE_CONTEXT *) handle;
-
-    if (handle_context->wait_set != OFC_HANDLE_NULL)
-        ofc_waitset_remove(handle_context->wait_set, handle);
-
-    ofc_lock(HandleLock);
-#if defined(DISABLED)
-    handle_context->trace[handle_context->trace_idx].event =
-      HANDLE_EVENT_DESTROY ;
-    handle_context->trace[handle_context->trace_idx].reference =
-      handle_context->reference ;
-    handle_context->trace[handle_context->trace_idx].destroy =
-      handle_context->destroy ;
-    handle_context->trace[handle_context->trace_idx].caller1 =
-      __builtin_return_address(1) ;
-    handle_context->trace[handle_context->trace_idx].caller2 =
-      __builtin_return_address(2) ;
-    handle_context->trace[handle_context->trace_idx].caller3 =
-      __builtin_return_address(3) ;
-    handle_context->trace[handle_context->trace_idx].caller4 =
-      __builtin_return_address(4) ;
-    handle_context->trace_idx = (handle_context->trace_idx+1) % 100 ;
-#endif
+    handle_context = ofc_handle_resolve(handle);
+    if (handle_context != OFC_NULL) {
+        if (handle_context->wait_set != OFC_HANDLE_NULL)
+            ofc_waitset_remove(handle_context->wait_set, handle);
 
-    handle_context->destroy = OFC_TRUE;
-
-    if (handle_context->reference == 0)
-      {
-	ofc_unlock(HandleLock);
+        state = OFC_ATOMIC_LOAD(&handle_context->state);
+        do {
+            /*
+             * Already destroyed (or released and reused) is a noop
+             */
+            if (!STATE_MATCH(state, handle) || STATE_DESTROYED(state))
+                return;
+            newstate = state | STATE_DESTROY;
+        } while (!OFC_ATOMIC_CAS(&handle_context->state, &state, newstate));
 
-#if defined(OFC_HANDLE_DEBUG)
-        ofc_handle_debug_free(handle_context) ;
-#endif
-#if defined(OFC_HANDLE_PERF)
-        ofc_handle_print_interval("Handle: ", handle) ;
-#endif
-        ofc_free(handle_context);
-      }
-    else
-      ofc_unlock(HandleLock);
+        if (STATE_REF(newstate) == 0)
+            ofc_handle_release(handle_context, HANDLE_INDEX(handle));
+    }
 }
 
 OFC_CORE_LIB OFC_VOID
 ofc_handle_set_app(OFC_HANDLE hHandle, OFC_HANDLE hApp, OFC_HANDLE hSet) {
     HANDLE_CONTEXT *handle_context;
 
-    if (hHandle != OFC_HANDLE_NULL) {
-        handle_context = (HANDLE_CONTEXT *) hHandle;
-
+    handle_context = ofc_handle_resolve(hHandle);
+    if (handle_context != OFC_NULL) {
         handle_context->wait_app = hApp;
         handle_context->wait_set = hSet;
         ofc_waitset_set_assoc_impl(hHandle, hApp, hSet);
@@ -432,18 +560,26 @@ ofc_handle_set_app(OFC_HANDLE hHandle, OFC_HANDLE hApp, OFC_HANDLE hSet) {
 
 OFC_CORE_LIB OFC_HANDLE ofc_handle_get_app(OFC_HANDLE hHandle) {
     HANDLE_CONTEXT *handle_context;
+    OFC_HANDLE hApp;
 
-    handle_context = (HANDLE_CONTEXT *) hHandle;
+    hApp = OFC_HANDLE_NULL;
+    handle_context = ofc_handle_resolve(hHandle);
+    if (handle_context != OFC_NULL)
+        hApp = handle_context->wait_app;
 
-    return (handle_context->wait_app);
+    return (hApp);
 }
 
 OFC_CORE_LIB OFC_HANDLE ofc_handle_get_wait_set(OFC_HANDLE hHandle) {
     HANDLE_CONTEXT *handle_context;
+    OFC_HANDLE hSet;
 
-    handle_context = (HANDLE_CONTEXT *) hHandle;
+    hSet = OFC_HANDLE_NULL;
+    handle_context = ofc_handle_resolve(hHandle);
+    if (handle_context != OFC_NULL)
+        hSet = handle_context->wait_set;
 
-    return (handle_context->wait_set);
+    return (hSet);
 }
 
 static HANDLE16_CONTEXT Handle16Array[OFC_MAX_HANDLE16];
@@ -463,6 +599,13 @@ OFC_CORE_LIB OFC_VOID ofc_handle16_init(OFC_VOID) {
     OfcHandle16Mutex = ofc_lock_init();
     HandleLock = ofc_lock_init();
 
+    HandleShardNext = 0;
+    for (i = 0; i < OFC_HANDLE_SHARDS; i++) {
+        HandleShards[i].lock = ofc_lock_init();
+        HandleShards[i].free = 0;
+        HandleShards[i].segments = 0;
+    }
+
     Handle16Free = ofc_queue_create();
 
     for (i = 0; i < OFC_MAX_HANDLE16; i++) {
@@ -476,11 +619,26 @@ OFC_CORE_LIB OFC_VOID ofc_handle16_init(OFC_VOID) {
 }
 
 OFC_CORE_LIB OFC_VOID ofc_handle16_free(OFC_VOID) {
+    OFC_INT i;
+
     ofc_queue_clear(Handle16Free);
     ofc_queue_destroy(Handle16Free);
 
     ofc_lock_destroy(OfcHandle16Mutex);
     ofc_lock_destroy(HandleLock);
+
+    for (i = 0; i < OFC_HANDLE_SHARDS; i++) {
+        ofc_lock_destroy(HandleShards[i].lock);
+        HandleShards[i].lock = OFC_NULL;
+        HandleShards[i].free = 0;
+        HandleShards[i].segments = 0;
+    }
+    for (i = 0; i < HANDLE_MAX_SEGMENTS; i++) {
+        if (HandleSegments[i] != OFC_NULL) {
+            ofc_free(HandleSegments[i]);
+            HandleSegments[i] = OFC_NULL;
+        }
+    }
 }
 
 OFC_CORE_LIB OFC_VOID *ofc_handle16_lock(OFC_HANDLE16 hHandle) {
@@ -592,13 +750,18 @@ OFC_CORE_LIB OFC_VOID ofc_handle16_unlock(OFC_HANDLE16 hHandle) {
 OFC_CORE_LIB OFC_VOID OfcHandleMeasure (OFC_HANDLE hHandle)
 {
   HANDLE_CONTEXT *handle_context ;
-  OFC_MSTIME now ;
-  OFC_MSTIME interval ;
+  OFC_NSTIME now ;
+  OFC_NSTIME interval ;
 
   if (hHandle != OFC_HANDLE_NULL)
     {
-      now = ofc_time_get_now() ;
-      handle_context = (HANDLE_CONTEXT *) hHandle ;
+      /*
+       * The scheduler refreshed the coarse clock as the wait returned
+       */
+      now = ofc_time_get_coarse_ns() ;
+      handle_context = ofc_handle_resolve(hHandle) ;
+      if (handle_context == OFC_NULL)
+        return ;
       if (handle_context->last_triggered != 0)
     {
       interval = now - handle_context->last_triggered ;
@@ -616,16 +779,18 @@ OFC_CORE_LIB OFC_VOID OfcHandleMeasure (OFC_HANDLE hHandle)
     }
 }
 
-OFC_CORE_LIB OFC_MSTIME OfcHandleGetAvgInterval (OFC_HANDLE hHandle,
+OFC_CORE_LIB OFC_NSTIME OfcHandleGetAvgInterval (OFC_HANDLE hHandle,
                             OFC_UINT32 *count,
                             OFC_HANDLE_TYPE *type)
 {
   HANDLE_CONTEXT *handle_context ;
-  OFC_MSTIME interval ;
+  OFC_NSTIME interval ;
 
-  if (hHandle != OFC_HANDLE_NULL)
+  interval = 0 ;
+  *count = 0 ;
+  handle_context = ofc_handle_resolve(hHandle) ;
+  if (handle_context != OFC_NULL)
     {
-      handle_context = (HANDLE_CONTEXT *) hHandle ;
       interval = handle_context->avg_interval ;
       *count = handle_context->avg_count ;
       *type = handle_context->type ;
@@ -695,7 +860,7 @@ OFC_CORE_LIB OFC_VOID ofc_handle_print_interval_header(OFC_VOID)
 OFC_CORE_LIB OFC_VOID
 ofc_handle_print_interval(OFC_CHAR *prefix, OFC_HANDLE hHandle)
 {
-  OFC_MSTIME interval ;
+  OFC_NSTIME interval ;
   OFC_UINT32 count ;
   OFC_HANDLE_TYPE type ;
 
@@ -705,14 +870,16 @@ ofc_handle_print_interval(OFC_CHAR *prefix, OFC_HANDLE hHandle)
     {
       if (type == OFC_HANDLE_TIMER)
 	{
-	  ofc_printf ("%s%-15.15s  %12lu ms  %15lu  %s\n", prefix,
+	  ofc_printf ("%s%-15.15s  %12lu us  %15lu  %s\n", prefix,
 		      type2str(type),
-		      interval, count, ofc_timer_id (hHandle)) ;
+		      (OFC_ULONG) (interval / OFC_NS_PER_US), count,
+		      ofc_timer_id (hHandle)) ;
 	}
       else
 	{
-	  ofc_printf ("%s%-15.15s  %12lu ms  %15lu\n", prefix,
-		      type2str(type), interval, count) ;
+	  ofc_printf ("%s%-15.15s  %12lu us  %15lu\n", prefix,
+		      type2str(type),
+		      (OFC_ULONG) (interval / OFC_NS_PER_US), count) ;
 	}
     }
 }
@@ -14,11 +14,14 @@
 #include "ofc/thread.h"
 #include "ofc/process.h"
 #include "ofc/heap.h"
+#include "ofc/atomic.h"
 #include "ofc/backtrace.h"
+#include "ofc/log.h"
 #include "ofc/impl/heapimpl.h"
 
 struct heap_chunk {
     OFC_SIZET alloc_size;
+    OFC_UINT32 site;
 #if defined(OFC_HEAP_DEBUG)
     struct heap_chunk *dbgnext;
     struct heap_chunk *dbgprev;
@@ -35,52 +38,263 @@ struct heap_chunk {
 #endif
 };
 
+/*
+ * Heap accounting is kept per thread.  Each thread owns a slot in a
+ * static table and updates it without synchronization.  The byte count
+ * is folded into the global total only when the thread's running delta
+ * crosses OFC_HEAP_FLUSH, which is also when the high water mark is
+ * updated, so Max is accurate to within OFC_HEAP_FLUSH per thread.
+ * Everything else is merged when the stats are dumped.
+ *
+ * If more than OFC_HEAP_THREADS threads are live, the overflow threads
+ * share the last slot and update it atomically.
+ *
+ * Allocations are also attributed to the call site that made them.
+ * Sites are kept in a small open addressed table keyed by return
+ * address.  When the table is full, allocations are charged to site 0.
+ */
+#define OFC_HEAP_THREADS 64
+#define OFC_HEAP_FLUSH (64 * 1024)
+#define OFC_HEAP_CLASSES 16
+#define OFC_HEAP_CLASS_MIN_SHIFT 4
+#define OFC_HEAP_SITES 512
+#define OFC_HEAP_SITE_PROBE 8
+#define OFC_HEAP_SITE_TOP 16
+
+#if defined(__GNUC__) || defined(__clang__)
+#define OFC_HEAP_CALLER() __builtin_return_address(0)
+#else
+#define OFC_HEAP_CALLER() OFC_NULL
+#endif
+
+struct heap_thread_stats {
+    volatile OFC_INT active;
+    OFC_BOOL shared;
+    OFC_UINT32 epoch;
+    OFC_SIZET delta;
+    OFC_UINT32 allocs;
+    OFC_UINT32 frees;
+    OFC_UINT32 classes[OFC_HEAP_CLASSES];
+};
+
+struct heap_site {
+    OFC_VOID *volatile caller;
+    volatile OFC_UINT32 allocs;
+    volatile OFC_SIZET bytes;
+};
+
 typedef struct {
     OFC_LOCK lock;
-    OFC_UINT32 Max;
-    OFC_UINT32 Total;
+    volatile OFC_SIZET Max;
+    volatile OFC_SIZET Total;
+    OFC_UINT32 epoch;
 #if defined(OFC_HEAP_DEBUG)
     struct heap_chunk *Allocated;
 #endif
 } OFC_HEAP_STATS;
 
 static OFC_HEAP_STATS ofc_heap_stats = {0};
+static struct heap_thread_stats ofc_heap_threads[OFC_HEAP_THREADS];
+static struct heap_site ofc_heap_sites[OFC_HEAP_SITES];
+static OFC_THREAD_LOCAL struct heap_thread_stats *ofc_heap_thread;
+
+static OFC_VOID ofc_slab_unload(OFC_VOID);
+static OFC_VOID ofc_slab_dump_stats(OFC_VOID);
+
+/*
+ * Find a free per thread slot for the calling thread.  A slot released by
+ * an exited thread is reused as is, since its residual delta is still
+ * part of the total.
+ */
+static struct heap_thread_stats *
+ofc_heap_thread_stats(OFC_VOID) {
+    struct heap_thread_stats *stats;
+    OFC_INT expected;
+    OFC_INT i;
+
+    stats = ofc_heap_thread;
+    if (stats == OFC_NULL) {
+        for (i = 0; i < OFC_HEAP_THREADS - 1 && stats == OFC_NULL; i++) {
+            expected = 0;
+            if (OFC_ATOMIC_CAS(&ofc_heap_threads[i].active, &expected, 1))
+                stats = &ofc_heap_threads[i];
+        }
+        if (stats == OFC_NULL) {
+            stats = &ofc_heap_threads[OFC_HEAP_THREADS - 1];
+            stats->shared = OFC_TRUE;
+            OFC_ATOMIC_STORE(&stats->active, 1);
+        }
+        ofc_heap_thread = stats;
+    }
+
+    if (stats->epoch != ofc_heap_stats.epoch) {
+        /*
+         * The heap has been reloaded since this slot was last used
+         */
+        stats->delta = 0;
+        stats->allocs = 0;
+        stats->frees = 0;
+        ofc_memset(stats->classes, 0, sizeof(stats->classes));
+        stats->epoch = ofc_heap_stats.epoch;
+    }
+    return (stats);
+}
+
+static OFC_INT
+ofc_heap_class(OFC_SIZET size) {
+    OFC_INT class;
+
+    class = 0;
+    if (size > (1 << OFC_HEAP_CLASS_MIN_SHIFT)) {
+#if defined(__GNUC__) || defined(__clang__)
+        class = (OFC_INT) (sizeof(unsigned long) * 8) -
+                __builtin_clzl((unsigned long) (size - 1)) -
+                OFC_HEAP_CLASS_MIN_SHIFT;
+#else
+        OFC_SIZET limit;
+
+        for (limit = 1 << OFC_HEAP_CLASS_MIN_SHIFT; size > limit;
+             limit <<= 1)
+            class++;
+#endif
+        if (class >= OFC_HEAP_CLASSES)
+            class = OFC_HEAP_CLASSES - 1;
+    }
+    return (class);
+}
 
+static OFC_UINT32
+ofc_heap_site(OFC_VOID *caller) {
+    OFC_UINT32 hash;
+    OFC_UINT32 site;
+    OFC_VOID *current;
+    OFC_INT i;
+
+    if (caller == OFC_NULL)
+        return (0);
+
+    hash = (OFC_UINT32) (((OFC_DWORD_PTR) caller >> 2) * 0x9E3779B1U);
+    for (i = 0; i < OFC_HEAP_SITE_PROBE; i++) {
+        site = (hash + i) % (OFC_HEAP_SITES - 1) + 1;
+        current = OFC_ATOMIC_LOAD(&ofc_heap_sites[site].caller);
+        if (current == caller)
+            return (site);
+        if (current == OFC_NULL) {
+            if (OFC_ATOMIC_CAS(&ofc_heap_sites[site].caller, &current, caller)
+                || current == caller)
+                return (site);
+        }
+    }
+    return (0);
+}
+
+/*
+ * Fold the thread's running byte delta into the global total and track
+ * the high water mark
+ */
 static OFC_VOID
-ofc_heap_malloc_acct(OFC_SIZET size, struct heap_chunk *chunk) {
-    /*
-     * Put on the allocation queue
-     */
-    chunk->alloc_size = size;
-    /*
-     * If heap_stats.lock is null, it's during initialization.
-     * skip locking
-     */
-    if (ofc_heap_stats.lock != OFC_NULL)
-      ofc_lock(ofc_heap_stats.lock);
+ofc_heap_fold(struct heap_thread_stats *stats) {
+    OFC_SIZET delta;
+    OFC_SIZET total;
+    OFC_SIZET max;
+
+    if (stats->shared)
+        delta = OFC_ATOMIC_XCHG(&stats->delta, 0);
+    else {
+        delta = stats->delta;
+        stats->delta = 0;
+    }
+
+    total = OFC_ATOMIC_ADD(&ofc_heap_stats.Total, delta);
+    max = OFC_ATOMIC_LOAD(&ofc_heap_stats.Max);
+    while (total > max &&
+           !OFC_ATOMIC_CAS(&ofc_heap_stats.Max, &max, total));
+}
 
-    ofc_heap_stats.Total += size;
-    if (ofc_heap_stats.Total >= ofc_heap_stats.Max)
-        ofc_heap_stats.Max = ofc_heap_stats.Total;
+static OFC_VOID
+ofc_heap_malloc_acct(OFC_SIZET size, struct heap_chunk *chunk,
+                     OFC_VOID *caller) {
+    struct heap_thread_stats *stats;
+    struct heap_site *site;
+    OFC_INT class;
+    OFC_SIZET delta;
 
-    if (ofc_heap_stats.lock != OFC_NULL)
-      ofc_unlock(ofc_heap_stats.lock);
+    chunk->alloc_size = size;
+    chunk->site = ofc_heap_site(caller);
+
+    site = &ofc_heap_sites[chunk->site];
+    OFC_ATOMIC_ADD_RELAXED(&site->allocs, 1);
+    OFC_ATOMIC_ADD_RELAXED(&site->bytes, size);
+
+    stats = ofc_heap_thread_stats();
+    class = ofc_heap_class(size);
+    if (stats->shared) {
+        OFC_ATOMIC_ADD_RELAXED(&stats->allocs, 1);
+        OFC_ATOMIC_ADD_RELAXED(&stats->classes[class], 1);
+        delta = OFC_ATOMIC_ADD(&stats->delta, size);
+    } else {
+        stats->allocs++;
+        stats->classes[class]++;
+        delta = stats->delta += size;
+    }
+    if (delta >= OFC_HEAP_FLUSH)
+        ofc_heap_fold(stats);
 }
 
 static OFC_VOID
 ofc_heap_free_acct(struct heap_chunk *chunk) {
-    ofc_lock(ofc_heap_stats.lock);
-    ofc_heap_stats.Total -= chunk->alloc_size;
-    ofc_unlock(ofc_heap_stats.lock);
+    struct heap_thread_stats *stats;
+    struct heap_site *site;
+    OFC_SIZET delta;
+
+    site = &ofc_heap_sites[chunk->site];
+    OFC_ATOMIC_ADD_RELAXED(&site->bytes, -chunk->alloc_size);
+
+    stats = ofc_heap_thread_stats();
+    if (stats->shared) {
+        OFC_ATOMIC_ADD_RELAXED(&stats->frees, 1);
+        delta = OFC_ATOMIC_SUB(&stats->delta, chunk->alloc_size);
+    } else {
+        stats->frees++;
+        delta = stats->delta -= chunk->alloc_size;
+    }
+    if (delta <= -OFC_HEAP_FLUSH)
+        ofc_heap_fold(stats);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_heap_thread_exit(OFC_VOID) {
+    struct heap_thread_stats *stats;
+
+    ofc_slab_flush();
+
+    stats = ofc_heap_thread;
+    if (stats != OFC_NULL) {
+        ofc_heap_thread = OFC_NULL;
+        if (!stats->shared)
+            OFC_ATOMIC_STORE(&stats->active, 0);
+    }
 }
 
 OFC_CORE_LIB OFC_VOID
 ofc_heap_load(OFC_VOID) {
+    struct heap_thread_stats *overflow;
+
     ofc_heap_stats.Max = 0;
     ofc_heap_stats.Total = 0;
+    ofc_heap_stats.epoch++;
 #if defined(OFC_HEAP_DEBUG)
     ofc_heap_stats.Allocated = OFC_NULL;
 #endif
+    ofc_memset(ofc_heap_sites, 0, sizeof(ofc_heap_sites));
+    overflow = &ofc_heap_threads[OFC_HEAP_THREADS - 1];
+    if (overflow->shared) {
+        overflow->delta = 0;
+        overflow->allocs = 0;
+        overflow->frees = 0;
+        ofc_memset(overflow->classes, 0, sizeof(overflow->classes));
+        overflow->epoch = ofc_heap_stats.epoch;
+    }
     /* Make NULL until we init the heap.  Since nothing
      * is running, we don't need locks yet
      */
@@ -94,6 +308,7 @@ ofc_heap_unload(OFC_VOID) {
 #if !defined(OF_SMB_SERVER)
     /* The client or server doesn't shutdown */
     OFC_LOCK save;
+    ofc_slab_unload();
     save = ofc_heap_stats.lock;
     ofc_heap_stats.lock = OFC_NULL;
     ofc_lock_destroy(save);
@@ -179,15 +394,95 @@ ofc_heap_debug_free(struct heap_chunk *chunk) {
 #define OBUF_SIZE 200
 OFC_CORE_LIB OFC_VOID
 ofc_heap_dump_stats(OFC_VOID) {
-#if defined(OFC_HEAP_DEBUG)
     OFC_CHAR obuf[OBUF_SIZE];
-    OFC_SIZET len;
+    struct heap_thread_stats *stats;
+    struct heap_site *top[OFC_HEAP_SITE_TOP];
+    struct heap_site *site;
+    OFC_UINT32 classes[OFC_HEAP_CLASSES];
+    OFC_UINT32 allocs;
+    OFC_UINT32 frees;
+    OFC_SIZET total;
+    OFC_INT i;
+    OFC_INT j;
+    OFC_INT k;
+
+    /*
+     * Merge the per thread counters.  The values are read without
+     * synchronization so a busy heap gives a close, not exact, snapshot.
+     */
+    total = OFC_ATOMIC_LOAD(&ofc_heap_stats.Total);
+    allocs = 0;
+    frees = 0;
+    ofc_memset(classes, 0, sizeof(classes));
+    for (i = 0; i < OFC_HEAP_THREADS; i++) {
+        stats = &ofc_heap_threads[i];
+        if (stats->epoch == ofc_heap_stats.epoch) {
+            total += stats->delta;
+            allocs += stats->allocs;
+            frees += stats->frees;
+            for (j = 0; j < OFC_HEAP_CLASSES; j++)
+                classes[j] += stats->classes[j];
+        }
+    }
 
-    len = ofc_snprintf(obuf, OBUF_SIZE,
-                       "Total Allocated Memory %d, Max Allocated Memory %d\n",
-                       ofc_heap_stats.Total, ofc_heap_stats.Max);
+    ofc_snprintf(obuf, OBUF_SIZE,
+                 "Total Allocated Memory %ld, Max Allocated Memory %ld\n",
+                 (long) total,
+                 (long) OFC_MAX(total, ofc_heap_stats.Max));
     ofc_write_console(obuf);
-#endif
+    ofc_snprintf(obuf, OBUF_SIZE, "Allocations %u, Frees %u\n",
+                 allocs, frees);
+    ofc_write_console(obuf);
+
+    ofc_snprintf(obuf, OBUF_SIZE, "%-12s %10s\n", "Size Class", "Allocs");
+    ofc_write_console(obuf);
+    for (i = 0; i < OFC_HEAP_CLASSES; i++) {
+        if (classes[i] != 0) {
+            ofc_snprintf(obuf, OBUF_SIZE, "%s%-10ld %10u\n",
+                         i == OFC_HEAP_CLASSES - 1 ? "> " : "<=",
+                         (long) 1 << (OFC_HEAP_CLASS_MIN_SHIFT +
+                                      (i == OFC_HEAP_CLASSES - 1 ?
+                                       i - 1 : i)),
+                         classes[i]);
+            ofc_write_console(obuf);
+        }
+    }
+
+    /*
+     * Report the call sites holding the most memory
+     */
+    k = 0;
+    for (i = 0; i < OFC_HEAP_SITES; i++) {
+        site = &ofc_heap_sites[i];
+        if (site->allocs == 0)
+            continue;
+        for (j = k; j > 0 && top[j - 1]->bytes < site->bytes; j--) {
+            if (j < OFC_HEAP_SITE_TOP)
+                top[j] = top[j - 1];
+        }
+        if (j < OFC_HEAP_SITE_TOP) {
+            top[j] = site;
+            if (k < OFC_HEAP_SITE_TOP)
+                k++;
+        }
+    }
+
+    ofc_snprintf(obuf, OBUF_SIZE, "%-18s %10s %12s\n",
+                 "Call Site", "Allocs", "Outstanding");
+    ofc_write_console(obuf);
+    for (i = 0; i < k; i++) {
+        if (top[i]->caller == OFC_NULL)
+            ofc_snprintf(obuf, OBUF_SIZE, "%-18s %10u %12ld\n",
+                         "(other)", top[i]->allocs, (long) top[i]->bytes);
+        else
+            ofc_snprintf(obuf, OBUF_SIZE, "%-18p %10u %12ld\n",
+                         ofc_process_relative_addr(top[i]->caller),
+                         top[i]->allocs, (long) top[i]->bytes);
+        ofc_write_console(obuf);
+    }
+
+    ofc_slab_dump_stats();
+    ofc_log_dump_stats();
 }
 
 OFC_CORE_LIB OFC_VOID
@@ -196,10 +491,8 @@ ofc_heap_dump(OFC_VOID) {
     struct heap_chunk *chunk;
     OFC_CHAR obuf[OBUF_SIZE];
     OFC_SIZET len;
-#endif
 
     ofc_heap_dump_stats();
-#if defined(OFC_HEAP_DEBUG)
 #if (defined(__GNUC__) || defined(__clang__)) && defined(OFC_STACK_TRACE)
     if (ofc_heap_stats.Allocated == OFC_NULL) {
         len = ofc_snprintf(obuf, OBUF_SIZE,
@@ -309,15 +602,15 @@ ofc_heap_dump_chunk(OFC_LPVOID mem) {
 #endif
 }
 
-OFC_CORE_LIB OFC_LPVOID
-ofc_malloc(OFC_SIZET size) {
+static OFC_LPVOID
+ofc_heap_alloc(OFC_SIZET size, OFC_VOID *caller) {
     OFC_LPVOID mem;
     struct heap_chunk *chunk;
 
     mem = OFC_NULL;
     chunk = ofc_malloc_impl(size + sizeof(struct heap_chunk));
     if (chunk != OFC_NULL) {
-        ofc_heap_malloc_acct(size, chunk);
+        ofc_heap_malloc_acct(size, chunk, caller);
 #if defined(OFC_HEAP_DEBUG)
         ofc_heap_debug_alloc(size, chunk);
 #endif
@@ -328,9 +621,14 @@ ofc_malloc(OFC_SIZET size) {
     return (mem);
 }
 
+OFC_CORE_LIB OFC_LPVOID
+ofc_malloc(OFC_SIZET size) {
+    return (ofc_heap_alloc(size, OFC_HEAP_CALLER()));
+}
+
 OFC_CORE_LIB OFC_LPVOID
 ofc_calloc(OFC_SIZET nmemb, OFC_SIZET size) {
-    return (ofc_malloc(nmemb * size));
+    return (ofc_heap_alloc(nmemb * size, OFC_HEAP_CALLER()));
 }
 
 OFC_CORE_LIB OFC_VOID
@@ -373,15 +671,256 @@ ofc_realloc(OFC_LPVOID ptr, OFC_SIZET size) {
 #if defined(OFC_HEAP_DEBUG)
           ofc_heap_debug_alloc(size, newchunk);
 #endif
-            ofc_heap_malloc_acct(size, newchunk);
+            ofc_heap_malloc_acct(size, newchunk, OFC_HEAP_CALLER());
             chunk = newchunk;
             mem = chunk + 1;
         } else {
             ofc_process_crash("ofc_realloc Allocation Failed\n");
         }
     } else
-        mem = ofc_malloc(size);
+        mem = ofc_heap_alloc(size, OFC_HEAP_CALLER());
 
     return (mem);
 }
 
+
+#if defined(OFC_HEAP_DEBUG) && !defined(OFC_SLAB_BYPASS)
+#define OFC_SLAB_BYPASS
+#endif
+
+/*
+ * A free object in a slab cache is linked through its first word
+ */
+struct slab_free {
+    struct slab_free *next;
+};
+
+/*
+ * Chunks carved by a cache are linked through a header so they can be
+ * returned to the heap when the heap is unloaded
+ */
+struct slab_chunk {
+    struct slab_chunk *next;
+    OFC_VOID *pad;
+};
+
+/*
+ * A per thread magazine of free objects for one cache.  The epoch
+ * records the cache epoch the magazine was filled in.  If the cache has
+ * been reset since, the magazine contents are stale and discarded.
+ */
+struct slab_magazine {
+    OFC_UINT32 epoch;
+    OFC_INT count;
+    OFC_VOID *objs[OFC_SLAB_MAGAZINE];
+};
+
+static OFC_THREAD_LOCAL struct slab_magazine ofc_slab_magazines[OFC_SLAB_MAX];
+
+static OFC_SPINLOCK ofc_slab_registry_lock = 0;
+static OFC_SLAB *ofc_slab_registry = OFC_NULL;
+static volatile OFC_INT ofc_slab_count = 0;
+
+static OFC_SIZET
+ofc_slab_object_size(OFC_SLAB *slab) {
+    OFC_SIZET align;
+
+    align = sizeof(OFC_VOID *) * 2;
+    return ((slab->size + align - 1) & ~(align - 1));
+}
+
+static OFC_VOID
+ofc_slab_register(OFC_SLAB *slab) {
+    OFC_SPINLOCK_LOCK(&ofc_slab_registry_lock);
+    if (slab->index < 0) {
+        if (ofc_slab_count >= OFC_SLAB_MAX)
+            ofc_process_crash("Slab Caches Exhausted\n");
+        slab->next = ofc_slab_registry;
+        ofc_slab_registry = slab;
+        OFC_ATOMIC_STORE(&slab->index, ofc_slab_count);
+        ofc_slab_count++;
+    }
+    OFC_SPINLOCK_UNLOCK(&ofc_slab_registry_lock);
+}
+
+/*
+ * Carve a new chunk of objects onto the depot.  Called with the
+ * slab lock held.
+ */
+static OFC_VOID
+ofc_slab_grow(OFC_SLAB *slab) {
+    struct slab_chunk *chunk;
+    struct slab_free *obj;
+    OFC_SIZET size;
+    OFC_CHAR *p;
+    OFC_INT i;
+
+    size = ofc_slab_object_size(slab);
+    chunk = ofc_malloc(sizeof(struct slab_chunk) + size * OFC_SLAB_CHUNK);
+    chunk->next = slab->chunks;
+    slab->chunks = chunk;
+
+    p = (OFC_CHAR *) (chunk + 1);
+    for (i = 0; i < OFC_SLAB_CHUNK; i++) {
+        obj = (struct slab_free *) (p + i * size);
+        obj->next = slab->depot;
+        slab->depot = obj;
+    }
+    slab->depot_count += OFC_SLAB_CHUNK;
+    slab->objects += OFC_SLAB_CHUNK;
+}
+
+/*
+ * Move half a magazine from the depot into the magazine
+ */
+static OFC_VOID
+ofc_slab_refill(OFC_SLAB *slab, struct slab_magazine *mag) {
+    struct slab_free *obj;
+
+    OFC_SPINLOCK_LOCK(&slab->lock);
+    if (mag->epoch != slab->epoch) {
+        mag->epoch = slab->epoch;
+        mag->count = 0;
+    }
+    if (slab->depot_count < OFC_SLAB_MAGAZINE / 2)
+        ofc_slab_grow(slab);
+    while (mag->count < OFC_SLAB_MAGAZINE / 2) {
+        obj = slab->depot;
+        slab->depot = obj->next;
+        slab->depot_count--;
+        mag->objs[mag->count++] = obj;
+    }
+    slab->refills++;
+    OFC_SPINLOCK_UNLOCK(&slab->lock);
+}
+
+/*
+ * Move objects from the magazine back to the depot, leaving keep
+ * objects in the magazine.
+ */
+static OFC_VOID
+ofc_slab_drain(OFC_SLAB *slab, struct slab_magazine *mag, OFC_INT keep) {
+    struct slab_free *obj;
+
+    OFC_SPINLOCK_LOCK(&slab->lock);
+    if (mag->epoch == slab->epoch) {
+        while (mag->count > keep) {
+            obj = mag->objs[--mag->count];
+            obj->next = slab->depot;
+            slab->depot = obj;
+            slab->depot_count++;
+        }
+        slab->drains++;
+    } else {
+        mag->epoch = slab->epoch;
+        mag->count = 0;
+    }
+    OFC_SPINLOCK_UNLOCK(&slab->lock);
+}
+
+OFC_CORE_LIB OFC_LPVOID
+ofc_slab_alloc(OFC_SLAB *slab) {
+#if defined(OFC_SLAB_BYPASS)
+    OFC_ATOMIC_ADD_RELAXED(&slab->bypass_allocs, 1);
+    return (ofc_malloc(slab->size));
+#else
+    struct slab_magazine *mag;
+    OFC_INT index;
+
+    index = OFC_ATOMIC_LOAD(&slab->index);
+    if (index < 0) {
+        ofc_slab_register(slab);
+        index = slab->index;
+    }
+
+    mag = &ofc_slab_magazines[index];
+    if (mag->count == 0 || mag->epoch != slab->epoch)
+        ofc_slab_refill(slab, mag);
+
+    return (mag->objs[--mag->count]);
+#endif
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_slab_free(OFC_SLAB *slab, OFC_LPVOID mem) {
+#if defined(OFC_SLAB_BYPASS)
+    if (mem != OFC_NULL) {
+        OFC_ATOMIC_ADD_RELAXED(&slab->bypass_frees, 1);
+        ofc_free(mem);
+    }
+#else
+    struct slab_magazine *mag;
+
+    if (mem != OFC_NULL) {
+        mag = &ofc_slab_magazines[slab->index];
+        if (mag->count == OFC_SLAB_MAGAZINE || mag->epoch != slab->epoch)
+            ofc_slab_drain(slab, mag, OFC_SLAB_MAGAZINE / 2);
+        mag->objs[mag->count++] = mem;
+    }
+#endif
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_slab_flush(OFC_VOID) {
+    OFC_SLAB *slab;
+
+    OFC_SPINLOCK_LOCK(&ofc_slab_registry_lock);
+    for (slab = ofc_slab_registry; slab != OFC_NULL; slab = slab->next) {
+        if (ofc_slab_magazines[slab->index].count > 0)
+            ofc_slab_drain(slab, &ofc_slab_magazines[slab->index], 0);
+    }
+    OFC_SPINLOCK_UNLOCK(&ofc_slab_registry_lock);
+}
+
+/*
+ * Return all slab chunks to the heap.  Any magazines still holding
+ * objects are invalidated by advancing the cache epoch.
+ */
+static OFC_VOID
+ofc_slab_unload(OFC_VOID) {
+    OFC_SLAB *slab;
+    struct slab_chunk *chunk;
+
+    OFC_SPINLOCK_LOCK(&ofc_slab_registry_lock);
+    for (slab = ofc_slab_registry; slab != OFC_NULL; slab = slab->next) {
+        OFC_SPINLOCK_LOCK(&slab->lock);
+        for (chunk = slab->chunks; chunk != OFC_NULL; chunk = slab->chunks) {
+            slab->chunks = chunk->next;
+            ofc_free(chunk);
+        }
+        slab->depot = OFC_NULL;
+        slab->depot_count = 0;
+        slab->objects = 0;
+        slab->epoch++;
+        OFC_SPINLOCK_UNLOCK(&slab->lock);
+    }
+    OFC_SPINLOCK_UNLOCK(&ofc_slab_registry_lock);
+}
+
+static OFC_VOID
+ofc_slab_dump_stats(OFC_VOID) {
+    OFC_SLAB *slab;
+    OFC_CHAR obuf[OBUF_SIZE];
+
+    ofc_snprintf(obuf, OBUF_SIZE, "%-16s %6s %10s %10s %10s %10s\n",
+                 "Slab Cache", "Size", "Objects", "Depot",
+                 "Refills", "Drains");
+    ofc_write_console(obuf);
+
+    OFC_SPINLOCK_LOCK(&ofc_slab_registry_lock);
+    for (slab = ofc_slab_registry; slab != OFC_NULL; slab = slab->next) {
+#if defined(OFC_SLAB_BYPASS)
+        ofc_snprintf(obuf, OBUF_SIZE, "%-16s %6d %10u %10s %10u %10u\n",
+                     slab->name, (OFC_INT) slab->size,
+                     slab->bypass_allocs - slab->bypass_frees, "-",
+                     slab->bypass_allocs, slab->bypass_frees);
+#else
+        ofc_snprintf(obuf, OBUF_SIZE, "%-16s %6d %10u %10u %10u %10u\n",
+                     slab->name, (OFC_INT) slab->size,
+                     slab->objects, slab->depot_count,
+                     slab->refills, slab->drains);
+#endif
+        ofc_write_console(obuf);
+    }
+    OFC_SPINLOCK_UNLOCK(&ofc_slab_registry_lock);
+}
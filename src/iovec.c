@@ -12,44 +12,167 @@
 #include "ofc/heap.h"
 #include "ofc/process.h"
 #include "ofc/iovec.h"
+#include "ofc/buffer.h"
+
+#if !defined(OFC_IOVEC_MIN_CAPACITY)
+#define OFC_IOVEC_MIN_CAPACITY 4
+#endif
+
+static OFC_SLAB ofc_iovec_slab =
+  OFC_SLAB_INIT("IO Vector", sizeof(struct iovec_list));
 
 OFC_IOMAP ofc_iovec_new(OFC_VOID)
 {
   struct iovec_list *iovec;
-  iovec = ofc_malloc(sizeof(struct iovec_list));
+  iovec = ofc_slab_alloc(&ofc_iovec_slab);
   iovec->num_vecs = 0;
+  iovec->capacity = 0;
+  iovec->cursor = 0;
   iovec->end_offset = 0;
   iovec->iovecs = OFC_NULL;
   return (iovec);
 }
 
+/*
+ * Make room for at least num_vecs vectors.  The array grows
+ * geometrically so building a message a segment at a time is linear.
+ */
+static OFC_VOID ofc_iovec_reserve(struct iovec_list *iovec,
+                                  OFC_UINT num_vecs)
+{
+  OFC_UINT capacity;
+
+  if (num_vecs > iovec->capacity)
+    {
+      capacity = iovec->capacity * 2;
+      if (capacity < OFC_IOVEC_MIN_CAPACITY)
+        capacity = OFC_IOVEC_MIN_CAPACITY;
+      if (capacity < num_vecs)
+        capacity = num_vecs;
+      iovec->iovecs = ofc_realloc(iovec->iovecs,
+                                  capacity * sizeof (struct iovec_entry));
+      iovec->capacity = capacity;
+    }
+}
+
 /*
  * Find the index of the vector on or before the requsted offset
  * This is really private, but needed for test
+ *
+ * The result is the vector that contains the offset.  If the offset is
+ * the boundary between two vectors, it is the first vector that starts
+ * there (which may be empty).  If the offset is at or past the end of
+ * the map, it is num_vecs.
+ *
+ * Marshalling walks a message mostly in order, so the vector of the last
+ * lookup is tried first.  Otherwise we binary search on the end offsets.
  */
 OFC_INT ofc_iovec_find(OFC_IOMAP list, OFC_OFFT offset)
 {
   struct iovec_list *iovec = list;
-  OFC_OFFT working_offset = 0;
+  struct iovec_entry *entry;
+  OFC_UINT cursor;
+  OFC_UINT low;
+  OFC_UINT high;
+  OFC_UINT mid;
   OFC_INT index;
 
-  for (index = 0;
-       index < iovec->num_vecs && offset > working_offset;)
+  if (offset <= 0)
+    return (0);
+
+  for (cursor = iovec->cursor;
+       cursor < iovec->num_vecs && cursor <= iovec->cursor + 1;
+       cursor++)
     {
-      OFC_INT next_offset = working_offset + iovec->iovecs[index].length;
-        
-      if (next_offset <= offset)
+      entry = &iovec->iovecs[cursor];
+      if (entry->offset <= offset &&
+          offset < entry->offset + (OFC_OFFT) entry->length &&
+          (offset > entry->offset || entry[-1].length > 0))
         {
-          index++;
+          iovec->cursor = cursor;
+          return ((OFC_INT) cursor);
         }
-      working_offset = next_offset;
+    }
+
+  /*
+   * Find the first vector that ends at or after the offset
+   */
+  low = 0;
+  high = iovec->num_vecs;
+  while (low < high)
+    {
+      mid = low + (high - low) / 2;
+      entry = &iovec->iovecs[mid];
+      if (entry->offset + (OFC_OFFT) entry->length < offset)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  index = (OFC_INT) low;
+  if (low < iovec->num_vecs)
+    {
+      entry = &iovec->iovecs[low];
+      /*
+       * If it ends exactly at the offset, the offset starts the next one
+       */
+      if (entry->offset + (OFC_OFFT) entry->length == offset)
+        index++;
+      else
+        iovec->cursor = low;
     }
   return (index);
 }
 
-OFC_UCHAR * ofc_iovec_insert(OFC_IOMAP list, OFC_OFFT offset,
-                             IOVEC_ALLOC_TYPE alloc_type,
-                             OFC_UCHAR *data, OFC_SIZET length)
+/*
+ * Fill in a vector.  A pool vector holds a reference to the buffer and
+ * may start skip bytes into it.
+ */
+static OFC_UCHAR *ofc_iovec_set(struct iovec_entry *entry,
+                                IOVEC_ALLOC_TYPE alloc_type,
+                                OFC_UCHAR *data, OFC_SIZET skip,
+                                OFC_SIZET length)
+{
+  entry->type = alloc_type;
+  entry->length = length;
+  entry->buffer = OFC_NULL;
+  if (alloc_type == IOVEC_ALLOC_HEAP && data == OFC_NULL)
+    data = ofc_malloc(length);
+  else if (alloc_type == IOVEC_ALLOC_POOL)
+    {
+      if (data == OFC_NULL)
+        data = ofc_buffer_alloc(length);
+      else
+        ofc_buffer_ref(data);
+      entry->buffer = data;
+      data += skip;
+    }
+  entry->data = data;
+  return (data);
+}
+
+/*
+ * Open a gap of count vectors at index, moving the vectors from index on
+ * up and past the length being inserted
+ */
+static OFC_VOID ofc_iovec_open(struct iovec_list *iovec, OFC_UINT index,
+                               OFC_UINT count, OFC_SIZET length)
+{
+  OFC_UINT i;
+
+  ofc_iovec_reserve(iovec, iovec->num_vecs + count);
+  iovec->num_vecs += count;
+  for (i = iovec->num_vecs - 1; i >= index + count; i--)
+    {
+      iovec->iovecs[i] = iovec->iovecs[i - count];
+      iovec->iovecs[i].offset += length;
+    }
+}
+
+static OFC_UCHAR *
+ofc_iovec_insert_segment(OFC_IOMAP list, OFC_OFFT offset,
+                         IOVEC_ALLOC_TYPE alloc_type,
+                         OFC_UCHAR *data, OFC_SIZET skip, OFC_SIZET length)
 {
   struct iovec_list *iovec = list;
   OFC_INT index = ofc_iovec_find(iovec, offset);
@@ -66,23 +189,19 @@ OFC_UCHAR * ofc_iovec_insert(OFC_IOMAP list, OFC_OFFT offset,
        * contiguous with the message, or it may require a hole
        * first create a block that is contiguous
        */
+      ofc_iovec_reserve(iovec, iovec->num_vecs + 2);
       iovec->num_vecs++;
-      iovec->iovecs = ofc_realloc(iovec->iovecs,
-                                  (iovec->num_vecs) *
-                                  sizeof (struct iovec_entry));
       iovec->iovecs[index].offset = iovec->end_offset;
       if (offset > iovec->iovecs[index].offset)
         {
           /* create a hole */
           iovec->iovecs[index].type = IOVEC_ALLOC_NONE;
           iovec->iovecs[index].data = OFC_NULL;
+          iovec->iovecs[index].buffer = OFC_NULL;
           iovec->iovecs[index].length = offset - iovec->iovecs[index].offset;
 
           iovec->end_offset += iovec->iovecs[index].length;
           iovec->num_vecs++;
-          iovec->iovecs = ofc_realloc(iovec->iovecs,
-                                      (iovec->num_vecs) *
-                                      sizeof (struct iovec_entry));
           index++;
         }
       /*
@@ -90,12 +209,8 @@ OFC_UCHAR * ofc_iovec_insert(OFC_IOMAP list, OFC_OFFT offset,
        * insertion
        */
       iovec->iovecs[index].offset = iovec->end_offset;
-      iovec->iovecs[index].type = alloc_type;
-      iovec->iovecs[index].length = length;
-      if (iovec->iovecs[index].type == IOVEC_ALLOC_HEAP &&
-          data == OFC_NULL)
-        data = ofc_malloc(iovec->iovecs[index].length);
-      iovec->iovecs[index].data = data;
+      data = ofc_iovec_set(&iovec->iovecs[index], alloc_type, data, skip,
+                           length);
       iovec->end_offset += length;
     }
   else
@@ -106,33 +221,13 @@ OFC_UCHAR * ofc_iovec_insert(OFC_IOMAP list, OFC_OFFT offset,
       if (offset == iovec->iovecs[index].offset)
         {
           /*
-           * insert chunk before current index
-           */
-          iovec->num_vecs++;
-          iovec->iovecs = ofc_realloc(iovec->iovecs,
-                                      iovec->num_vecs *
-                                      sizeof (struct iovec_entry));
-          /* say we have seven vecs.  The last index is 6 (one less)
-           * say we're inserting at 3.  We want to move down to 4.
-           */
-          for (OFC_INT i = iovec->num_vecs-1; i > index+1; i--)
-            {
-              iovec->iovecs[i] = iovec->iovecs[i-1];
-              /*
-               * update offsets of all subsequent blocks to account
-               * for what we are inserting
-               */
-              iovec->iovecs[i].offset += length;
-            }
-          /*
-           * current blocks offset is already set from previous block
+           * insert chunk before current index.  The block we move up
+           * keeps its offset, which becomes ours.
            */
-          iovec->iovecs[index].type = alloc_type;
-          iovec->iovecs[index].length = length;
-          if (iovec->iovecs[index].type == IOVEC_ALLOC_HEAP &&
-              data == OFC_NULL)
-            data = ofc_malloc(iovec->iovecs[index].length);
-          iovec->iovecs[index].data = data;
+          ofc_iovec_open(iovec, index, 1, length);
+          iovec->iovecs[index].offset = offset;
+          data = ofc_iovec_set(&iovec->iovecs[index], alloc_type,
+                               data, skip, length);
           iovec->end_offset += length;
         }
       else
@@ -141,19 +236,7 @@ OFC_UCHAR * ofc_iovec_insert(OFC_IOMAP list, OFC_OFFT offset,
            * Offset is in the middle of the chunk.  Need to split
            * current chunk
            */
-          iovec->num_vecs += 2;
-          iovec->iovecs = ofc_realloc(iovec->iovecs,
-                                      iovec->num_vecs *
-                                      sizeof(struct iovec_entry));
-          for (OFC_INT i = iovec->num_vecs-1; i > (index + 2); i--)
-            {
-              iovec->iovecs[i] = iovec->iovecs[i-2];
-              /*
-               * update offsets of all subsequent blocks to account
-               * for what we are inserting
-               */
-              iovec->iovecs[i].offset += length;
-            }
+          ofc_iovec_open(iovec, index + 1, 2, length);
           /*
            * split our iovec at index into two at 
            * say iovec at index is at offet 1020 and length of 100
@@ -174,21 +257,20 @@ OFC_UCHAR * ofc_iovec_insert(OFC_IOMAP list, OFC_OFFT offset,
            */
           iovec->iovecs[index+2].offset = iovec->iovecs[index].offset +
             length + split_offset;
-          iovec->iovecs[index+2].type = IOVEC_ALLOC_STATIC;
-          iovec->iovecs[index+2].data = iovec->iovecs[index].data +
-            split_offset;
+          iovec->iovecs[index+2].type =
+            iovec->iovecs[index].type == IOVEC_ALLOC_NONE ?
+            IOVEC_ALLOC_NONE : IOVEC_ALLOC_STATIC;
+          iovec->iovecs[index+2].data = iovec->iovecs[index].data == OFC_NULL ?
+            OFC_NULL : iovec->iovecs[index].data + split_offset;
           iovec->iovecs[index+2].length = iovec->iovecs[index].length -
             split_offset;
+          iovec->iovecs[index+2].buffer = OFC_NULL;
           /*
            * Fill in the inserted block.  It's offset 
            */
           iovec->iovecs[index+1].offset = offset;
-          iovec->iovecs[index+1].type = alloc_type;
-          iovec->iovecs[index+1].length = length;
-          if (iovec->iovecs[index+1].type == IOVEC_ALLOC_HEAP &&
-              data == OFC_NULL)
-            data = ofc_malloc(iovec->iovecs[index+1].length);
-          iovec->iovecs[index+1].data = data;
+          data = ofc_iovec_set(&iovec->iovecs[index+1], alloc_type,
+                               data, skip, length);
           /*
            * Now fill in the first part of the split
            * only thing that changes is the length
@@ -200,6 +282,22 @@ OFC_UCHAR * ofc_iovec_insert(OFC_IOMAP list, OFC_OFFT offset,
   return (data);
 }
       
+OFC_UCHAR * ofc_iovec_insert(OFC_IOMAP list, OFC_OFFT offset,
+                             IOVEC_ALLOC_TYPE alloc_type,
+                             OFC_UCHAR *data, OFC_SIZET length)
+{
+  return (ofc_iovec_insert_segment(list, offset, alloc_type, data, 0,
+                                   length));
+}
+
+OFC_UCHAR * ofc_iovec_attach(OFC_IOMAP list, OFC_OFFT offset,
+                             OFC_UCHAR *buffer, OFC_SIZET skip,
+                             OFC_SIZET length)
+{
+  return (ofc_iovec_insert_segment(list, offset, IOVEC_ALLOC_POOL,
+                                   buffer, skip, length));
+}
+
 OFC_UCHAR * ofc_iovec_append(OFC_IOMAP list,
                              IOVEC_ALLOC_TYPE alloc_type,
                              OFC_UCHAR *data, OFC_SIZET length)
@@ -227,9 +325,16 @@ OFC_VOID ofc_iovec_destroy(OFC_IOMAP list)
           iovec->iovecs[i].type = IOVEC_ALLOC_NONE;
           iovec->iovecs[i].data = OFC_NULL;
         }
+      else if (iovec->iovecs[i].type == IOVEC_ALLOC_POOL)
+        {
+          ofc_buffer_release(iovec->iovecs[i].buffer);
+          iovec->iovecs[i].type = IOVEC_ALLOC_NONE;
+          iovec->iovecs[i].data = OFC_NULL;
+          iovec->iovecs[i].buffer = OFC_NULL;
+        }
     }
   ofc_free(iovec->iovecs);
-  ofc_free(iovec);
+  ofc_slab_free(&ofc_iovec_slab, iovec);
 }
 
 OFC_VOID ofc_iovec_check(OFC_IOMAP list)
@@ -269,6 +374,28 @@ OFC_VOID ofc_iovec_realloc(OFC_IOMAP list, OFC_SIZET len)
         ofc_realloc(iovec->iovecs[0].data, len);
       iovec->end_offset = len;
     }
+  else if (iovec->iovecs[0].type == IOVEC_ALLOC_POOL)
+    {
+      /*
+       * Grow into a bigger buffer if this one is too small, or if
+       * another message holds it and could see the bytes we grow into.
+       * The old buffer may still be referenced by another message.
+       */
+      struct iovec_entry *entry = &iovec->iovecs[0];
+      OFC_UCHAR *buffer;
+
+      if (entry->data + len > entry->buffer + ofc_buffer_size(entry->buffer) ||
+          (len > entry->length && ofc_buffer_shared(entry->buffer)))
+        {
+          buffer = ofc_buffer_alloc(len);
+          ofc_memcpy(buffer, entry->data, OFC_MIN(entry->length, len));
+          ofc_buffer_release(entry->buffer);
+          entry->buffer = buffer;
+          entry->data = buffer;
+        }
+      entry->length = len;
+      iovec->end_offset = len;
+    }
 }
 
 OFC_UCHAR *ofc_iovec_lookup(OFC_IOMAP list, OFC_OFFT offset,
@@ -354,3 +481,35 @@ OFC_VOID ofc_iovec_get(OFC_IOMAP inp,
         }
     }
 }
+
+OFC_INT ofc_iovec_fill(OFC_IOMAP inp,
+                       OFC_OFFT offset,
+                       OFC_OFFT last_offset,
+                       OFC_IOVEC *iovec,
+                       OFC_INT max)
+{
+  struct iovec_list *list = inp;
+  OFC_INT i;
+  OFC_INT j;
+  OFC_OFFT pre_len;
+  OFC_OFFT end;
+
+  j = 0;
+  for (i = ofc_iovec_find(list, offset);
+       i < list->num_vecs && offset < last_offset && j < max;
+       i++)
+    {
+      end = list->iovecs[i].offset + list->iovecs[i].length;
+      if (end > last_offset)
+        end = last_offset;
+      if (list->iovecs[i].type != IOVEC_ALLOC_NONE && end > offset)
+        {
+          pre_len = offset - list->iovecs[i].offset;
+          iovec[j].iov_base = (OFC_CHAR *) list->iovecs[i].data + pre_len;
+          iovec[j].iov_len = (OFC_LONG) (end - offset);
+          j++;
+        }
+      offset = end;
+    }
+  return (j);
+}
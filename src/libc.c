@@ -31,12 +31,8 @@
 #include "ofc/persist.h"
 
 #include "ofc/heap.h"
-
-struct trace_t {
-    OFC_INT trace_offset;
-    OFC_CHAR trace_buf[OFC_TRACE_LEN];
-    OFC_OFFT trace_lock;
-};
+#include "ofc/atomic.h"
+#include "ofc/libc_simd.h"
 
 /**
  * \internal
@@ -207,23 +203,30 @@ ofc_strlen(OFC_CCHAR *astr) {
     return (ret);
 }
 
+static OFC_SIZET
+ofc_strnlen_scalar(OFC_CCHAR *astr, OFC_SIZET len) {
+    OFC_SIZET ret;
+    OFC_CCHAR *pa;
+
+    ret = 0;
+    pa = astr;
+
+    while (*pa != '\0' && len > 0) {
+        ret++;
+        pa++;
+        len--;
+    }
+    return (ret);
+}
+
 OFC_CORE_LIB OFC_SIZET
 ofc_strnlen(OFC_CCHAR *astr, OFC_SIZET len) {
     OFC_SIZET ret;
-    OFC_CCHAR *pa;
 
     if (astr == OFC_NULL)
         ret = 0;
-    else {
-        ret = 0;
-        pa = astr;
-
-        while (*pa != '\0' && len > 0) {
-            ret++;
-            pa++;
-            len--;
-        }
-    }
+    else
+        ret = ofc_libc_active->str_nlen(astr, len);
     return (ret);
 }
 
@@ -325,20 +328,26 @@ OFC_CHAR *ofc_strnupr(OFC_CHAR *src, OFC_SIZET len) {
     return (ret);
 }
 
-OFC_TCHAR *ofc_tstrnupr(OFC_TCHAR *src, OFC_SIZET len) {
+static OFC_VOID
+ofc_tstrnupr_scalar(OFC_TCHAR *src, OFC_SIZET len) {
     OFC_TCHAR *psrc;
+
+    psrc = src;
+
+    while (*psrc != '\0' && len > 0) {
+        *psrc = OFC_TTOUPPER(*psrc);
+        psrc++;
+        len--;
+    }
+}
+
+OFC_TCHAR *ofc_tstrnupr(OFC_TCHAR *src, OFC_SIZET len) {
     OFC_TCHAR *ret;
 
     if (src == OFC_NULL) {
         ret = OFC_NULL;
     } else {
-        psrc = src;
-
-        while (*psrc != '\0' && len > 0) {
-            *psrc = OFC_TTOUPPER(*psrc);
-            psrc++;
-            len--;
-        }
+        ofc_libc_active->tstr_nupr(src, len);
         ret = src;
     }
 
@@ -465,15 +474,23 @@ ofc_tstrcpy(OFC_TCHAR *dst, OFC_CTCHAR *src) {
     return (ret);
 }
 
+static OFC_SIZET
+ofc_tstrlen_scalar(OFC_LPCTSTR str) {
+    OFC_SIZET ret;
+    OFC_LPCTSTR p;
+
+    for (ret = 0, p = str; *p != TCHAR_EOS; ret++, p++);
+    return (ret);
+}
+
 OFC_CORE_LIB OFC_SIZET
 ofc_tstrlen(OFC_LPCTSTR str) {
     OFC_SIZET ret;
-    OFC_LPCTSTR p;
 
     if (str == OFC_NULL)
         ret = 0;
     else
-        for (ret = 0, p = str; *p != TCHAR_EOS; ret++, p++);
+        ret = ofc_libc_active->tstr_len(str);
     return (ret);
 }
 
@@ -538,10 +555,34 @@ ofc_tstrcmp(OFC_LPCTSTR astr, OFC_LPCTSTR bstr) {
     return ret;
 }
 
-OFC_CORE_LIB OFC_INT
-ofc_tstrcasecmp(OFC_LPCTSTR astr, OFC_LPCTSTR bstr) {
+static OFC_INT
+ofc_tstrcasecmp_scalar(OFC_LPCTSTR astr, OFC_LPCTSTR bstr) {
     OFC_CTCHAR *pa;
     OFC_CTCHAR *pb;
+
+    pa = astr;
+    pb = bstr;
+
+    /*
+     * Step through the string until one of them reaches a NIL
+     */
+    while (OFC_TTOUPPER(*pa) == OFC_TTOUPPER(*pb) &&
+           *pa != TCHAR_EOS && *pb != TCHAR_EOS) {
+        pa++;
+        pb++;
+    }
+
+    /*
+     * Then if the character from a at that position is greater then the
+     * respsective character in b, a is bigger.  If the a character is less
+     * then a is less, and if they are equal (or both NIL), then the strings
+     * are equal.
+     */
+    return (OFC_TTOUPPER(*pa) - OFC_TTOUPPER(*pb));
+}
+
+OFC_CORE_LIB OFC_INT
+ofc_tstrcasecmp(OFC_LPCTSTR astr, OFC_LPCTSTR bstr) {
     OFC_INT ret;
 
     if (astr == OFC_NULL || bstr == OFC_NULL) {
@@ -549,27 +590,8 @@ ofc_tstrcasecmp(OFC_LPCTSTR astr, OFC_LPCTSTR bstr) {
             ret = 0;
         else
             ret = -1;
-    } else {
-        pa = astr;
-        pb = bstr;
-
-        /*
-         * Step through the string until one of them reaches a NIL
-         */
-        while (OFC_TTOUPPER(*pa) == OFC_TTOUPPER(*pb) &&
-               *pa != TCHAR_EOS && *pb != TCHAR_EOS) {
-            pa++;
-            pb++;
-        }
-
-        /*
-         * Then if the character from a at that position is greater then the
-         * respsective character in b, a is bigger.  If the a character is less
-         * then a is less, and if they are equal (or both NIL), then the strings
-         * are equal.
-         */
-        ret = OFC_TTOUPPER(*pa) - OFC_TTOUPPER(*pb);
-    }
+    } else
+        ret = ofc_libc_active->tstr_casecmp(astr, bstr);
     return (ret);
 }
 
@@ -776,50 +798,54 @@ ofc_strrtok(OFC_LPCSTR str, OFC_LPCSTR terms) {
     return (ret);
 }
 
+static OFC_VOID
+ofc_tstr2cstr_scalar(OFC_CHAR *cstr, OFC_LPCTSTR str, OFC_SIZET len) {
+    OFC_SIZET i;
+
+    for (i = 0; i < len; i++)
+        *cstr++ = (OFC_CHAR) *str++;
+}
+
 OFC_CORE_LIB OFC_CHAR *
 ofc_tstr2cstr(OFC_LPCTSTR str) {
     OFC_SIZET len;
     OFC_CHAR *cstr;
-    OFC_INT i;
-    OFC_CTCHAR *ptstr;
-    OFC_CHAR *pcstr;
 
     cstr = OFC_NULL;
     if (str != OFC_NULL) {
         len = ofc_tstrlen(str);
         cstr = ofc_malloc(len + 1);
-        pcstr = cstr;
-        ptstr = str;
-        for (i = 0; i < len; i++)
-            *pcstr++ = (OFC_CHAR) *ptstr++;
-        *pcstr = '\0';
+        ofc_libc_active->tstr_narrow(cstr, str, len);
+        cstr[len] = '\0';
     }
     return (cstr);
 }
 
+static OFC_VOID
+ofc_cstr2tstr_scalar(OFC_TCHAR *tstr, OFC_CCHAR *str, OFC_SIZET len) {
+    OFC_SIZET i;
+
+    for (i = 0; i < len; i++)
+        *tstr++ = (OFC_TCHAR) (*str++);
+}
+
 OFC_CORE_LIB OFC_LPTSTR
 ofc_cstr2tstr(OFC_CCHAR *str) {
     OFC_SIZET len;
     OFC_LPTSTR tstr;
-    OFC_INT i;
-    OFC_TCHAR *ptstr;
-    OFC_CCHAR *pcstr;
 
     tstr = OFC_NULL;
     if (str != OFC_NULL) {
         len = ofc_strlen(str);
         tstr = ofc_malloc((len + 1) * sizeof(OFC_TCHAR));
-        ptstr = tstr;
-        pcstr = str;
-        for (i = 0; i < len; i++)
-            *ptstr++ = (OFC_TCHAR) (*pcstr++);
-        *ptstr = (OFC_TCHAR) '\0';
+        ofc_libc_active->cstr_widen(tstr, str, len);
+        tstr[len] = (OFC_TCHAR) '\0';
     }
     return (tstr);
 }
 
-OFC_CORE_LIB OFC_INT
-ofc_memcmp(OFC_LPCVOID a, OFC_LPCVOID b, OFC_SIZET size) {
+static OFC_INT
+ofc_memcmp_scalar(OFC_LPCVOID a, OFC_LPCVOID b, OFC_SIZET size) {
     OFC_INT ret;
     OFC_UINT32 *puint32;
     const OFC_UINT32 *pcuint32;
@@ -828,53 +854,108 @@ ofc_memcmp(OFC_LPCVOID a, OFC_LPCVOID b, OFC_SIZET size) {
     OFC_UINT8 *puint8;
     const OFC_UINT8 *pcuint8;
 
+    ret = 0;
+    if (!((OFC_DWORD_PTR) a & 0x03) && !((OFC_DWORD_PTR) b & 0x03)) {
+        puint32 = (OFC_UINT32 *) b;
+        pcuint32 = (const OFC_UINT32 *) a;
+
+        while (size >= 4 && ret == 0) {
+            ret = *pcuint32++ - *puint32++;
+            size -= 4;
+        }
+        puint8 = (OFC_UINT8 *) puint32;
+        pcuint8 = (const OFC_UINT8 *) pcuint32;
+        while (size != 0 && ret == 0) {
+            ret = *pcuint8++ - *puint8++;
+            size--;
+        }
+
+    } else if (!((OFC_DWORD_PTR) a & 0x01) && !((OFC_DWORD_PTR) b & 0x01)) {
+        puint16 = (OFC_UINT16 *) b;
+        pcuint16 = (const OFC_UINT16 *) a;
+
+        while (size >= 2 && ret == 0) {
+            ret = *pcuint16++ - *puint16++;
+            size -= 2;
+        }
+        puint8 = (OFC_UINT8 *) puint16;
+        pcuint8 = (const OFC_UINT8 *) pcuint16;
+        while (size != 0 && ret == 0) {
+            ret = *pcuint8++ - *puint8++;
+            size--;
+        }
+    } else {
+        puint8 = (OFC_UINT8 *) b;
+        pcuint8 = (const OFC_UINT8 *) a;
+
+        while (size != 0 && ret == 0) {
+            ret = *pcuint8++ - *puint8++;
+            size--;
+        }
+    }
+    return (ret);
+}
+
+OFC_CORE_LIB OFC_INT
+ofc_memcmp(OFC_LPCVOID a, OFC_LPCVOID b, OFC_SIZET size) {
+    OFC_INT ret;
+
     if (a == OFC_NULL || b == OFC_NULL) {
         if (a == OFC_NULL && b == OFC_NULL)
             ret = 0;
         else
             ret = -1;
-    } else {
-        ret = 0;
-        if (!((OFC_DWORD_PTR) a & 0x03) && !((OFC_DWORD_PTR) b & 0x03)) {
-            puint32 = (OFC_UINT32 *) b;
-            pcuint32 = (const OFC_UINT32 *) a;
+    } else
+        ret = ofc_libc_active->mem_compare(a, b, size);
+    return (ret);
+}
 
-            while (size >= 4 && ret == 0) {
-                ret = *pcuint32++ - *puint32++;
-                size -= 4;
-            }
-            puint8 = (OFC_UINT8 *) puint32;
-            pcuint8 = (const OFC_UINT8 *) pcuint32;
-            while (size != 0 && ret == 0) {
-                ret = *pcuint8++ - *puint8++;
-                size--;
-            }
+static OFC_VOID
+ofc_memcpy_scalar(OFC_LPVOID out, OFC_LPCVOID in, OFC_SIZET size) {
+    OFC_UINT32 *puint32;
+    const OFC_UINT32 *pcuint32;
+    OFC_UINT16 *puint16;
+    const OFC_UINT16 *pcuint16;
+    OFC_UINT8 *puint8;
+    const OFC_UINT8 *pcuint8;
 
-        } else if (!((OFC_DWORD_PTR) a & 0x01) && !((OFC_DWORD_PTR) b & 0x01)) {
-            puint16 = (OFC_UINT16 *) b;
-            pcuint16 = (const OFC_UINT16 *) a;
+    if (!((OFC_DWORD_PTR) in & 0x03) && !((OFC_DWORD_PTR) out & 0x03)) {
+        puint32 = (OFC_UINT32 *) out;
+        pcuint32 = (const OFC_UINT32 *) in;
 
-            while (size >= 2 && ret == 0) {
-                ret = *pcuint16++ - *puint16++;
-                size -= 2;
-            }
-            puint8 = (OFC_UINT8 *) puint16;
-            pcuint8 = (const OFC_UINT8 *) pcuint16;
-            while (size != 0 && ret == 0) {
-                ret = *pcuint8++ - *puint8++;
-                size--;
-            }
-        } else {
-            puint8 = (OFC_UINT8 *) b;
-            pcuint8 = (const OFC_UINT8 *) a;
+        while (size >= 4) {
+            *puint32++ = *pcuint32++;
+            size -= 4;
+        }
+        puint8 = (OFC_UINT8 *) puint32;
+        pcuint8 = (const OFC_UINT8 *) pcuint32;
+        while (size != 0) {
+            *puint8++ = *pcuint8++;
+            size--;
+        }
+    } else if (!((OFC_DWORD_PTR) in & 0x01) && !((OFC_DWORD_PTR) out & 0x01)) {
+        puint16 = (OFC_UINT16 *) out;
+        pcuint16 = (const OFC_UINT16 *) in;
 
-            while (size != 0 && ret == 0) {
-                ret = *pcuint8++ - *puint8++;
-                size--;
-            }
+        while (size >= 2) {
+            *puint16++ = *pcuint16++;
+            size -= 2;
+        }
+        puint8 = (OFC_UINT8 *) puint16;
+        pcuint8 = (const OFC_UINT8 *) pcuint16;
+        while (size != 0) {
+            *puint8++ = *pcuint8++;
+            size--;
+        }
+    } else {
+        puint8 = (OFC_UINT8 *) out;
+        pcuint8 = (const OFC_UINT8 *) in;
+
+        while (size != 0) {
+            *puint8++ = *pcuint8++;
+            size--;
         }
     }
-    return (ret);
 }
 
 OFC_CORE_LIB OFC_LPVOID
@@ -883,60 +964,35 @@ ofc_memcpy(OFC_LPVOID out, OFC_LPCVOID in, OFC_SIZET size) {
 #if defined(__linux__)
     dst = memcpy (out, in, size);
 #else
-    OFC_UINT32 *puint32;
-    const OFC_UINT32 *pcuint32;
-    OFC_UINT16 *puint16;
-    const OFC_UINT16 *pcuint16;
-    OFC_UINT8 *puint8;
-    const OFC_UINT8 *pcuint8;
-
     if (out == OFC_NULL || in == OFC_NULL)
         dst = OFC_NULL;
     else {
         dst = out;
-
-        if (!((OFC_DWORD_PTR) in & 0x03) && !((OFC_DWORD_PTR) out & 0x03)) {
-            puint32 = (OFC_UINT32 *) out;
-            pcuint32 = (const OFC_UINT32 *) in;
-
-            while (size >= 4) {
-                *puint32++ = *pcuint32++;
-                size -= 4;
-            }
-            puint8 = (OFC_UINT8 *) puint32;
-            pcuint8 = (const OFC_UINT8 *) pcuint32;
-            while (size != 0) {
-                *puint8++ = *pcuint8++;
-                size--;
-            }
-        } else if (!((OFC_DWORD_PTR) in & 0x01) && !((OFC_DWORD_PTR) out & 0x01)) {
-            puint16 = (OFC_UINT16 *) out;
-            pcuint16 = (const OFC_UINT16 *) in;
-
-            while (size >= 2) {
-                *puint16++ = *pcuint16++;
-                size -= 2;
-            }
-            puint8 = (OFC_UINT8 *) puint16;
-            pcuint8 = (const OFC_UINT8 *) pcuint16;
-            while (size != 0) {
-                *puint8++ = *pcuint8++;
-                size--;
-            }
-        } else {
-            puint8 = (OFC_UINT8 *) out;
-            pcuint8 = (const OFC_UINT8 *) in;
-
-            while (size != 0) {
-                *puint8++ = *pcuint8++;
-                size--;
-            }
-        }
+        ofc_libc_active->mem_copy(out, in, size);
     }
 #endif
     return (dst);
 }
 
+/*
+ * The portable kernels.  Used until the core is loaded and wherever the
+ * CPU has no vector unit.
+ */
+const OFC_LIBC_OPS ofc_libc_scalar_ops =
+        {
+                "scalar",
+                ofc_memcmp_scalar,
+                ofc_memcpy_scalar,
+                ofc_strnlen_scalar,
+                ofc_tstrlen_scalar,
+                ofc_tstrcasecmp_scalar,
+                ofc_tstrnupr_scalar,
+                ofc_tstr2cstr_scalar,
+                ofc_cstr2tstr_scalar
+        };
+
+const OFC_LIBC_OPS *ofc_libc_active = &ofc_libc_scalar_ops;
+
 OFC_CORE_LIB OFC_LPVOID
 ofc_memset(OFC_LPVOID dst, OFC_INT c, OFC_SIZET size) {
     OFC_CHAR *pa;
@@ -1667,35 +1723,6 @@ ofc_snprintf(OFC_CHAR *str, OFC_SIZET count, OFC_CCHAR *fmt, ...) {
     return ret;
 }
 
-OFC_CORE_LIB OFC_VOID
-ofc_log(OFC_LOG_LEVEL level, OFC_CCHAR *fmt, ...)
-{
-  OFC_CHAR *obuf;
-  OFC_SIZET len;
-  OFC_SIZET tlen;
-
-  va_list ap;
-
-  if (level <= ofc_persist_log_level())
-    {
-      va_start(ap, fmt);
-      len = ofc_vsnprintf(OFC_NULL, 0, fmt, ap);
-      va_end(ap);
-
-      obuf = ofc_malloc(len + 1);
-      va_start(ap, fmt);
-      ofc_vsnprintf(obuf, len + 1, fmt, ap);
-      va_end(ap);
-
-      ofc_write_log(level, obuf, len);
-
-      if (ofc_persist_log_console())
-        ofc_write_stdout(obuf, len);
-
-      ofc_free(obuf);
-    }
-}
-
 OFC_CORE_LIB OFC_VOID
 ofc_printf(OFC_CCHAR *fmt, ...) {
     OFC_CHAR *obuf;
@@ -1741,120 +1768,573 @@ ofc_saprintf(OFC_CCHAR *fmt, ...) {
     return (obuf);
 }
 
-#if 0
-OFC_CORE_LIB OFC_VOID 
-ofc_trace_init (OFC_VOID)
-{
-  struct trace_t *trace ;
+#if !defined(OFC_NO_TRACE)
+/*
+ * Each thread claims a ring and is the only writer of it, so recording
+ * takes no lock.  A record's seq is its position in the ring plus one
+ * once it is complete and zero while it is being written.  The dump
+ * reads rings while their owners keep writing and uses seq to discard
+ * records that were torn or overwritten under it.
+ */
+union trace_arg {
+    OFC_INT i;
+    OFC_UINT u;
+    OFC_LONG l;
+    OFC_ULONG ul;
+    OFC_VOID *p;
+};
 
-  trace = ofc_get_trace() ;
-  if (trace == OFC_NULL)
-    {
-      trace = ofc_malloc (sizeof (struct trace_t)) ;
-      if (trace != OFC_NULL)
-    {
-      ofc_memset (trace, '\0', sizeof (struct trace_t)) ;
-      trace->trace_offset = 0 ;
-      trace->trace_lock = ofc_lock_init() ;
-      ofc_set_trace (trace) ;
-      ofc_trace ("Trace Buffer Initialized\n") ;
+struct trace_record {
+    volatile OFC_UINT32 seq;
+    OFC_INT nargs;
+    OFC_CCHAR *fmt;
+    OFC_NSTIME stamp;
+    union trace_arg args[OFC_TRACE_ARGS];
+    OFC_CHAR text[OFC_TRACE_TEXT];    /* Copies of string arguments */
+};
+
+struct trace_ring {
+    volatile OFC_INT active;
+    volatile OFC_UINT32 head;    /* Records ever written to the ring */
+    struct trace_record *records;
+};
+
+static struct trace_ring ofc_trace_rings[OFC_TRACE_THREADS];
+static volatile OFC_BOOL ofc_trace_enabled = OFC_FALSE;
+static OFC_UINT32 ofc_trace_epoch;
+static volatile OFC_UINT32 ofc_trace_dropped;
+static OFC_THREAD_LOCAL struct trace_ring *ofc_trace_thread;
+static OFC_THREAD_LOCAL OFC_UINT32 ofc_trace_thread_epoch;
+
+/*
+ * Per thread cache of parsed format strings, keyed by address
+ */
+#define OFC_TRACE_FORMATS 64
+#define OFC_TRACE_KINDS (2 * OFC_TRACE_ARGS)
+
+struct trace_kinds {
+    OFC_CCHAR *fmt;
+    OFC_CHAR kinds[OFC_TRACE_KINDS + 1];
+};
+
+static OFC_THREAD_LOCAL struct trace_kinds ofc_trace_kinds[OFC_TRACE_FORMATS];
+
+/*
+ * One conversion of a format string, parsed with the grammar dopr uses
+ */
+struct trace_spec {
+    OFC_CCHAR *start;        /* The '%' */
+    OFC_CCHAR *end;        /* Just past the conversion */
+    OFC_INT stars;        /* Width and precision arguments */
+    OFC_INT cflags;
+    OFC_CHAR conv;
+};
+
+static OFC_BOOL
+trace_next_spec(OFC_CCHAR *fmt, struct trace_spec *spec) {
+    OFC_CCHAR *p;
+
+    for (p = fmt; *p != '\0' && *p != '%'; p++);
+    if (*p == '\0')
+        return (OFC_FALSE);
+
+    spec->start = p++;
+    spec->stars = 0;
+    spec->cflags = 0;
+
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+        p++;
+    if (*p == '*') {
+        spec->stars++;
+        p++;
+    } else {
+        while (OFC_ISDIGIT((OFC_UINT8) *p))
+            p++;
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec->stars++;
+            p++;
+        } else {
+            while (OFC_ISDIGIT((OFC_UINT8) *p))
+                p++;
+        }
+    }
+    if (*p == 'h') {
+        spec->cflags = DP_C_SHORT;
+        p++;
+    } else if (*p == 'l') {
+        spec->cflags = DP_C_LONG;
+        p++;
+    }
+
+    spec->conv = *p;
+    if (*p != '\0') {
+        p++;
+        /* dopr skips the character after a 'w' */
+        if (spec->conv == 'w' && *p != '\0')
+            p++;
+    }
+    spec->end = p;
+    return (OFC_TRUE);
+}
+
+/*
+ * Number of recorded arguments a conversion consumes
+ */
+static OFC_INT
+trace_spec_args(const struct trace_spec *spec) {
+    OFC_INT nargs;
+
+    nargs = spec->stars;
+    switch (spec->conv) {
+        case 'b':
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'c':
+        case 'p':
+        case 's':
+        case 'S':
+        case 'A':
+            nargs++;
+            break;
+        default:
+            break;
+    }
+    return (nargs);
+}
+
+/*
+ * Copy a string argument into the record's text.  Each string is
+ * terminated.  Once the text is full, later strings are empty.
+ */
+static OFC_INT
+trace_copy_text(struct trace_record *rec, OFC_INT *used,
+                OFC_CHAR conv, OFC_VOID *str) {
+    OFC_CCHAR *cstr;
+    OFC_CTCHAR *tstr;
+    OFC_CTACHAR *tastr;
+    OFC_INT offset;
+
+    if (str == OFC_NULL)
+        return (-1);
+
+    offset = *used;
+    if (conv == 's') {
+        for (cstr = str; *cstr != '\0' && *used < OFC_TRACE_TEXT - 1;)
+            rec->text[(*used)++] = *cstr++;
+    } else if (conv == 'S') {
+        for (tstr = str; *tstr != TCHAR_EOS && *used < OFC_TRACE_TEXT - 1;)
+            rec->text[(*used)++] = (OFC_CHAR) *tstr++;
+    } else {
+        for (tastr = str; *tastr != 0 && *used < OFC_TRACE_TEXT - 1;)
+            rec->text[(*used)++] = (OFC_CHAR) *tastr++;
+    }
+    rec->text[*used] = '\0';
+    if (*used < OFC_TRACE_TEXT - 1)
+        (*used)++;
+    return (offset);
+}
+
+/*
+ * Reduce a format string to the kinds of the arguments it takes, one
+ * character per argument: 'i' int, 'u' unsigned, 'l' long, 'L' unsigned
+ * long, 'p' pointer, 's', 'S' or 'A' for a string, and 'n' for a %n
+ * pointer, which is not recorded.  Arguments that do not fit in a record
+ * are left off.
+ */
+static OFC_VOID
+trace_compile(OFC_CCHAR *fmt, OFC_CHAR *kinds) {
+    struct trace_spec spec;
+    OFC_CCHAR *p;
+    OFC_CHAR kind;
+    OFC_INT nargs;
+    OFC_INT nkinds;
+
+    nargs = 0;
+    nkinds = 0;
+    for (p = fmt; trace_next_spec(p, &spec); p = spec.end) {
+        if (nargs + trace_spec_args(&spec) > OFC_TRACE_ARGS ||
+            nkinds + spec.stars + 1 > OFC_TRACE_KINDS)
+            break;
+        nargs += trace_spec_args(&spec);
+        if (spec.stars > 0)
+            kinds[nkinds++] = 'i';
+        if (spec.stars > 1)
+            kinds[nkinds++] = 'i';
+
+        switch (spec.conv) {
+            case 'd':
+            case 'i':
+                kind = spec.cflags == DP_C_LONG ? 'l' : 'i';
+                break;
+            case 'c':
+                kind = 'i';
+                break;
+            case 'b':
+            case 'o':
+            case 'u':
+            case 'x':
+            case 'X':
+                kind = spec.cflags == DP_C_LONG ? 'L' : 'u';
+                break;
+            case 'p':
+            case 'n':
+            case 's':
+            case 'S':
+            case 'A':
+                kind = spec.conv;
+                break;
+            default:
+                kind = '\0';
+                break;
+        }
+        if (kind != '\0')
+            kinds[nkinds++] = kind;
+    }
+    kinds[nkinds] = '\0';
+}
+
+/*
+ * Look up the argument kinds of a format string in the calling thread's
+ * cache, so each format is only parsed once per thread
+ */
+static OFC_CCHAR *
+trace_kinds(OFC_CCHAR *fmt) {
+    struct trace_kinds *entry;
+
+    entry = &ofc_trace_kinds[((OFC_ULONG_PTR) fmt >> 3) &
+                             (OFC_TRACE_FORMATS - 1)];
+    if (entry->fmt != fmt) {
+        trace_compile(fmt, entry->kinds);
+        entry->fmt = fmt;
+    }
+    return (entry->kinds);
+}
+
+/*
+ * Find the calling thread's ring, claiming one on first use.  A thread
+ * that finds no free ring is not traced until the trace is reloaded.
+ */
+static struct trace_ring *
+ofc_trace_ring(OFC_VOID) {
+    struct trace_ring *ring;
+    OFC_INT expected;
+    OFC_INT i;
+
+    if (ofc_trace_thread_epoch == ofc_trace_epoch)
+        return (ofc_trace_thread);
+
+    ring = OFC_NULL;
+    for (i = 0; i < OFC_TRACE_THREADS && ring == OFC_NULL; i++) {
+        expected = 0;
+        if (OFC_ATOMIC_CAS(&ofc_trace_rings[i].active, &expected, 1))
+            ring = &ofc_trace_rings[i];
     }
+
+    if (ring != OFC_NULL && ring->records == OFC_NULL) {
+        ring->records =
+                ofc_malloc(OFC_TRACE_RECORDS * sizeof(struct trace_record));
+        if (ring->records == OFC_NULL) {
+            OFC_ATOMIC_STORE(&ring->active, 0);
+            ring = OFC_NULL;
+        } else
+            ofc_memset(ring->records, 0,
+                       OFC_TRACE_RECORDS * sizeof(struct trace_record));
     }
+
+    ofc_trace_thread = ring;
+    ofc_trace_thread_epoch = ofc_trace_epoch;
+    return (ring);
 }
 
 OFC_CORE_LIB OFC_VOID
-ofc_trace_destroy (OFC_VOID)
-{
-  struct trace_t *trace ;
+ofc_trace_init(OFC_VOID) {
+    if (!ofc_trace_enabled) {
+        ofc_trace_epoch++;
+        ofc_trace_dropped = 0;
+        ofc_trace_enabled = OFC_TRUE;
+        ofc_trace("Trace Buffer Initialized\n");
+    }
+}
 
-  trace = ofc_get_trace() ;
-  if (trace != OFC_NULL)
-    {
-      ofc_lock_destroy(trace->trace_lock);
-      ofc_set_trace(OFC_NULL);
-      ofc_free (trace);
+OFC_CORE_LIB OFC_VOID
+ofc_trace_destroy(OFC_VOID) {
+    OFC_INT i;
+
+    if (ofc_trace_enabled) {
+        ofc_trace_enabled = OFC_FALSE;
+        for (i = 0; i < OFC_TRACE_THREADS; i++) {
+            if (ofc_trace_rings[i].records != OFC_NULL)
+                ofc_free(ofc_trace_rings[i].records);
+            ofc_trace_rings[i].records = OFC_NULL;
+            ofc_trace_rings[i].head = 0;
+            ofc_trace_rings[i].active = 0;
+        }
     }
 }
 
 OFC_CORE_LIB OFC_VOID
-ofc_trace(OFC_CCHAR *fmt,...)
-{
-  OFC_CHAR *obuf ;
-  OFC_CHAR *obuf2 ;
-  OFC_SIZET len ;
-  OFC_SIZET olen ;
-  struct trace_t *trace ;
-  OFC_PROCESS_ID pid ;
-
-  va_list ap ;
-
-  va_start(ap, fmt) ;
-
-  len = ofc_vsnprintf(OFC_NULL, 0, fmt, ap) ;
-  va_end(ap) ;
-  obuf = ofc_malloc (len+1) ;
-  va_start(ap, fmt) ;
-  ofc_vsnprintf(obuf, len+1, fmt, ap) ;
-  va_end(ap) ;
-
-  /*
-   * prepend process id
-   */
-  pid = ofc_process_get() ;
-  obuf2 = ofc_saprintf ("%8d: %s\n", pid, obuf) ;
-  len = ofc_strlen (obuf2) ;
-  ofc_free (obuf) ;
-
-  trace = ofc_get_trace() ;
-  if (trace != OFC_NULL && ((len + 1) < OFC_TRACE_LEN))
-    {
-      ofc_lock (trace->trace_lock) ;
-      olen = OFC_MIN (len, OFC_TRACE_LEN -
-             trace->trace_offset - 1) ;
-      ofc_memcpy (trace->trace_buf + trace->trace_offset,
-           obuf2, olen) ;
-      *(trace->trace_buf + trace->trace_offset + olen) = '\0' ;
-
-      trace->trace_offset += (olen + 1) ;
-      if ((trace->trace_offset) == OFC_TRACE_LEN)
-    trace->trace_offset = 0 ;
-
-      len -= olen ;
-      if (len > 0)
-    {
-      ofc_memcpy (trace->trace_buf + trace->trace_offset,
-               obuf2 + olen, len) ;
-      *(trace->trace_buf + trace->trace_offset + len) =
-        '\0' ;
-      trace->trace_offset += (len + 1) ;
+ofc_trace_thread_exit(OFC_VOID) {
+    if (ofc_trace_thread != OFC_NULL &&
+        ofc_trace_thread_epoch == ofc_trace_epoch)
+        OFC_ATOMIC_STORE(&ofc_trace_thread->active, 0);
+    ofc_trace_thread = OFC_NULL;
+    ofc_trace_thread_epoch = 0;
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_trace(OFC_CCHAR *fmt, ...) {
+    struct trace_ring *ring;
+    struct trace_record *rec;
+    OFC_CCHAR *kinds;
+    OFC_UINT32 head;
+    OFC_INT nargs;
+    OFC_INT used;
+    va_list ap;
+
+    if (!ofc_trace_enabled)
+        return;
+
+    ring = ofc_trace_ring();
+    if (ring == OFC_NULL) {
+        OFC_ATOMIC_ADD_RELAXED(&ofc_trace_dropped, 1);
+        return;
     }
-      ofc_unlock (trace->trace_lock) ;
+
+    kinds = trace_kinds(fmt);
+
+    head = ring->head;
+    rec = &ring->records[head & (OFC_TRACE_RECORDS - 1)];
+    rec->seq = 0;
+    OFC_ATOMIC_FENCE_RELEASE();
+
+    rec->fmt = fmt;
+    rec->stamp = ofc_time_get_ns();
+
+    nargs = 0;
+    used = 0;
+    va_start(ap, fmt);
+    for (; *kinds != '\0'; kinds++) {
+        switch (*kinds) {
+            case 'i':
+                rec->args[nargs++].i = va_arg(ap, OFC_INT);
+                break;
+            case 'u':
+                rec->args[nargs++].u = va_arg(ap, OFC_UINT);
+                break;
+            case 'l':
+                rec->args[nargs++].l = va_arg(ap, OFC_LONG);
+                break;
+            case 'L':
+                rec->args[nargs++].ul = va_arg(ap, OFC_ULONG);
+                break;
+            case 'p':
+                rec->args[nargs++].p = va_arg(ap, OFC_VOID *);
+                break;
+            case 'n':
+                (OFC_VOID) va_arg(ap, OFC_VOID *);
+                break;
+            default:
+                rec->args[nargs++].i =
+                        trace_copy_text(rec, &used, *kinds,
+                                        va_arg(ap, OFC_VOID *));
+                break;
+        }
     }
-  ofc_free (obuf2) ;
+    va_end(ap);
+    rec->nargs = nargs;
+
+    OFC_ATOMIC_STORE(&rec->seq, head + 1);
+    OFC_ATOMIC_STORE(&ring->head, head + 1);
 }
 
-OFC_CORE_LIB OFC_VOID ofc_dump_trace(OFC_VOID)
-{
-  struct trace_t *trace ;
+static OFC_VOID
+trace_append(OFC_CHAR *out, OFC_SIZET size, OFC_SIZET *len,
+             OFC_CCHAR *str, OFC_SIZET count) {
+    count = OFC_MIN(count, size - 1 - *len);
+    ofc_memcpy(out + *len, str, count);
+    *len += count;
+    out[*len] = '\0';
+}
 
-  OFC_CHAR *obuf ;
-  OFC_SIZET olen ;
-  OFC_INT off ;
+/*
+ * Format a record.  Each conversion is handed to ofc_snprintf on its
+ * own with its recorded argument, so the output is the same as if the
+ * record had been formatted when it was traced.
+ */
+static OFC_VOID
+trace_format(OFC_CHAR *out, OFC_SIZET size, OFC_SIZET *len,
+             struct trace_record *rec) {
+    struct trace_spec spec;
+    OFC_CHAR conv[48];
+    OFC_CCHAR *fmt;
+    OFC_CCHAR *p;
+    OFC_SIZET clen;
+    OFC_INT arg;
+    union trace_arg value;
+
+    arg = 0;
+    for (fmt = rec->fmt; trace_next_spec(fmt, &spec); fmt = spec.end) {
+        trace_append(out, size, len, fmt, spec.start - fmt);
+
+        if (arg + trace_spec_args(&spec) > rec->nargs ||
+            spec.end - spec.start > 16) {
+            /* Not recorded */
+            trace_append(out, size, len, spec.start, spec.end - spec.start);
+            arg = rec->nargs;
+            continue;
+        }
 
-  trace = ofc_get_trace() ;
-  if (trace != OFC_NULL)
-    {
-      off = trace->trace_offset ;
-      do
-    {
-      obuf = trace->trace_buf + off ;
-      olen = ofc_strlen (obuf) ;
-      ofc_printf ("%s", obuf) ;
-      off += (olen + 1) ;
-      if (off == OFC_TRACE_LEN)
-        off = 0 ;
-    }
-      while (off != trace->trace_offset) ;
+        /*
+         * Rebuild the conversion with the recorded width and precision
+         */
+        clen = 0;
+        for (p = spec.start; p < spec.end; p++) {
+            if (*p == '*') {
+                clen += ofc_snprintf(conv + clen, sizeof(conv) - clen, "%d",
+                                     OFC_MAX(rec->args[arg].i, 0));
+                arg++;
+            } else
+                conv[clen++] = *p;
+        }
+        conv[clen] = '\0';
+
+        if (spec.conv == 'n' || spec.conv == '\0')
+            continue;
+
+        value = rec->args[arg];
+        if (trace_spec_args(&spec) > spec.stars)
+            arg++;
+
+        switch (spec.conv) {
+            case 'd':
+            case 'i':
+                if (spec.cflags == DP_C_LONG)
+                    clen = ofc_snprintf(out + *len, size - *len, conv, value.l);
+                else
+                    clen = ofc_snprintf(out + *len, size - *len, conv, value.i);
+                break;
+            case 'b':
+            case 'o':
+            case 'u':
+            case 'x':
+            case 'X':
+                if (spec.cflags == DP_C_LONG)
+                    clen = ofc_snprintf(out + *len, size - *len, conv, value.ul);
+                else
+                    clen = ofc_snprintf(out + *len, size - *len, conv, value.u);
+                break;
+            case 'c':
+                clen = ofc_snprintf(out + *len, size - *len, conv, value.i);
+                break;
+            case 'p':
+                clen = ofc_snprintf(out + *len, size - *len, conv, value.p);
+                break;
+            case 's':
+            case 'S':
+            case 'A':
+                /* The copy is always narrow */
+                conv[ofc_strlen(conv) - 1] = 's';
+                clen = ofc_snprintf(out + *len, size - *len, conv,
+                                    value.i < 0 ? OFC_NULL :
+                                    rec->text + value.i);
+                break;
+            default:
+                clen = ofc_snprintf(out + *len, size - *len, conv);
+                break;
+        }
+        *len += OFC_MIN(clen, size - 1 - *len);
+    }
+    trace_append(out, size, len, fmt, ofc_strlen(fmt));
+}
+
+/*
+ * Copy a record out of a ring that may be written while we read it
+ */
+static OFC_BOOL
+trace_read(struct trace_ring *ring, OFC_UINT32 pos, struct trace_record *out) {
+    struct trace_record *rec;
+
+    rec = &ring->records[pos & (OFC_TRACE_RECORDS - 1)];
+    if (OFC_ATOMIC_LOAD(&rec->seq) != pos + 1)
+        return (OFC_FALSE);
+    ofc_memcpy(out, rec, sizeof(struct trace_record));
+    OFC_ATOMIC_FENCE_ACQUIRE();
+    return (rec->seq == pos + 1 ? OFC_TRUE : OFC_FALSE);
+}
+
+#define OFC_TRACE_LINE 256
+
+OFC_CORE_LIB OFC_VOID
+ofc_dump_trace(OFC_VOID) {
+    OFC_UINT32 next[OFC_TRACE_THREADS];
+    OFC_UINT32 end[OFC_TRACE_THREADS];
+    struct trace_ring *ring;
+    struct trace_record *rec;
+    struct trace_record copy;
+    OFC_CHAR obuf[OFC_TRACE_LINE];
+    OFC_NSTIME stamp;
+    OFC_SIZET len;
+    OFC_INT best;
+    OFC_INT i;
+
+    if (!ofc_trace_enabled)
+        return;
+
+    for (i = 0; i < OFC_TRACE_THREADS; i++) {
+        ring = &ofc_trace_rings[i];
+        end[i] = next[i] = 0;
+        if (ring->records != OFC_NULL) {
+            end[i] = OFC_ATOMIC_LOAD(&ring->head);
+            if (end[i] > OFC_TRACE_RECORDS)
+                next[i] = end[i] - OFC_TRACE_RECORDS;
+        }
+    }
+
+    /*
+     * Merge the rings by timestamp
+     */
+    for (;;) {
+        best = -1;
+        stamp = 0;
+        for (i = 0; i < OFC_TRACE_THREADS; i++) {
+            if (next[i] != end[i]) {
+                rec = &ofc_trace_rings[i].records[next[i] &
+                                                  (OFC_TRACE_RECORDS - 1)];
+                if (best < 0 || rec->stamp < stamp) {
+                    best = i;
+                    stamp = rec->stamp;
+                }
+            }
+        }
+        if (best < 0)
+            break;
+
+        if (trace_read(&ofc_trace_rings[best], next[best], &copy)) {
+            len = ofc_snprintf(obuf, sizeof(obuf), "%3d %5lu.%06lu: ", best,
+                               (OFC_ULONG) (copy.stamp / 1000000000),
+                               (OFC_ULONG) ((copy.stamp / 1000) % 1000000));
+            trace_format(obuf, sizeof(obuf) - 1, &len, &copy);
+            if (len == 0 || obuf[len - 1] != '\n') {
+                obuf[len++] = '\n';
+                obuf[len] = '\0';
+            }
+            ofc_write_console(obuf);
+        }
+        next[best]++;
+    }
+
+    if (ofc_trace_dropped > 0) {
+        ofc_snprintf(obuf, sizeof(obuf),
+                     "%u trace records dropped from untraced threads\n",
+                     ofc_trace_dropped);
+        ofc_write_console(obuf);
     }
 }
 #endif
@@ -0,0 +1,600 @@
+/* Copyright (c) 2021 Connected Way, LLC. All rights reserved.
+ * Use of this source code is governed by a Creative Commons
+ * Attribution-NoDerivatives 4.0 International license that can be
+ * found in the LICENSE file.
+ */
+#define __OFC_CORE_DLL__
+
+#include "ofc/core.h"
+#include "ofc/config.h"
+#include "ofc/types.h"
+#include "ofc/libc.h"
+#include "ofc/libc_simd.h"
+
+#if !defined(OFC_LIBC_NO_SIMD) && (defined(__GNUC__) || defined(__clang__))
+#if defined(__x86_64__) || defined(__i386__)
+#define LIBC_SIMD_X86
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define LIBC_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(LIBC_SIMD_X86) || defined(LIBC_SIMD_NEON)
+/*
+ * The length scans read whole aligned vectors, which may extend past the
+ * end of the string but never into another page.  The compare and case
+ * kernels use unaligned loads and fall back to a character at a time
+ * near a page boundary.  Either way nothing is read from a page the
+ * string doesn't touch, but the sanitizer can't know that.
+ */
+#define LIBC_PAGE_SIZE 4096
+#define LIBC_OVERREAD __attribute__((no_sanitize_address))
+#define LIBC_CTZ(x) __builtin_ctz(x)
+#define LIBC_CTZLL(x) __builtin_ctzll(x)
+
+static __inline OFC_BOOL
+libc_page_cross(const OFC_VOID *p, OFC_SIZET len) {
+    return (((OFC_DWORD_PTR) p & (LIBC_PAGE_SIZE - 1)) >
+            LIBC_PAGE_SIZE - len);
+}
+
+/*
+ * Wide characters are 2 bytes on some platforms and 4 on others.  The
+ * test is on a constant so only one arm survives.
+ */
+#define LIBC_TCHAR_WORD (sizeof(OFC_TCHAR) == sizeof(OFC_UINT16))
+
+/*
+ * Sign or zero extend when widening, the same as the scalar cast
+ */
+#define LIBC_CHAR_SIGNED ((OFC_CHAR) -1 < 0)
+#endif
+
+#if defined(LIBC_SIMD_X86)
+#define LIBC_SSE2 __attribute__((target("sse2")))
+#define LIBC_AVX2 __attribute__((target("avx2")))
+
+static LIBC_SSE2 OFC_INT
+libc_memcmp_sse2(OFC_LPCVOID a, OFC_LPCVOID b, OFC_SIZET size) {
+    const OFC_UINT8 *pa = (const OFC_UINT8 *) a;
+    const OFC_UINT8 *pb = (const OFC_UINT8 *) b;
+    OFC_UINT32 mask;
+    OFC_INT i;
+
+    while (size >= 16) {
+        mask = _mm_movemask_epi8
+                (_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) pa),
+                                _mm_loadu_si128((const __m128i *) pb)));
+        mask ^= 0xFFFF;
+        if (mask != 0) {
+            i = LIBC_CTZ(mask);
+            return (pa[i] - pb[i]);
+        }
+        pa += 16;
+        pb += 16;
+        size -= 16;
+    }
+    for (; size > 0; size--, pa++, pb++)
+        if (*pa != *pb)
+            return (*pa - *pb);
+    return (0);
+}
+
+static LIBC_SSE2 OFC_VOID
+libc_memcpy_sse2(OFC_LPVOID out, OFC_LPCVOID in, OFC_SIZET size) {
+    OFC_UINT8 *dst = (OFC_UINT8 *) out;
+    const OFC_UINT8 *src = (const OFC_UINT8 *) in;
+
+    while (size >= 32) {
+        __m128i v0 = _mm_loadu_si128((const __m128i *) src);
+        __m128i v1 = _mm_loadu_si128((const __m128i *) (src + 16));
+        _mm_storeu_si128((__m128i *) dst, v0);
+        _mm_storeu_si128((__m128i *) (dst + 16), v1);
+        src += 32;
+        dst += 32;
+        size -= 32;
+    }
+    if (size >= 16) {
+        _mm_storeu_si128((__m128i *) dst,
+                         _mm_loadu_si128((const __m128i *) src));
+        src += 16;
+        dst += 16;
+        size -= 16;
+    }
+    while (size--)
+        *dst++ = *src++;
+}
+
+static LIBC_SSE2 LIBC_OVERREAD OFC_SIZET
+libc_strnlen_sse2(OFC_CCHAR *str, OFC_SIZET len) {
+    const OFC_UINT8 *p = (const OFC_UINT8 *) str;
+    const OFC_UINT8 *base;
+    __m128i zero = _mm_setzero_si128();
+    OFC_UINT32 mask;
+    OFC_SIZET off;
+
+    if (len == 0)
+        return (0);
+
+    base = (const OFC_UINT8 *) ((OFC_DWORD_PTR) p & ~(OFC_DWORD_PTR) 15);
+    mask = _mm_movemask_epi8
+            (_mm_cmpeq_epi8(_mm_load_si128((const __m128i *) base), zero));
+    mask >>= (p - base);
+    if (mask != 0)
+        return (OFC_MIN((OFC_SIZET) LIBC_CTZ(mask), len));
+
+    for (off = 16 - (p - base), base += 16; off < len; off += 16, base += 16) {
+        mask = _mm_movemask_epi8
+                (_mm_cmpeq_epi8(_mm_load_si128((const __m128i *) base), zero));
+        if (mask != 0)
+            return (OFC_MIN(off + LIBC_CTZ(mask), len));
+    }
+    return (len);
+}
+
+static LIBC_SSE2 __inline __m128i
+libc_tcmpeq_sse2(__m128i a, __m128i b) {
+    return (LIBC_TCHAR_WORD ? _mm_cmpeq_epi16(a, b) : _mm_cmpeq_epi32(a, b));
+}
+
+static LIBC_SSE2 LIBC_OVERREAD OFC_SIZET
+libc_tstrlen_sse2(OFC_LPCTSTR str) {
+    const OFC_UINT8 *p = (const OFC_UINT8 *) str;
+    const OFC_UINT8 *base;
+    __m128i zero = _mm_setzero_si128();
+    OFC_UINT32 mask;
+
+    base = (const OFC_UINT8 *) ((OFC_DWORD_PTR) p & ~(OFC_DWORD_PTR) 15);
+    mask = _mm_movemask_epi8
+            (libc_tcmpeq_sse2(_mm_load_si128((const __m128i *) base), zero));
+    mask >>= (p - base);
+    if (mask != 0)
+        return (LIBC_CTZ(mask) / sizeof(OFC_TCHAR));
+
+    for (base += 16;; base += 16) {
+        mask = _mm_movemask_epi8
+                (libc_tcmpeq_sse2(_mm_load_si128((const __m128i *) base),
+                                  zero));
+        if (mask != 0)
+            return ((base - p + LIBC_CTZ(mask)) / sizeof(OFC_TCHAR));
+    }
+}
+
+/*
+ * Upper case the characters a..z in a vector of wide characters
+ */
+static LIBC_SSE2 __inline __m128i
+libc_tupper_sse2(__m128i v) {
+    __m128i lower;
+
+    if (LIBC_TCHAR_WORD) {
+        lower = _mm_and_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16('a' - 1)),
+                              _mm_cmpgt_epi16(_mm_set1_epi16('z' + 1), v));
+        return (_mm_sub_epi16(v, _mm_and_si128(lower,
+                                               _mm_set1_epi16('a' - 'A'))));
+    }
+    lower = _mm_and_si128(_mm_cmpgt_epi32(v, _mm_set1_epi32('a' - 1)),
+                          _mm_cmpgt_epi32(_mm_set1_epi32('z' + 1), v));
+    return (_mm_sub_epi32(v, _mm_and_si128(lower,
+                                           _mm_set1_epi32('a' - 'A'))));
+}
+
+static LIBC_SSE2 LIBC_OVERREAD OFC_INT
+libc_tstrcasecmp_sse2(OFC_LPCTSTR astr, OFC_LPCTSTR bstr) {
+    OFC_CTCHAR *pa = astr;
+    OFC_CTCHAR *pb = bstr;
+    __m128i zero = _mm_setzero_si128();
+    __m128i va;
+    __m128i vb;
+    OFC_UINT32 mask;
+    OFC_TCHAR ca;
+    OFC_TCHAR cb;
+
+    for (;;) {
+        if (!libc_page_cross(pa, 16) && !libc_page_cross(pb, 16)) {
+            va = _mm_loadu_si128((const __m128i *) pa);
+            vb = _mm_loadu_si128((const __m128i *) pb);
+            /*
+             * Stop at the first character that differs or ends a
+             */
+            mask = _mm_movemask_epi8
+                    (libc_tcmpeq_sse2(libc_tupper_sse2(va),
+                                      libc_tupper_sse2(vb))) ^ 0xFFFF;
+            mask |= _mm_movemask_epi8(libc_tcmpeq_sse2(va, zero));
+            if (mask == 0) {
+                pa += 16 / sizeof(OFC_TCHAR);
+                pb += 16 / sizeof(OFC_TCHAR);
+                continue;
+            }
+            pa += LIBC_CTZ(mask) / sizeof(OFC_TCHAR);
+            pb += LIBC_CTZ(mask) / sizeof(OFC_TCHAR);
+        }
+        ca = OFC_TTOUPPER(*pa);
+        cb = OFC_TTOUPPER(*pb);
+        if (ca != cb || *pa == TCHAR_EOS)
+            return (ca - cb);
+        pa++;
+        pb++;
+    }
+}
+
+static LIBC_SSE2 LIBC_OVERREAD OFC_VOID
+libc_tstrnupr_sse2(OFC_TCHAR *str, OFC_SIZET len) {
+    const OFC_SIZET lanes = 16 / sizeof(OFC_TCHAR);
+    __m128i zero = _mm_setzero_si128();
+    __m128i v;
+
+    while (len > 0 && *str != TCHAR_EOS) {
+        if (len >= lanes && !libc_page_cross(str, 16)) {
+            v = _mm_loadu_si128((const __m128i *) str);
+            if (_mm_movemask_epi8(libc_tcmpeq_sse2(v, zero)) == 0) {
+                _mm_storeu_si128((__m128i *) str, libc_tupper_sse2(v));
+                str += lanes;
+                len -= lanes;
+                continue;
+            }
+        }
+        *str = OFC_TTOUPPER(*str);
+        str++;
+        len--;
+    }
+}
+
+static LIBC_SSE2 OFC_VOID
+libc_tstr2cstr_sse2(OFC_CHAR *dst, OFC_LPCTSTR src, OFC_SIZET len) {
+    const __m128i *in;
+    __m128i lo;
+    __m128i hi;
+    __m128i low_byte;
+
+    /*
+     * Keep only the low byte of each character, like the scalar cast,
+     * so the saturating packs never saturate.
+     */
+    while (len >= 16) {
+        in = (const __m128i *) src;
+        if (LIBC_TCHAR_WORD) {
+            low_byte = _mm_set1_epi16(0xFF);
+            lo = _mm_and_si128(_mm_loadu_si128(in), low_byte);
+            hi = _mm_and_si128(_mm_loadu_si128(in + 1), low_byte);
+        } else {
+            low_byte = _mm_set1_epi32(0xFF);
+            lo = _mm_packs_epi32
+                    (_mm_and_si128(_mm_loadu_si128(in), low_byte),
+                     _mm_and_si128(_mm_loadu_si128(in + 1), low_byte));
+            hi = _mm_packs_epi32
+                    (_mm_and_si128(_mm_loadu_si128(in + 2), low_byte),
+                     _mm_and_si128(_mm_loadu_si128(in + 3), low_byte));
+        }
+        _mm_storeu_si128((__m128i *) dst, _mm_packus_epi16(lo, hi));
+        src += 16;
+        dst += 16;
+        len -= 16;
+    }
+    while (len--)
+        *dst++ = (OFC_CHAR) *src++;
+}
+
+static LIBC_SSE2 OFC_VOID
+libc_cstr2tstr_sse2(OFC_TCHAR *dst, OFC_CCHAR *src, OFC_SIZET len) {
+    __m128i *out;
+    __m128i v;
+    __m128i ext;
+    __m128i lo;
+    __m128i hi;
+
+    while (len >= 16) {
+        out = (__m128i *) dst;
+        v = _mm_loadu_si128((const __m128i *) src);
+        ext = LIBC_CHAR_SIGNED ?
+              _mm_cmpgt_epi8(_mm_setzero_si128(), v) : _mm_setzero_si128();
+        lo = _mm_unpacklo_epi8(v, ext);
+        hi = _mm_unpackhi_epi8(v, ext);
+        if (LIBC_TCHAR_WORD) {
+            _mm_storeu_si128(out, lo);
+            _mm_storeu_si128(out + 1, hi);
+        } else {
+            ext = _mm_srai_epi16(lo, 15);
+            _mm_storeu_si128(out, _mm_unpacklo_epi16(lo, ext));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo, ext));
+            ext = _mm_srai_epi16(hi, 15);
+            _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi, ext));
+            _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi, ext));
+        }
+        src += 16;
+        dst += 16;
+        len -= 16;
+    }
+    while (len--)
+        *dst++ = (OFC_TCHAR) (*src++);
+}
+
+static LIBC_AVX2 OFC_INT
+libc_memcmp_avx2(OFC_LPCVOID a, OFC_LPCVOID b, OFC_SIZET size) {
+    const OFC_UINT8 *pa = (const OFC_UINT8 *) a;
+    const OFC_UINT8 *pb = (const OFC_UINT8 *) b;
+    OFC_UINT32 mask;
+    OFC_INT i;
+
+    while (size >= 32) {
+        mask = (OFC_UINT32) _mm256_movemask_epi8
+                (_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) pa),
+                                   _mm256_loadu_si256((const __m256i *) pb)));
+        mask = ~mask;
+        if (mask != 0) {
+            i = LIBC_CTZ(mask);
+            return (pa[i] - pb[i]);
+        }
+        pa += 32;
+        pb += 32;
+        size -= 32;
+    }
+    return (libc_memcmp_sse2(pa, pb, size));
+}
+
+static LIBC_AVX2 OFC_VOID
+libc_memcpy_avx2(OFC_LPVOID out, OFC_LPCVOID in, OFC_SIZET size) {
+    OFC_UINT8 *dst = (OFC_UINT8 *) out;
+    const OFC_UINT8 *src = (const OFC_UINT8 *) in;
+
+    while (size >= 64) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i *) src);
+        __m256i v1 = _mm256_loadu_si256((const __m256i *) (src + 32));
+        _mm256_storeu_si256((__m256i *) dst, v0);
+        _mm256_storeu_si256((__m256i *) (dst + 32), v1);
+        src += 64;
+        dst += 64;
+        size -= 64;
+    }
+    libc_memcpy_sse2(dst, src, size);
+}
+
+static LIBC_AVX2 LIBC_OVERREAD OFC_SIZET
+libc_strnlen_avx2(OFC_CCHAR *str, OFC_SIZET len) {
+    const OFC_UINT8 *p = (const OFC_UINT8 *) str;
+    const OFC_UINT8 *base;
+    __m256i zero = _mm256_setzero_si256();
+    OFC_UINT32 mask;
+    OFC_SIZET off;
+
+    if (len == 0)
+        return (0);
+
+    base = (const OFC_UINT8 *) ((OFC_DWORD_PTR) p & ~(OFC_DWORD_PTR) 31);
+    mask = (OFC_UINT32) _mm256_movemask_epi8
+            (_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *) base),
+                               zero));
+    mask >>= (p - base);
+    if (mask != 0)
+        return (OFC_MIN((OFC_SIZET) LIBC_CTZ(mask), len));
+
+    for (off = 32 - (p - base), base += 32; off < len; off += 32, base += 32) {
+        mask = (OFC_UINT32) _mm256_movemask_epi8
+                (_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *) base),
+                                   zero));
+        if (mask != 0)
+            return (OFC_MIN(off + LIBC_CTZ(mask), len));
+    }
+    return (len);
+}
+
+static LIBC_AVX2 LIBC_OVERREAD OFC_SIZET
+libc_tstrlen_avx2(OFC_LPCTSTR str) {
+    const OFC_UINT8 *p = (const OFC_UINT8 *) str;
+    const OFC_UINT8 *base;
+    __m256i zero = _mm256_setzero_si256();
+    __m256i v;
+    OFC_UINT32 mask;
+
+    base = (const OFC_UINT8 *) ((OFC_DWORD_PTR) p & ~(OFC_DWORD_PTR) 31);
+    for (;; base += 32) {
+        v = _mm256_load_si256((const __m256i *) base);
+        v = LIBC_TCHAR_WORD ?
+            _mm256_cmpeq_epi16(v, zero) : _mm256_cmpeq_epi32(v, zero);
+        mask = (OFC_UINT32) _mm256_movemask_epi8(v);
+        if (base < p)
+            mask &= ~0U << (p - base);
+        if (mask != 0)
+            return ((base + LIBC_CTZ(mask) - p) / sizeof(OFC_TCHAR));
+    }
+}
+
+static OFC_LIBC_OPS libc_sse2_ops =
+        {
+                "sse2",
+                libc_memcmp_sse2,
+                libc_memcpy_sse2,
+                libc_strnlen_sse2,
+                libc_tstrlen_sse2,
+                libc_tstrcasecmp_sse2,
+                libc_tstrnupr_sse2,
+                libc_tstr2cstr_sse2,
+                libc_cstr2tstr_sse2
+        };
+
+/*
+ * Only the long scans gain from the wider vectors.  The rest come from
+ * the SSE2 table.
+ */
+static OFC_LIBC_OPS libc_avx2_ops =
+        {
+                "avx2",
+                libc_memcmp_avx2,
+                libc_memcpy_avx2,
+                libc_strnlen_avx2,
+                libc_tstrlen_avx2,
+                libc_tstrcasecmp_sse2,
+                libc_tstrnupr_sse2,
+                libc_tstr2cstr_sse2,
+                libc_cstr2tstr_sse2
+        };
+#endif
+
+#if defined(LIBC_SIMD_NEON)
+/*
+ * NEON has no movemask.  Narrowing each 16 bit lane by 4 leaves a 64 bit
+ * value with 4 bits per byte lane.
+ */
+static __inline OFC_UINT64
+libc_mask_neon(uint8x16_t v) {
+    return (vget_lane_u64(vreinterpret_u64_u8
+                                  (vshrn_n_u16(vreinterpretq_u16_u8(v), 4)),
+                          0));
+}
+
+static OFC_INT
+libc_memcmp_neon(OFC_LPCVOID a, OFC_LPCVOID b, OFC_SIZET size) {
+    const OFC_UINT8 *pa = (const OFC_UINT8 *) a;
+    const OFC_UINT8 *pb = (const OFC_UINT8 *) b;
+    OFC_UINT64 mask;
+    OFC_INT i;
+
+    while (size >= 16) {
+        mask = ~libc_mask_neon(vceqq_u8(vld1q_u8(pa), vld1q_u8(pb)));
+        if (mask != 0) {
+            i = LIBC_CTZLL(mask) >> 2;
+            return (pa[i] - pb[i]);
+        }
+        pa += 16;
+        pb += 16;
+        size -= 16;
+    }
+    for (; size > 0; size--, pa++, pb++)
+        if (*pa != *pb)
+            return (*pa - *pb);
+    return (0);
+}
+
+static OFC_VOID
+libc_memcpy_neon(OFC_LPVOID out, OFC_LPCVOID in, OFC_SIZET size) {
+    OFC_UINT8 *dst = (OFC_UINT8 *) out;
+    const OFC_UINT8 *src = (const OFC_UINT8 *) in;
+
+    while (size >= 32) {
+        uint8x16_t v0 = vld1q_u8(src);
+        uint8x16_t v1 = vld1q_u8(src + 16);
+        vst1q_u8(dst, v0);
+        vst1q_u8(dst + 16, v1);
+        src += 32;
+        dst += 32;
+        size -= 32;
+    }
+    if (size >= 16) {
+        vst1q_u8(dst, vld1q_u8(src));
+        src += 16;
+        dst += 16;
+        size -= 16;
+    }
+    while (size--)
+        *dst++ = *src++;
+}
+
+static LIBC_OVERREAD OFC_SIZET
+libc_strnlen_neon(OFC_CCHAR *str, OFC_SIZET len) {
+    const OFC_UINT8 *p = (const OFC_UINT8 *) str;
+    const OFC_UINT8 *base;
+    OFC_UINT64 mask;
+    OFC_SIZET off;
+
+    if (len == 0)
+        return (0);
+
+    base = (const OFC_UINT8 *) ((OFC_DWORD_PTR) p & ~(OFC_DWORD_PTR) 15);
+    mask = libc_mask_neon(vceqq_u8(vld1q_u8(base), vdupq_n_u8(0)));
+    mask >>= (p - base) * 4;
+    if (mask != 0)
+        return (OFC_MIN((OFC_SIZET) (LIBC_CTZLL(mask) >> 2), len));
+
+    for (off = 16 - (p - base), base += 16; off < len; off += 16, base += 16) {
+        mask = libc_mask_neon(vceqq_u8(vld1q_u8(base), vdupq_n_u8(0)));
+        if (mask != 0)
+            return (OFC_MIN(off + (LIBC_CTZLL(mask) >> 2), len));
+    }
+    return (len);
+}
+
+static LIBC_OVERREAD OFC_SIZET
+libc_tstrlen_neon(OFC_LPCTSTR str) {
+    const OFC_UINT8 *p = (const OFC_UINT8 *) str;
+    const OFC_UINT8 *base;
+    uint8x16_t eq;
+    OFC_UINT64 mask;
+
+    base = (const OFC_UINT8 *) ((OFC_DWORD_PTR) p & ~(OFC_DWORD_PTR) 15);
+    for (;; base += 16) {
+        if (LIBC_TCHAR_WORD)
+            eq = vreinterpretq_u8_u16
+                    (vceqq_u16(vld1q_u16((const OFC_UINT16 *) base),
+                               vdupq_n_u16(0)));
+        else
+            eq = vreinterpretq_u8_u32
+                    (vceqq_u32(vld1q_u32((const OFC_UINT32 *) base),
+                               vdupq_n_u32(0)));
+        mask = libc_mask_neon(eq);
+        if (base < p)
+            mask &= ~0ULL << ((p - base) * 4);
+        if (mask != 0)
+            return ((base + (LIBC_CTZLL(mask) >> 2) - p) / sizeof(OFC_TCHAR));
+    }
+}
+
+/*
+ * The remaining kernels are simple enough that the compiler vectorizes
+ * the scalar loops for NEON on its own.
+ */
+static OFC_LIBC_OPS libc_neon_ops;
+#endif
+
+static OFC_BOOL libc_simd_probed = OFC_FALSE;
+static const OFC_LIBC_OPS *libc_ops[OFC_LIBC_IMPL_MAX];
+
+static OFC_VOID
+libc_simd_probe(OFC_VOID) {
+    if (libc_simd_probed)
+        return;
+
+    libc_ops[OFC_LIBC_SCALAR] = &ofc_libc_scalar_ops;
+#if defined(LIBC_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        libc_ops[OFC_LIBC_SSE2] = &libc_sse2_ops;
+        if (__builtin_cpu_supports("avx2"))
+            libc_ops[OFC_LIBC_AVX2] = &libc_avx2_ops;
+    }
+#endif
+#if defined(LIBC_SIMD_NEON)
+    libc_neon_ops = ofc_libc_scalar_ops;
+    libc_neon_ops.name = "neon";
+    libc_neon_ops.mem_compare = libc_memcmp_neon;
+    libc_neon_ops.mem_copy = libc_memcpy_neon;
+    libc_neon_ops.str_nlen = libc_strnlen_neon;
+    libc_neon_ops.tstr_len = libc_tstrlen_neon;
+    libc_ops[OFC_LIBC_NEON] = &libc_neon_ops;
+#endif
+    libc_simd_probed = OFC_TRUE;
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_libc_simd_init(OFC_VOID) {
+    OFC_INT impl;
+
+    libc_simd_probe();
+    /*
+     * The implementations are listed from least to most capable
+     */
+    for (impl = OFC_LIBC_IMPL_MAX - 1; libc_ops[impl] == OFC_NULL; impl--);
+    ofc_libc_active = libc_ops[impl];
+}
+
+OFC_CORE_LIB const OFC_LIBC_OPS *
+ofc_libc_get_ops(OFC_LIBC_IMPL impl) {
+    const OFC_LIBC_OPS *ops;
+
+    libc_simd_probe();
+    ops = OFC_NULL;
+    if (impl >= OFC_LIBC_SCALAR && impl < OFC_LIBC_IMPL_MAX)
+        ops = libc_ops[impl];
+    return (ops);
+}
@@ -0,0 +1,350 @@
+/* Copyright (c) 2021 Connected Way, LLC. All rights reserved.
+ * Use of this source code is governed by a Creative Commons
+ * Attribution-NoDerivatives 4.0 International license that can be
+ * found in the LICENSE file.
+ */
+#define __OFC_CORE_DLL__
+
+#include <stdarg.h>
+
+#include "ofc/core.h"
+#include "ofc/config.h"
+#include "ofc/types.h"
+#include "ofc/libc.h"
+#include "ofc/console.h"
+#include "ofc/atomic.h"
+#include "ofc/time.h"
+#include "ofc/event.h"
+#include "ofc/thread.h"
+#include "ofc/persist.h"
+#include "ofc/log.h"
+
+/*
+ * The queue is a ring of cells, each with a sequence number.  A cell
+ * whose sequence equals a producer's position is free for that
+ * position.  The producer claims it by advancing the tail, formats into
+ * it, and publishes it by setting the sequence to position + 1.  The
+ * writer consumes it and sets the sequence to position + OFC_LOG_QUEUE,
+ * which frees it for the producer one lap later.
+ *
+ * pending counts messages published but not yet consumed.  A producer
+ * that takes it from zero wakes the writer, so a busy writer is not
+ * signalled for every message.
+ *
+ * A producer holds a reference on the gate while it enqueues.  Stopping
+ * the writer closes the gate in the same word, so each producer either
+ * sees it closed and writes synchronously, or is counted and waited for
+ * before the final drain.
+ */
+struct log_cell {
+    volatile OFC_UINT32 seq;
+    OFC_LOG_LEVEL level;
+    OFC_BOOL console;
+    OFC_SIZET len;
+    OFC_CHAR text[OFC_LOG_LINE];
+};
+
+/*
+ * Rate limiting state for a call site
+ */
+struct log_site {
+    OFC_CCHAR *fmt;
+    OFC_MSTIME window;        /* Second the count applies to */
+    OFC_UINT count;
+    OFC_UINT suppressed;
+};
+
+OFC_CORE_LIB volatile OFC_UINT ofc_log_threshold = OFC_LOG_DEFAULT;
+
+static struct log_cell ofc_log_cells[OFC_LOG_QUEUE];
+static volatile OFC_UINT32 ofc_log_tail;
+static volatile OFC_UINT32 ofc_log_head;
+static volatile OFC_INT ofc_log_pending;
+static volatile OFC_BOOL ofc_log_running = OFC_FALSE;
+#define LOG_GATE_CLOSED 0x40000000
+static volatile OFC_INT ofc_log_gate = LOG_GATE_CLOSED;
+static OFC_HANDLE ofc_log_event = OFC_HANDLE_NULL;
+static OFC_HANDLE ofc_log_thread = OFC_HANDLE_NULL;
+
+static struct log_site ofc_log_sites[OFC_LOG_SITES];
+static OFC_SPINLOCK ofc_log_site_lock;
+
+static OFC_LOG_STATS ofc_log_stats;
+
+static OFC_VOID
+ofc_log_write(OFC_LOG_LEVEL level, OFC_BOOL console,
+              OFC_CCHAR *obuf, OFC_SIZET len) {
+    ofc_write_log(level, obuf, len);
+    if (console)
+        ofc_write_stdout(obuf, len);
+}
+
+/*
+ * Write every published message.  Only the writer thread, or the
+ * thread stopping it, consumes.
+ */
+static OFC_INT
+ofc_log_drain(OFC_VOID) {
+    struct log_cell *cell;
+    OFC_UINT32 head;
+    OFC_INT count;
+
+    count = 0;
+    head = ofc_log_head;
+    for (;;) {
+        cell = &ofc_log_cells[head & (OFC_LOG_QUEUE - 1)];
+        if (OFC_ATOMIC_LOAD(&cell->seq) != head + 1)
+            break;
+        ofc_log_write(cell->level, cell->console, cell->text, cell->len);
+        OFC_ATOMIC_STORE(&cell->seq, head + OFC_LOG_QUEUE);
+        head++;
+        OFC_ATOMIC_STORE(&ofc_log_head, head);
+        count++;
+    }
+    if (count > 0)
+        OFC_ATOMIC_ADD_RELAXED(&ofc_log_stats.written, count);
+    return (count);
+}
+
+static OFC_DWORD
+ofc_log_writer(OFC_HANDLE hThread, OFC_VOID *context) {
+    OFC_INT count;
+
+    while (!ofc_thread_is_deleting(hThread)) {
+        count = ofc_log_drain();
+        if (count > 0)
+            OFC_ATOMIC_SUB(&ofc_log_pending, count);
+        else if (OFC_ATOMIC_LOAD(&ofc_log_pending) == 0)
+            ofc_event_wait(ofc_log_event);
+        else
+            /* A producer has published but not yet counted */
+            OFC_ATOMIC_PAUSE();
+    }
+    return (0);
+}
+
+static OFC_VOID
+ofc_log_enqueue(OFC_LOG_LEVEL level, OFC_BOOL console,
+                OFC_CCHAR *fmt, va_list ap) {
+    struct log_cell *cell;
+    OFC_UINT32 pos;
+    OFC_INT32 diff;
+    OFC_SIZET len;
+
+    pos = OFC_ATOMIC_LOAD(&ofc_log_tail);
+    for (;;) {
+        cell = &ofc_log_cells[pos & (OFC_LOG_QUEUE - 1)];
+        diff = (OFC_INT32) (OFC_ATOMIC_LOAD(&cell->seq) - pos);
+        if (diff == 0) {
+            if (OFC_ATOMIC_CAS(&ofc_log_tail, &pos, pos + 1))
+                break;
+        } else if (diff < 0) {
+            /* Full */
+            OFC_ATOMIC_ADD_RELAXED(&ofc_log_stats.dropped, 1);
+            return;
+        } else
+            pos = OFC_ATOMIC_LOAD(&ofc_log_tail);
+    }
+
+    cell->level = level;
+    cell->console = console;
+    len = ofc_vsnprintf(cell->text, OFC_LOG_LINE, fmt, ap);
+    cell->len = OFC_MIN(len, OFC_LOG_LINE - 1);
+    OFC_ATOMIC_STORE(&cell->seq, pos + 1);
+
+    OFC_ATOMIC_ADD_RELAXED(&ofc_log_stats.queued, 1);
+    if (OFC_ATOMIC_ADD(&ofc_log_pending, 1) == 1)
+        ofc_event_set(ofc_log_event);
+}
+
+static OFC_VOID
+ofc_log_submit(OFC_LOG_LEVEL level, OFC_BOOL console,
+               OFC_CCHAR *fmt, va_list ap) {
+    OFC_CHAR obuf[OFC_LOG_LINE];
+    OFC_SIZET len;
+    OFC_BOOL queued;
+
+    queued = OFC_FALSE;
+#if !defined(OFC_LOG_SYNC)
+    if (level != OFC_LOG_FATAL) {
+        if ((OFC_ATOMIC_ADD(&ofc_log_gate, 1) & LOG_GATE_CLOSED) == 0) {
+            ofc_log_enqueue(level, console, fmt, ap);
+            queued = OFC_TRUE;
+        }
+        OFC_ATOMIC_SUB(&ofc_log_gate, 1);
+    }
+#endif
+    if (!queued) {
+        len = ofc_vsnprintf(obuf, OFC_LOG_LINE, fmt, ap);
+        ofc_log_write(level, console, obuf, OFC_MIN(len, OFC_LOG_LINE - 1));
+        OFC_ATOMIC_ADD_RELAXED(&ofc_log_stats.written, 1);
+    }
+}
+
+static OFC_VOID
+ofc_log_submitf(OFC_LOG_LEVEL level, OFC_BOOL console,
+                OFC_CCHAR *fmt, ...) {
+    va_list ap;
+
+    va_start(ap, fmt);
+    ofc_log_submit(level, console, fmt, ap);
+    va_end(ap);
+}
+
+/*
+ * Decide whether a call site may log now.  Returns the number of the
+ * site's messages suppressed in its last window when that window has
+ * just ended, so the caller can report it.
+ */
+static OFC_BOOL
+ofc_log_admit(OFC_CCHAR *fmt, OFC_UINT *suppressed) {
+    struct log_site *site;
+    OFC_MSTIME window;
+    OFC_BOOL admit;
+
+    window = ofc_time_get_now() / 1000;
+    site = &ofc_log_sites[((OFC_ULONG_PTR) fmt >> 3) & (OFC_LOG_SITES - 1)];
+
+    *suppressed = 0;
+    OFC_SPINLOCK_LOCK(&ofc_log_site_lock);
+    if (site->fmt != fmt) {
+        /* A new site, or one that shares the slot */
+        site->fmt = fmt;
+        site->window = window;
+        site->count = 0;
+        site->suppressed = 0;
+    } else if (site->window != window) {
+        *suppressed = site->suppressed;
+        site->window = window;
+        site->count = 0;
+        site->suppressed = 0;
+    }
+
+    admit = site->count < OFC_LOG_RATE;
+    if (admit)
+        site->count++;
+    else
+        site->suppressed++;
+    OFC_SPINLOCK_UNLOCK(&ofc_log_site_lock);
+
+    if (!admit)
+        OFC_ATOMIC_ADD_RELAXED(&ofc_log_stats.suppressed, 1);
+    return (admit);
+}
+
+/*
+ * The ofc_log macro checks the level first
+ */
+OFC_CORE_LIB OFC_VOID
+(ofc_log)(OFC_LOG_LEVEL level, OFC_CCHAR *fmt, ...) {
+    OFC_UINT suppressed;
+    OFC_BOOL console;
+    va_list ap;
+
+    if (!OFC_LOG_ENABLED(level))
+        return;
+
+    suppressed = 0;
+    if (level != OFC_LOG_FATAL && !ofc_log_admit(fmt, &suppressed))
+        return;
+
+    console = ofc_persist_log_console();
+    if (suppressed > 0)
+        ofc_log_submitf(level, console,
+                        "(%u messages like the next were suppressed)\n",
+                        suppressed);
+
+    va_start(ap, fmt);
+    ofc_log_submit(level, console, fmt, ap);
+    va_end(ap);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_log_init(OFC_VOID) {
+#if !defined(OFC_LOG_SYNC)
+    OFC_UINT32 i;
+
+    if (!ofc_log_running) {
+        for (i = 0; i < OFC_LOG_QUEUE; i++)
+            ofc_log_cells[i].seq = i;
+        ofc_log_head = 0;
+        ofc_log_tail = 0;
+        ofc_log_pending = 0;
+
+        ofc_log_event = ofc_event_create(OFC_EVENT_AUTO);
+        ofc_log_thread = ofc_thread_create(&ofc_log_writer,
+                                           OFC_THREAD_LOG, 0, OFC_NULL,
+                                           OFC_THREAD_JOIN,
+                                           OFC_HANDLE_NULL);
+        if (ofc_log_thread == OFC_HANDLE_NULL) {
+            ofc_event_destroy(ofc_log_event);
+            ofc_log_event = OFC_HANDLE_NULL;
+        } else {
+            ofc_log_running = OFC_TRUE;
+            OFC_ATOMIC_STORE(&ofc_log_gate, 0);
+        }
+    }
+#endif
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_log_destroy(OFC_VOID) {
+    if (ofc_log_running) {
+        /*
+         * New messages are written synchronously from here on.  Wait for
+         * the producers already through the gate to publish.
+         */
+        OFC_ATOMIC_ADD(&ofc_log_gate, LOG_GATE_CLOSED);
+        while ((OFC_ATOMIC_LOAD(&ofc_log_gate) & ~LOG_GATE_CLOSED) != 0)
+            OFC_ATOMIC_PAUSE();
+        ofc_log_running = OFC_FALSE;
+
+        ofc_thread_delete(ofc_log_thread);
+        ofc_event_set(ofc_log_event);
+        ofc_thread_wait(ofc_log_thread);
+        ofc_log_thread = OFC_HANDLE_NULL;
+
+        /*
+         * Everything queued has been published, so this empties it
+         */
+        ofc_log_drain();
+        ofc_event_destroy(ofc_log_event);
+        ofc_log_event = OFC_HANDLE_NULL;
+    }
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_log_flush(OFC_VOID) {
+    OFC_UINT32 tail;
+
+    tail = OFC_ATOMIC_LOAD(&ofc_log_tail);
+    while (ofc_log_running &&
+           (OFC_INT32) (OFC_ATOMIC_LOAD(&ofc_log_head) - tail) < 0)
+        ofc_sleep(1);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_log_set_threshold(OFC_UINT level) {
+    ofc_log_threshold = level;
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_log_get_stats(OFC_LOG_STATS *stats) {
+    stats->queued = OFC_ATOMIC_LOAD(&ofc_log_stats.queued);
+    stats->written = OFC_ATOMIC_LOAD(&ofc_log_stats.written);
+    stats->dropped = OFC_ATOMIC_LOAD(&ofc_log_stats.dropped);
+    stats->suppressed = OFC_ATOMIC_LOAD(&ofc_log_stats.suppressed);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_log_dump_stats(OFC_VOID) {
+    OFC_LOG_STATS stats;
+    OFC_CHAR obuf[80];
+
+    ofc_log_get_stats(&stats);
+    ofc_snprintf(obuf, sizeof(obuf),
+                 "Log Queued %u, Written %u, Dropped %u, Suppressed %u\n",
+                 stats.queued, stats.written, stats.dropped,
+                 stats.suppressed);
+    ofc_write_console(obuf);
+}
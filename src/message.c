@@ -20,6 +20,9 @@
 #include "ofc/heap.h"
 #include "ofc/persist.h"
 
+static OFC_SLAB ofc_message_slab =
+  OFC_SLAB_INIT("Message", sizeof(OFC_MESSAGE));
+
 #if defined(OFC_MESSAGE_DEBUG)
 static struct _OFC_MESSAGE *OfcMessageAlloc ;
 OFC_LOCK OfcMessageDebugLock ;
@@ -118,7 +121,7 @@ ofc_message_create(MSG_ALLOC_TYPE msgType, OFC_SIZET msgDataLength,
     OFC_MESSAGE *msg;
     OFC_INT i;
 
-    msg = ofc_malloc(sizeof(OFC_MESSAGE));
+    msg = ofc_slab_alloc(&ofc_message_slab);
 
     ofc_assert(msg != OFC_NULL, "message: Couldn't alloc message\n");
 
@@ -139,7 +142,11 @@ ofc_message_create(MSG_ALLOC_TYPE msgType, OFC_SIZET msgDataLength,
       {
         if (msgType == MSG_ALLOC_HEAP)
           {
-            ofc_iovec_insert(msg->map, 0, IOVEC_ALLOC_HEAP,
+            /*
+             * Message data comes from the buffer pool so the buffer
+             * can be recycled and shared with other messages
+             */
+            ofc_iovec_insert(msg->map, 0, IOVEC_ALLOC_POOL,
                              OFC_NULL, msgDataLength);
           }
         else
@@ -188,6 +195,23 @@ ofc_datagram_create(MSG_ALLOC_TYPE msgType, OFC_SIZET msgDataLength,
     return (msg);
 }
 
+OFC_CORE_LIB OFC_MESSAGE *
+ofc_message_create_scatter(OFC_SIZET header_len, OFC_SIZET payload_len,
+                           OFC_VOID *payload) {
+    OFC_MESSAGE *msg;
+
+    msg = ofc_message_create(MSG_ALLOC_HEAP, header_len, OFC_NULL);
+    if (msg != OFC_NULL) {
+        ofc_iovec_insert(msg->map, header_len,
+                         payload == OFC_NULL ?
+                         IOVEC_ALLOC_POOL : IOVEC_ALLOC_STATIC,
+                         payload, payload_len);
+        msg->send_size += payload_len;
+        msg->count = msg->send_size;
+    }
+    return (msg);
+}
+
 OFC_CORE_LIB OFC_VOID
 ofc_message_destroy(OFC_MESSAGE *msg)
 {
@@ -198,7 +222,7 @@ ofc_message_destroy(OFC_MESSAGE *msg)
 #if defined(OFC_MESSAGE_DEBUG)
   ofc_message_debug_free(msg) ;
 #endif
-  ofc_free(msg);
+  ofc_slab_free(&ofc_message_slab, msg);
 }
 
 OFC_CORE_LIB OFC_BOOL
@@ -310,6 +334,13 @@ OFC_VOID ofc_message_put_indirect(OFC_MESSAGE *msg,
                    buffer, size);
 }  
 
+OFC_CORE_LIB OFC_VOID
+ofc_message_attach(OFC_MESSAGE *msg, OFC_INT offset,
+                   OFC_UCHAR *buffer, OFC_SIZET skip, OFC_SIZET size)
+{
+  ofc_iovec_attach(msg->map, offset + msg->base, buffer, skip, size);
+}
+
 OFC_VOID ofc_message_get_map(OFC_MESSAGE *msg,
                              OFC_SIZET total,
                              OFC_IOVEC **iovec,
@@ -364,13 +395,9 @@ ofc_message_put_u16(OFC_MESSAGE *msg, OFC_INT offset, OFC_UINT16 value)
     {
       ret = OFC_TRUE;
       if (msg->endian == MSG_ENDIAN_BIG)
-        {
-          OFC_NET_STON (ptr, 0, value);
-        }
+        ofc_store_be16(ptr, value);
       else
-        {
-          OFC_NET_STOSMB (ptr, 0, value);
-        }
+        ofc_store_le16(ptr, value);
     }
     return (ret);
 }
@@ -390,13 +417,9 @@ ofc_message_put_u32(OFC_MESSAGE *msg, OFC_INT offset, OFC_UINT32 value)
     {
       ret = OFC_TRUE;
       if (msg->endian == MSG_ENDIAN_BIG)
-        {
-          OFC_NET_LTON (ptr, 0, value);
-        }
+        ofc_store_be32(ptr, value);
       else
-        {
-          OFC_NET_LTOSMB (ptr, 0, value);
-        }
+        ofc_store_le32(ptr, value);
     }
     return (ret);
 }
@@ -417,13 +440,9 @@ ofc_message_put_u64(OFC_MESSAGE *msg, OFC_INT offset, OFC_UINT64 *value)
       ret = OFC_TRUE;
 #if defined (OFC_64BIT_INTEGER)
       if (msg->endian == MSG_ENDIAN_BIG)
-        {
-          OFC_NET_LLTON (ptr, 0, *value);
-        }
+        ofc_store_be64(ptr, *value);
       else
-        {
-          OFC_NET_LLTOSMB (ptr, 0, *value);
-        }
+        ofc_store_le64(ptr, *value);
 #else
       if (msg->endian == MSG_ENDIAN_BIG)
         {
@@ -440,27 +459,99 @@ ofc_message_put_u64(OFC_MESSAGE *msg, OFC_INT offset, OFC_UINT64 *value)
     return (ret);
 }
 
+/*
+ * Bulk UTF-16 conversion.  When the characters are in one segment they
+ * are converted in a single pass over the window.  The loops carry no
+ * state between iterations so the compiler vectorizes them.  Strings
+ * that straddle segments fall back to one character at a time.
+ */
+static OFC_VOID
+message_encode_utf16(OFC_UCHAR *window, OFC_CTCHAR *str, OFC_SIZET count,
+                     MSG_ENDIAN endian)
+{
+  OFC_SIZET i;
+
+  if (endian == MSG_ENDIAN_BIG)
+    {
+      for (i = 0; i < count; i++)
+        ofc_store_be16(window + i * sizeof(OFC_WORD), (OFC_UINT16) str[i]);
+    }
+  else
+    {
+      for (i = 0; i < count; i++)
+        ofc_store_le16(window + i * sizeof(OFC_WORD), (OFC_UINT16) str[i]);
+    }
+}
+
+static OFC_VOID
+message_decode_utf16(OFC_TCHAR *str, const OFC_UCHAR *window,
+                     OFC_SIZET count, MSG_ENDIAN endian)
+{
+  OFC_SIZET i;
+
+  if (endian == MSG_ENDIAN_BIG)
+    {
+      for (i = 0; i < count; i++)
+        str[i] = ofc_load_be16(window + i * sizeof(OFC_WORD));
+    }
+  else
+    {
+      for (i = 0; i < count; i++)
+        str[i] = ofc_load_le16(window + i * sizeof(OFC_WORD));
+    }
+}
+
+static OFC_BOOL
+message_put_utf16(OFC_MESSAGE *msg, OFC_INT offset, OFC_CTCHAR *str,
+                  OFC_SIZET count)
+{
+  OFC_BOOL ret;
+  OFC_UCHAR *window;
+  OFC_SIZET i;
+
+  ret = OFC_TRUE;
+  window = ofc_message_window(msg, offset, count * sizeof(OFC_WORD));
+  if (window != OFC_NULL)
+    message_encode_utf16(window, str, count, msg->endian);
+  else
+    {
+      for (i = 0; i < count && ret == OFC_TRUE; i++)
+        ret = ofc_message_put_u16(msg, offset + (i * sizeof(OFC_WORD)),
+                                  str[i]);
+    }
+  return (ret);
+}
+
+static OFC_VOID
+message_get_utf16(OFC_MESSAGE *msg, OFC_INT offset, OFC_TCHAR *str,
+                  OFC_SIZET count)
+{
+  OFC_UCHAR *window;
+  OFC_SIZET i;
+
+  window = ofc_message_window(msg, offset, count * sizeof(OFC_WORD));
+  if (window != OFC_NULL)
+    message_decode_utf16(str, window, count, msg->endian);
+  else
+    {
+      for (i = 0; i < count; i++)
+        str[i] = ofc_message_get_u16(msg, offset + (i * sizeof(OFC_WORD)));
+    }
+}
+
 OFC_CORE_LIB OFC_BOOL
 ofc_message_put_tstr(OFC_MESSAGE *msg, OFC_INT offset, OFC_LPCTSTR str)
 {
   OFC_BOOL ret;
-  OFC_SIZET len;
-  OFC_CTCHAR *p;
-  OFC_INT i;
+  OFC_SIZET count;
 
   ret = OFC_TRUE;
   if (str != OFC_NULL)
     {
-      len = (ofc_tstrlen(str) + 1) * sizeof(OFC_WORD);
-
-      p = str;
-      for (i = 0, p = str; i < len && ret == OFC_TRUE;
-           i += sizeof(OFC_WORD), p++)
-        {
-          ret = ofc_message_put_u16(msg, offset + i, *p) ;
-        }
+      count = ofc_tstrlen(str) + 1;
+      ret = message_put_utf16(msg, offset, str, count);
     }
-    return (ret);
+  return (ret);
 }
 
 OFC_CORE_LIB OFC_SIZET
@@ -470,6 +561,35 @@ ofc_message_get_tstring_len(OFC_MESSAGE *msg, OFC_INT offset,
   OFC_INT i;
   OFC_TCHAR c;
   OFC_BOOL done;
+  OFC_SIZET avail;
+  OFC_UCHAR *window;
+
+  /*
+   * Scan in place if the rest of the string is in one segment
+   */
+  window = OFC_NULL;
+  avail = ofc_message_get_length(msg);
+  if (offset + msg->base < avail)
+    {
+      avail = (avail - (offset + msg->base)) / sizeof(OFC_WORD);
+      window = ofc_message_window(msg, offset,
+                                  OFC_MIN(avail, max_len) * sizeof(OFC_WORD));
+    }
+
+  if (window != OFC_NULL)
+    {
+      max_len = OFC_MIN(avail, max_len);
+      for (i = 0; i < max_len; i++)
+        {
+          if (ofc_load_le16(window + i * sizeof(OFC_WORD)) == 0)
+            {
+              /* Include the EOS */
+              i++;
+              break;
+            }
+        }
+      return (i);
+    }
 
   /*
    * Include the EOS in the string len
@@ -491,8 +611,6 @@ ofc_message_get_tstring_len(OFC_MESSAGE *msg, OFC_INT offset,
 OFC_CORE_LIB OFC_BOOL
 ofc_message_get_tstr(OFC_MESSAGE *msg, OFC_INT offset, OFC_LPTSTR *str) {
     OFC_BOOL ret;
-    OFC_TCHAR *p;
-    OFC_INT i;
     OFC_SIZET string_len;
     OFC_SIZET max_len;
 
@@ -504,9 +622,7 @@ ofc_message_get_tstr(OFC_MESSAGE *msg, OFC_INT offset, OFC_LPTSTR *str) {
 
     *str = ofc_malloc(string_len * sizeof(OFC_TCHAR));
 
-    for (i = 0, p = *str; i < string_len; i++, p++) {
-        *p = ofc_message_get_u16(msg, offset + (i * sizeof(OFC_WORD)));
-    }
+    message_get_utf16(msg, offset, *str, string_len);
     return (ret);
 }
 
@@ -514,17 +630,10 @@ OFC_CORE_LIB OFC_BOOL
 ofc_message_put_tstrn(OFC_MESSAGE *msg, OFC_INT offset, OFC_LPCTSTR str,
                       OFC_SIZET len) {
     OFC_BOOL ret;
-    OFC_CTCHAR *p;
-    OFC_INT i;
 
-    len = OFC_MIN (len, ofc_tstrnlen(str, len)) * sizeof(OFC_WORD);
+    len = OFC_MIN (len, ofc_tstrnlen(str, len));
 
-    ret = OFC_TRUE;
-    p = str;
-    for (i = 0, p = str; i < len && ret == OFC_TRUE;
-         i += sizeof(OFC_WORD), p++) {
-        ret = ofc_message_put_u16(msg, offset + i, *p);
-    }
+    ret = message_put_utf16(msg, offset, str, len);
     return (ret);
 }
 
@@ -532,8 +641,6 @@ OFC_CORE_LIB OFC_BOOL
 ofc_message_get_tstrn(OFC_MESSAGE *msg, OFC_INT offset, OFC_LPTSTR *str,
                       OFC_SIZET max_len) {
     OFC_BOOL ret;
-    OFC_TCHAR *p;
-    OFC_INT i;
     OFC_SIZET string_len;
 
     ret = OFC_TRUE;
@@ -541,10 +648,8 @@ ofc_message_get_tstrn(OFC_MESSAGE *msg, OFC_INT offset, OFC_LPTSTR *str,
     string_len = ofc_message_get_tstring_len(msg, offset, max_len);
     *str = ofc_malloc((string_len + 1) * sizeof(OFC_TCHAR));
 
-    for (i = 0, p = *str; i < string_len; i++, p++) {
-        *p = ofc_message_get_u16(msg, offset + (i * sizeof(OFC_WORD)));
-    }
-    *p = TCHAR_EOS;
+    message_get_utf16(msg, offset, *str, string_len);
+    (*str)[string_len] = TCHAR_EOS;
 
     return (ret);
 }
@@ -553,17 +658,13 @@ OFC_CORE_LIB OFC_BOOL
 ofc_message_get_tstrnx(OFC_MESSAGE *msg, OFC_INT offset,
                        OFC_LPTSTR str, OFC_SIZET max_len) {
     OFC_BOOL ret;
-    OFC_TCHAR *p;
-    OFC_INT i;
     OFC_SIZET string_len;
 
     ret = OFC_TRUE;
 
     string_len = ofc_message_get_tstring_len(msg, offset, max_len);
 
-    for (i = 0, p = str; i < string_len; i++, p++) {
-        *p = ofc_message_get_u16(msg, offset + (i * sizeof(OFC_WORD)));
-    }
+    message_get_utf16(msg, offset, str, string_len);
 
     return (ret);
 }
@@ -623,9 +724,9 @@ ofc_message_get_u16(OFC_MESSAGE *msg, OFC_INT offset)
   if (ptr != OFC_NULL)
     {
       if (msg->endian == MSG_ENDIAN_BIG)
-        value = OFC_NET_NTOS (ptr, 0);
+        value = ofc_load_be16(ptr);
       else
-        value = OFC_NET_SMBTOS (ptr, 0);
+        value = ofc_load_le16(ptr);
     }
   return (value);
 }
@@ -644,9 +745,9 @@ ofc_message_get_u32(OFC_MESSAGE *msg, OFC_INT offset)
   if (ptr != OFC_NULL)
     {
       if (msg->endian == MSG_ENDIAN_BIG)
-        value = OFC_NET_NTOL (ptr, 0);
+        value = ofc_load_be32(ptr);
       else
-        value = OFC_NET_SMBTOL (ptr, 0);
+        value = ofc_load_le32(ptr);
     }
   return (value);
 }
@@ -670,9 +771,9 @@ ofc_message_get_u64(OFC_MESSAGE *msg, OFC_INT offset, OFC_UINT64 *value)
     {
 #if defined (OFC_64BIT_INTEGER)
       if (msg->endian == MSG_ENDIAN_BIG)
-        *value = OFC_NET_NTOLL (ptr, 0);
+        *value = ofc_load_be64(ptr);
       else
-        *value = OFC_NET_SMBTOLL (ptr, 0);
+        *value = ofc_load_le64(ptr);
 #else
       if (msg->endian == MSG_ENDIAN_BIG)
         {
@@ -32,8 +32,52 @@ typedef struct {
 				   First is the share */
     OFC_BOOL absolute;        /**< If the path is absolute */
     OFC_BOOL remote;        /**< If the path is remote */
+    OFC_BOOL meta_cache;    /**< If the target's metadata may be cached */
+    OFC_SIZET size;         /**< Bytes allocated with the path */
+    OFC_UINT arena_dirs;    /**< Directory slots allocated with the path */
 } _OFC_PATH;
 
+#define OFC_PATH_PORT_MAX 65535
+
+/*
+ * A parsed path is one allocation.  The structure is followed by the
+ * directory slots and then by every component, each terminated, so the
+ * getters can hand out plain strings.  A component that is replaced
+ * later is allocated on its own, so only what lies outside the arena is
+ * freed.
+ */
+static OFC_BOOL
+ofc_path_in_arena(_OFC_PATH *path, OFC_LPCVOID p) {
+    return ((const OFC_CHAR *) p >= (const OFC_CHAR *) path &&
+            (const OFC_CHAR *) p < (const OFC_CHAR *) path + path->size);
+}
+
+static OFC_VOID
+ofc_path_free_part(_OFC_PATH *path, OFC_LPVOID p) {
+    if (!ofc_path_in_arena(path, p))
+        ofc_free(p);
+}
+
+/*
+ * Make room for num_dirs directories.  The slots in the arena are kept
+ * as long as they are enough.
+ */
+static OFC_VOID
+ofc_path_resize_dirs(_OFC_PATH *path, OFC_UINT num_dirs) {
+    OFC_LPTSTR *dir;
+
+    if (path->dir != OFC_NULL && ofc_path_in_arena(path, path->dir)) {
+        if (num_dirs > path->arena_dirs) {
+            dir = ofc_malloc(num_dirs * sizeof(OFC_LPTSTR));
+            ofc_memcpy(dir, path->dir,
+                       OFC_MIN(path->num_dirs, path->arena_dirs) *
+                       sizeof(OFC_LPTSTR));
+            path->dir = dir;
+        }
+    } else
+        path->dir = ofc_realloc(path->dir, num_dirs * sizeof(OFC_LPTSTR));
+}
+
 typedef struct {
     OFC_LPTSTR lpDevice;
     OFC_LPTSTR lpDesc;
@@ -44,6 +88,239 @@ typedef struct {
 static PATH_MAP_ENTRY OfcPathMaps[OFC_MAX_MAPS];
 static OFC_LOCK lockPath;
 
+/*
+ * Device maps by the hash of their lower case device name.  Each slot
+ * holds an index into OfcPathMaps or -1.  There are twice as many slots
+ * as maps so a probe always ends at a free slot.  Rebuilt whenever a map
+ * is added or deleted.
+ */
+#define OFC_PATH_MAP_SLOTS (OFC_MAX_MAPS * 2)
+static OFC_INT OfcPathMapIndex[OFC_PATH_MAP_SLOTS];
+
+/*
+ * Mapped names, chained by the hash of the name and linked from the
+ * most to the least recently used.  The least recently used entry is
+ * reused for a new name.  Everything is protected by lockPath.
+ */
+typedef struct {
+    OFC_LPTSTR lpFileName;
+    OFC_LPTSTR lpMappedName;
+    OFC_FST_TYPE type;
+    OFC_BOOL remote;
+    OFC_BOOL meta_cache;
+    OFC_UINT32 hash;
+    OFC_INT next;            /* Next entry in the hash chain */
+    OFC_INT newer;
+    OFC_INT older;
+} PATH_CACHE_ENTRY;
+
+#if (OFC_PATH_CACHE > 0)
+#define OFC_PATH_CACHE_BUCKETS (OFC_PATH_CACHE * 2)
+static PATH_CACHE_ENTRY OfcPathCache[OFC_PATH_CACHE];
+static OFC_INT OfcPathCacheBuckets[OFC_PATH_CACHE_BUCKETS];
+static OFC_INT OfcPathCacheNewest;
+static OFC_INT OfcPathCacheOldest;
+#endif
+/*
+ * Bumped by every change to the maps.  A name mapped while the maps
+ * changed is not cached.
+ */
+static OFC_UINT32 OfcPathGeneration;
+static OFC_UINT32 OfcPathCacheHits;
+static OFC_UINT32 OfcPathCacheMisses;
+
+/*
+ * FNV-1a, optionally of the lower case name
+ */
+static OFC_UINT32
+ofc_path_hash(OFC_LPCTSTR str, OFC_SIZET len, OFC_BOOL fold) {
+    OFC_UINT32 hash;
+    OFC_SIZET i;
+    OFC_TCHAR c;
+
+    hash = 2166136261U;
+    for (i = 0; i < len; i++) {
+        c = str[i];
+        if (fold)
+            c = OFC_TTOLOWER(c);
+        hash = (hash ^ (OFC_UINT32) c) * 16777619U;
+    }
+    return (hash);
+}
+
+static OFC_VOID
+ofc_path_index_maps(OFC_VOID) {
+    OFC_INT i;
+    OFC_UINT32 slot;
+    OFC_LPCTSTR lpDevice;
+
+    for (slot = 0; slot < OFC_PATH_MAP_SLOTS; slot++)
+        OfcPathMapIndex[slot] = -1;
+
+    for (i = 0; i < OFC_MAX_MAPS; i++) {
+        lpDevice = OfcPathMaps[i].lpDevice;
+        if (lpDevice != OFC_NULL) {
+            slot = ofc_path_hash(lpDevice, ofc_tstrlen(lpDevice), OFC_TRUE) %
+                   OFC_PATH_MAP_SLOTS;
+            while (OfcPathMapIndex[slot] != -1)
+                slot = (slot + 1) % OFC_PATH_MAP_SLOTS;
+            OfcPathMapIndex[slot] = i;
+        }
+    }
+}
+
+/*
+ * Find the map for the first len characters of lpDevice, ignoring case.
+ * Called with lockPath held.
+ */
+static PATH_MAP_ENTRY *
+ofc_path_find_map(OFC_LPCTSTR lpDevice, OFC_SIZET len) {
+    PATH_MAP_ENTRY *pathEntry;
+    PATH_MAP_ENTRY *candidate;
+    OFC_UINT32 slot;
+
+    pathEntry = OFC_NULL;
+    slot = ofc_path_hash(lpDevice, len, OFC_TRUE) % OFC_PATH_MAP_SLOTS;
+    while (pathEntry == OFC_NULL && OfcPathMapIndex[slot] != -1) {
+        candidate = &OfcPathMaps[OfcPathMapIndex[slot]];
+        if (ofc_tstrncasecmp(candidate->lpDevice, lpDevice, len) == 0 &&
+            candidate->lpDevice[len] == TCHAR_EOS)
+            pathEntry = candidate;
+        slot = (slot + 1) % OFC_PATH_MAP_SLOTS;
+    }
+    return (pathEntry);
+}
+
+#if (OFC_PATH_CACHE > 0)
+static OFC_VOID
+ofc_path_init_cache(OFC_VOID) {
+    OFC_INT i;
+
+    for (i = 0; i < OFC_PATH_CACHE; i++) {
+        OfcPathCache[i].lpFileName = OFC_NULL;
+        OfcPathCache[i].lpMappedName = OFC_NULL;
+        OfcPathCache[i].next = -1;
+        OfcPathCache[i].newer = i - 1;
+        OfcPathCache[i].older = i + 1 < OFC_PATH_CACHE ? i + 1 : -1;
+    }
+    OfcPathCacheNewest = 0;
+    OfcPathCacheOldest = OFC_PATH_CACHE - 1;
+
+    for (i = 0; i < OFC_PATH_CACHE_BUCKETS; i++)
+        OfcPathCacheBuckets[i] = -1;
+}
+
+/*
+ * Mapped names may carry credentials.  Clear them before they go back
+ * to the heap.
+ */
+static OFC_VOID
+ofc_path_cache_free_name(OFC_LPTSTR name) {
+    if (name != OFC_NULL) {
+        ofc_memset(name, '\0', ofc_tstrlen(name) * sizeof(OFC_TCHAR));
+        ofc_free(name);
+    }
+}
+
+/*
+ * Make an entry the most recently used
+ */
+static OFC_VOID
+ofc_path_cache_touch(OFC_INT i) {
+    PATH_CACHE_ENTRY *entry;
+
+    entry = &OfcPathCache[i];
+    if (OfcPathCacheNewest != i) {
+        OfcPathCache[entry->newer].older = entry->older;
+        if (entry->older == -1)
+            OfcPathCacheOldest = entry->newer;
+        else
+            OfcPathCache[entry->older].newer = entry->newer;
+
+        entry->older = OfcPathCacheNewest;
+        entry->newer = -1;
+        OfcPathCache[OfcPathCacheNewest].newer = i;
+        OfcPathCacheNewest = i;
+    }
+}
+
+static PATH_CACHE_ENTRY *
+ofc_path_cache_find(OFC_LPCTSTR lpFileName, OFC_UINT32 hash) {
+    OFC_INT i;
+
+    for (i = OfcPathCacheBuckets[hash % OFC_PATH_CACHE_BUCKETS];
+         i != -1 && (OfcPathCache[i].hash != hash ||
+                     ofc_tstrcmp(OfcPathCache[i].lpFileName, lpFileName) != 0);
+         i = OfcPathCache[i].next);
+
+    if (i == -1)
+        return (OFC_NULL);
+    ofc_path_cache_touch(i);
+    return (&OfcPathCache[i]);
+}
+
+static OFC_VOID
+ofc_path_cache_insert(OFC_LPCTSTR lpFileName, OFC_UINT32 hash,
+                      OFC_LPCTSTR lpMappedName, OFC_FST_TYPE type,
+                      OFC_BOOL remote, OFC_BOOL meta_cache) {
+    PATH_CACHE_ENTRY *entry;
+    OFC_INT *link;
+    OFC_INT i;
+
+    /*
+     * Another thread may have mapped the same name
+     */
+    if (ofc_path_cache_find(lpFileName, hash) == OFC_NULL) {
+        i = OfcPathCacheOldest;
+        entry = &OfcPathCache[i];
+        if (entry->lpFileName != OFC_NULL) {
+            for (link = &OfcPathCacheBuckets[entry->hash %
+                                             OFC_PATH_CACHE_BUCKETS];
+                 *link != i;
+                 link = &OfcPathCache[*link].next);
+            *link = entry->next;
+            ofc_path_cache_free_name(entry->lpFileName);
+            ofc_path_cache_free_name(entry->lpMappedName);
+        }
+
+        entry->lpFileName = ofc_tstrdup(lpFileName);
+        entry->lpMappedName = ofc_tstrdup(lpMappedName);
+        entry->type = type;
+        entry->remote = remote;
+        entry->meta_cache = meta_cache;
+        entry->hash = hash;
+        entry->next = OfcPathCacheBuckets[hash % OFC_PATH_CACHE_BUCKETS];
+        OfcPathCacheBuckets[hash % OFC_PATH_CACHE_BUCKETS] = i;
+        ofc_path_cache_touch(i);
+    }
+}
+#else
+#define ofc_path_init_cache()
+#define ofc_path_cache_find(name, hash) ((PATH_CACHE_ENTRY *) OFC_NULL)
+#define ofc_path_cache_insert(name, hash, mapped, type, remote, meta_cache)
+#endif
+
+/*
+ * Forget every mapped name.  Called with lockPath held whenever the
+ * maps change.
+ */
+static OFC_VOID
+ofc_path_flush_cache(OFC_VOID) {
+#if (OFC_PATH_CACHE > 0)
+    OFC_INT i;
+
+    for (i = 0; i < OFC_PATH_CACHE; i++) {
+        ofc_path_cache_free_name(OfcPathCache[i].lpFileName);
+        ofc_path_cache_free_name(OfcPathCache[i].lpMappedName);
+        OfcPathCache[i].lpFileName = OFC_NULL;
+        OfcPathCache[i].lpMappedName = OFC_NULL;
+    }
+    for (i = 0; i < OFC_PATH_CACHE_BUCKETS; i++)
+        OfcPathCacheBuckets[i] = -1;
+#endif
+    OfcPathGeneration++;
+}
+
 OFC_BOOL ofc_path_is_wild(OFC_LPCTSTR dir) {
     OFC_LPCTSTR p;
     OFC_BOOL wild;
@@ -63,21 +340,21 @@ ofc_path_update(OFC_PATH *_path, OFC_PATH *_map) {
     _OFC_PATH *map = (_OFC_PATH *) _map;
 
     path->type = map->type;
-    ofc_free(path->device);
+    ofc_path_free_part(path, path->device);
     path->device = ofc_tstrdup(map->device);
 
     if (map->username != OFC_NULL) {
-        ofc_free(path->username);
+        ofc_path_free_part(path, path->username);
         path->username = ofc_tstrdup(map->username);
     }
 
     if (map->password != OFC_NULL) {
-        ofc_free(path->password);
+        ofc_path_free_part(path, path->password);
         path->password = ofc_tstrdup(map->password);
     }
 
     if (map->domain != OFC_NULL) {
-        ofc_free(path->domain);
+        ofc_path_free_part(path, path->domain);
         path->domain = ofc_tstrdup(map->domain);
     }
 
@@ -85,7 +362,7 @@ ofc_path_update(OFC_PATH *_path, OFC_PATH *_map) {
      * If there is a server in the path, we want to remove it.
      */
     if (path->remote && path->num_dirs > 0) {
-        ofc_free(path->dir[0]);
+        ofc_path_free_part(path, path->dir[0]);
         for (i = 1; i < path->num_dirs; i++) {
             path->dir[i - 1] = path->dir[i];
         }
@@ -94,12 +371,11 @@ ofc_path_update(OFC_PATH *_path, OFC_PATH *_map) {
 
     path->absolute = map->absolute;
     path->remote = map->remote;
+    path->meta_cache = map->meta_cache;
     if (path->remote)
         path->port = map->port;
 
-    path->dir = ofc_realloc(path->dir,
-                            (map->num_dirs + path->num_dirs) *
-                            sizeof(OFC_TCHAR *));
+    ofc_path_resize_dirs(path, map->num_dirs + path->num_dirs);
     /*
      * Now insert the mapped paths in front of the existing path dirs
      * Move paths dirs
@@ -120,12 +396,10 @@ ofc_path_update(OFC_PATH *_path, OFC_PATH *_map) {
      */
     if (path->num_dirs > 1 && !ofc_path_is_wild(path->dir[1]) &&
         lookup_workgroup(path->dir[0])) {
-        ofc_free(path->dir[0]);
+        ofc_path_free_part(path, path->dir[0]);
         for (i = 1; i < path->num_dirs; i++)
             path->dir[i - 1] = path->dir[i];
         path->num_dirs--;
-        path->dir = ofc_realloc(path->dir,
-                                path->num_dirs * sizeof(OFC_TCHAR *));
     }
 }
 
@@ -172,7 +446,7 @@ static OFC_BOOL terminator(OFC_CTCHAR c, OFC_CTCHAR *terms) {
     if (c == '\0')
         hit = OFC_TRUE;
     else {
-        for (i = 0, hit = OFC_FALSE; i < ofc_tstrlen(terms) && !hit; i++) {
+        for (i = 0, hit = OFC_FALSE; terms[i] != TCHAR_EOS && !hit; i++) {
             if (c == terms[i])
                 hit = OFC_TRUE;
         }
@@ -188,116 +462,49 @@ static OFC_BOOL terminator(OFC_CTCHAR c, OFC_CTCHAR *terms) {
 #define HEX2T(val) \
   ((val >= 0 && val <= 9) ? val + TCHAR('0') : (val - 10 + 'A'))
 
-static OFC_TCHAR *ParseEscaped(OFC_CTCHAR *cursor, OFC_CTCHAR **outcursor,
-                               OFC_CTCHAR *terms) {
+/*
+ * Copy the component at cursor, up to one of terms, to the arena and
+ * terminate it.  %xx escapes are decoded if escaped is set, so the copy
+ * is never longer than the text it came from.  An empty component is
+ * not copied and returns OFC_NULL.  With no arena, just finds the end.
+ */
+static OFC_TCHAR *ParsePart(OFC_CTCHAR *cursor, OFC_CTCHAR **outcursor,
+                            OFC_CTCHAR *terms, OFC_BOOL escaped,
+                            OFC_TCHAR **arena) {
     OFC_LPCTSTR peek;
-    OFC_BOOL hit;
-    OFC_LPTSTR ret;
-    OFC_INT len;
     OFC_TCHAR *p;
     OFC_TCHAR *outstr;
-
-    outstr = OFC_NULL;
-    *outcursor = cursor;
-
-    if (cursor == OFC_NULL || terms == OFC_NULL)
-        ret = OFC_NULL;
-    else {
-        /*
-         * First, find the length
-         */
-        for (peek = cursor, len = 0, hit = OFC_FALSE; !hit;) {
-            OFC_INT i;
-            OFC_CHAR c;
-
-            if (*peek == TCHAR ('%')) {
-                peek++;
-                for (c = 0x00, i = 0; *peek != TCHAR_EOS && i < 2; i++, peek++)
-                    c = (c << 4) | THEX(*peek);
-                len++;
-            } else {
-                if (terminator(*peek, terms)) {
-                    hit = OFC_TRUE;
-                } else {
-                    peek++;
-                    len++;
-                }
-            }
-        }
-
-        if (len > 0) {
-            outstr = ofc_malloc(sizeof(OFC_TCHAR) * (len + 1));
-            p = outstr;
-
-            for (peek = cursor, hit = OFC_FALSE; !hit;) {
-                OFC_INT i;
-                OFC_CHAR c;
-
-                if (*peek == TCHAR ('%')) {
-                    peek++;
-                    for (c = 0x00, i = 0; *peek != '\0' && i < 2; i++, peek++)
-                        c = (c << 4) | THEX(*peek);
-                    *p++ = c;
-                } else {
-                    if (terminator(*peek, terms)) {
-                        hit = OFC_TRUE;
-                    } else {
-                        *p++ = *peek++;
-                    }
-                }
-            }
-            *p = TCHAR_EOS;
-            *outcursor = peek;
-        }
-        ret = outstr;
-    }
-    return (ret);
-}
-
-static OFC_TCHAR *ParseUnescaped(OFC_CTCHAR *cursor, OFC_CTCHAR **outcursor,
-				 OFC_CTCHAR *terms) {
-    OFC_LPCTSTR peek;
-    OFC_BOOL hit;
-    OFC_LPTSTR ret;
     OFC_INT len;
-    OFC_TCHAR *p;
-    OFC_TCHAR *outstr;
+    OFC_INT i;
+    OFC_CHAR c;
 
     outstr = OFC_NULL;
-    *outcursor = cursor;
-
-    if (cursor == OFC_NULL || terms == OFC_NULL)
-        ret = OFC_NULL;
-    else {
-        /*
-         * First, find the length
-         */
-        for (peek = cursor, len = 0, hit = OFC_FALSE; !hit;) {
-	    if (terminator(*peek, terms)) {
-	      hit = OFC_TRUE;
-	    } else {
-	      peek++;
-	      len++;
-            }
-        }
-
-        if (len > 0) {
-            outstr = ofc_malloc(sizeof(OFC_TCHAR) * (len + 1));
-            p = outstr;
+    p = OFC_NULL;
+    if (arena != OFC_NULL)
+        p = *arena;
+
+    for (peek = cursor, len = 0; ; len++) {
+        if (escaped && *peek == TCHAR ('%')) {
+            peek++;
+            for (c = 0x00, i = 0; *peek != TCHAR_EOS && i < 2; i++, peek++)
+                c = (c << 4) | THEX(*peek);
+            if (p != OFC_NULL)
+                *p++ = c;
+        } else if (terminator(*peek, terms)) {
+            break;
+        } else if (p != OFC_NULL) {
+            *p++ = *peek++;
+        } else
+            peek++;
+    }
 
-            for (peek = cursor, hit = OFC_FALSE; !hit;) {
-		if (terminator(*peek, terms)) {
-		  hit = OFC_TRUE;
-		} else {
-		  *p++ = *peek++;
-		}
-            }
-            *p = TCHAR_EOS;
-            *outcursor = peek;
-        }
-        ret = outstr;
+    if (len > 0 && p != OFC_NULL) {
+        *p++ = TCHAR_EOS;
+        outstr = *arena;
+        *arena = p;
     }
-    return (ret);
+    *outcursor = peek;
+    return (outstr);
 }
 
 OFC_CORE_LIB OFC_PATH *
@@ -315,6 +522,9 @@ ofc_path_init_path(OFC_VOID) {
     path->dir = OFC_NULL;
     path->absolute = OFC_FALSE;
     path->remote = OFC_FALSE;
+    path->meta_cache = OFC_FALSE;
+    path->size = sizeof(_OFC_PATH);
+    path->arena_dirs = 0;
 
     return (path);
 }
@@ -350,13 +560,45 @@ ofc_path_createW(OFC_LPCTSTR lpFileName)
   _OFC_PATH *path;
   OFC_LPCTSTR cursor;
   OFC_LPCTSTR p;
-  OFC_TCHAR *portw;
-  OFC_CHAR *porta;
   OFC_LPTSTR dir;
-  OFC_TCHAR *credentials;
+  OFC_TCHAR *arena;
+  OFC_SIZET len;
+  OFC_UINT seps;
+  OFC_INT port;
   OFC_BOOL wild;
 
-  path = ofc_path_init_path();
+  /*
+   * Size the arena.  Every component is followed by a terminator, or is
+   * the last one, so the components fit in the length of the name plus
+   * one.  There is at most one more directory than separators.
+   */
+  seps = 0;
+  for (len = 0; lpFileName[len] != TCHAR_EOS; len++)
+    {
+      if (lpFileName[len] == TCHAR_SLASH ||
+          lpFileName[len] == TCHAR_BACKSLASH ||
+          lpFileName[len] == TCHAR_COLON)
+        seps++;
+    }
+
+  path = ofc_malloc(sizeof(_OFC_PATH) + (seps + 1) * sizeof(OFC_LPTSTR) +
+                    (len + 1) * sizeof(OFC_TCHAR));
+  path->type = OFC_FST_FILE;
+  path->device = OFC_NULL;
+  path->username = OFC_NULL;
+  path->password = OFC_NULL;
+  path->domain = OFC_NULL;
+  path->port = 445;
+  path->num_dirs = 0;
+  path->dir = (OFC_LPTSTR *) (path + 1);
+  path->absolute = OFC_FALSE;
+  path->remote = OFC_FALSE;
+  path->meta_cache = OFC_FALSE;
+  path->size = sizeof(_OFC_PATH) + (seps + 1) * sizeof(OFC_LPTSTR) +
+    (len + 1) * sizeof(OFC_TCHAR);
+  path->arena_dirs = seps + 1;
+  arena = (OFC_TCHAR *) (path->dir + path->arena_dirs);
+
   cursor = lpFileName;
   /*
    * path_parse - Parse a path into it's requisite parts.
@@ -376,7 +618,7 @@ ofc_path_createW(OFC_LPCTSTR lpFileName)
   p = ofc_tstrtok(cursor, TSTR("\\/:"));
   if (*p == TCHAR_COLON)
     {
-      path->device = ParseUnescaped(cursor, &cursor, TSTR(":"));
+      path->device = ParsePart(cursor, &cursor, TSTR(":"), OFC_FALSE, &arena);
       cursor++;
       if ((ofc_tstrcmp(path->device, TSTR("cifs")) == 0) ||
           (ofc_tstrcmp(path->device, TSTR("smb")) == 0) ||
@@ -413,29 +655,29 @@ ofc_path_createW(OFC_LPCTSTR lpFileName)
       path->absolute = OFC_TRUE;
     }
 
-  path->num_dirs = 0;
   if (path->remote)
     {
       /*
        * There's an authority (remote access)
        * Find out if there's a credential.  There will be an unescapedd "@"
        */
-      credentials = ParseEscaped(cursor, &p, TSTR("@"));
-      ofc_free(credentials);
+      ParsePart(cursor, &p, TSTR("@"), OFC_TRUE, OFC_NULL);
 
       if (*p == TCHAR_AMP)
         {
           /*
            * we have user:pass:domain
            */
-          path->username = ParseEscaped(cursor, &cursor, TSTR(":@"));
+          path->username = ParsePart(cursor, &cursor, TSTR(":@"),
+                                     OFC_TRUE, &arena);
           if (*cursor == TCHAR_COLON)
             {
               cursor++;
               /*
                * we have a password:domain
                */
-              path->password = ParseEscaped(cursor, &cursor, TSTR(":@"));
+              path->password = ParsePart(cursor, &cursor, TSTR(":@"),
+                                         OFC_TRUE, &arena);
             }
 
           if (*cursor == TCHAR_COLON)
@@ -444,7 +686,8 @@ ofc_path_createW(OFC_LPCTSTR lpFileName)
               /*
                * we have a domain
                */
-              path->domain = ParseEscaped(cursor, &cursor, TSTR("@"));
+              path->domain = ParsePart(cursor, &cursor, TSTR("@"),
+                                       OFC_TRUE, &arena);
             }
           cursor++;
         }
@@ -452,7 +695,7 @@ ofc_path_createW(OFC_LPCTSTR lpFileName)
 
   while (*cursor != TCHAR_EOS)
     {
-      dir = ParseUnescaped(cursor, &cursor, TSTR("\\/:"));
+      dir = ParsePart(cursor, &cursor, TSTR("\\/:"), OFC_FALSE, &arena);
 
       if (dir != OFC_NULL)
         {
@@ -461,19 +704,11 @@ ofc_path_createW(OFC_LPCTSTR lpFileName)
           if (ofc_tstrcmp(dir, TSTR("..")) == 0)
             {
               if (path->num_dirs > 0)
-                {
-                  path->num_dirs--;
-                  ofc_free(path->dir[path->num_dirs]);
-                  path->dir = ofc_realloc(path->dir,
-                                          sizeof(OFC_LPCTSTR *) *
-                                          (path->num_dirs));
-                }
-              ofc_free(dir);
+                path->num_dirs--;
             }
           else if (ofc_tstrcmp(dir, TSTR(".")) == 0)
             {
               /* Skip it */
-              ofc_free(dir);
             }
           /*
            * if we're remote and if dir index is 1 we're looking at a share or
@@ -485,17 +720,12 @@ ofc_path_createW(OFC_LPCTSTR lpFileName)
                    lookup_workgroup(path->dir[0]))
             {
               /*
-               * Strip the workgroup.
-               * Free the old one, and replace it with this one.
+               * Strip the workgroup by replacing it with this one.
                */
-              ofc_free(path->dir[0]);
               path->dir[0] = dir;
             }
           else
             {
-              path->dir = ofc_realloc(path->dir,
-                                      sizeof(OFC_LPCTSTR *) *
-                                      (path->num_dirs + 1));
               path->dir[path->num_dirs] = dir;
               path->num_dirs++;
             }
@@ -505,11 +735,19 @@ ofc_path_createW(OFC_LPCTSTR lpFileName)
               (path->num_dirs == 1))
             {
               cursor++;
-              portw = ParseUnescaped(cursor, &cursor, TSTR("\\/"));
-              porta = ofc_tstr2cstr(portw);
-              path->port = (OFC_INT) ofc_strtoul(porta, OFC_NULL, 10);
-              ofc_free(portw);
-              ofc_free(porta);
+              /*
+               * Stop accumulating once out of range, so a long run of
+               * digits can't overflow.  A port out of range is no port.
+               */
+              for (port = 0;
+                   *cursor >= TCHAR('0') && *cursor <= TCHAR('9');
+                   cursor++)
+                {
+                  if (port <= OFC_PATH_PORT_MAX)
+                    port = port * 10 + (*cursor - TCHAR('0'));
+                }
+              ParsePart(cursor, &cursor, TSTR("\\/"), OFC_FALSE, OFC_NULL);
+              path->port = (port <= OFC_PATH_PORT_MAX) ? port : 0;
             }
         }
       if (*cursor != TCHAR_EOS)
@@ -537,14 +775,14 @@ ofc_path_delete(OFC_PATH *_path) {
     OFC_UINT i;
     _OFC_PATH *path = (_OFC_PATH *) _path;
 
-    ofc_free(path->device);
-    ofc_free(path->username);
-    ofc_free(path->password);
-    ofc_free(path->domain);
+    ofc_path_free_part(path, path->device);
+    ofc_path_free_part(path, path->username);
+    ofc_path_free_part(path, path->password);
+    ofc_path_free_part(path, path->domain);
     for (i = 0; i < path->num_dirs; i++) {
-        ofc_free(path->dir[i]);
+        ofc_path_free_part(path, path->dir[i]);
     }
-    ofc_free(path->dir);
+    ofc_path_free_part(path, path->dir);
     ofc_free(path);
 }
 
@@ -714,19 +952,13 @@ ofc_path_printW(OFC_PATH *_path, OFC_LPTSTR *filename, OFC_SIZET *rem) {
             len += ofc_path_out_str(path->dir[i], filename, rem);
 
             if (path->remote && (i == 0) && (path->port != 0)) {
-                OFC_SIZET count;
-                OFC_CHAR *porta;
-                OFC_TCHAR *portw;
-
-                count = 0;
-                count = ofc_snprintf(OFC_NULL, count, "%d", path->port);
-                porta = ofc_malloc((count + 1) * sizeof(OFC_CHAR));
-                ofc_snprintf(porta, count + 1, "%d", path->port);
-                portw = ofc_cstr2tstr(porta);
+                OFC_CHAR porta[12];
+                OFC_CHAR *p;
+
+                ofc_snprintf(porta, sizeof(porta), "%d", path->port);
                 len += ofc_path_out_char(TCHAR(':'), filename, rem);
-                len += ofc_path_out_str(portw, filename, rem);
-                ofc_free(porta);
-                ofc_free(portw);
+                for (p = porta; *p != '\0'; p++)
+                    len += ofc_path_out_char((OFC_TCHAR) *p, filename, rem);
             }
 
             if ((i + 1) < path->num_dirs)
@@ -763,18 +995,29 @@ ofc_path_printA(OFC_PATH *_path, OFC_LPSTR *filename, OFC_SIZET *rem) {
 
 OFC_CORE_LIB OFC_TCHAR *ofc_path_print_alloc(OFC_PATH *path)
 {
+  OFC_TCHAR buf[OFC_MAX_PATH + 1];
   OFC_TCHAR *cursor;
+  OFC_SIZET rem;
   OFC_SIZET size;
   OFC_TCHAR *filename;
 
-  cursor = OFC_NULL ;
-  size = 0 ;
+  /*
+   * Print once to the stack and copy out.  Only a name longer than
+   * OFC_MAX_PATH is printed again.
+   */
+  cursor = buf ;
+  rem = OFC_MAX_PATH + 1 ;
+  size = ofc_path_printW(path, &cursor, &rem) ;
 
-  size = ofc_path_print(path, &cursor, &size) ;
   filename = ofc_malloc ((size+1) * sizeof (OFC_TCHAR)) ;
-  cursor = filename ;
-  size++ ;
-  ofc_path_print(path, &cursor, &size) ;
+  if (size <= OFC_MAX_PATH)
+    ofc_memcpy (filename, buf, (size+1) * sizeof (OFC_TCHAR)) ;
+  else
+    {
+      cursor = filename ;
+      rem = size + 1 ;
+      ofc_path_printW(path, &cursor, &rem) ;
+    }
   return (filename);
 }
 
@@ -792,8 +1035,6 @@ OFC_CORE_LIB OFC_PATH *ofc_map_path(OFC_LPCTSTR lpFileName,
                                     OFC_LPTSTR *lppMappedName) {
     OFC_PATH *path;
     OFC_PATH *map;
-    OFC_SIZET len;
-    OFC_LPTSTR cursor;
 #if defined(AUTHENTICATE)
     OFC_LPCTSTR server;
     OFC_BOOL updated;
@@ -845,15 +1086,8 @@ OFC_CORE_LIB OFC_PATH *ofc_map_path(OFC_LPCTSTR lpFileName,
 
     ofc_path_update_type(path);
 
-    if (lppMappedName != OFC_NULL) {
-        len = 0;
-        len = ofc_path_printW(path, OFC_NULL, &len) + 1;
-
-        *lppMappedName = ofc_malloc(len * sizeof(OFC_TCHAR));
-
-        cursor = *lppMappedName;
-        ofc_path_printW(path, &cursor, &len);
-    }
+    if (lppMappedName != OFC_NULL)
+        *lppMappedName = ofc_path_print_alloc(path);
 
     return (path);
 }
@@ -864,13 +1098,86 @@ OFC_CORE_LIB OFC_PATH *ofc_map_path(OFC_LPCTSTR lpFileName,
 OFC_CORE_LIB OFC_VOID
 ofc_path_mapW(OFC_LPCTSTR lpFileName, OFC_LPTSTR *lppMappedName,
               OFC_FST_TYPE *filesystem) {
+    ofc_path_lookupW(lpFileName, lppMappedName, filesystem, OFC_NULL,
+                     OFC_NULL);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_path_lookupW(OFC_LPCTSTR lpFileName, OFC_LPTSTR *lppMappedName,
+                 OFC_FST_TYPE *filesystem, OFC_BOOL *remote,
+                 OFC_BOOL *meta_cache) {
     OFC_PATH *path;
+    PATH_CACHE_ENTRY *entry;
+    OFC_LPTSTR lpMappedName;
+    OFC_FST_TYPE type;
+    OFC_BOOL isremote;
+    OFC_BOOL cacheable;
+    OFC_UINT32 hash;
+    OFC_UINT32 generation;
+
+    entry = OFC_NULL;
+    hash = 0;
+    generation = 0;
+    lpMappedName = OFC_NULL;
+    type = OFC_FST_UNKNOWN;
+    isremote = OFC_FALSE;
+    cacheable = OFC_FALSE;
+
+    if (lpFileName != OFC_NULL) {
+        hash = ofc_path_hash(lpFileName, ofc_tstrlen(lpFileName), OFC_FALSE);
+
+        ofc_lock(lockPath);
+        generation = OfcPathGeneration;
+        entry = ofc_path_cache_find(lpFileName, hash);
+        if (entry != OFC_NULL) {
+            type = entry->type;
+            isremote = entry->remote;
+            cacheable = entry->meta_cache;
+            if (lppMappedName != OFC_NULL)
+                lpMappedName = ofc_tstrdup(entry->lpMappedName);
+            OfcPathCacheHits++;
+        } else
+            OfcPathCacheMisses++;
+        ofc_unlock(lockPath);
+    }
 
-    path = ofc_map_path(lpFileName, lppMappedName);
+    if (entry == OFC_NULL) {
+        path = ofc_map_path(lpFileName, &lpMappedName);
+        type = ofc_path_type(path);
+        isremote = ofc_path_remote(path);
+        cacheable = ofc_path_meta_cache(path);
+        ofc_path_delete(path);
+
+        if (lpFileName != OFC_NULL) {
+            ofc_lock(lockPath);
+            if (generation == OfcPathGeneration)
+                ofc_path_cache_insert(lpFileName, hash, lpMappedName,
+                                      type, isremote, cacheable);
+            ofc_unlock(lockPath);
+        }
 
+        if (lppMappedName == OFC_NULL) {
+            ofc_free(lpMappedName);
+            lpMappedName = OFC_NULL;
+        }
+    }
+
+    if (lppMappedName != OFC_NULL)
+        *lppMappedName = lpMappedName;
     if (filesystem != OFC_NULL)
-        *filesystem = ofc_path_type(path);
-    ofc_path_delete(path);
+        *filesystem = type;
+    if (remote != OFC_NULL)
+        *remote = isremote;
+    if (meta_cache != OFC_NULL)
+        *meta_cache = cacheable;
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_path_get_cache_stats(OFC_UINT32 *hits, OFC_UINT32 *misses) {
+    ofc_lock(lockPath);
+    *hits = OfcPathCacheHits;
+    *misses = OfcPathCacheMisses;
+    ofc_unlock(lockPath);
 }
 
 OFC_CORE_LIB OFC_VOID
@@ -900,6 +1207,12 @@ ofc_path_init(OFC_VOID) {
         OfcPathMaps[i].map = OFC_NULL;
         OfcPathMaps[i].thumbnail = OFC_FALSE;
     }
+    ofc_path_index_maps();
+
+    ofc_path_init_cache();
+    OfcPathGeneration = 0;
+    OfcPathCacheHits = 0;
+    OfcPathCacheMisses = 0;
 }
 
 OFC_CORE_LIB OFC_VOID
@@ -911,6 +1224,10 @@ ofc_path_destroy(OFC_VOID) {
             ofc_path_delete_mapW(OfcPathMaps[i].lpDevice);
     }
 
+    ofc_lock(lockPath);
+    ofc_path_flush_cache();
+    ofc_unlock(lockPath);
+
     ofc_lock_destroy(lockPath);
 }
 
@@ -939,32 +1256,29 @@ ofc_path_add_mapW(OFC_LPCTSTR lpDevice, OFC_LPCTSTR lpDesc,
 
     ofc_lock(lockPath);
 
-    for (i = 0; i < OFC_MAX_MAPS && ret == OFC_TRUE; i++) {
-        if (OfcPathMaps[i].lpDevice == OFC_NULL) {
-            if (free == OFC_NULL)
-                free = &OfcPathMaps[i];
-        } else {
-            if (ofc_tstrcasecmp(OfcPathMaps[i].lpDevice, lpDevice) == 0) {
-                ret = OFC_FALSE;
-            }
-        }
+    if (lpDevice == OFC_NULL ||
+        ofc_path_find_map(lpDevice, ofc_tstrlen(lpDevice)) != OFC_NULL)
+        ret = OFC_FALSE;
+
+    for (i = 0; i < OFC_MAX_MAPS && ret == OFC_TRUE && free == OFC_NULL; i++) {
+        if (OfcPathMaps[i].lpDevice == OFC_NULL)
+            free = &OfcPathMaps[i];
     }
 
     if (ret == OFC_TRUE) {
         if (free == OFC_NULL) {
             ret = OFC_FALSE;
         } else {
-            if (lpDevice == OFC_NULL)
-                ret = OFC_FALSE;
-            else {
-                map->type = fsType;
-                free->lpDevice = ofc_tstrdup(lpDevice);
-                for (lc = free->lpDevice; *lc != TCHAR_EOS; lc++)
-                    *lc = OFC_TTOLOWER(*lc);
-                free->lpDesc = ofc_tstrdup(lpDesc);
-                free->map = map;
-                free->thumbnail = thumbnail;
-            }
+            map->type = fsType;
+            free->lpDevice = ofc_tstrdup(lpDevice);
+            for (lc = free->lpDevice; *lc != TCHAR_EOS; lc++)
+                *lc = OFC_TTOLOWER(*lc);
+            free->lpDesc = ofc_tstrdup(lpDesc);
+            free->map = map;
+            free->thumbnail = thumbnail;
+
+            ofc_path_index_maps();
+            ofc_path_flush_cache();
         }
     }
     ofc_unlock(lockPath);
@@ -994,21 +1308,14 @@ ofc_path_add_mapA(OFC_LPCSTR lpDevice, OFC_LPCSTR lpDesc,
  */
 OFC_CORE_LIB OFC_VOID
 ofc_path_delete_mapW(OFC_LPCTSTR lpDevice) {
-    OFC_INT i;
     PATH_MAP_ENTRY *pathEntry;
 
-    /*
-     * Search for a free entry and make sure the device is not already mapped
-     */
     pathEntry = OFC_NULL;
 
     ofc_lock(lockPath);
 
-    for (i = 0; i < OFC_MAX_MAPS && pathEntry == OFC_NULL; i++) {
-        if (OfcPathMaps[i].lpDevice != OFC_NULL &&
-            ofc_tstrcasecmp(OfcPathMaps[i].lpDevice, lpDevice) == 0)
-            pathEntry = &OfcPathMaps[i];
-    }
+    if (lpDevice != OFC_NULL)
+        pathEntry = ofc_path_find_map(lpDevice, ofc_tstrlen(lpDevice));
 
     if (pathEntry != OFC_NULL) {
         ofc_free(pathEntry->lpDevice);
@@ -1016,6 +1323,9 @@ ofc_path_delete_mapW(OFC_LPCTSTR lpDevice) {
         ofc_path_delete(pathEntry->map);
         pathEntry->lpDevice = OFC_NULL;
         pathEntry->map = OFC_NULL;
+
+        ofc_path_index_maps();
+        ofc_path_flush_cache();
     }
 
     ofc_unlock(lockPath);
@@ -1030,6 +1340,39 @@ ofc_path_delete_mapA(OFC_LPCSTR lpDevice) {
     ofc_free(lptDevice);
 }
 
+OFC_CORE_LIB OFC_BOOL
+ofc_path_set_map_cacheW(OFC_LPCTSTR lpDevice, OFC_BOOL enable) {
+    PATH_MAP_ENTRY *pathEntry;
+    OFC_BOOL ret;
+
+    ret = OFC_FALSE;
+    ofc_lock(lockPath);
+    if (lpDevice != OFC_NULL) {
+        pathEntry = ofc_path_find_map(lpDevice, ofc_tstrlen(lpDevice));
+        if (pathEntry != OFC_NULL) {
+            ((_OFC_PATH *) pathEntry->map)->meta_cache = enable;
+            /*
+             * Names already mapped through it carry the old setting
+             */
+            ofc_path_flush_cache();
+            ret = OFC_TRUE;
+        }
+    }
+    ofc_unlock(lockPath);
+    return (ret);
+}
+
+OFC_CORE_LIB OFC_BOOL
+ofc_path_set_map_cacheA(OFC_LPCSTR lpDevice, OFC_BOOL enable) {
+    OFC_TCHAR *lptDevice;
+    OFC_BOOL ret;
+
+    lptDevice = ofc_cstr2tstr(lpDevice);
+    ret = ofc_path_set_map_cacheW(lptDevice, enable);
+    ofc_free(lptDevice);
+    return (ret);
+}
+
 OFC_CORE_LIB OFC_VOID
 ofc_path_get_mapW(OFC_INT idx, OFC_LPCTSTR *lpDevice,
                   OFC_LPCTSTR *lpDesc, OFC_PATH **map,
@@ -1045,17 +1388,11 @@ ofc_path_get_mapW(OFC_INT idx, OFC_LPCTSTR *lpDevice,
 
 OFC_CORE_LIB OFC_PATH *
 ofc_path_map_deviceW(OFC_LPCTSTR lpDevice) {
-    OFC_INT i;
     PATH_MAP_ENTRY *pathEntry;
     OFC_PATH *map;
     OFC_CTCHAR *p;
-    OFC_TCHAR *lc;
     OFC_SIZET len;
-    OFC_LPTSTR tstrDevice;
 
-    /*
-     * Search for a free entry and make sure the device is not already mapped
-     */
     map = OFC_NULL;
     if (lpDevice != OFC_NULL) {
         /*
@@ -1067,26 +1404,12 @@ ofc_path_map_deviceW(OFC_LPCTSTR lpDevice) {
         p = ofc_tstrtok(lpDevice, TSTR(":"));
         len = ((OFC_ULONG_PTR) p - (OFC_ULONG_PTR) lpDevice) /
               sizeof(OFC_TCHAR);
-        tstrDevice = ofc_malloc((len + 1) * sizeof(OFC_TCHAR));
-
-        ofc_tstrncpy(tstrDevice, lpDevice, len);
-        tstrDevice[len] = TCHAR_EOS;
-
-        for (lc = tstrDevice; *lc != TCHAR_EOS; lc++)
-            *lc = OFC_TTOLOWER(*lc);
-
-        pathEntry = OFC_NULL;
-
-        for (i = 0; i < OFC_MAX_MAPS && pathEntry == OFC_NULL; i++) {
-            if (OfcPathMaps[i].lpDevice != OFC_NULL &&
-                ofc_tstrcasecmp(OfcPathMaps[i].lpDevice, tstrDevice) == 0) {
-                pathEntry = &OfcPathMaps[i];
-            }
-        }
 
-        ofc_free(tstrDevice);
+        ofc_lock(lockPath);
+        pathEntry = ofc_path_find_map(lpDevice, len);
         if (pathEntry != OFC_NULL)
             map = pathEntry->map;
+        ofc_unlock(lockPath);
     }
     return (map);
 }
@@ -1255,18 +1578,19 @@ ofc_path_update_credentialsW(OFC_LPCTSTR filename, OFC_LPCTSTR username,
         _map = (_OFC_PATH *) map;
 
         if (_map->username != OFC_NULL)
-            ofc_free(_map->username);
+            ofc_path_free_part(_map, _map->username);
         _map->username = ofc_tstrdup(username);
         if (_map->password != OFC_NULL) {
             ofc_memset(_map->password, '\0',
                        ofc_tstrlen(_map->password) * sizeof(OFC_TCHAR));
-            ofc_free(_map->password);
+            ofc_path_free_part(_map, _map->password);
         }
         _map->password = ofc_tstrdup(password);
         if (_map->domain != OFC_NULL)
-            ofc_free(_map->domain);
+            ofc_path_free_part(_map, _map->domain);
         _map->domain = ofc_tstrdup(domain);
 
+        ofc_path_flush_cache();
         ofc_unlock(lockPath);
     }
 }
@@ -1281,19 +1605,20 @@ ofc_path_update_credentialsW(OFC_PATH *_path, OFC_LPCTSTR username,
   ofc_lock(lockPath) ;
 
   if (path->username != OFC_NULL)
-    ofc_free(path->username) ;
+    ofc_path_free_part(path, path->username) ;
   path->username = ofc_tstrdup (username) ;
   if (path->password != OFC_NULL)
      {
        ofc_memset (path->password, '\0',
            ofc_tstrlen (path->password) * sizeof (OFC_TCHAR)) ;
-       ofc_free(path->password) ;
+       ofc_path_free_part(path, path->password) ;
      }
   path->password = ofc_tstrdup (password) ;
   if (path->domain != OFC_NULL)
-    ofc_free(path->domain) ;
+    ofc_path_free_part(path, path->domain) ;
   path->domain = ofc_tstrdup (domain) ;
 
+  ofc_path_flush_cache() ;
   ofc_unlock (lockPath) ;
 }
 #endif
@@ -1404,6 +1729,12 @@ ofc_path_get_rootA(OFC_CCHAR *lpFileName, OFC_CHAR **lpRoot,
     ofc_free(lptRoot);
 }
 
+OFC_CORE_LIB OFC_BOOL ofc_path_meta_cache(OFC_PATH *_path) {
+    _OFC_PATH *path = (_OFC_PATH *) _path;
+
+    return (path->meta_cache);
+}
+
 OFC_CORE_LIB OFC_BOOL ofc_path_remote(OFC_PATH *_path) {
     _OFC_PATH *path = (_OFC_PATH *) _path;
     OFC_BOOL ret;
@@ -1451,7 +1782,7 @@ OFC_CORE_LIB OFC_VOID ofc_path_set_device(OFC_PATH *_path,
     _OFC_PATH *path = (_OFC_PATH *) _path;
 
     if (path->device != OFC_NULL)
-      ofc_free(path->device);
+      ofc_path_free_part(path, path->device);
     path->device = ofc_tstrdup(device);
 }
 
@@ -1471,7 +1802,7 @@ OFC_CORE_LIB OFC_VOID ofc_path_free_server(OFC_PATH *_path) {
     _OFC_PATH *path = (_OFC_PATH *) _path;
 
     if (path->remote && path->num_dirs > 0) {
-        ofc_free(path->dir[0]);
+        ofc_path_free_part(path, path->dir[0]);
         path->dir[0] = OFC_NULL;
     }
 }
@@ -1485,13 +1816,12 @@ ofc_path_set_server(OFC_PATH *_path, OFC_LPCTSTR server)
     {
       if (path->num_dirs > 0)
         {
-          ofc_free(path->dir[0]);
+          ofc_path_free_part(path, path->dir[0]);
         }
       else
         {
           path->num_dirs++;
-          path->dir = ofc_realloc(path->dir, (path->num_dirs *
-                                              sizeof(OFC_LPCSTR)));
+          ofc_path_resize_dirs(path, path->num_dirs);
         }
       path->dir[0] = ofc_tstrdup(server);
     }
@@ -1503,11 +1833,10 @@ ofc_path_set_share(OFC_PATH *_path, OFC_LPCTSTR share) {
 
     if (path->remote) {
         if (path->num_dirs > 1) {
-            ofc_free(path->dir[1]);
+            ofc_path_free_part(path, path->dir[1]);
         } else {
             path->num_dirs++;
-            path->dir = ofc_realloc(path->dir, (path->num_dirs *
-                                                sizeof(OFC_LPCSTR)));
+            ofc_path_resize_dirs(path, path->num_dirs);
         }
         path->dir[1] = ofc_tstrdup(share);
     }
@@ -1524,11 +1853,10 @@ ofc_path_set_filename(OFC_PATH *_path, OFC_LPCTSTR filename) {
         prefix = 0;
 
     if (path->num_dirs > prefix) {
-        ofc_free(path->dir[path->num_dirs - 1]);
+        ofc_path_free_part(path, path->dir[path->num_dirs - 1]);
     } else {
         path->num_dirs++;
-        path->dir = ofc_realloc(path->dir, (path->num_dirs *
-                                            sizeof(OFC_LPCSTR)));
+        ofc_path_resize_dirs(path, path->num_dirs);
     }
     path->dir[path->num_dirs - 1] = ofc_tstrdup(filename);
 }
@@ -1600,7 +1928,7 @@ OFC_CORE_LIB OFC_VOID ofc_path_set_username(OFC_PATH *_path,
 
     if (path->remote) {
         if (path->username != OFC_NULL)
-            ofc_free(path->username);
+            ofc_path_free_part(path, path->username);
         path->username = ofc_tstrdup(username);
     }
 }
@@ -1640,7 +1968,7 @@ OFC_CORE_LIB OFC_VOID ofc_path_set_password(OFC_PATH *_path,
 
     if (path->remote) {
         if (path->password != OFC_NULL)
-            ofc_free(path->password);
+            ofc_path_free_part(path, path->password);
         path->password = ofc_tstrdup(password);
     }
 }
@@ -1680,7 +2008,7 @@ OFC_CORE_LIB OFC_VOID ofc_path_set_domain(OFC_PATH *_path,
 
     if (path->remote) {
         if (path->domain != OFC_NULL)
-            ofc_free(path->domain);
+            ofc_path_free_part(path, path->domain);
         path->domain = ofc_tstrdup(domain);
     }
 }
@@ -1692,25 +2020,25 @@ OFC_CORE_LIB OFC_LPCTSTR ofc_path_device(OFC_PATH *_path) {
 
 OFC_CORE_LIB OFC_VOID ofc_path_free_device(OFC_PATH *_path) {
     _OFC_PATH *path = (_OFC_PATH *) _path;
-    ofc_free(path->device);
+    ofc_path_free_part(path, path->device);
     path->device = OFC_NULL;
 }
 
 OFC_CORE_LIB OFC_VOID ofc_path_free_username(OFC_PATH *_path) {
     _OFC_PATH *path = (_OFC_PATH *) _path;
-    ofc_free(path->username);
+    ofc_path_free_part(path, path->username);
     path->username = OFC_NULL;
 }
 
 OFC_CORE_LIB OFC_VOID ofc_path_free_password(OFC_PATH *_path) {
     _OFC_PATH *path = (_OFC_PATH *) _path;
-    ofc_free(path->password);
+    ofc_path_free_part(path, path->password);
     path->password = OFC_NULL;
 }
 
 OFC_CORE_LIB OFC_VOID ofc_path_free_domain(OFC_PATH *_path) {
     _OFC_PATH *path = (_OFC_PATH *) _path;
-    ofc_free(path->domain);
+    ofc_path_free_part(path, path->domain);
     path->domain = OFC_NULL;
 }
 
@@ -1722,7 +2050,7 @@ ofc_path_promote_dirs(OFC_PATH *_path, OFC_UINT num_dirs) {
     num_dirs = OFC_MIN (num_dirs, path->num_dirs);
 
     for (i = 0; i < num_dirs; i++) {
-        ofc_free(path->dir[i]);
+        ofc_path_free_part(path, path->dir[i]);
         path->dir[i] = OFC_NULL;
     }
 
@@ -1741,8 +2069,7 @@ OFC_CORE_LIB OFC_VOID ofc_path_insert_dir(OFC_PATH *_path, OFC_UINT ix,
   OFC_UINT i;
 
   path->num_dirs++;
-  path->dir = ofc_realloc(path->dir, (path->num_dirs *
-                                      sizeof(OFC_LPCSTR)));
+  ofc_path_resize_dirs(path, path->num_dirs);
 
   /*
    * Copy from the back
@@ -1805,13 +2132,13 @@ OFC_CORE_LIB OFC_VOID ofc_path_free_filename(OFC_PATH *_path) {
     _OFC_PATH *path = (_OFC_PATH *) _path;
     if (path->remote) {
         if (path->num_dirs > 2) {
-            ofc_free(path->dir[path->num_dirs - 1]);
+            ofc_path_free_part(path, path->dir[path->num_dirs - 1]);
             path->dir[path->num_dirs - 1] = OFC_NULL;
             path->num_dirs--;
         }
     } else {
         if (path->num_dirs > 0) {
-            ofc_free(path->dir[path->num_dirs - 1]);
+            ofc_path_free_part(path, path->dir[path->num_dirs - 1]);
             path->dir[path->num_dirs - 1] = OFC_NULL;
             path->num_dirs--;
         }
@@ -1861,7 +2188,7 @@ OFC_CORE_LIB OFC_VOID ofc_path_free_dirs(OFC_PATH *_path) {
     }
 
     for (ix = jx; ix < path->num_dirs; ix++) {
-        ofc_free(path->dir[ix]);
+        ofc_path_free_part(path, path->dir[ix]);
         path->dir[ix] = OFC_NULL;
     }
 
@@ -1869,7 +2196,7 @@ OFC_CORE_LIB OFC_VOID ofc_path_free_dirs(OFC_PATH *_path) {
         path->num_dirs = jx;
 
     if (path->num_dirs == 0) {
-        ofc_free(path->dir);
+        ofc_path_free_part(path, path->dir);
         path->dir = OFC_NULL;
     }
 }
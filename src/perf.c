@@ -17,6 +17,11 @@
 #include "ofc/event.h"
 #include "ofc/thread.h"
 #include "ofc/lock.h"
+#include "ofc/atomic.h"
+
+#define PERF_QUEUE(l) OFC_IQUEUE_ENTRY(l, struct perf_queue, link)
+#define PERF_RT(l) OFC_IQUEUE_ENTRY(l, struct perf_rt, link)
+#define PERF_COUNTER(l) OFC_IQUEUE_ENTRY(l, struct perf_counter, link)
 
 /*
  * Little's Law Brief
@@ -37,6 +42,10 @@ WIP(packets) = Number of requests = 250
 Average Queue Depth x 1000 = 5000
 Lead(packets) = Queue Basis(ms) / Average Queue Depth x 1000 = 5.06 (s)
 
+The stamps and the queue basis are kept in nanoseconds so that requests
+completing in under a millisecond still contribute to the lead time.
+The statistics report the basis and the lead time in microseconds.
+
 Throughput(packets/sec) = WIP(packets) / Lead(packets) = 49.40 p/sec
 
 Total Byte Count = 256000
@@ -80,9 +89,11 @@ struct perf_measurement *measurement_alloc (OFC_VOID)
     (struct perf_measurement *) ofc_malloc(sizeof(struct perf_measurement));
 
   measurement->nqueues = 0;
-  measurement->queues = ofc_queue_create();
+  ofc_iqueue_init(&measurement->queues);
   measurement->nrts = 0;
-  measurement->rts = ofc_queue_create();
+  ofc_iqueue_init(&measurement->rts);
+  measurement->ncounters = 0;
+  ofc_iqueue_init(&measurement->counters);
   measurement->notify = OFC_HANDLE_NULL;
   measurement->stop = OFC_FALSE;
   measurement->lock = ofc_lock_init();
@@ -94,6 +105,7 @@ OFC_VOID measurement_free(struct perf_measurement *measurement)
 {
   struct perf_queue *queue;
   struct perf_rt *rt;
+  struct perf_counter *counter;
 
   if (measurement->hThread != OFC_HANDLE_NULL)
     {
@@ -102,21 +114,26 @@ OFC_VOID measurement_free(struct perf_measurement *measurement)
       measurement->hThread = OFC_HANDLE_NULL;
     }
 
-  for (queue = ofc_dequeue(measurement->queues);
+  for (queue = PERF_QUEUE(ofc_iqueue_first(&measurement->queues));
        queue != OFC_NULL;
-       queue = ofc_dequeue(measurement->queues))
+       queue = PERF_QUEUE(ofc_iqueue_first(&measurement->queues)))
     {
       perf_queue_destroy(measurement, queue);
     }
-  ofc_queue_destroy(measurement->queues);
-  
-  for (rt = ofc_dequeue(measurement->rts);
+
+  for (rt = PERF_RT(ofc_iqueue_first(&measurement->rts));
        rt != OFC_NULL;
-       rt = ofc_dequeue(measurement->rts))
+       rt = PERF_RT(ofc_iqueue_first(&measurement->rts)))
     {
       perf_rt_destroy(measurement, rt);
     }
-  ofc_queue_destroy(measurement->rts);
+
+  for (counter = PERF_COUNTER(ofc_iqueue_first(&measurement->counters));
+       counter != OFC_NULL;
+       counter = PERF_COUNTER(ofc_iqueue_first(&measurement->counters)))
+    {
+      perf_counter_destroy(measurement, counter);
+    }
   ofc_lock_destroy(measurement->lock);
   ofc_free(measurement);
 }
@@ -141,24 +158,34 @@ OFC_BOOL measurement_start(struct perf_measurement *measurement)
   static OFC_UINT instance = 0;
   struct perf_queue *queue;
   struct perf_rt *rt;
+  struct perf_counter *counter;
 
-  measurement->start_stamp = ofc_time_get_now();
+  measurement->start_stamp = ofc_time_get_ns();
   measurement->stop = OFC_FALSE;
 
-  for (queue = ofc_queue_first(measurement->queues);
+  for (queue = PERF_QUEUE(ofc_iqueue_first(&measurement->queues));
        queue != OFC_NULL;
-       queue = ofc_queue_next(measurement->queues, queue))
+       queue = PERF_QUEUE(ofc_iqueue_next(&measurement->queues,
+                                          &queue->link)))
     {
       perf_queue_reset(queue);
     }
 
-  for (rt = ofc_queue_first(measurement->rts);
+  for (rt = PERF_RT(ofc_iqueue_first(&measurement->rts));
        rt != OFC_NULL;
-       rt = ofc_queue_next(measurement->rts, rt))
+       rt = PERF_RT(ofc_iqueue_next(&measurement->rts, &rt->link)))
     {
       perf_rt_reset(rt);
     }
 
+  for (counter = PERF_COUNTER(ofc_iqueue_first(&measurement->counters));
+       counter != OFC_NULL;
+       counter = PERF_COUNTER(ofc_iqueue_next(&measurement->counters,
+                                              &counter->link)))
+    {
+      perf_counter_reset(counter);
+    }
+
   if (measurement->hThread == OFC_HANDLE_NULL)
     {
       measurement->instance = instance++;
@@ -192,6 +219,7 @@ OFC_BOOL measurement_statistics(struct perf_measurement *measurement)
 {
   struct perf_queue *queue;
   struct perf_rt *rt;
+  struct perf_counter *counter;
   struct perf_statistics statistics;
 
   static char *perf_stats_header =
@@ -221,9 +249,10 @@ OFC_BOOL measurement_statistics(struct perf_measurement *measurement)
 	     "   (pps)  ",
 	     "  (Kbps)  ");
 
-  for (queue = ofc_queue_first(measurement->queues);
+  for (queue = PERF_QUEUE(ofc_iqueue_first(&measurement->queues));
        queue != OFC_NULL;
-       queue = ofc_queue_next(measurement->queues, queue))
+       queue = PERF_QUEUE(ofc_iqueue_next(&measurement->queues,
+                                          &queue->link)))
     {
       perf_queue_statistics(measurement, queue, &statistics);
       perf_statistics_print(&statistics);
@@ -233,9 +262,9 @@ OFC_BOOL measurement_statistics(struct perf_measurement *measurement)
   static char *perf_rt_header = "%13s %11s\n";
   ofc_printf(perf_rt_header, "   Runtime   ", "  runtime ");
   ofc_printf(perf_rt_header, "     Name    ", "   (ms)   ");
-  for (rt = ofc_queue_first(measurement->rts);
+  for (rt = PERF_RT(ofc_iqueue_first(&measurement->rts));
        rt != OFC_NULL;
-       rt = ofc_queue_next(measurement->rts, rt))
+       rt = PERF_RT(ofc_iqueue_next(&measurement->rts, &rt->link)))
     {
       static char *perf_rt_format = "%10.10S:%02d %7d.%03d\n";
 
@@ -244,6 +273,23 @@ OFC_BOOL measurement_statistics(struct perf_measurement *measurement)
 		 rt->instance,
 		 rt->total / 1000, rt->total % 1000);
     }
+  ofc_printf("\n");
+
+  static char *perf_counter_header = "%13s %11s\n";
+  ofc_printf(perf_counter_header, "   Counter   ", "   count   ");
+  ofc_printf(perf_counter_header, "     Name    ", "           ");
+  for (counter = PERF_COUNTER(ofc_iqueue_first(&measurement->counters));
+       counter != OFC_NULL;
+       counter = PERF_COUNTER(ofc_iqueue_next(&measurement->counters,
+                                              &counter->link)))
+    {
+      static char *perf_counter_format = "%10.10S:%02d %11lu\n";
+
+      ofc_printf(perf_counter_format,
+		 counter->description,
+		 counter->instance,
+		 perf_counter_get(counter));
+    }
   return OFC_TRUE;
 }
 
@@ -252,9 +298,10 @@ OFC_VOID measurement_poll(struct perf_measurement *measurement)
   struct perf_queue *queue;
 
   ofc_lock(measurement->lock);
-  for (queue = ofc_queue_first(measurement->queues);
+  for (queue = PERF_QUEUE(ofc_iqueue_first(&measurement->queues));
        queue != OFC_NULL;
-       queue = ofc_queue_next(measurement->queues, queue))
+       queue = PERF_QUEUE(ofc_iqueue_next(&measurement->queues,
+                                          &queue->link)))
     {
       perf_queue_poll(measurement, queue);
     }
@@ -268,13 +315,14 @@ OFC_BOOL measurement_notify(struct perf_measurement *measurement)
 
   if (measurement->stop)
     {
-      for (queue = ofc_queue_first(measurement->queues);
+      for (queue = PERF_QUEUE(ofc_iqueue_first(&measurement->queues));
 	   queue!= OFC_NULL && queue->depth == 0;
-	   queue = ofc_queue_next(measurement->queues, queue));
+	   queue = PERF_QUEUE(ofc_iqueue_next(&measurement->queues,
+					      &queue->link)));
 
       if (queue == OFC_NULL)
 	{
-	  measurement->stop_stamp = ofc_time_get_now();
+	  measurement->stop_stamp = ofc_time_get_ns();
 	  if (measurement->notify != OFC_HANDLE_NULL)
             {
               ofc_event_set(measurement->notify);
@@ -309,7 +357,7 @@ perf_queue_create (struct perf_measurement *measurement,
   queue->instance = instance;
   perf_queue_reset(queue);
 
-  ofc_enqueue (measurement->queues, queue);
+  ofc_iqueue_enqueue (&measurement->queues, &queue->link);
   measurement->nqueues++;
   return (queue);
 }
@@ -317,7 +365,7 @@ perf_queue_create (struct perf_measurement *measurement,
 OFC_VOID perf_queue_destroy(struct perf_measurement *measurement,
 			    struct perf_queue *queue)
 {
-  ofc_queue_unlink (measurement->queues, queue);
+  ofc_iqueue_unlink (&measurement->queues, &queue->link);
   ofc_lock_destroy(queue->lock);
   measurement->nqueues--;
   ofc_free(queue);
@@ -342,7 +390,7 @@ perf_rt_create (struct perf_measurement *measurement,
   rt->instance = instance;
   perf_rt_reset(rt);
 
-  ofc_enqueue (measurement->rts, rt);
+  ofc_iqueue_enqueue (&measurement->rts, &rt->link);
   measurement->nrts++;
   return (rt);
 }
@@ -350,7 +398,7 @@ perf_rt_create (struct perf_measurement *measurement,
 OFC_VOID perf_rt_destroy(struct perf_measurement *measurement,
 			 struct perf_rt *rt)
 {
-  ofc_queue_unlink (measurement->rts, rt);
+  ofc_iqueue_unlink (&measurement->rts, &rt->link);
   measurement->nrts--;
   ofc_free(rt);
 }
@@ -364,6 +412,51 @@ OFC_VOID perf_rt_stop(struct perf_rt *rt)
 {
   rt->total = ofc_get_runtime() - rt->start;
 }
+
+OFC_VOID perf_counter_reset(struct perf_counter *counter)
+{
+  OFC_ATOMIC_STORE(&counter->count, 0);
+}
+
+struct perf_counter *
+perf_counter_create (struct perf_measurement *measurement,
+		     OFC_CTCHAR *description,
+		     OFC_INT instance)
+{
+  struct perf_counter *counter;
+
+  counter = ofc_malloc(sizeof (struct perf_counter));
+
+  counter->description = description;
+  counter->instance = instance;
+  perf_counter_reset(counter);
+
+  ofc_lock(measurement->lock);
+  ofc_iqueue_enqueue (&measurement->counters, &counter->link);
+  measurement->ncounters++;
+  ofc_unlock(measurement->lock);
+  return (counter);
+}
+
+OFC_VOID perf_counter_destroy(struct perf_measurement *measurement,
+			      struct perf_counter *counter)
+{
+  ofc_lock(measurement->lock);
+  ofc_iqueue_unlink (&measurement->counters, &counter->link);
+  measurement->ncounters--;
+  ofc_unlock(measurement->lock);
+  ofc_free(counter);
+}
+
+OFC_VOID perf_counter_add(struct perf_counter *counter, OFC_ULONG count)
+{
+  OFC_ATOMIC_ADD_RELAXED(&counter->count, count);
+}
+
+OFC_ULONG perf_counter_get(struct perf_counter *counter)
+{
+  return (OFC_ATOMIC_LOAD(&counter->count));
+}
 				   
 OFC_VOID perf_statistics_print(struct perf_statistics *statistics)
 {
@@ -390,19 +483,36 @@ OFC_VOID perf_queue_statistics(struct perf_measurement *measurement,
   ofc_lock(queue->lock);
   statistics->description = queue->description;
   statistics->instance = queue->instance;
-  statistics->elapsed_ms = measurement->stop_stamp - measurement->start_stamp;
+  statistics->elapsed_ms = (OFC_LONG)
+    ((measurement->stop_stamp - measurement->start_stamp) / OFC_NS_PER_MS);
   statistics->total_byte_count = queue->total_byte_count;
   statistics->num_requests = queue->num_requests;
-  statistics->avg_packet_size = queue->total_byte_count / queue->num_requests;
+  statistics->avg_packet_size = 0;
+  if (queue->num_requests > 0)
+    statistics->avg_packet_size = queue->total_byte_count /
+      queue->num_requests;
   statistics->depth_samples = queue->depth_samples;
   statistics->total_depth = queue->total_depth;
-  statistics->average_depth_x1000 = (queue->total_depth * 1000) /
-    queue->depth_samples;
-  statistics->basis = queue->basis;
-  statistics->lead_x1000 = (queue->basis * 1000) /
-    statistics->average_depth_x1000 ;
-  statistics->request_throughput = (queue->num_requests * 1000) /
-    statistics->lead_x1000;
+  statistics->average_depth_x1000 = 0;
+  if (queue->depth_samples > 0)
+    statistics->average_depth_x1000 = (queue->total_depth * 1000) /
+      queue->depth_samples;
+  statistics->basis = (OFC_LONG) (queue->basis / OFC_NS_PER_US);
+  /*
+   * The basis is in us, so dividing by the depth x 1000 leaves the lead
+   * time in ms x 1000.  The basis x 1000 passes 32 bits after about two
+   * seconds.
+   */
+  statistics->lead_x1000 = 0;
+  if (statistics->average_depth_x1000 > 0)
+    statistics->lead_x1000 = (OFC_LONG)
+      (((OFC_UINT64) statistics->basis * 1000) /
+       (OFC_UINT64) statistics->average_depth_x1000);
+  statistics->request_throughput = 0;
+  if (statistics->lead_x1000 > 0)
+    statistics->request_throughput = (OFC_LONG)
+      (((OFC_NSTIME) queue->num_requests * 1000 * 1000) /
+       (OFC_NSTIME) statistics->lead_x1000);
   ofc_unlock(queue->lock);
 }
 
@@ -412,7 +522,7 @@ OFC_VOID perf_request_start (struct perf_measurement *measurement,
   ofc_lock(queue->lock);
   if (!measurement->stop)
     {
-      queue->basis -= ofc_time_get_now();
+      queue->basis -= ofc_time_get_ns();
       queue->num_requests++;
       queue->depth++;
     }
@@ -426,7 +536,7 @@ OFC_VOID perf_request_stop (struct perf_measurement *measurement,
   ofc_lock(queue->lock);
   if (queue->depth > 0)
     {
-      queue->basis += ofc_time_get_now();
+      queue->basis += ofc_time_get_ns();
       queue->depth--;
       if (byte_count > 0)
 	queue->total_byte_count += byte_count;
@@ -26,6 +26,7 @@
 #endif
 
 #include "ofc/persist.h"
+#include "ofc/log.h"
 
 #include "ofc/file.h"
 
@@ -585,6 +586,7 @@ ofc_persist_parse_dom(OFC_DOMNode *config_dom) {
                 }
               level = ofc_dom_get_element_cdata_ulong(log_node, "level");
               ofc_persist->log_level = (OFC_UINT) level;
+              ofc_log_set_threshold(ofc_persist->log_level);
             }
         }
 
@@ -1169,6 +1171,7 @@ ofc_persist_init(OFC_VOID) {
             ofc_persist->config_lock = ofc_lock_init();
             ofc_persist->log_level = OFC_LOG_DEFAULT;
             ofc_persist->log_console = OFC_LOG_CONSOLE;
+            ofc_log_set_threshold(OFC_LOG_DEFAULT);
             ofc_persist->loaded = OFC_FALSE;
             ofc_persist->workstation_name = OFC_NULL;
             ofc_persist->workstation_domain = OFC_NULL;
@@ -1216,6 +1219,7 @@ ofc_persist_unload(OFC_VOID) {
 
         ofc_free(ofc_persist);
         ofc_set_config(OFC_NULL);
+        ofc_log_set_threshold(OFC_LOG_DEFAULT);
     }
 }
 
@@ -1728,6 +1732,7 @@ OFC_CORE_LIB OFC_VOID ofc_perist_set_logging(OFC_UINT log_level, OFC_BOOL log_co
       {
         ofc_persist->log_level = log_level;
         ofc_persist->log_console = log_console;
+        ofc_log_set_threshold(log_level);
       }
 }
 
@@ -25,6 +25,9 @@ typedef struct _QUEUE_LINK {
     } u;
 } QUEUE_LINK;
 
+static OFC_SLAB ofc_queue_slab =
+  OFC_SLAB_INIT("Queue Link", sizeof(QUEUE_LINK));
+
 /*
 * Forward declarations
 */
@@ -47,7 +50,7 @@ ofc_queue_create(OFC_VOID) {
     /*
      * Allocate space for the queue head
      */
-    qHead = ofc_malloc(sizeof(QUEUE_LINK));
+    qHead = ofc_slab_alloc(&ofc_queue_slab);
     /*
      * Did we get a head
      */
@@ -94,7 +97,7 @@ ofc_queue_destroy(OFC_HANDLE qHandle) {
             /*
              * Yes, so deallocate it
              */
-            ofc_free(qHead);
+            ofc_slab_free(&ofc_queue_slab, qHead);
             ofc_handle_destroy(qHandle);
         }
         ofc_handle_unlock(qHandle);
@@ -124,7 +127,7 @@ ofc_enqueue(OFC_HANDLE qHandle, OFC_VOID *qElement) {
         /*
          * Allocate a new list element
          */
-        qLink = ofc_malloc(sizeof(QUEUE_LINK));
+        qLink = ofc_slab_alloc(&ofc_queue_slab);
 
         qLink->u.qElement = qElement;
         qLink->qPrev = qHead->qPrev;
@@ -182,7 +185,7 @@ ofc_dequeue(OFC_HANDLE qHandle) {
             /*
              * And get rid of the link
              */
-            ofc_free(qLink);
+            ofc_slab_free(&ofc_queue_slab, qLink);
         }
         if (qHead->qPrev == OFC_NULL)
             ofc_process_crash("queue corruption\n");
@@ -359,7 +362,7 @@ ofc_queue_unlink(OFC_HANDLE qHandle, OFC_VOID *qElement) {
             /*
              * And get rid of the link
              */
-            ofc_free(qLink);
+            ofc_slab_free(&ofc_queue_slab, qLink);
         }
         if (qHead->qPrev == OFC_NULL)
             ofc_process_crash("queue corruption\n");
@@ -411,3 +414,108 @@ ofc_queue_clear(OFC_HANDLE qHandle) {
     for (entry = ofc_dequeue(qHandle); entry != OFC_NULL;
          entry = ofc_dequeue(qHandle));
 }
+
+#if defined(OFC_QUEUE_DEBUG)
+/*
+ * ofc_iqueue_contains - See if a link is on an intrusive queue
+ *
+ * Linear, so only used to validate enqueue and unlink in debug builds
+ */
+static OFC_BOOL
+ofc_iqueue_contains(OFC_IQUEUE *queue, OFC_IQUEUE_LINK *link) {
+    OFC_IQUEUE_LINK *current;
+
+    for (current = queue->head.next;
+         current != &queue->head && current != link;
+         current = current->next);
+    return (current == link);
+}
+#endif
+
+OFC_CORE_LIB OFC_VOID
+ofc_iqueue_init(OFC_IQUEUE *queue) {
+    queue->head.next = &queue->head;
+    queue->head.prev = &queue->head;
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_iqueue_link_init(OFC_IQUEUE_LINK *link) {
+    link->next = OFC_NULL;
+    link->prev = OFC_NULL;
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_iqueue_enqueue(OFC_IQUEUE *queue, OFC_IQUEUE_LINK *link) {
+#if defined(OFC_QUEUE_DEBUG)
+    if (link->next != OFC_NULL || ofc_iqueue_contains(queue, link))
+        ofc_process_crash("Link already queued\n");
+#endif
+    link->next = &queue->head;
+    link->prev = queue->head.prev;
+    queue->head.prev->next = link;
+    queue->head.prev = link;
+}
+
+OFC_CORE_LIB OFC_IQUEUE_LINK *
+ofc_iqueue_dequeue(OFC_IQUEUE *queue) {
+    OFC_IQUEUE_LINK *link;
+
+    link = OFC_NULL;
+    if (queue->head.next != &queue->head) {
+        link = queue->head.next;
+        ofc_iqueue_unlink(queue, link);
+    }
+    return (link);
+}
+
+OFC_CORE_LIB OFC_BOOL
+ofc_iqueue_empty(OFC_IQUEUE *queue) {
+    return (queue->head.next == &queue->head);
+}
+
+OFC_CORE_LIB OFC_IQUEUE_LINK *
+ofc_iqueue_first(OFC_IQUEUE *queue) {
+    OFC_IQUEUE_LINK *link;
+
+    link = queue->head.next;
+    if (link == &queue->head)
+        link = OFC_NULL;
+    return (link);
+}
+
+OFC_CORE_LIB OFC_IQUEUE_LINK *
+ofc_iqueue_next(OFC_IQUEUE *queue, OFC_IQUEUE_LINK *link) {
+    OFC_IQUEUE_LINK *next;
+
+    next = link->next;
+    if (next == &queue->head)
+        next = OFC_NULL;
+    return (next);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_iqueue_unlink(OFC_IQUEUE *queue, OFC_IQUEUE_LINK *link) {
+#if defined(OFC_QUEUE_DEBUG)
+    if (link->next == OFC_NULL || !ofc_iqueue_contains(queue, link))
+        ofc_process_crash("Link not on queue\n");
+#endif
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->next = OFC_NULL;
+    link->prev = OFC_NULL;
+}
+
+OFC_CORE_LIB OFC_BOOL
+ofc_iqueue_linked(OFC_IQUEUE_LINK *link) {
+    return (link->next != OFC_NULL);
+}
+
+OFC_CORE_LIB OFC_VOID *
+ofc_iqueue_entry(OFC_IQUEUE_LINK *link, OFC_SIZET offset) {
+    OFC_VOID *entry;
+
+    entry = OFC_NULL;
+    if (link != OFC_NULL)
+        entry = (OFC_CHAR *) link - offset;
+    return (entry);
+}
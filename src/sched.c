@@ -16,12 +16,33 @@
 #include "ofc/sched.h"
 #include "ofc/event.h"
 #include "ofc/time.h"
+#include "ofc/lock.h"
+#include "ofc/atomic.h"
 #if defined(OFC_PERF_STATS)
 #include "ofc/perf.h"
 #endif
 
 #include "ofc/heap.h"
 
+#if defined(OFC_SCHED_INCREMENTAL) && defined(OFC_PRESELECT_PASS)
+#error "OFC_SCHED_INCREMENTAL cannot be combined with OFC_PRESELECT_PASS"
+#endif
+
+/*
+ * Most events dispatched from a single wake up
+ */
+#if !defined(OFC_SCHED_BATCH)
+#define OFC_SCHED_BATCH 32
+#endif
+
+/*
+ * How much busier, in dispatches per pass scaled by 16, a worker in a
+ * pool must be than an idle one before the idle one takes an app from it
+ */
+#if !defined(OFC_SCHED_STEAL_LOAD)
+#define OFC_SCHED_STEAL_LOAD 32
+#endif
+
 static OFC_DWORD
 ofc_scheduler_loop(OFC_HANDLE hThread, OFC_VOID *context);
 
@@ -29,35 +50,56 @@ ofc_scheduler_loop(OFC_HANDLE hThread, OFC_VOID *context);
 * Define the scheduler data structure
 */
 typedef struct _SCHEDULER {
-    OFC_HANDLE applications;    /* List of applications for this sched */
+    OFC_IQUEUE applications;    /* List of applications for this sched */
     OFC_BOOL quit;        /* does this scheduler want to quit */
     OFC_BOOL significant_event;    /* Is there a significant event */
     OFC_HANDLE hEventSet;        /* The pending read events */
     OFC_HANDLE thread;
     OFC_HANDLE hTriggered;
+    OFC_INT num_triggered;    /* Number of events returned by the wait */
+    OFC_HANDLE triggered[OFC_SCHED_BATCH];    /* Events returned by wait */
 #if defined(OFC_HANDLE_PERF)
-    OFC_MSTIME avg_sleep ;
+    OFC_NSTIME avg_sleep ;
     OFC_UINT32 avg_count ;
 #endif
     OFC_HANDLE hEvent;
 #if defined(OFC_PERF_STATS)
     struct perf_queue *pqueue_poll;
 #endif
+#if defined(OFC_SCHED_INCREMENTAL)
+    OFC_IQUEUE ready;        /* Apps that need a preselect */
+    OFC_LOCK ready_lock;    /* Protects the ready queue */
+#endif
+    /*
+     * Pool support.  A pool is a scheduler with no thread of its own that
+     * routes app requests to its workers.  A worker is an ordinary
+     * scheduler that knows the pool it belongs to.
+     */
+    OFC_HANDLE hPool;        /* Pool this worker belongs to */
+    OFC_INT index;        /* Index of this worker in the pool */
+    OFC_INT num_apps;        /* Number of apps owned */
+    OFC_INT load;        /* Decaying dispatches per pass, times 16 */
+    OFC_INT steal;        /* Index + 1 of a worker wanting an app */
+    OFC_IQUEUE inbox;        /* Apps handed to this worker */
+    OFC_LOCK inbox_lock;    /* Protects the inbox */
+    OFC_INT num_workers;    /* Number of workers if this is a pool */
+    OFC_HANDLE *workers;    /* The workers if this is a pool */
 } SCHEDULER;
 
 static OFC_INT g_instance = 0;
 
-/*
- * ofc_sched_create - Create an application scheduler
+/*
+ * ofc_sched_create_worker - Create a scheduler and its thread
  *
  * Accepts:
- *    Nothing
+ *    hPool - Pool the scheduler belongs to or OFC_HANDLE_NULL
+ *    index - Index of the scheduler within the pool
  *
  * Returns:
  *    Scheduler Context
  */
-OFC_CORE_LIB OFC_HANDLE
-ofc_sched_create(OFC_VOID) {
+static OFC_HANDLE
+ofc_sched_create_worker(OFC_HANDLE hPool, OFC_INT index) {
     SCHEDULER *scheduler;
     OFC_HANDLE hScheduler;
     static OFC_INT instance = 0;
@@ -66,6 +108,15 @@ ofc_sched_create(OFC_VOID) {
      */
     scheduler = ofc_malloc(sizeof(SCHEDULER));
 
+    scheduler->hPool = hPool;
+    scheduler->index = index;
+    scheduler->num_apps = 0;
+    scheduler->load = 0;
+    scheduler->steal = 0;
+    ofc_iqueue_init(&scheduler->inbox);
+    scheduler->inbox_lock = ofc_lock_init();
+    scheduler->num_workers = 0;
+    scheduler->workers = OFC_NULL;
     scheduler->quit = OFC_FALSE;
     scheduler->significant_event = OFC_FALSE;
     scheduler->hEvent = OFC_HANDLE_NULL;
@@ -74,8 +125,13 @@ ofc_sched_create(OFC_VOID) {
 #endif
     scheduler->hEventSet = ofc_waitset_create();
 
-    scheduler->applications = ofc_queue_create();
+    ofc_iqueue_init(&scheduler->applications);
+#if defined(OFC_SCHED_INCREMENTAL)
+    ofc_iqueue_init(&scheduler->ready);
+    scheduler->ready_lock = ofc_lock_init();
+#endif
     scheduler->hTriggered = OFC_HANDLE_NULL;
+    scheduler->num_triggered = 0;
 #if defined(OFC_HANDLE_PERF)
     scheduler->avg_sleep = 0 ;
     scheduler->avg_count = 0 ;
@@ -93,6 +149,217 @@ ofc_sched_create(OFC_VOID) {
     return (hScheduler);
 }
 
+/*
+ * ofc_sched_create - Create an application scheduler
+ *
+ * Accepts:
+ *    Nothing
+ *
+ * Returns:
+ *    Scheduler Context
+ */
+OFC_CORE_LIB OFC_HANDLE
+ofc_sched_create(OFC_VOID) {
+    return (ofc_sched_create_worker(OFC_HANDLE_NULL, 0));
+}
+
+/*
+ * ofc_sched_pool_create - Create a pool of schedulers
+ *
+ * Accepts:
+ *    Number of worker threads
+ *
+ * Returns:
+ *    Handle of the pool.  Used wherever a scheduler handle is.
+ */
+OFC_CORE_LIB OFC_HANDLE
+ofc_sched_pool_create(OFC_INT num_workers) {
+    SCHEDULER *pool;
+    OFC_HANDLE hPool;
+    OFC_INT i;
+
+    if (num_workers < 1)
+        num_workers = 1;
+
+    pool = ofc_malloc(sizeof(SCHEDULER));
+    ofc_memset(pool, '\0', sizeof(SCHEDULER));
+    pool->hPool = OFC_HANDLE_NULL;
+    pool->hEventSet = OFC_HANDLE_NULL;
+    pool->thread = OFC_HANDLE_NULL;
+    pool->hTriggered = OFC_HANDLE_NULL;
+    pool->hEvent = OFC_HANDLE_NULL;
+    pool->inbox_lock = OFC_NULL;
+    ofc_iqueue_init(&pool->applications);
+    ofc_iqueue_init(&pool->inbox);
+    pool->num_workers = num_workers;
+    pool->workers = ofc_malloc(sizeof(OFC_HANDLE) * num_workers);
+    for (i = 0; i < num_workers; i++)
+        pool->workers[i] = OFC_HANDLE_NULL;
+
+    hPool = ofc_handle_create(OFC_HANDLE_SCHED, pool);
+    for (i = 0; i < num_workers; i++)
+        pool->workers[i] = ofc_sched_create_worker(hPool, i);
+
+    return (hPool);
+}
+
+/*
+ * ofc_sched_pool_free - Release a pool once its workers are gone
+ */
+static OFC_VOID
+ofc_sched_pool_free(OFC_HANDLE hPool, SCHEDULER *pool) {
+    ofc_free(pool->workers);
+    ofc_free(pool);
+    ofc_handle_destroy(hPool);
+}
+
+/*
+ * ofc_sched_post - Hand an app to a worker
+ *
+ * The app is linked into the worker's app list by the worker's own thread
+ * the next time around its loop, so an app is only ever run by one thread.
+ */
+static OFC_VOID
+ofc_sched_post(OFC_HANDLE hWorker, OFC_HANDLE hApp) {
+    SCHEDULER *worker;
+
+    worker = ofc_handle_lock(hWorker);
+    if (worker != OFC_NULL) {
+        ofc_app_set_worker(hApp, hWorker);
+        ofc_lock(worker->inbox_lock);
+        ofc_iqueue_enqueue(&worker->inbox, ofc_app_sched_link(hApp));
+        ofc_unlock(worker->inbox_lock);
+        ofc_sched_wake(hWorker);
+        ofc_handle_unlock(hWorker);
+    }
+}
+
+/*
+ * ofc_sched_adopt - Take ownership of apps handed to this worker
+ */
+static OFC_VOID
+ofc_sched_adopt(OFC_HANDLE hScheduler, SCHEDULER *scheduler) {
+    OFC_IQUEUE_LINK *link;
+    OFC_HANDLE hApp;
+
+    ofc_lock(scheduler->inbox_lock);
+    for (link = ofc_iqueue_dequeue(&scheduler->inbox);
+         link != OFC_NULL;
+         link = ofc_iqueue_dequeue(&scheduler->inbox)) {
+        ofc_unlock(scheduler->inbox_lock);
+        hApp = ofc_app_from_sched_link(link);
+        ofc_iqueue_enqueue(&scheduler->applications, link);
+        OFC_ATOMIC_ADD(&scheduler->num_apps, 1);
+        /*
+         * Its events are registered with the old owner, if any, so it
+         * needs a preselect here
+         */
+        ofc_sched_app_event(hScheduler, hApp);
+        ofc_lock(scheduler->inbox_lock);
+    }
+    ofc_unlock(scheduler->inbox_lock);
+}
+
+/*
+ * ofc_sched_unlink_app - Release an app from this scheduler
+ *
+ * Drops its events from our wait set and removes it from our queues.
+ * The caller either destroys the app or hands it to another worker.
+ */
+static OFC_VOID
+ofc_sched_unlink_app(SCHEDULER *scheduler, OFC_HANDLE hApp) {
+    ofc_waitset_clear_app(scheduler->hEventSet, hApp);
+    ofc_iqueue_unlink(&scheduler->applications, ofc_app_sched_link(hApp));
+#if defined(OFC_SCHED_INCREMENTAL)
+    ofc_lock(scheduler->ready_lock);
+    if (ofc_iqueue_linked(ofc_app_ready_link(hApp)))
+        ofc_iqueue_unlink(&scheduler->ready, ofc_app_ready_link(hApp));
+    ofc_unlock(scheduler->ready_lock);
+#endif
+    OFC_ATOMIC_SUB(&scheduler->num_apps, 1);
+}
+
+/*
+ * ofc_sched_balance - Give an app to a worker that asked for one
+ *
+ * Called by a pool worker between passes, when none of its apps are
+ * running, so the app moves with nothing in flight.
+ */
+static OFC_VOID
+ofc_sched_balance(SCHEDULER *scheduler) {
+    SCHEDULER *pool;
+    OFC_INT thief;
+    OFC_IQUEUE_LINK *link;
+    OFC_HANDLE hApp;
+
+    thief = OFC_ATOMIC_XCHG(&scheduler->steal, 0);
+    if (thief != 0 && OFC_ATOMIC_LOAD(&scheduler->num_apps) > 1) {
+        hApp = OFC_HANDLE_NULL;
+        for (link = ofc_iqueue_first(&scheduler->applications);
+             link != OFC_NULL && hApp == OFC_HANDLE_NULL;
+             link = ofc_iqueue_next(&scheduler->applications, link)) {
+            hApp = ofc_app_from_sched_link(link);
+            if (ofc_app_destroying(hApp))
+                hApp = OFC_HANDLE_NULL;
+        }
+
+        pool = ofc_handle_lock(scheduler->hPool);
+        if (pool != OFC_NULL) {
+            if (hApp != OFC_HANDLE_NULL) {
+                /*
+                 * Change owner first so events signalled from now on
+                 * go to the new worker
+                 */
+                ofc_app_set_worker(hApp, pool->workers[thief - 1]);
+                ofc_sched_unlink_app(scheduler, hApp);
+                ofc_sched_post(pool->workers[thief - 1], hApp);
+            }
+            ofc_handle_unlock(scheduler->hPool);
+        }
+    }
+}
+
+/*
+ * ofc_sched_request_steal - Ask the busiest worker for an app
+ *
+ * Called by a pool worker that is about to block.
+ */
+static OFC_VOID
+ofc_sched_request_steal(SCHEDULER *scheduler) {
+    SCHEDULER *pool;
+    SCHEDULER *worker;
+    SCHEDULER *victim;
+    OFC_INT load;
+    OFC_INT i;
+    OFC_INT none;
+
+    pool = ofc_handle_lock(scheduler->hPool);
+    if (pool != OFC_NULL) {
+        victim = OFC_NULL;
+        load = OFC_ATOMIC_LOAD(&scheduler->load) + OFC_SCHED_STEAL_LOAD;
+        for (i = 0; i < pool->num_workers; i++) {
+            worker = ofc_handle_lock(pool->workers[i]);
+            if (worker != OFC_NULL) {
+                if (worker != scheduler &&
+                    OFC_ATOMIC_LOAD(&worker->num_apps) > 1 &&
+                    OFC_ATOMIC_LOAD(&worker->load) > load) {
+                    if (victim != OFC_NULL)
+                        ofc_handle_unlock(pool->workers[victim->index]);
+                    victim = worker;
+                    load = OFC_ATOMIC_LOAD(&worker->load);
+                } else
+                    ofc_handle_unlock(pool->workers[i]);
+            }
+        }
+        if (victim != OFC_NULL) {
+            none = 0;
+            OFC_ATOMIC_CAS(&victim->steal, &none, scheduler->index + 1);
+            ofc_handle_unlock(pool->workers[victim->index]);
+        }
+        ofc_handle_unlock(scheduler->hPool);
+    }
+}
+
 /*
  * ofc_sched_quit - See if the scheduler is supposed to quit
  *
@@ -106,13 +373,20 @@ OFC_CORE_LIB OFC_BOOL
 ofc_sched_quit(OFC_HANDLE hScheduler) {
     SCHEDULER *scheduler;
     OFC_BOOL ret;
+    OFC_INT i;
 
     scheduler = ofc_handle_lock(hScheduler);
     ret = OFC_FALSE;
     if (scheduler != OFC_NULL) {
-        ofc_thread_delete(scheduler->thread);
-        ofc_sched_wake(hScheduler);
-        ofc_thread_wait(scheduler->thread);
+        if (scheduler->workers != OFC_NULL) {
+            for (i = 0; i < scheduler->num_workers; i++)
+                ofc_sched_quit(scheduler->workers[i]);
+            ofc_sched_pool_free(hScheduler, scheduler);
+        } else {
+            ofc_thread_delete(scheduler->thread);
+            ofc_sched_wake(hScheduler);
+            ofc_thread_wait(scheduler->thread);
+        }
         ofc_handle_unlock(hScheduler);
         ret = OFC_TRUE;
     }
@@ -123,9 +397,14 @@ ofc_sched_quit(OFC_HANDLE hScheduler) {
 OFC_CORE_LIB OFC_VOID
 ofc_sched_join(OFC_HANDLE hScheduler) {
     SCHEDULER *scheduler;
+    OFC_INT i;
 
     scheduler = ofc_handle_lock(hScheduler);
-    if (scheduler != OFC_NULL) {
+    if (scheduler != OFC_NULL && scheduler->workers != OFC_NULL) {
+        for (i = 0; i < scheduler->num_workers; i++)
+            ofc_sched_join(scheduler->workers[i]);
+        ofc_handle_unlock(hScheduler);
+    } else if (scheduler != OFC_NULL) {
         if (scheduler->hEvent == OFC_HANDLE_NULL)
             scheduler->hEvent = ofc_event_create(OFC_EVENT_AUTO);
 
@@ -142,12 +421,19 @@ OFC_CORE_LIB OFC_BOOL
 ofc_sched_kill(OFC_HANDLE hScheduler) {
     SCHEDULER *scheduler;
     OFC_BOOL ret;
+    OFC_INT i;
 
     scheduler = ofc_handle_lock(hScheduler);
     ret = OFC_FALSE;
     if (scheduler != OFC_NULL) {
-        ofc_thread_delete(scheduler->thread);
-        ofc_sched_join(hScheduler);
+        if (scheduler->workers != OFC_NULL) {
+            for (i = 0; i < scheduler->num_workers; i++)
+                ofc_sched_kill(scheduler->workers[i]);
+            ofc_sched_pool_free(hScheduler, scheduler);
+        } else {
+            ofc_thread_delete(scheduler->thread);
+            ofc_sched_join(hScheduler);
+        }
         ofc_handle_unlock(hScheduler);
         ret = OFC_TRUE;
     }
@@ -155,6 +441,51 @@ ofc_sched_kill(OFC_HANDLE hScheduler) {
     return (ret);
 }
 
+#if defined(OFC_SCHED_INCREMENTAL)
+/*
+ * ofc_sched_preselect - Preselect the applications that are ready
+ *
+ * Accepts:
+ *    Scheduler
+ *
+ * Returns:
+ *    Nothing
+ *
+ * Registrations persist in the wait set so only apps that have signalled
+ * an event need to be looked at.  This will also clean up applications
+ * being deleted
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_sched_preselect(OFC_HANDLE hScheduler) {
+    SCHEDULER *scheduler;
+    OFC_HANDLE hApp;
+    OFC_IQUEUE_LINK *link;
+
+    scheduler = ofc_handle_lock(hScheduler);
+    if (scheduler != OFC_NULL) {
+        scheduler->significant_event = OFC_FALSE;
+
+        ofc_lock(scheduler->ready_lock);
+        for (link = ofc_iqueue_dequeue(&scheduler->ready);
+             link != OFC_NULL;
+             link = ofc_iqueue_dequeue(&scheduler->ready)) {
+            /*
+             * Let the app signal again while we're working on it
+             */
+            ofc_unlock(scheduler->ready_lock);
+            hApp = ofc_app_from_ready_link(link);
+            if (ofc_app_destroying(hApp)) {
+                ofc_sched_unlink_app(scheduler, hApp);
+                ofc_app_destroy(hApp);
+            } else
+                ofc_app_preselect(hApp);
+            ofc_lock(scheduler->ready_lock);
+        }
+        ofc_unlock(scheduler->ready_lock);
+        ofc_handle_unlock(hScheduler);
+    }
+}
+#else
 /*
  * ofc_sched_preselect - Preselect all the applications
  *
@@ -170,6 +501,8 @@ OFC_CORE_LIB OFC_VOID
 ofc_sched_preselect(OFC_HANDLE hScheduler) {
     SCHEDULER *scheduler;
     OFC_HANDLE hApp;
+    OFC_IQUEUE_LINK *link;
+    OFC_IQUEUE_LINK *next;
 
     scheduler = ofc_handle_lock(hScheduler);
     if (scheduler != OFC_NULL) {
@@ -181,8 +514,14 @@ ofc_sched_preselect(OFC_HANDLE hScheduler) {
          * Go through all the apps until there are no more or someone
          * set a significant event
          */
-        for (hApp = (OFC_HANDLE) ofc_queue_first(scheduler->applications);
-             (hApp != OFC_HANDLE_NULL);) {
+        for (link = ofc_iqueue_first(&scheduler->applications);
+             link != OFC_NULL; link = next) {
+            /*
+             * Only the scheduler unlinks apps, so the next link is
+             * still valid after this one is destroyed
+             */
+            next = ofc_iqueue_next(&scheduler->applications, link);
+            hApp = ofc_app_from_sched_link(link);
             /*
              * See if we want to destroy this app
              */
@@ -190,19 +529,12 @@ ofc_sched_preselect(OFC_HANDLE hScheduler) {
                 /*
                  * Yes, remove it from the scheduler list
                  */
-                ofc_waitset_clear_app(scheduler->hEventSet, hApp);
-                ofc_queue_unlink(scheduler->applications, (OFC_VOID *) hApp);
+                ofc_sched_unlink_app(scheduler, hApp);
                 /*
                  * Destroy the application
                  */
                 ofc_app_destroy(hApp);
-                /*
-                 * And force another scheduler pass
-                 */
-                hApp = (OFC_HANDLE) ofc_queue_first(scheduler->applications);
-            } else
-                hApp = (OFC_HANDLE) ofc_queue_next(scheduler->applications,
-                                                   (OFC_VOID *) hApp);
+            }
         }
 
         /*
@@ -215,22 +547,22 @@ ofc_sched_preselect(OFC_HANDLE hScheduler) {
          */
         ofc_waitset_clear(scheduler->hEventSet);
 
-        for (hApp = (OFC_HANDLE) ofc_queue_first(scheduler->applications);
-             (hApp != OFC_HANDLE_NULL);) {
-            ofc_app_preselect(hApp);
+        for (link = ofc_iqueue_first(&scheduler->applications);
+             link != OFC_NULL;) {
+            ofc_app_preselect(ofc_app_from_sched_link(link));
 #if defined(OFC_PRESELECT_PASS)
             if (scheduler->significant_event) {
                 scheduler->significant_event = OFC_FALSE;
-                hApp = (OFC_HANDLE) ofc_queue_first(scheduler->applications);
+                link = ofc_iqueue_first(&scheduler->applications);
                 ofc_waitset_clear(scheduler->hEventSet);
             } else
 #endif
-                hApp = (OFC_HANDLE) ofc_queue_next(scheduler->applications,
-                                                   (OFC_VOID *) hApp);
+                link = ofc_iqueue_next(&scheduler->applications, link);
         }
         ofc_handle_unlock(hScheduler);
     }
 }
+#endif
 
 /*
  * ofc_sched_postselect - Process any triggered events
@@ -245,6 +577,8 @@ OFC_CORE_LIB OFC_VOID
 ofc_sched_postselect(OFC_HANDLE hScheduler) {
     OFC_HANDLE hApp;
     SCHEDULER *scheduler;
+    OFC_INT i;
+    OFC_INT dispatched;
 
     scheduler = ofc_handle_lock(hScheduler);
     if (scheduler != OFC_NULL) {
@@ -255,31 +589,47 @@ ofc_sched_postselect(OFC_HANDLE hScheduler) {
         scheduler->significant_event = OFC_FALSE;
 #endif
 
-        while (scheduler->hTriggered != OFC_HANDLE_NULL) {
-            hApp = ofc_handle_get_app(scheduler->hTriggered);
-            if (hApp != OFC_HANDLE_NULL) {
-                scheduler->hTriggered =
-                        ofc_app_postselect(hApp, scheduler->hTriggered);
+        /*
+         * Drain every event from the wait before waiting again.  An event
+         * whose app was destroyed by an earlier dispatch no longer has an
+         * app and is skipped.
+         */
+        dispatched = 0;
+        for (i = 0; i < scheduler->num_triggered; i++) {
+            scheduler->hTriggered = scheduler->triggered[i];
+            while (scheduler->hTriggered != OFC_HANDLE_NULL) {
+                hApp = ofc_handle_get_app(scheduler->hTriggered);
+                if (hApp != OFC_HANDLE_NULL) {
+                    scheduler->hTriggered =
+                            ofc_app_postselect(hApp, scheduler->hTriggered);
+                    dispatched++;
 #if !defined(OFC_PRESELECT_PASS)
-                if (ofc_app_destroying(hApp)) {
-                    /*
-                     * Yes, remove it from the scheduler list
-                     */
-                    ofc_waitset_clear_app(scheduler->hEventSet, hApp);
-                    ofc_queue_unlink(scheduler->applications, (OFC_VOID *) hApp);
+                    if (ofc_app_destroying(hApp)) {
+                        /*
+                         * Yes, remove it from the scheduler list
+                         */
+                        ofc_sched_unlink_app(scheduler, hApp);
+                        /*
+                         * Destroy the application
+                         */
+                        ofc_app_destroy(hApp);
+                    } else
+                        ofc_app_preselect(hApp);
+#endif
+                } else
                     /*
-                     * Destroy the application
+                     * No one waiting on that handle yet, so can't schedule it.
                      */
-                    ofc_app_destroy(hApp);
-                } else
-                    ofc_app_preselect(hApp);
-#endif
-            } else
-                /*
-                 * No one waiting on that handle yet, so can't schedule it.
-                 */
-                scheduler->hTriggered = OFC_HANDLE_NULL;
+                    scheduler->hTriggered = OFC_HANDLE_NULL;
+            }
         }
+        scheduler->num_triggered = 0;
+        /*
+         * Keep a decaying measure of how busy we are for the pool
+         */
+        OFC_ATOMIC_STORE(&scheduler->load,
+                         scheduler->load - (scheduler->load >> 3) +
+                         (dispatched << 1));
         ofc_handle_unlock(hScheduler);
     }
 }
@@ -294,29 +644,41 @@ OFC_CORE_LIB OFC_VOID
 ofc_sched_wait(OFC_HANDLE hScheduler) {
     SCHEDULER *scheduler;
 #if defined(OFC_HANDLE_PERF)
-    OFC_MSTIME sleep ;
-    OFC_MSTIME slept ;
+    OFC_NSTIME sleep ;
+    OFC_NSTIME slept ;
+    OFC_INT i ;
 #endif
 
     scheduler = ofc_handle_lock(hScheduler);
     if (scheduler != OFC_NULL) {
         scheduler->hTriggered = OFC_HANDLE_NULL;
+        scheduler->num_triggered = 0;
+        if (!scheduler->significant_event && scheduler->hPool != OFC_HANDLE_NULL)
+            ofc_sched_request_steal(scheduler);
         if (!scheduler->significant_event) {
             /*
              * Wait for an event (preselect set up the events to wait for)
              */
 #if defined(OFC_HANDLE_PERF)
-            sleep = ofc_time_get_now() ;
+            sleep = ofc_time_get_ns() ;
 #endif
 #if defined(OFC_PERF_STATS)
             perf_request_start(g_measurement, scheduler->pqueue_poll);
 #endif
-            scheduler->hTriggered = ofc_waitset_wait(scheduler->hEventSet);
+            scheduler->num_triggered =
+                    ofc_waitset_wait_many(scheduler->hEventSet,
+                                          scheduler->triggered,
+                                          OFC_SCHED_BATCH);
 #if defined(OFC_PERF_STATS)
             perf_request_stop(g_measurement, scheduler->pqueue_poll, 1);
 #endif
+            /*
+             * The wait may have been long.  Refresh the coarse clock for
+             * the handlers we are about to dispatch.
+             */
+            ofc_time_update_coarse_ns();
 #if defined(OFC_HANDLE_PERF)
-            slept = ofc_time_get_now() - sleep ;
+            slept = ofc_time_get_coarse_ns() - sleep ;
             if (slept > scheduler->avg_sleep)
               scheduler->avg_sleep +=
                 ((slept - scheduler->avg_sleep) /
@@ -326,7 +688,8 @@ ofc_sched_wait(OFC_HANDLE hScheduler) {
                 ((scheduler->avg_sleep - slept) /
                  (scheduler->avg_count + 1)) ;
             scheduler->avg_count++ ;
-            ofc_handle_measure (scheduler->hTriggered) ;
+            for (i = 0 ; i < scheduler->num_triggered ; i++)
+              ofc_handle_measure (scheduler->triggered[i]) ;
 #endif
         }
         ofc_handle_unlock(hScheduler);
@@ -341,7 +704,8 @@ OFC_VOID ofc_sched_log_measure (OFC_HANDLE hScheduler)
   scheduler = ofc_handle_lock (hScheduler) ;
   if (scheduler != OFC_NULL)
     {
-      ofc_printf ("Average Sleep Time: %lu ms\n", scheduler->avg_sleep) ;
+      ofc_printf ("Average Sleep Time: %lu us\n",
+                  (OFC_ULONG) (scheduler->avg_sleep / OFC_NS_PER_US)) ;
 
       ofc_waitset_log_measure (scheduler->hEventSet) ;
 
@@ -362,28 +726,37 @@ OFC_VOID ofc_sched_log_measure (OFC_HANDLE hScheduler)
 OFC_CORE_LIB OFC_VOID
 ofc_sched_destroy(OFC_HANDLE hScheduler) {
     OFC_HANDLE hApp;
+    OFC_IQUEUE_LINK *link;
     SCHEDULER *scheduler;
 
     scheduler = ofc_handle_lock(hScheduler);
-    if (scheduler != OFC_NULL) {
+    if (scheduler != OFC_NULL && scheduler->workers != OFC_NULL) {
+        ofc_sched_pool_free(hScheduler, scheduler);
+        ofc_handle_unlock(hScheduler);
+    } else if (scheduler != OFC_NULL) {
         if (scheduler->hEvent != OFC_HANDLE_NULL)
             ofc_event_set(scheduler->hEvent);
+        /*
+         * Take on anything still being handed to us so it's destroyed too
+         */
+        ofc_sched_adopt(hScheduler, scheduler);
         /*
          * Dequeue all the applications and destroy them
          */
-        for (hApp = (OFC_HANDLE) ofc_dequeue(scheduler->applications);
-             hApp != OFC_HANDLE_NULL;
-             hApp = (OFC_HANDLE) ofc_dequeue(scheduler->applications)) {
+        for (link = ofc_iqueue_dequeue(&scheduler->applications);
+             link != OFC_NULL;
+             link = ofc_iqueue_dequeue(&scheduler->applications)) {
             /*
              * Destroy the app
              */
+            hApp = ofc_app_from_sched_link(link);
             ofc_waitset_clear_app(scheduler->hEventSet, hApp);
             ofc_app_destroy(hApp);
         }
-        /*
-         * Get rid of the applications list
-         */
-        ofc_queue_destroy(scheduler->applications);
+#if defined(OFC_SCHED_INCREMENTAL)
+        ofc_lock_destroy(scheduler->ready_lock);
+#endif
+        ofc_lock_destroy(scheduler->inbox_lock);
         /*
          * And get rid of the scheduler
          */
@@ -399,22 +772,24 @@ ofc_sched_destroy(OFC_HANDLE hScheduler) {
 
 OFC_CORE_LIB OFC_VOID
 ofc_sched_kill_all(OFC_HANDLE hScheduler) {
-    OFC_HANDLE hApp;
+    OFC_IQUEUE_LINK *link;
     SCHEDULER *scheduler;
+    OFC_INT i;
 
     scheduler = ofc_handle_lock(hScheduler);
     if (scheduler != OFC_NULL) {
+        for (i = 0; i < scheduler->num_workers; i++)
+            ofc_sched_kill_all(scheduler->workers[i]);
         /*
          * Dequeue all the applications and destroy them
          */
-        for (hApp = (OFC_HANDLE) ofc_queue_first(scheduler->applications);
-             hApp != OFC_HANDLE_NULL;
-             hApp = (OFC_HANDLE) ofc_queue_next(scheduler->applications,
-                                                (OFC_VOID *) hApp)) {
+        for (link = ofc_iqueue_first(&scheduler->applications);
+             link != OFC_NULL;
+             link = ofc_iqueue_next(&scheduler->applications, link)) {
             /*
              * Destroy the app
              */
-            ofc_app_kill(hApp);
+            ofc_app_kill(ofc_app_from_sched_link(link));
         }
     }
 }
@@ -431,14 +806,62 @@ ofc_sched_kill_all(OFC_HANDLE hScheduler) {
 OFC_CORE_LIB OFC_VOID
 ofc_sched_significant_event(OFC_HANDLE hScheduler) {
     SCHEDULER *scheduler;
+    OFC_INT i;
 
     scheduler = ofc_handle_lock(hScheduler);
     if (scheduler != OFC_NULL) {
+        for (i = 0; i < scheduler->num_workers; i++)
+            ofc_sched_significant_event(scheduler->workers[i]);
         scheduler->significant_event = OFC_TRUE;
         ofc_handle_unlock(hScheduler);
     }
 }
 
+/*
+ * ofc_sched_app_event - Schedule a significant event for one app
+ *
+ * Accepts:
+ *    Scheduler Handle
+ *    Handle of app with the event
+ *
+ * Returns:
+ *    nothing
+ */
+OFC_CORE_LIB OFC_VOID
+ofc_sched_app_event(OFC_HANDLE hScheduler, OFC_HANDLE hApp) {
+    SCHEDULER *scheduler;
+#if defined(OFC_SCHED_INCREMENTAL)
+    OFC_IQUEUE_LINK *link;
+    OFC_HANDLE hOwner;
+#endif
+
+    scheduler = ofc_handle_lock(hScheduler);
+    if (scheduler != OFC_NULL) {
+        if (scheduler->workers != OFC_NULL)
+            ofc_sched_app_event(ofc_app_get_worker(hApp), hApp);
+        else {
+#if defined(OFC_SCHED_INCREMENTAL)
+            link = ofc_app_ready_link(hApp);
+            hOwner = hScheduler;
+            if (link != OFC_NULL) {
+                /*
+                 * The app may have moved to another pool worker
+                 */
+                ofc_lock(scheduler->ready_lock);
+                hOwner = ofc_app_get_worker(hApp);
+                if (hOwner == hScheduler && !ofc_iqueue_linked(link))
+                    ofc_iqueue_enqueue(&scheduler->ready, link);
+                ofc_unlock(scheduler->ready_lock);
+            }
+            if (hOwner != hScheduler)
+                ofc_sched_app_event(hOwner, hApp);
+#endif
+            scheduler->significant_event = OFC_TRUE;
+        }
+        ofc_handle_unlock(hScheduler);
+    }
+}
+
 /*
  * ofc_sched_add - Add an application to the scheduler list
  *
@@ -452,10 +875,42 @@ ofc_sched_significant_event(OFC_HANDLE hScheduler) {
 OFC_CORE_LIB OFC_VOID
 ofc_sched_add(OFC_HANDLE hScheduler, OFC_HANDLE hApp) {
     SCHEDULER *scheduler;
+    SCHEDULER *worker;
+    OFC_INT i;
+    OFC_INT best;
+    OFC_INT fewest;
 
     scheduler = ofc_handle_lock(hScheduler);
-    if (scheduler != OFC_NULL) {
-        ofc_enqueue(scheduler->applications, (OFC_VOID *) hApp);
+    if (scheduler != OFC_NULL && scheduler->workers != OFC_NULL) {
+        /*
+         * Give it to the worker with the fewest apps
+         */
+        best = 0;
+        fewest = -1;
+        for (i = 0; i < scheduler->num_workers; i++) {
+            worker = ofc_handle_lock(scheduler->workers[i]);
+            if (worker != OFC_NULL) {
+                if (fewest < 0 ||
+                    OFC_ATOMIC_LOAD(&worker->num_apps) < fewest) {
+                    fewest = OFC_ATOMIC_LOAD(&worker->num_apps);
+                    best = i;
+                }
+                ofc_handle_unlock(scheduler->workers[i]);
+            }
+        }
+        ofc_sched_post(scheduler->workers[best], hApp);
+        ofc_handle_unlock(hScheduler);
+    } else if (scheduler != OFC_NULL) {
+        ofc_app_set_worker(hApp, hScheduler);
+        ofc_iqueue_enqueue(&scheduler->applications,
+                           ofc_app_sched_link(hApp));
+        OFC_ATOMIC_ADD(&scheduler->num_apps, 1);
+#if defined(OFC_SCHED_INCREMENTAL)
+        /*
+         * A new app needs its first preselect
+         */
+        ofc_sched_app_event(hScheduler, hApp);
+#endif
         ofc_handle_unlock(hScheduler);
     }
 }
@@ -469,9 +924,14 @@ ofc_sched_add(OFC_HANDLE hScheduler, OFC_HANDLE hApp) {
 OFC_CORE_LIB OFC_VOID
 ofc_sched_wake(OFC_HANDLE hScheduler) {
     SCHEDULER *scheduler;
+    OFC_INT i;
 
     scheduler = ofc_handle_lock(hScheduler);
-    if (scheduler != OFC_NULL) {
+    if (scheduler != OFC_NULL && scheduler->workers != OFC_NULL) {
+        for (i = 0; i < scheduler->num_workers; i++)
+            ofc_sched_wake(scheduler->workers[i]);
+        ofc_handle_unlock(hScheduler);
+    } else if (scheduler != OFC_NULL) {
         ofc_sched_significant_event(hScheduler);
         ofc_waitset_wake(scheduler->hEventSet);
         ofc_handle_unlock(hScheduler);
@@ -483,8 +943,15 @@ ofc_sched_clear_wait(OFC_HANDLE hScheduler, OFC_HANDLE hApp) {
     SCHEDULER *scheduler;
 
     scheduler = ofc_handle_lock(hScheduler);
-    if (scheduler != OFC_NULL) {
-        ofc_waitset_clear_app(scheduler->hEventSet, hApp);
+    if (scheduler != OFC_NULL && scheduler->workers != OFC_NULL) {
+        ofc_sched_clear_wait(ofc_app_get_worker(hApp), hApp);
+        ofc_handle_unlock(hScheduler);
+    } else if (scheduler != OFC_NULL) {
+        /*
+         * In incremental mode, events the app re-adds before the next
+         * wait stay registered with the platform
+         */
+        ofc_waitset_clear_app_deferred(scheduler->hEventSet, hApp);
         ofc_handle_unlock(hScheduler);
     }
 }
@@ -494,7 +961,10 @@ ofc_sched_add_wait(OFC_HANDLE hScheduler, OFC_HANDLE hApp, OFC_HANDLE hEvent) {
     SCHEDULER *scheduler;
 
     scheduler = ofc_handle_lock(hScheduler);
-    if (scheduler != OFC_NULL) {
+    if (scheduler != OFC_NULL && scheduler->workers != OFC_NULL) {
+        ofc_sched_add_wait(ofc_app_get_worker(hApp), hApp, hEvent);
+        ofc_handle_unlock(hScheduler);
+    } else if (scheduler != OFC_NULL) {
         ofc_waitset_add(scheduler->hEventSet, hApp, hEvent);
         ofc_handle_unlock(hScheduler);
     }
@@ -503,9 +973,15 @@ ofc_sched_add_wait(OFC_HANDLE hScheduler, OFC_HANDLE hApp, OFC_HANDLE hEvent) {
 OFC_CORE_LIB OFC_VOID
 ofc_sched_remove_wait(OFC_HANDLE hScheduler, OFC_HANDLE hEvent) {
     SCHEDULER *scheduler;
+    OFC_HANDLE hApp;
 
     scheduler = ofc_handle_lock(hScheduler);
-    if (scheduler != OFC_NULL) {
+    if (scheduler != OFC_NULL && scheduler->workers != OFC_NULL) {
+        hApp = ofc_handle_get_app(hEvent);
+        if (hApp != OFC_HANDLE_NULL)
+            ofc_sched_remove_wait(ofc_app_get_worker(hApp), hEvent);
+        ofc_handle_unlock(hScheduler);
+    } else if (scheduler != OFC_NULL) {
         ofc_waitset_remove(scheduler->hEventSet, hEvent);
         ofc_handle_unlock(hScheduler);
     }
@@ -527,9 +1003,11 @@ ofc_scheduler_loop(OFC_HANDLE hThread, OFC_VOID *context) {
     scheduler = ofc_handle_lock(hScheduler);
 
     while (!ofc_thread_is_deleting(hThread)) {
+        ofc_time_update_coarse_ns();
 #if defined(OFC_PERF_STATS)
       perf_rt_start(perf_rt_sched);
 #endif
+        ofc_sched_adopt(hScheduler, scheduler);
 #if defined(OFC_PRESELECT_PASS)
         /*
          * Do a preselect path
@@ -547,6 +1025,8 @@ ofc_scheduler_loop(OFC_HANDLE hThread, OFC_VOID *context) {
          * And do a post select pas
          */
         ofc_sched_postselect(hScheduler);
+        if (scheduler->hPool != OFC_HANDLE_NULL)
+            ofc_sched_balance(scheduler);
 #if defined(OFC_PERF_STATS)
         perf_rt_stop(perf_rt_sched);
 #endif
@@ -564,11 +1044,18 @@ OFC_CORE_LIB OFC_BOOL
 ofc_sched_empty(OFC_HANDLE hScheduler) {
     SCHEDULER *scheduler;
     OFC_BOOL ret;
+    OFC_INT i;
 
     ret = OFC_FALSE;
     scheduler = ofc_handle_lock(hScheduler);
-    if (scheduler != OFC_NULL) {
-        if (ofc_queue_empty(scheduler->applications))
+    if (scheduler != OFC_NULL && scheduler->workers != OFC_NULL) {
+        ret = OFC_TRUE;
+        for (i = 0; i < scheduler->num_workers && ret; i++)
+            ret = ofc_sched_empty(scheduler->workers[i]);
+        ofc_handle_unlock(hScheduler);
+    } else if (scheduler != OFC_NULL) {
+        if (ofc_iqueue_empty(&scheduler->applications) &&
+            OFC_ATOMIC_LOAD(&scheduler->num_apps) == 0)
             ret = OFC_TRUE;
         ofc_handle_unlock(hScheduler);
     }
@@ -580,7 +1067,7 @@ OFC_CORE_LIB OFC_VOID
 ofc_sched_dump (OFC_HANDLE hScheduler)
 {
   SCHEDULER *scheduler ;
-  OFC_HANDLE hApp ;
+  OFC_IQUEUE_LINK *link ;
 
   scheduler = ofc_handle_lock (hScheduler) ;
   if (scheduler != OFC_NULL)
@@ -593,13 +1080,12 @@ ofc_sched_dump (OFC_HANDLE hScheduler)
       /*
        * Go through all the apps until there are no more or someone
        */
-      for (hApp = (OFC_HANDLE) ofc_queue_first (scheduler->applications) ;
-       hApp != OFC_HANDLE_NULL ;
-       hApp = (OFC_HANDLE) ofc_queue_next (scheduler->applications,
-                       (OFC_VOID *) hApp))
+      for (link = ofc_iqueue_first (&scheduler->applications) ;
+       link != OFC_NULL ;
+       link = ofc_iqueue_next (&scheduler->applications, link))
 
     {
-      ofc_app_dump (hApp) ;
+      ofc_app_dump (ofc_app_from_sched_link (link)) ;
     }
       ofc_handle_unlock (hScheduler) ;
     }
@@ -13,11 +13,48 @@
 #include "ofc/libc.h"
 #include "ofc/impl/socketimpl.h"
 #include "ofc/process.h"
+#include "ofc/file.h"
+#include "ofc/thread.h"
 
 #include "ofc/heap.h"
 
 #define OFC_SCOPE_ALGORITHM
 
+/*
+ * Most segments of a message we hand to the platform in one send.  Without
+ * a vectored send the platform takes one segment at a time.
+ */
+#if defined(OFC_SOCKET_SENDV)
+#if !defined(OFC_SOCKET_SENDV_MAX)
+#define OFC_SOCKET_SENDV_MAX 64
+#endif
+#define SOCKET_SEND_IOVEC_MAX OFC_SOCKET_SENDV_MAX
+#else
+#define SOCKET_SEND_IOVEC_MAX 1
+#endif
+
+/*
+ * Likewise for a receive.  A scatter receive lets a header land in one
+ * segment and the payload in another.
+ */
+#if defined(OFC_SOCKET_RECVV)
+#if !defined(OFC_SOCKET_RECVV_MAX)
+#define OFC_SOCKET_RECVV_MAX 16
+#endif
+#define SOCKET_RECV_IOVEC_MAX OFC_SOCKET_RECVV_MAX
+#else
+#define SOCKET_RECV_IOVEC_MAX 1
+#endif
+
+/*
+ * Most datagrams taken in one batched receive, and the most segments
+ * each of them may be scattered across
+ */
+#if !defined(OFC_SOCKET_RECV_BATCH_MAX)
+#define OFC_SOCKET_RECV_BATCH_MAX 16
+#endif
+#define SOCKET_BATCH_IOVEC_MAX 4
+
 /*
 * Forward Delcarations
 */
@@ -438,9 +475,9 @@ ofc_socket_write(OFC_HANDLE hSocket, OFC_MESSAGE *msg)
   OFC_SIZET nbytes;
   OFC_SOCKET *socket;
   OFC_BOOL progress;
-  OFC_SIZET count;
   OFC_SIZET len;
-  OFC_VOID *ptr;
+  OFC_IOVEC iovec[SOCKET_SEND_IOVEC_MAX];
+  OFC_INT veclen;
 
   socket = ofc_handle_lock(hSocket);
   nbytes = 0;
@@ -454,29 +491,47 @@ ofc_socket_write(OFC_HANDLE hSocket, OFC_MESSAGE *msg)
       len = 0;
       if (msg->count > 0)
         {
-          OFC_IOVEC *iovec;
-          OFC_INT veclen;
           /*
-           * Yes, so try to send it
+           * Yes, so try to send it.  Describe the unsent part of the
+           * message in place, without allocating.
+           */
+          veclen = ofc_iovec_fill(msg->map, msg->offset,
+                                  msg->offset + msg->count,
+                                  iovec, SOCKET_SEND_IOVEC_MAX);
+#if defined(OFC_SOCKET_SENDV)
+          /*
+           * The whole message, or as much of it as fits in iovec, in one
+           * call
            */
-          ofc_iovec_get(msg->map, msg->offset, msg->offset + msg->count,
-                        &iovec, &veclen);
-          ptr = iovec[0].iov_base;
-          count = OFC_MIN(msg->count, iovec[0].iov_len);
-          ofc_free(iovec);
-
           if (socket->type == SOCKET_TYPE_STREAM)
             {
-              len = ofc_socket_impl_send(socket->impl, ptr, count);
+              len = ofc_socket_impl_sendv(socket->impl, iovec, veclen,
+                                          OFC_NULL, 0);
             }
           else if (socket->type == SOCKET_TYPE_DGRAM ||
                    socket->type == SOCKET_TYPE_ICMP)
+            {
+              len = ofc_socket_impl_sendv(socket->impl, iovec, veclen,
+                                          &msg->ip, msg->port);
+            }
+#else
+          if (veclen > 0 && socket->type == SOCKET_TYPE_STREAM)
+            {
+              len = ofc_socket_impl_send(socket->impl,
+                                         iovec[0].iov_base,
+                                         iovec[0].iov_len);
+            }
+          else if (veclen > 0 &&
+                   (socket->type == SOCKET_TYPE_DGRAM ||
+                    socket->type == SOCKET_TYPE_ICMP))
             {
               len = ofc_socket_impl_sendto(socket->impl,
-                                           ptr, count,
+                                           iovec[0].iov_base,
+                                           iovec[0].iov_len,
                                            &msg->ip,
                                            msg->port);
             }
+#endif
 
           if ((len < 0) ||
               ((socket->type == SOCKET_TYPE_DGRAM) && (len == 0)))
@@ -508,7 +563,144 @@ ofc_socket_write(OFC_HANDLE hSocket, OFC_MESSAGE *msg)
     return (progress);
 }
 
-/*
+OFC_CORE_LIB OFC_SENDFILE *
+ofc_socket_sendfile_create(OFC_HANDLE hFile, OFC_OFFT offset,
+                           OFC_SIZET count) {
+    OFC_SENDFILE *xfer;
+
+    xfer = ofc_malloc(sizeof(OFC_SENDFILE));
+    xfer->hFile = hFile;
+    xfer->offset = offset;
+    xfer->count = count;
+    xfer->failed = OFC_FALSE;
+#if defined(OFC_SOCKET_SENDFILE)
+    xfer->fd = OfcFileGetDescriptor(hFile);
+#else
+    xfer->fd = -1;
+#endif
+    xfer->buffer = OFC_NULL;
+    xfer->buffered = 0;
+    xfer->sent = 0;
+    return (xfer);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_socket_sendfile_destroy(OFC_SENDFILE *xfer) {
+    ofc_free(xfer->buffer);
+    ofc_free(xfer);
+}
+
+/*
+ * Move a file's position and return the new one.  A position whose low
+ * word is all ones looks like OFC_INVALID_SET_FILE_POINTER, so the last
+ * error is cleared first to tell the two apart.
+ */
+static OFC_BOOL
+ofc_socket_sendfile_seek(OFC_HANDLE hFile, OFC_OFFT offset,
+                         OFC_DWORD dwMoveMethod, OFC_OFFT *pos) {
+    OFC_LONG high;
+    OFC_DWORD low;
+    OFC_BOOL ret;
+
+    high = (OFC_LONG) (offset >> 32);
+    ofc_thread_set_variable(OfcLastError, (OFC_DWORD_PTR) OFC_ERROR_SUCCESS);
+    low = OfcSetFilePointer(hFile, (OFC_LONG) (offset & 0xFFFFFFFF),
+                            &high, dwMoveMethod);
+    ret = (low != OFC_INVALID_SET_FILE_POINTER ||
+           OfcGetLastError() == OFC_ERROR_SUCCESS);
+    if (ret && pos != OFC_NULL)
+        *pos = ((OFC_OFFT) high << 32) | low;
+    return (ret);
+}
+
+/*
+ * Read the next chunk of the file into the transfer's buffer.  Like the
+ * platform's sendfile, this reads at the transfer's offset and leaves the
+ * file's position where it was.
+ */
+static OFC_BOOL
+ofc_socket_sendfile_fill(OFC_SENDFILE *xfer) {
+    OFC_OFFT pos;
+    OFC_DWORD len;
+    OFC_BOOL ret;
+
+    if (xfer->buffer == OFC_NULL)
+        xfer->buffer = ofc_malloc(OFC_SOCKET_SENDFILE_CHUNK);
+
+    ret = OFC_FALSE;
+    if (xfer->buffer != OFC_NULL &&
+        ofc_socket_sendfile_seek(xfer->hFile, 0, OFC_FILE_CURRENT, &pos) &&
+        ofc_socket_sendfile_seek(xfer->hFile, xfer->offset, OFC_FILE_BEGIN,
+                                 OFC_NULL)) {
+        len = 0;
+        ret = OfcReadFile(xfer->hFile, xfer->buffer,
+                          (OFC_DWORD) OFC_MIN(xfer->count,
+                                              OFC_SOCKET_SENDFILE_CHUNK),
+                          &len, OFC_HANDLE_NULL);
+        /*
+         * The file ending early is an error too
+         */
+        if (len == 0)
+            ret = OFC_FALSE;
+        xfer->buffered = len;
+        xfer->sent = 0;
+        if (!ofc_socket_sendfile_seek(xfer->hFile, pos, OFC_FILE_BEGIN,
+                                      OFC_NULL))
+            ret = OFC_FALSE;
+    }
+    return (ret);
+}
+
+OFC_CORE_LIB OFC_BOOL
+ofc_socket_sendfile(OFC_HANDLE hSocket, OFC_SENDFILE *xfer) {
+    OFC_SOCKET *socket;
+    OFC_SIZET len;
+    OFC_BOOL progress;
+
+    progress = OFC_FALSE;
+    socket = ofc_handle_lock(hSocket);
+    if (socket != OFC_NULL) {
+        if (xfer->count > 0) {
+            len = -1;
+            if (socket->type != SOCKET_TYPE_STREAM)
+                ;
+#if defined(OFC_SOCKET_SENDFILE)
+            else if (xfer->fd >= 0)
+                len = ofc_socket_impl_sendfile(socket->impl, xfer->fd,
+                                               xfer->offset,
+                                               OFC_MIN(xfer->count,
+                                                       OFC_SOCKET_SENDFILE_CHUNK));
+#endif
+            else if (xfer->sent < xfer->buffered ||
+                     ofc_socket_sendfile_fill(xfer)) {
+                len = ofc_socket_impl_send(socket->impl,
+                                           xfer->buffer + xfer->sent,
+                                           xfer->buffered - xfer->sent);
+                if (len > 0)
+                    xfer->sent += len;
+            }
+
+            if (len < 0) {
+                ofc_log(OFC_LOG_WARN,
+                        "Socket Error on sendfile, type %d, count %d\n",
+                        socket->type, (OFC_INT) xfer->count);
+                /*
+                 * Force the transfer to retire
+                 */
+                xfer->count = 0;
+                xfer->failed = OFC_TRUE;
+            } else if (len > 0) {
+                progress = OFC_TRUE;
+                xfer->offset += len;
+                xfer->count -= len;
+            }
+        }
+        ofc_handle_unlock(hSocket);
+    }
+    return (progress);
+}
+
+/*
  * SOCKET_read - Read data from a socket
  *
  * Accepts:
@@ -523,6 +715,8 @@ ofc_socket_read(OFC_HANDLE hSocket, OFC_MESSAGE *msg) {
     OFC_SOCKET *socket;
     OFC_SIZET len;
     OFC_BOOL progress;
+    OFC_IOVEC iovec[SOCKET_RECV_IOVEC_MAX];
+    OFC_INT veclen;
 
     socket = ofc_handle_lock(hSocket);
     progress = OFC_FALSE;
@@ -531,23 +725,42 @@ ofc_socket_read(OFC_HANDLE hSocket, OFC_MESSAGE *msg) {
         if (msg->count > 0)
           {
             /*
-             * Yes, so try to receive it.
+             * Yes, so try to receive it.  Describe the unfilled part of
+             * the message, which may span several segments.
              */
-            OFC_UCHAR *ptr;
-            ptr = ofc_iovec_lookup(msg->map, msg->offset, msg->count);
-            if (socket->type == SOCKET_TYPE_STREAM)
+            veclen = ofc_iovec_fill(msg->map, msg->offset,
+                                    msg->offset + msg->count,
+                                    iovec, SOCKET_RECV_IOVEC_MAX);
+#if defined(OFC_SOCKET_RECVV)
+            if (veclen > 0 && socket->type == SOCKET_TYPE_STREAM)
+              {
+                len = ofc_socket_impl_recvv(socket->impl, iovec, veclen,
+                                            OFC_NULL, OFC_NULL);
+                msg->ip = socket->ip;
+                msg->port = socket->port;
+            } else if (veclen > 0 &&
+                       (socket->type == SOCKET_TYPE_DGRAM ||
+                        socket->type == SOCKET_TYPE_ICMP)) {
+                len = ofc_socket_impl_recvv(socket->impl, iovec, veclen,
+                                            &msg->ip, &msg->port);
+            }
+#else
+            if (veclen > 0 && socket->type == SOCKET_TYPE_STREAM)
               {
-                len = ofc_socket_impl_recv(socket->impl, ptr,
-                                           msg->count);
+                len = ofc_socket_impl_recv(socket->impl,
+                                           iovec[0].iov_base,
+                                           iovec[0].iov_len);
                 msg->ip = socket->ip;
                 msg->port = socket->port;
-            } else if (socket->type == SOCKET_TYPE_DGRAM ||
-                       socket->type == SOCKET_TYPE_ICMP) {
+            } else if (veclen > 0 &&
+                       (socket->type == SOCKET_TYPE_DGRAM ||
+                        socket->type == SOCKET_TYPE_ICMP)) {
                 len = ofc_socket_impl_recv_from(socket->impl,
-                                                ptr,
-                                                msg->count,
+                                                iovec[0].iov_base,
+                                                iovec[0].iov_len,
                                                 &msg->ip, &msg->port);
             }
+#endif
         }
 
         if (len > 0) {
@@ -564,6 +777,66 @@ ofc_socket_read(OFC_HANDLE hSocket, OFC_MESSAGE *msg) {
     return (progress);
 }
 
+/*
+ * ofc_socket_read_batch - Receive several datagrams in one call
+ *
+ * Accepts:
+ *    hSocket - Datagram socket to read from
+ *    msgs - Messages to receive into, one datagram each
+ *    count - Number of messages
+ *
+ * Returns:
+ *    Number of messages, from the front of the array, that received a
+ *    datagram, or -1 if the receive failed
+ */
+OFC_CORE_LIB OFC_INT
+ofc_socket_read_batch(OFC_HANDLE hSocket, OFC_MESSAGE **msgs, OFC_INT count) {
+    OFC_INT received;
+#if defined(OFC_SOCKET_RECV_BATCH)
+    OFC_SOCKET *socket;
+    OFC_SOCKET_DATAGRAM dgrams[OFC_SOCKET_RECV_BATCH_MAX];
+    OFC_IOVEC iovec[OFC_SOCKET_RECV_BATCH_MAX][SOCKET_BATCH_IOVEC_MAX];
+    OFC_INT i;
+    OFC_INT batch;
+
+    received = 0;
+    socket = ofc_handle_lock(hSocket);
+    if (socket != OFC_NULL) {
+        if (socket->type == SOCKET_TYPE_DGRAM ||
+            socket->type == SOCKET_TYPE_ICMP) {
+            batch = OFC_MIN(count, OFC_SOCKET_RECV_BATCH_MAX);
+            for (i = 0; i < batch; i++) {
+                dgrams[i].iovec = iovec[i];
+                dgrams[i].veclen =
+                        ofc_iovec_fill(msgs[i]->map, msgs[i]->offset,
+                                       msgs[i]->offset + msgs[i]->count,
+                                       iovec[i], SOCKET_BATCH_IOVEC_MAX);
+                dgrams[i].len = 0;
+            }
+            received = ofc_socket_impl_recv_batch(socket->impl, dgrams,
+                                                  batch);
+            for (i = 0; i < received; i++) {
+                msgs[i]->ip = dgrams[i].ip;
+                msgs[i]->port = dgrams[i].port;
+                msgs[i]->offset += dgrams[i].len;
+                msgs[i]->count -= dgrams[i].len;
+                if (msgs[i]->count < 0)
+                    ofc_process_crash("here\n");
+            }
+        }
+        ofc_handle_unlock(hSocket);
+    }
+#else
+    /*
+     * One receive per datagram until the socket runs dry
+     */
+    for (received = 0;
+         received < count && ofc_socket_read(hSocket, msgs[received]);
+         received++);
+#endif
+    return (received);
+}
+
 OFC_CORE_LIB OFC_HANDLE
 ofc_socket_get_impl(OFC_HANDLE hSocket) {
     OFC_SOCKET *sock;
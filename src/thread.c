@@ -12,6 +12,7 @@
 #include "ofc/impl/threadimpl.h"
 #include "ofc/file.h"
 #include "ofc/libc.h"
+#include "ofc/heap.h"
 
 OFC_CORE_LIB OFC_HANDLE
 ofc_thread_create(OFC_DWORD(scheduler)(OFC_HANDLE hThread,
@@ -89,6 +90,12 @@ ofc_thread_create_local_storage(OFC_VOID) {
 
 OFC_CORE_LIB OFC_VOID
 ofc_thread_destroy_local_storage(OFC_VOID) {
+    /*
+     * Return any objects cached by this thread to the heap and give up
+     * its trace ring
+     */
+    ofc_heap_thread_exit();
+    ofc_trace_thread_exit();
     ofc_thread_destroy_local_storage_impl();
 }
 
@@ -11,8 +11,20 @@
 #include "ofc/time.h"
 #include "ofc/perf.h"
 #include "ofc/event.h"
+#include "ofc/atomic.h"
 #include "ofc/impl/timeimpl.h"
 
+#if !defined(OFC_TIME_NS_IMPL) && \
+  (defined(__linux__) || defined(__APPLE__) || defined(__unix__))
+#include <time.h>
+#define OFC_TIME_NS_MONOTONIC
+#endif
+
+/*
+ * The coarse clock of each thread.  Zero until the first refresh.
+ */
+static OFC_THREAD_LOCAL OFC_NSTIME ofc_time_coarse_ns = 0;
+
 #if defined(OFC_64BIT_INTEGER)
 
 OFC_VOID epoch_time_to_file_time(const OFC_ULONG tv_sec,
@@ -129,6 +141,39 @@ ofc_time_get_now(OFC_VOID) {
     return (ofc_time_get_now_impl());
 }
 
+OFC_CORE_LIB OFC_NSTIME
+ofc_time_get_ns(OFC_VOID) {
+#if defined(OFC_TIME_NS_IMPL)
+    return (ofc_time_get_ns_impl());
+#elif defined(OFC_TIME_NS_MONOTONIC)
+    struct timespec ts;
+
+    /*
+     * On Linux this is a vDSO call and never enters the kernel
+     */
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((OFC_NSTIME) ts.tv_sec * OFC_NS_PER_SEC + (OFC_NSTIME) ts.tv_nsec);
+#else
+    return ((OFC_NSTIME) (OFC_UINT32) ofc_time_get_now_impl() * OFC_NS_PER_MS);
+#endif
+}
+
+OFC_CORE_LIB OFC_NSTIME
+ofc_time_get_coarse_ns(OFC_VOID) {
+    OFC_NSTIME now;
+
+    now = ofc_time_coarse_ns;
+    if (now == 0)
+        now = ofc_time_update_coarse_ns();
+    return (now);
+}
+
+OFC_CORE_LIB OFC_NSTIME
+ofc_time_update_coarse_ns(OFC_VOID) {
+    ofc_time_coarse_ns = ofc_time_get_ns();
+    return (ofc_time_coarse_ns);
+}
+
 OFC_CORE_LIB OFC_VOID
 ofc_time_get_file_time(OFC_FILETIME *filetime) {
     ofc_time_get_file_time_impl(filetime);
@@ -10,22 +10,487 @@
 #include "ofc/timer.h"
 #include "ofc/handle.h"
 #include "ofc/time.h"
+#include "ofc/queue.h"
+#include "ofc/atomic.h"
+#include "ofc/libc.h"
+#include "ofc/thread.h"
 #include "ofc/heap.h"
 
+/*
+ * Timer Wheel
+ *
+ * Timers that are members of a wait set are kept on that wait set's
+ * hierarchical timing wheel so the platform does not have to scan every
+ * timer to find the next timeout or the expired ones.
+ *
+ * The wheel runs in milliseconds.  The first level has 256 one
+ * millisecond slots.  Each of the four levels above it has 64 slots, each
+ * slot spanning all of the level below, so the wheel covers the full 32
+ * bit millisecond range.  A timer is placed in the lowest level whose
+ * span covers its expiration and is cascaded down a level each time the
+ * level below wraps.  Arm and cancel are O(1).
+ *
+ * Expirations are rounded up to OFC_TIMER_WHEEL_GRAIN milliseconds so
+ * timers that expire close together fire on the same wake up.
+ *
+ * Timers keep their expiration on the monotonic nanosecond clock when
+ * there are 64 bit integers to hold it.  The wheel's milliseconds are
+ * that clock divided down, so a timer and its wheel never disagree about
+ * what time it is.  A 32 bit nanosecond count wraps every four seconds,
+ * so without 64 bit integers both stay on the millisecond clock.
+ *
+ * A timer holds a reference on the wheel it is associated with, and only
+ * the timer's own calls change that association.  Destroying the wheel
+ * disarms its timers and drops the owner's reference.  The memory goes
+ * when the last timer lets go, so a timer being set or destroyed never
+ * locks a wheel that has been freed under it.
+ *
+ * Each level keeps a bitmap of occupied slots.  The next expiry is found
+ * from the bitmaps without visiting any timers.  For the upper levels it
+ * is the time at which the next occupied slot cascades, which is never
+ * later than the timers in it.
+ */
+#if !defined(OFC_TIMER_WHEEL_GRAIN)
+#define OFC_TIMER_WHEEL_GRAIN 4
+#endif
+
+#define WHEEL_ROOT_BITS 8
+#define WHEEL_ROOT_SIZE (1 << WHEEL_ROOT_BITS)
+#define WHEEL_ROOT_MASK (WHEEL_ROOT_SIZE - 1)
+#define WHEEL_LEVEL_BITS 6
+#define WHEEL_LEVEL_SIZE (1 << WHEEL_LEVEL_BITS)
+#define WHEEL_LEVEL_MASK (WHEEL_LEVEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_SHIFT(level) (WHEEL_ROOT_BITS + (level) * WHEEL_LEVEL_BITS)
+
+struct ofc_timer_wheel {
+    OFC_SPINLOCK lock;
+    OFC_INT refs;        /* The owner's and one per associated timer */
+    OFC_BOOL destroyed;        /* Owner has destroyed the wheel */
+    OFC_UINT32 now;        /* Millisecond the wheel has run up to */
+    OFC_INT count;        /* Number of armed timers */
+    OFC_IQUEUE root[WHEEL_ROOT_SIZE];
+    OFC_UINT64 root_map[WHEEL_ROOT_SIZE / 64];
+    OFC_IQUEUE level[WHEEL_LEVELS][WHEEL_LEVEL_SIZE];
+    OFC_UINT64 level_map[WHEEL_LEVELS];
+};
+
+#if defined(OFC_64BIT_INTEGER)
+typedef OFC_NSTIME TIMER_TIME;
+#define TIMER_PER_MS OFC_NS_PER_MS
+#define ofc_timer_clock() ofc_time_get_ns()
+#else
+typedef OFC_MSTIME TIMER_TIME;
+#define TIMER_PER_MS 1
+#define ofc_timer_clock() ofc_time_get_now()
+#endif
+
 typedef struct {
-    OFC_MSTIME expiration_time;
+    TIMER_TIME expiration_time;
     OFC_CCHAR *id;
+    OFC_HANDLE hTimer;        /* Our own handle */
+    OFC_TIMER_WHEEL *wheel;    /* Wheel we belong to, if any */
+    OFC_IQUEUE *slot;        /* Slot we are armed in, if any */
+    OFC_UINT32 expires;        /* Expiration rounded to the wheel grain */
+    OFC_IQUEUE_LINK link;    /* Link on the slot */
 } OFC_TIMER;
 
+static OFC_SLAB ofc_timer_slab = OFC_SLAB_INIT("Timer", sizeof(OFC_TIMER));
+
+static OFC_UINT32
+ofc_timer_wheel_now(OFC_VOID) {
+    return ((OFC_UINT32) (ofc_timer_clock() / TIMER_PER_MS));
+}
+
+static OFC_INT
+ofc_timer_wheel_ffs(OFC_UINT64 map) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (__builtin_ctzll(map));
+#else
+    OFC_INT bit;
+
+    for (bit = 0; (map & 1) == 0; bit++)
+        map >>= 1;
+    return (bit);
+#endif
+}
+
+/*
+ * Find the first occupied root slot at or after index, not wrapping
+ */
+static OFC_INT
+ofc_timer_wheel_root_next(OFC_TIMER_WHEEL *wheel, OFC_INT index) {
+    OFC_INT word;
+    OFC_UINT64 map;
+    OFC_INT ret;
+
+    ret = -1;
+    word = index >> 6;
+    map = wheel->root_map[word] & (~(OFC_UINT64) 0 << (index & 63));
+    while (ret < 0 && word < WHEEL_ROOT_SIZE / 64) {
+        if (map != 0)
+            ret = (word << 6) + ofc_timer_wheel_ffs(map);
+        else if (++word < WHEEL_ROOT_SIZE / 64)
+            map = wheel->root_map[word];
+    }
+    return (ret);
+}
+
+static OFC_VOID
+ofc_timer_wheel_insert(OFC_TIMER_WHEEL *wheel, OFC_TIMER *pTimer) {
+    OFC_UINT32 delta;
+    OFC_INT index;
+    OFC_INT level;
+
+    if ((OFC_INT32) (pTimer->expires - wheel->now) < 0)
+        /*
+         * Already expired.  Fire on the next run.
+         */
+        delta = 0;
+    else
+        delta = pTimer->expires - wheel->now;
+
+    if (delta < WHEEL_ROOT_SIZE) {
+        index = (delta == 0 ? wheel->now : pTimer->expires) & WHEEL_ROOT_MASK;
+        pTimer->slot = &wheel->root[index];
+        wheel->root_map[index >> 6] |= (OFC_UINT64) 1 << (index & 63);
+    } else {
+        for (level = 0; level < WHEEL_LEVELS - 1 &&
+                        delta >= (OFC_UINT32) 1 << WHEEL_SHIFT(level + 1);
+             level++);
+        index = (pTimer->expires >> WHEEL_SHIFT(level)) & WHEEL_LEVEL_MASK;
+        pTimer->slot = &wheel->level[level][index];
+        wheel->level_map[level] |= (OFC_UINT64) 1 << index;
+    }
+    ofc_iqueue_enqueue(pTimer->slot, &pTimer->link);
+}
+
+static OFC_VOID
+ofc_timer_wheel_unlink(OFC_TIMER_WHEEL *wheel, OFC_TIMER *pTimer) {
+    OFC_IQUEUE *slot;
+    OFC_INT index;
+    OFC_INT level;
+
+    slot = pTimer->slot;
+    ofc_iqueue_unlink(slot, &pTimer->link);
+    pTimer->slot = OFC_NULL;
+    if (ofc_iqueue_empty(slot)) {
+        if (slot >= &wheel->root[0] && slot < &wheel->root[WHEEL_ROOT_SIZE]) {
+            index = (OFC_INT) (slot - &wheel->root[0]);
+            wheel->root_map[index >> 6] &= ~((OFC_UINT64) 1 << (index & 63));
+        } else {
+            level = (OFC_INT) ((slot - &wheel->level[0][0]) / WHEEL_LEVEL_SIZE);
+            index = (OFC_INT) ((slot - &wheel->level[0][0]) % WHEEL_LEVEL_SIZE);
+            wheel->level_map[level] &= ~((OFC_UINT64) 1 << index);
+        }
+    }
+}
+
+/*
+ * Move the timers of an upper level slot down now that its span is near
+ */
+static OFC_INT
+ofc_timer_wheel_cascade(OFC_TIMER_WHEEL *wheel, OFC_INT level) {
+    OFC_INT index;
+    OFC_IQUEUE *slot;
+    OFC_IQUEUE_LINK *link;
+    OFC_TIMER *pTimer;
+
+    index = (wheel->now >> WHEEL_SHIFT(level)) & WHEEL_LEVEL_MASK;
+    slot = &wheel->level[level][index];
+    for (link = ofc_iqueue_first(slot); link != OFC_NULL;
+         link = ofc_iqueue_first(slot)) {
+        pTimer = OFC_IQUEUE_ENTRY(link, OFC_TIMER, link);
+        ofc_timer_wheel_unlink(wheel, pTimer);
+        ofc_timer_wheel_insert(wheel, pTimer);
+    }
+    return (index);
+}
+
+/*
+ * Drop a reference on a wheel, freeing it with the last
+ */
+static OFC_VOID
+ofc_timer_wheel_release(OFC_TIMER_WHEEL *wheel) {
+    if (OFC_ATOMIC_SUB(&wheel->refs, 1) == 0)
+        ofc_free(wheel);
+}
+
+/*
+ * Disassociate a timer from its wheel.  The caller holds the wheel lock
+ * and releases the timer's reference once it has dropped it.
+ */
+static OFC_VOID
+ofc_timer_wheel_detach_locked(OFC_TIMER_WHEEL *wheel, OFC_TIMER *pTimer) {
+    if (pTimer->slot != OFC_NULL) {
+        ofc_timer_wheel_unlink(wheel, pTimer);
+        wheel->count--;
+    }
+    pTimer->wheel = OFC_NULL;
+}
+
+OFC_CORE_LIB OFC_TIMER_WHEEL *
+ofc_timer_wheel_create(OFC_VOID) {
+    OFC_TIMER_WHEEL *wheel;
+    OFC_INT i;
+    OFC_INT level;
+
+    wheel = ofc_malloc(sizeof(OFC_TIMER_WHEEL));
+    wheel->lock = 0;
+    wheel->refs = 1;
+    wheel->destroyed = OFC_FALSE;
+    wheel->now = ofc_timer_wheel_now();
+    wheel->count = 0;
+    for (i = 0; i < WHEEL_ROOT_SIZE; i++)
+        ofc_iqueue_init(&wheel->root[i]);
+    for (i = 0; i < WHEEL_ROOT_SIZE / 64; i++)
+        wheel->root_map[i] = 0;
+    for (level = 0; level < WHEEL_LEVELS; level++) {
+        for (i = 0; i < WHEEL_LEVEL_SIZE; i++)
+            ofc_iqueue_init(&wheel->level[level][i]);
+        wheel->level_map[level] = 0;
+    }
+    return (wheel);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_timer_wheel_destroy(OFC_TIMER_WHEEL *wheel) {
+    OFC_INT i;
+    OFC_INT level;
+    OFC_IQUEUE_LINK *link;
+    OFC_TIMER *pTimer;
+
+    /*
+     * Disarm the timers but leave them associated.  They let go of the
+     * wheel the next time they are set, canceled or destroyed.
+     */
+    OFC_SPINLOCK_LOCK(&wheel->lock);
+    wheel->destroyed = OFC_TRUE;
+    for (i = 0; i < WHEEL_ROOT_SIZE; i++) {
+        for (link = ofc_iqueue_dequeue(&wheel->root[i]); link != OFC_NULL;
+             link = ofc_iqueue_dequeue(&wheel->root[i])) {
+            pTimer = OFC_IQUEUE_ENTRY(link, OFC_TIMER, link);
+            pTimer->slot = OFC_NULL;
+        }
+    }
+    for (level = 0; level < WHEEL_LEVELS; level++) {
+        for (i = 0; i < WHEEL_LEVEL_SIZE; i++) {
+            for (link = ofc_iqueue_dequeue(&wheel->level[level][i]);
+                 link != OFC_NULL;
+                 link = ofc_iqueue_dequeue(&wheel->level[level][i])) {
+                pTimer = OFC_IQUEUE_ENTRY(link, OFC_TIMER, link);
+                pTimer->slot = OFC_NULL;
+            }
+        }
+    }
+    OFC_SPINLOCK_UNLOCK(&wheel->lock);
+    ofc_timer_wheel_release(wheel);
+}
+
+/*
+ * Arm a timer on the wheel it is associated with.  The caller holds the
+ * wheel lock.
+ */
+static OFC_VOID
+ofc_timer_wheel_arm_locked(OFC_TIMER_WHEEL *wheel, OFC_TIMER *pTimer) {
+    if (pTimer->slot != OFC_NULL) {
+        ofc_timer_wheel_unlink(wheel, pTimer);
+        wheel->count--;
+    }
+    if (wheel->count == 0)
+        /*
+         * Nothing to run through.  Catch up with the clock.
+         */
+        wheel->now = ofc_timer_wheel_now();
+    pTimer->expires = ((OFC_UINT32) ((pTimer->expiration_time +
+                                      TIMER_PER_MS - 1) / TIMER_PER_MS) +
+                       OFC_TIMER_WHEEL_GRAIN - 1) &
+                      ~((OFC_UINT32) OFC_TIMER_WHEEL_GRAIN - 1);
+    ofc_timer_wheel_insert(wheel, pTimer);
+    wheel->count++;
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_timer_wheel_arm(OFC_TIMER_WHEEL *wheel, OFC_HANDLE hTimer) {
+    OFC_TIMER *pTimer;
+    OFC_TIMER_WHEEL *old;
+
+    pTimer = ofc_handle_lock(hTimer);
+    if (pTimer != OFC_NULL) {
+        old = pTimer->wheel;
+        if (old != OFC_NULL && old != wheel) {
+            /*
+             * Moving from another wheel
+             */
+            OFC_SPINLOCK_LOCK(&old->lock);
+            ofc_timer_wheel_detach_locked(old, pTimer);
+            OFC_SPINLOCK_UNLOCK(&old->lock);
+            ofc_timer_wheel_release(old);
+        }
+        OFC_SPINLOCK_LOCK(&wheel->lock);
+        if (pTimer->wheel != wheel) {
+            OFC_ATOMIC_ADD(&wheel->refs, 1);
+            pTimer->wheel = wheel;
+        }
+        ofc_timer_wheel_arm_locked(wheel, pTimer);
+        OFC_SPINLOCK_UNLOCK(&wheel->lock);
+        ofc_handle_unlock(hTimer);
+    }
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_timer_wheel_cancel(OFC_TIMER_WHEEL *wheel, OFC_HANDLE hTimer) {
+    OFC_TIMER *pTimer;
+
+    pTimer = ofc_handle_lock(hTimer);
+    if (pTimer != OFC_NULL) {
+        if (pTimer->wheel == wheel) {
+            OFC_SPINLOCK_LOCK(&wheel->lock);
+            ofc_timer_wheel_detach_locked(wheel, pTimer);
+            OFC_SPINLOCK_UNLOCK(&wheel->lock);
+            ofc_timer_wheel_release(wheel);
+        }
+        ofc_handle_unlock(hTimer);
+    }
+}
+
+OFC_CORE_LIB OFC_MSTIME
+ofc_timer_wheel_next(OFC_TIMER_WHEEL *wheel) {
+    OFC_UINT32 next;
+    OFC_UINT32 candidate;
+    OFC_UINT32 now;
+    OFC_UINT64 map;
+    OFC_INT index;
+    OFC_INT level;
+    OFC_INT k;
+    OFC_MSTIME ret;
+
+    ret = OFC_INFINITE;
+    OFC_SPINLOCK_LOCK(&wheel->lock);
+    if (wheel->count > 0) {
+        next = wheel->now + 0x7FFFFFFF;
+        /*
+         * First occupied root slot, in this lap of the root and then the
+         * next
+         */
+        index = wheel->now & WHEEL_ROOT_MASK;
+        k = ofc_timer_wheel_root_next(wheel, index);
+        if (k < 0) {
+            k = ofc_timer_wheel_root_next(wheel, 0);
+            if (k >= 0)
+                k += WHEEL_ROOT_SIZE;
+        }
+        if (k >= 0)
+            next = wheel->now + (OFC_UINT32) (k - index);
+        /*
+         * Then the next cascade of an occupied slot on each level
+         */
+        for (level = 0; level < WHEEL_LEVELS; level++) {
+            map = wheel->level_map[level];
+            if (map != 0) {
+                index = (wheel->now >> WHEEL_SHIFT(level)) & WHEEL_LEVEL_MASK;
+                /*
+                 * Rotate so bit 0 is the slot after the current one
+                 */
+                map = (map >> ((index + 1) & WHEEL_LEVEL_MASK)) |
+                      (((index + 1) & WHEEL_LEVEL_MASK) == 0 ? 0 :
+                       map << (WHEEL_LEVEL_SIZE -
+                               ((index + 1) & WHEEL_LEVEL_MASK)));
+                k = ofc_timer_wheel_ffs(map) + 1;
+                candidate = ((wheel->now >> WHEEL_SHIFT(level)) +
+                             (OFC_UINT32) k) << WHEEL_SHIFT(level);
+                if ((OFC_INT32) (candidate - next) < 0)
+                    next = candidate;
+            }
+        }
+        now = ofc_timer_wheel_now();
+        if ((OFC_INT32) (next - now) <= 0)
+            ret = 0;
+        else
+            ret = (OFC_MSTIME) (next - now);
+    }
+    OFC_SPINLOCK_UNLOCK(&wheel->lock);
+    return (ret);
+}
+
+OFC_CORE_LIB OFC_INT
+ofc_timer_wheel_expire(OFC_TIMER_WHEEL *wheel, OFC_HANDLE *expired,
+                       OFC_INT max) {
+    OFC_UINT32 now;
+    OFC_UINT32 next;
+    OFC_INT index;
+    OFC_INT level;
+    OFC_INT k;
+    OFC_INT count;
+    OFC_IQUEUE_LINK *link;
+    OFC_TIMER *pTimer;
+    OFC_BOOL full;
+
+    count = 0;
+    full = OFC_FALSE;
+    now = ofc_timer_wheel_now();
+
+    OFC_SPINLOCK_LOCK(&wheel->lock);
+    if (wheel->count == 0)
+        wheel->now = now;
+
+    while (!full && (OFC_INT32) (now - wheel->now) >= 0) {
+        index = wheel->now & WHEEL_ROOT_MASK;
+        if (index == 0) {
+            /*
+             * Root wrapped.  Bring down the next span from above.
+             * Cascading again after a partial run is harmless.
+             */
+            for (level = 0; level < WHEEL_LEVELS &&
+                            ofc_timer_wheel_cascade(wheel, level) == 0;
+                 level++);
+        }
+
+        for (link = ofc_iqueue_first(&wheel->root[index]);
+             link != OFC_NULL && !full;
+             link = ofc_iqueue_first(&wheel->root[index])) {
+            if (count < max) {
+                pTimer = OFC_IQUEUE_ENTRY(link, OFC_TIMER, link);
+                ofc_timer_wheel_unlink(wheel, pTimer);
+                wheel->count--;
+                expired[count++] = pTimer->hTimer;
+            } else
+                full = OFC_TRUE;
+        }
+
+        if (!full) {
+            /*
+             * Skip to the next occupied root slot, the next wrap, or now
+             */
+            k = -1;
+            if (index + 1 < WHEEL_ROOT_SIZE)
+                k = ofc_timer_wheel_root_next(wheel, index + 1);
+            if (k < 0)
+                k = WHEEL_ROOT_SIZE;
+            next = wheel->now + (OFC_UINT32) (k - index);
+            if ((OFC_INT32) (next - now) > 0)
+                next = now + 1;
+            wheel->now = next;
+        }
+    }
+    OFC_SPINLOCK_UNLOCK(&wheel->lock);
+    return (count);
+}
+
 OFC_CORE_LIB OFC_HANDLE
 ofc_timer_create(OFC_CCHAR *id) {
     OFC_TIMER *pTimer;
     OFC_HANDLE hTimer;
 
-    pTimer = ofc_malloc(sizeof(OFC_TIMER));
+    pTimer = ofc_slab_alloc(&ofc_timer_slab);
     pTimer->expiration_time = 0;
     pTimer->id = id;
+    pTimer->wheel = OFC_NULL;
+    pTimer->slot = OFC_NULL;
+    pTimer->expires = 0;
+    ofc_iqueue_link_init(&pTimer->link);
     hTimer = ofc_handle_create(OFC_HANDLE_TIMER, pTimer);
+    pTimer->hTimer = hTimer;
     return (hTimer);
 }
 
@@ -44,18 +509,26 @@ OFC_CORE_LIB OFC_CCHAR *ofc_timer_id(OFC_HANDLE hTimer) {
 
 OFC_CORE_LIB OFC_MSTIME
 ofc_timer_get_wait_time(OFC_HANDLE hTimer) {
-    OFC_MSTIME now;
+    TIMER_TIME now;
     OFC_TIMER *pTimer;
     OFC_MSTIME ret;
 
     ret = 0;
     pTimer = ofc_handle_lock(hTimer);
     if (pTimer != OFC_NULL) {
-        OFC_MSTIME elapsed;
-        now = ofc_time_get_now();
-        elapsed = pTimer->expiration_time - now;
-        if (elapsed > 0)
-            ret = elapsed;
+        now = ofc_timer_clock();
+#if defined(OFC_64BIT_INTEGER)
+        /*
+         * Round up so a caller never wakes before the timer has expired
+         */
+        if (pTimer->expiration_time > now)
+            ret = (OFC_MSTIME) ((pTimer->expiration_time - now +
+                                 TIMER_PER_MS - 1) / TIMER_PER_MS);
+#else
+        ret = pTimer->expiration_time - now;
+        if (ret < 0)
+            ret = 0;
+#endif
         ofc_handle_unlock(hTimer);
     }
     return (ret);
@@ -64,10 +537,27 @@ ofc_timer_get_wait_time(OFC_HANDLE hTimer) {
 OFC_CORE_LIB OFC_VOID
 ofc_timer_set(OFC_HANDLE hTimer, OFC_MSTIME delta) {
     OFC_TIMER *pTimer;
+    OFC_TIMER_WHEEL *wheel;
 
     pTimer = ofc_handle_lock(hTimer);
     if (pTimer != OFC_NULL) {
-        pTimer->expiration_time = ofc_time_get_now() + delta;
+        pTimer->expiration_time = ofc_timer_clock() +
+                                  (TIMER_TIME) delta * TIMER_PER_MS;
+        wheel = pTimer->wheel;
+        if (wheel != OFC_NULL) {
+            /*
+             * Move it on the wheel of the wait set it's in.  Our reference
+             * keeps the wheel around even if the set has destroyed it.
+             */
+            OFC_SPINLOCK_LOCK(&wheel->lock);
+            if (wheel->destroyed)
+                ofc_timer_wheel_detach_locked(wheel, pTimer);
+            else
+                ofc_timer_wheel_arm_locked(wheel, pTimer);
+            OFC_SPINLOCK_UNLOCK(&wheel->lock);
+            if (pTimer->wheel == OFC_NULL)
+                ofc_timer_wheel_release(wheel);
+        }
         ofc_handle_unlock(hTimer);
     }
 }
@@ -75,10 +565,18 @@ ofc_timer_set(OFC_HANDLE hTimer, OFC_MSTIME delta) {
 OFC_CORE_LIB OFC_VOID
 ofc_timer_destroy(OFC_HANDLE hTimer) {
     OFC_TIMER *pTimer;
+    OFC_TIMER_WHEEL *wheel;
 
     pTimer = ofc_handle_lock(hTimer);
     if (pTimer != OFC_NULL) {
-        ofc_free(pTimer);
+        wheel = pTimer->wheel;
+        if (wheel != OFC_NULL) {
+            OFC_SPINLOCK_LOCK(&wheel->lock);
+            ofc_timer_wheel_detach_locked(wheel, pTimer);
+            OFC_SPINLOCK_UNLOCK(&wheel->lock);
+            ofc_timer_wheel_release(wheel);
+        }
+        ofc_slab_free(&ofc_timer_slab, pTimer);
         ofc_handle_destroy(hTimer);
         ofc_handle_unlock(hTimer);
     }
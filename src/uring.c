@@ -0,0 +1,434 @@
+/* Copyright (c) 2021 Connected Way, LLC. All rights reserved.
+ * Use of this source code is governed by a Creative Commons
+ * Attribution-NoDerivatives 4.0 International license that can be
+ * found in the LICENSE file.
+ */
+#define __OFC_CORE_DLL__
+
+#include "ofc/core.h"
+#include "ofc/config.h"
+#include "ofc/types.h"
+#include "ofc/handle.h"
+#include "ofc/libc.h"
+#include "ofc/atomic.h"
+#include "ofc/file.h"
+#include "ofc/waitq.h"
+#include "ofc/waitset.h"
+#include "ofc/heap.h"
+#include "ofc/uring.h"
+
+#if defined(OFC_FILE_URING) && defined(__linux__)
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+
+/*
+ * The kernel shares the submission and completion rings with us.  We
+ * own the submission tail and the completion head, the kernel owns the
+ * other ends.  Our end is published with a release store and the
+ * kernel's is read with an acquire load.
+ */
+struct ofc_uring {
+    OFC_INT fd;
+    OFC_SPINLOCK lock;        /* Held while submitting or reaping */
+    OFC_UINT inflight;        /* Queued and not yet reaped */
+    OFC_UINT pending;         /* Queued and not yet passed to the kernel */
+
+    OFC_VOID *sq_map;
+    OFC_SIZET sq_map_size;
+    OFC_VOID *cq_map;
+    OFC_SIZET cq_map_size;
+    struct io_uring_sqe *sqes;
+    OFC_SIZET sqes_size;
+
+    OFC_UINT32 *sq_head;
+    OFC_UINT32 *sq_tail;
+    OFC_UINT32 sq_mask;
+    OFC_UINT32 *sq_array;
+    OFC_UINT32 *cq_head;
+    OFC_UINT32 *cq_tail;
+    OFC_UINT32 cq_mask;
+    struct io_uring_cqe *cqes;
+};
+
+static OFC_INT
+ofc_uring_setup(OFC_UINT32 entries, struct io_uring_params *params) {
+    return ((OFC_INT) syscall(__NR_io_uring_setup, entries, params));
+}
+
+static OFC_INT
+ofc_uring_enter(OFC_INT fd, OFC_UINT to_submit, OFC_UINT min_complete,
+                OFC_UINT flags) {
+    return ((OFC_INT) syscall(__NR_io_uring_enter, fd, to_submit,
+                              min_complete, flags, OFC_NULL, 0));
+}
+
+OFC_CORE_LIB OFC_URING *
+ofc_uring_create(OFC_VOID) {
+    struct io_uring_params params;
+    OFC_URING *ring;
+    OFC_CHAR *sq;
+    OFC_CHAR *cq;
+
+    ring = ofc_malloc(sizeof(OFC_URING));
+    if (ring == OFC_NULL)
+        return (OFC_NULL);
+    ofc_memset(ring, 0, sizeof(OFC_URING));
+    ofc_memset(&params, 0, sizeof(params));
+
+    ring->fd = ofc_uring_setup(OFC_URING_ENTRIES, &params);
+    if (ring->fd < 0) {
+        ofc_free(ring);
+        return (OFC_NULL);
+    }
+
+    ring->sq_map_size = params.sq_off.array +
+                        params.sq_entries * sizeof(OFC_UINT32);
+    ring->cq_map_size = params.cq_off.cqes +
+                        params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->sq_map_size = OFC_MAX(ring->sq_map_size, ring->cq_map_size);
+        ring->cq_map_size = 0;
+    }
+
+    ring->sq_map = mmap(OFC_NULL, ring->sq_map_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED)
+        ring->sq_map = OFC_NULL;
+
+    ring->cq_map = ring->sq_map;
+    if (ring->sq_map != OFC_NULL && ring->cq_map_size != 0) {
+        ring->cq_map = mmap(OFC_NULL, ring->cq_map_size,
+                            PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring->fd,
+                            IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED)
+            ring->cq_map = OFC_NULL;
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = OFC_NULL;
+    if (ring->cq_map != OFC_NULL) {
+        ring->sqes = mmap(OFC_NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring->fd,
+                          IORING_OFF_SQES);
+        if (ring->sqes == MAP_FAILED)
+            ring->sqes = OFC_NULL;
+    }
+
+    if (ring->sqes == OFC_NULL) {
+        ofc_uring_destroy(ring);
+        return (OFC_NULL);
+    }
+
+    sq = ring->sq_map;
+    ring->sq_head = (OFC_UINT32 *) (sq + params.sq_off.head);
+    ring->sq_tail = (OFC_UINT32 *) (sq + params.sq_off.tail);
+    ring->sq_mask = *(OFC_UINT32 *) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (OFC_UINT32 *) (sq + params.sq_off.array);
+
+    cq = ring->cq_map;
+    ring->cq_head = (OFC_UINT32 *) (cq + params.cq_off.head);
+    ring->cq_tail = (OFC_UINT32 *) (cq + params.cq_off.tail);
+    ring->cq_mask = *(OFC_UINT32 *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+    return (ring);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_uring_destroy(OFC_URING *ring) {
+    if (ring != OFC_NULL) {
+        if (ring->sqes != OFC_NULL)
+            munmap(ring->sqes, ring->sqes_size);
+        if (ring->cq_map != OFC_NULL && ring->cq_map != ring->sq_map)
+            munmap(ring->cq_map, ring->cq_map_size);
+        if (ring->sq_map != OFC_NULL)
+            munmap(ring->sq_map, ring->sq_map_size);
+        close(ring->fd);
+        ofc_free(ring);
+    }
+}
+
+OFC_CORE_LIB OFC_INT
+ofc_uring_fd(OFC_URING *ring) {
+    OFC_INT fd;
+
+    fd = -1;
+    if (ring != OFC_NULL)
+        fd = ring->fd;
+    return (fd);
+}
+
+OFC_CORE_LIB OFC_UINT
+ofc_uring_inflight(OFC_URING *ring) {
+    OFC_UINT inflight;
+
+    inflight = 0;
+    if (ring != OFC_NULL)
+        inflight = OFC_ATOMIC_LOAD(&ring->inflight);
+    return (inflight);
+}
+
+/*
+ * Queue an I/O on the ring of the overlapped handle's wait set.  It is
+ * passed to the kernel the next time the wait set is serviced, so the
+ * first one queued wakes the wait set.
+ */
+static OFC_BOOL
+ofc_uring_queue(OFC_HANDLE hOverlapped, OFC_UINT8 opcode, OFC_INT fd,
+                OFC_LPCVOID lpBuffer, OFC_DWORD len) {
+    OFC_OVERLAPPED *Overlapped;
+    WAIT_SET *pWaitSet;
+    OFC_HANDLE hSet;
+    OFC_URING *ring;
+    struct io_uring_sqe *sqe;
+    OFC_UINT32 tail;
+    OFC_UINT32 index;
+    OFC_BOOL wake;
+    OFC_BOOL ret;
+
+    ret = OFC_FALSE;
+    wake = OFC_FALSE;
+    hSet = ofc_handle_get_wait_set(hOverlapped);
+    pWaitSet = ofc_handle_lock(hSet);
+    if (pWaitSet != OFC_NULL) {
+        ring = pWaitSet->uring;
+        Overlapped = ofc_handle_lock(hOverlapped);
+        if (ring != OFC_NULL && Overlapped != OFC_NULL) {
+            OFC_SPINLOCK_LOCK(&ring->lock);
+            tail = *ring->sq_tail;
+            if (ring->inflight < OFC_URING_ENTRIES &&
+                tail - OFC_ATOMIC_LOAD(ring->sq_head) <= ring->sq_mask) {
+                index = tail & ring->sq_mask;
+                sqe = &ring->sqes[index];
+                ofc_memset(sqe, 0, sizeof(struct io_uring_sqe));
+                sqe->opcode = opcode;
+                sqe->fd = fd;
+                sqe->off = (OFC_UINT64) Overlapped->offset;
+                sqe->addr = (OFC_UINT64) (OFC_ULONG_PTR) lpBuffer;
+                sqe->len = len;
+                sqe->user_data = (OFC_UINT64) hOverlapped;
+                ring->sq_array[index] = index;
+                OFC_ATOMIC_STORE(ring->sq_tail, tail + 1);
+
+                wake = (ring->pending == 0);
+                ring->pending++;
+                OFC_ATOMIC_ADD(&ring->inflight, 1);
+                ret = OFC_TRUE;
+            }
+            OFC_SPINLOCK_UNLOCK(&ring->lock);
+        }
+        if (Overlapped != OFC_NULL)
+            ofc_handle_unlock(hOverlapped);
+        ofc_handle_unlock(hSet);
+    }
+    if (wake)
+        ofc_waitset_wake(hSet);
+    return (ret);
+}
+
+OFC_CORE_LIB OFC_BOOL
+ofc_uring_read(OFC_HANDLE hOverlapped, OFC_INT fd, OFC_LPVOID lpBuffer,
+               OFC_DWORD nNumberOfBytesToRead) {
+    return (ofc_uring_queue(hOverlapped, IORING_OP_READ, fd, lpBuffer,
+                            nNumberOfBytesToRead));
+}
+
+OFC_CORE_LIB OFC_BOOL
+ofc_uring_write(OFC_HANDLE hOverlapped, OFC_INT fd, OFC_LPCVOID lpBuffer,
+                OFC_DWORD nNumberOfBytesToWrite) {
+    return (ofc_uring_queue(hOverlapped, IORING_OP_WRITE, fd, lpBuffer,
+                            nNumberOfBytesToWrite));
+}
+
+/*
+ * Map the errno of a failed completion to a file error
+ */
+static OFC_DWORD
+ofc_uring_error(OFC_INT32 err) {
+    OFC_DWORD ret;
+
+    switch (err) {
+        case EPERM:
+        case EACCES:
+            ret = OFC_ERROR_ACCESS_DENIED;
+            break;
+        case EBADF:
+            ret = OFC_ERROR_INVALID_HANDLE;
+            break;
+        case ENOMEM:
+            ret = OFC_ERROR_NOT_ENOUGH_MEMORY;
+            break;
+        case EINVAL:
+        case EFAULT:
+            ret = OFC_ERROR_INVALID_PARAMETER;
+            break;
+        case ENOSPC:
+        case EDQUOT:
+            ret = OFC_ERROR_HANDLE_DISK_FULL;
+            break;
+        case EPIPE:
+            ret = OFC_ERROR_BROKEN_PIPE;
+            break;
+        case ECANCELED:
+        case EINTR:
+            ret = OFC_ERROR_OPERATION_ABORTED;
+            break;
+        case EIO:
+            ret = OFC_ERROR_IO_DEVICE;
+            break;
+        default:
+            ret = OFC_ERROR_GEN_FAILURE;
+            break;
+    }
+    return (ret);
+}
+
+/*
+ * Pass a completion to the owner of the overlapped handle the way the
+ * I/O threads do.  The handle may have been destroyed meanwhile.
+ */
+static OFC_VOID
+ofc_uring_complete(OFC_HANDLE hOverlapped, OFC_INT32 res) {
+    OFC_OVERLAPPED *Overlapped;
+
+    Overlapped = ofc_handle_lock(hOverlapped);
+    if (Overlapped != OFC_NULL) {
+        if (res >= 0) {
+            Overlapped->status = OFC_TRUE;
+            Overlapped->dwLen = (OFC_DWORD) res;
+            Overlapped->dwError = OFC_ERROR_SUCCESS;
+        } else {
+            Overlapped->status = OFC_FALSE;
+            Overlapped->dwLen = 0;
+            Overlapped->dwError = ofc_uring_error(-res);
+        }
+        ofc_waitq_enqueue(Overlapped->response_queue,
+                          (OFC_VOID *) hOverlapped);
+        ofc_handle_unlock(hOverlapped);
+    }
+}
+
+OFC_CORE_LIB OFC_INT
+ofc_uring_service(OFC_URING *ring) {
+    struct io_uring_cqe *cqe;
+    OFC_HANDLE hOverlapped;
+    OFC_UINT32 head;
+    OFC_UINT32 tail;
+    OFC_INT32 res;
+    OFC_INT submitted;
+    OFC_INT count;
+
+    count = 0;
+    if (ring != OFC_NULL && OFC_ATOMIC_LOAD(&ring->inflight) > 0) {
+        OFC_SPINLOCK_LOCK(&ring->lock);
+        if (ring->pending > 0) {
+            submitted = ofc_uring_enter(ring->fd, ring->pending, 0, 0);
+            /*
+             * On EAGAIN or EBUSY the kernel is short of resources or
+             * has too many completions waiting.  Reaping below makes
+             * room and the rest goes on the next pass.
+             */
+            if (submitted > 0)
+                ring->pending -= OFC_MIN((OFC_UINT) submitted, ring->pending);
+        }
+
+        head = *ring->cq_head;
+        tail = OFC_ATOMIC_LOAD(ring->cq_tail);
+        while (head != tail) {
+            cqe = &ring->cqes[head & ring->cq_mask];
+            hOverlapped = (OFC_HANDLE) cqe->user_data;
+            res = cqe->res;
+            head++;
+            OFC_ATOMIC_STORE(ring->cq_head, head);
+            /*
+             * Completing takes other locks, so not under ours
+             */
+            OFC_SPINLOCK_UNLOCK(&ring->lock);
+            ofc_uring_complete(hOverlapped, res);
+            OFC_ATOMIC_SUB(&ring->inflight, 1);
+            count++;
+            OFC_SPINLOCK_LOCK(&ring->lock);
+            tail = OFC_ATOMIC_LOAD(ring->cq_tail);
+        }
+        OFC_SPINLOCK_UNLOCK(&ring->lock);
+    }
+    return (count);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_uring_drain(OFC_URING *ring) {
+    OFC_UINT pending;
+    OFC_BOOL failed;
+
+    failed = OFC_FALSE;
+    while (ring != OFC_NULL && !failed) {
+        /*
+         * Submit what is queued and reap what has finished
+         */
+        ofc_uring_service(ring);
+        if (OFC_ATOMIC_LOAD(&ring->inflight) == 0)
+            break;
+
+        OFC_SPINLOCK_LOCK(&ring->lock);
+        pending = ring->pending;
+        OFC_SPINLOCK_UNLOCK(&ring->lock);
+        /*
+         * Wait for the kernel to complete one, unless some are still
+         * to be submitted.  The kernel knows nothing of those.
+         */
+        if (pending == 0 &&
+            ofc_uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 &&
+            errno != EINTR)
+            failed = OFC_TRUE;
+    }
+}
+
+#else
+
+OFC_CORE_LIB OFC_URING *
+ofc_uring_create(OFC_VOID) {
+    return (OFC_NULL);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_uring_destroy(OFC_URING *ring) {
+}
+
+OFC_CORE_LIB OFC_INT
+ofc_uring_fd(OFC_URING *ring) {
+    return (-1);
+}
+
+OFC_CORE_LIB OFC_BOOL
+ofc_uring_read(OFC_HANDLE hOverlapped, OFC_INT fd, OFC_LPVOID lpBuffer,
+               OFC_DWORD nNumberOfBytesToRead) {
+    return (OFC_FALSE);
+}
+
+OFC_CORE_LIB OFC_BOOL
+ofc_uring_write(OFC_HANDLE hOverlapped, OFC_INT fd, OFC_LPCVOID lpBuffer,
+                OFC_DWORD nNumberOfBytesToWrite) {
+    return (OFC_FALSE);
+}
+
+OFC_CORE_LIB OFC_INT
+ofc_uring_service(OFC_URING *ring) {
+    return (0);
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_uring_drain(OFC_URING *ring) {
+}
+
+OFC_CORE_LIB OFC_UINT
+ofc_uring_inflight(OFC_URING *ring) {
+    return (0);
+}
+
+#endif
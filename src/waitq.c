@@ -12,26 +12,136 @@
 #include "ofc/handle.h"
 #include "ofc/event.h"
 #include "ofc/lock.h"
+#include "ofc/atomic.h"
+#include "ofc/thread.h"
 
 #include "ofc/heap.h"
 
+/*
+ * An MPSC wait queue is a Vyukov style queue.  Producers swap their node
+ * into the tail and then link it from the previous tail.  The consumer
+ * owns the head, which is always a dummy node; the first element is the
+ * one after it.  Between a producer's swap and its link the queue
+ * appears to end early, so the consumer may briefly see it as empty even
+ * though count says otherwise.
+ *
+ * count is the number of live elements.  It is incremented before the
+ * node is published so it never goes negative.  The producer that takes
+ * it from 0 to 1 sets the event.  The consumer that takes it to 0 resets
+ * the event, and then sets it again if a producer raced in.
+ *
+ * Unlinking from the middle of the queue cannot be done safely against
+ * producers, so an unlinked element is replaced by a tombstone
+ * (element OFC_NULL) that dequeue discards.  Enqueueing OFC_NULL would
+ * make a tombstone that count still includes, so it is ignored.
+ */
+struct waitq_node {
+    struct waitq_node *volatile next;
+    OFC_VOID *element;
+};
+
 typedef struct {
     OFC_HANDLE hEvent;
     OFC_HANDLE hQueue;
     OFC_LOCK lock;
+    OFC_BOOL mpsc;
+    volatile OFC_INT count;
+    struct waitq_node *head;
+    struct waitq_node *volatile tail;
 } WAIT_QUEUE;
 
-/*
- * ofc_waitq_create - create a linked list
- *
- * Accepts:
- *    nothing
- *
- * Returns:
- *    Queue
+#define WAITQ_SPIN 64
+
+static OFC_SLAB ofc_waitq_node_slab =
+  OFC_SLAB_INIT("Wait Queue Node", sizeof(struct waitq_node));
+
+static OFC_VOID
+ofc_waitq_mpsc_push(WAIT_QUEUE *pWaitQueue, OFC_VOID *qElement) {
+    struct waitq_node *node;
+    struct waitq_node *prev;
+
+    node = ofc_slab_alloc(&ofc_waitq_node_slab);
+    node->next = OFC_NULL;
+    node->element = qElement;
+
+    if (OFC_ATOMIC_ADD(&pWaitQueue->count, 1) == 1)
+        ofc_event_set(pWaitQueue->hEvent);
+
+    prev = OFC_ATOMIC_XCHG(&pWaitQueue->tail, node);
+    OFC_ATOMIC_STORE(&prev->next, node);
+}
+
+/*
+ * Account for an element leaving the queue
  */
-OFC_CORE_LIB OFC_HANDLE
-ofc_waitq_create(OFC_VOID) {
+static OFC_VOID
+ofc_waitq_mpsc_release(WAIT_QUEUE *pWaitQueue) {
+    if (OFC_ATOMIC_SUB(&pWaitQueue->count, 1) == 0) {
+        ofc_event_reset(pWaitQueue->hEvent);
+        if (OFC_ATOMIC_LOAD(&pWaitQueue->count) != 0)
+            ofc_event_set(pWaitQueue->hEvent);
+    }
+}
+
+/*
+ * Return the first live node, discarding any leading tombstones.  If a
+ * producer is between publishing and linking its node, wait briefly for
+ * the link.
+ */
+static struct waitq_node *
+ofc_waitq_mpsc_first(WAIT_QUEUE *pWaitQueue) {
+    struct waitq_node *next;
+    OFC_INT spin;
+
+    spin = 0;
+    for (next = OFC_ATOMIC_LOAD(&pWaitQueue->head->next);
+         (next != OFC_NULL && next->element == OFC_NULL) ||
+         (next == OFC_NULL && spin < WAITQ_SPIN &&
+          OFC_ATOMIC_LOAD(&pWaitQueue->count) > 0);
+         next = OFC_ATOMIC_LOAD(&pWaitQueue->head->next)) {
+        if (next == OFC_NULL) {
+            spin++;
+            OFC_ATOMIC_PAUSE();
+        } else {
+            ofc_slab_free(&ofc_waitq_node_slab, pWaitQueue->head);
+            pWaitQueue->head = next;
+        }
+    }
+    return (next);
+}
+
+static OFC_VOID *
+ofc_waitq_mpsc_pop(WAIT_QUEUE *pWaitQueue) {
+    struct waitq_node *next;
+    OFC_VOID *qElement;
+
+    qElement = OFC_NULL;
+    next = ofc_waitq_mpsc_first(pWaitQueue);
+    if (next != OFC_NULL) {
+        /*
+         * The node holding the element becomes the new dummy
+         */
+        qElement = next->element;
+        next->element = OFC_NULL;
+        ofc_slab_free(&ofc_waitq_node_slab, pWaitQueue->head);
+        pWaitQueue->head = next;
+        ofc_waitq_mpsc_release(pWaitQueue);
+    }
+    return (qElement);
+}
+
+static struct waitq_node *
+ofc_waitq_mpsc_find(WAIT_QUEUE *pWaitQueue, OFC_VOID *qElement) {
+    struct waitq_node *node;
+
+    for (node = OFC_ATOMIC_LOAD(&pWaitQueue->head->next);
+         node != OFC_NULL && node->element != qElement;
+         node = OFC_ATOMIC_LOAD(&node->next));
+    return (node);
+}
+
+static OFC_HANDLE
+ofc_waitq_alloc(OFC_BOOL mpsc) {
     WAIT_QUEUE *wait_queue;
     OFC_HANDLE hWaitQueue;
 
@@ -42,14 +152,59 @@ ofc_waitq_create(OFC_VOID) {
     wait_queue = ofc_malloc(sizeof(WAIT_QUEUE));
 
     if (wait_queue != OFC_NULL) {
-        wait_queue->hQueue = ofc_queue_create();
+        wait_queue->mpsc = mpsc;
+        wait_queue->count = 0;
+        wait_queue->hQueue = OFC_HANDLE_NULL;
+        wait_queue->lock = OFC_NULL;
+        wait_queue->head = OFC_NULL;
+        wait_queue->tail = OFC_NULL;
+        if (mpsc) {
+            wait_queue->head = ofc_slab_alloc(&ofc_waitq_node_slab);
+            wait_queue->head->next = OFC_NULL;
+            wait_queue->head->element = OFC_NULL;
+            wait_queue->tail = wait_queue->head;
+        } else {
+            wait_queue->hQueue = ofc_queue_create();
+            wait_queue->lock = ofc_lock_init();
+        }
         wait_queue->hEvent = ofc_event_create(OFC_EVENT_MANUAL);
         hWaitQueue = ofc_handle_create(OFC_HANDLE_WAIT_QUEUE, wait_queue);
-        wait_queue->lock = ofc_lock_init();
     }
     return (hWaitQueue);
 }
 
+/*
+ * ofc_waitq_create - create a linked list
+ *
+ * Accepts:
+ *    nothing
+ *
+ * Returns:
+ *    Queue
+ */
+OFC_CORE_LIB OFC_HANDLE
+ofc_waitq_create(OFC_VOID) {
+#if defined(OFC_WAITQ_MPSC)
+    return (ofc_waitq_alloc(OFC_TRUE));
+#else
+    return (ofc_waitq_alloc(OFC_FALSE));
+#endif
+}
+
+/*
+ * ofc_waitq_create_mpsc - create a multi producer single consumer queue
+ *
+ * Accepts:
+ *    nothing
+ *
+ * Returns:
+ *    Queue
+ */
+OFC_CORE_LIB OFC_HANDLE
+ofc_waitq_create_mpsc(OFC_VOID) {
+    return (ofc_waitq_alloc(OFC_TRUE));
+}
+
 /*
  * ofc_waitq_destroy - Destroy a queue
  *
@@ -67,8 +222,13 @@ ofc_waitq_destroy(OFC_HANDLE qHandle) {
     pWaitQueue = ofc_handle_lock(qHandle);
 
     if (pWaitQueue != OFC_NULL) {
-        ofc_lock_destroy(pWaitQueue->lock);
-        ofc_queue_destroy(pWaitQueue->hQueue);
+        if (pWaitQueue->mpsc) {
+            while (ofc_waitq_mpsc_pop(pWaitQueue) != OFC_NULL);
+            ofc_slab_free(&ofc_waitq_node_slab, pWaitQueue->head);
+        } else {
+            ofc_lock_destroy(pWaitQueue->lock);
+            ofc_queue_destroy(pWaitQueue->hQueue);
+        }
         ofc_event_destroy(pWaitQueue->hEvent);
 
         ofc_free(pWaitQueue);
@@ -90,10 +250,15 @@ ofc_waitq_enqueue(OFC_HANDLE qHandle, OFC_VOID *qElement) {
 
     pWaitQueue = ofc_handle_lock(qHandle);
     if (pWaitQueue != OFC_NULL) {
-        ofc_lock(pWaitQueue->lock);
-        ofc_enqueue(pWaitQueue->hQueue, qElement);
-        ofc_event_set(pWaitQueue->hEvent);
-        ofc_unlock(pWaitQueue->lock);
+        if (pWaitQueue->mpsc) {
+            if (qElement != OFC_NULL)
+                ofc_waitq_mpsc_push(pWaitQueue, qElement);
+        } else {
+            ofc_lock(pWaitQueue->lock);
+            ofc_enqueue(pWaitQueue->hQueue, qElement);
+            ofc_event_set(pWaitQueue->hEvent);
+            ofc_unlock(pWaitQueue->lock);
+        }
         ofc_handle_unlock(qHandle);
     }
 }
@@ -115,11 +280,15 @@ ofc_waitq_dequeue(OFC_HANDLE qHandle) {
     pWaitQueue = ofc_handle_lock(qHandle);
     qElement = OFC_NULL;
     if (pWaitQueue != OFC_NULL) {
-        ofc_lock(pWaitQueue->lock);
-        qElement = ofc_dequeue(pWaitQueue->hQueue);
-        if (ofc_queue_empty(pWaitQueue->hQueue))
-            ofc_event_reset(pWaitQueue->hEvent);
-        ofc_unlock(pWaitQueue->lock);
+        if (pWaitQueue->mpsc)
+            qElement = ofc_waitq_mpsc_pop(pWaitQueue);
+        else {
+            ofc_lock(pWaitQueue->lock);
+            qElement = ofc_dequeue(pWaitQueue->hQueue);
+            if (ofc_queue_empty(pWaitQueue->hQueue))
+                ofc_event_reset(pWaitQueue->hEvent);
+            ofc_unlock(pWaitQueue->lock);
+        }
         ofc_handle_unlock(qHandle);
     }
     return (qElement);
@@ -143,9 +312,13 @@ ofc_waitq_empty(OFC_HANDLE qHandle) {
 
     pWaitQueue = ofc_handle_lock(qHandle);
     if (pWaitQueue != OFC_NULL) {
-        ofc_lock(pWaitQueue->lock);
-        ret = ofc_queue_empty(pWaitQueue->hQueue);
-        ofc_unlock(pWaitQueue->lock);
+        if (pWaitQueue->mpsc)
+            ret = (OFC_ATOMIC_LOAD(&pWaitQueue->count) == 0);
+        else {
+            ofc_lock(pWaitQueue->lock);
+            ret = ofc_queue_empty(pWaitQueue->hQueue);
+            ofc_unlock(pWaitQueue->lock);
+        }
         ofc_handle_unlock(qHandle);
     }
     return (ret);
@@ -164,13 +337,20 @@ OFC_CORE_LIB OFC_VOID *
 ofc_waitq_first(OFC_HANDLE qHandle) {
     OFC_VOID *qElement;
     WAIT_QUEUE *pWaitQueue;
+    struct waitq_node *node;
 
     qElement = OFC_NULL;
     pWaitQueue = ofc_handle_lock(qHandle);
     if (pWaitQueue != OFC_NULL) {
-        ofc_lock(pWaitQueue->lock);
-        qElement = ofc_queue_first(pWaitQueue->hQueue);
-        ofc_unlock(pWaitQueue->lock);
+        if (pWaitQueue->mpsc) {
+            node = ofc_waitq_mpsc_first(pWaitQueue);
+            if (node != OFC_NULL)
+                qElement = node->element;
+        } else {
+            ofc_lock(pWaitQueue->lock);
+            qElement = ofc_queue_first(pWaitQueue->hQueue);
+            ofc_unlock(pWaitQueue->lock);
+        }
         ofc_handle_unlock(qHandle);
     }
     return (qElement);
@@ -190,13 +370,28 @@ OFC_CORE_LIB OFC_VOID *
 ofc_waitq_next(OFC_HANDLE qHandle, OFC_VOID *qElement) {
     WAIT_QUEUE *pWaitQueue;
     OFC_VOID *qReturn;
+    struct waitq_node *node;
 
     qReturn = OFC_NULL;
     pWaitQueue = ofc_handle_lock(qHandle);
     if (pWaitQueue != OFC_NULL) {
-        ofc_lock(pWaitQueue->lock);
-        qReturn = ofc_queue_next(pWaitQueue->hQueue, qElement);
-        ofc_unlock(pWaitQueue->lock);
+        if (pWaitQueue->mpsc) {
+            node = ofc_waitq_mpsc_find(pWaitQueue, qElement);
+            if (node != OFC_NULL) {
+                /*
+                 * Skip over tombstones
+                 */
+                for (node = OFC_ATOMIC_LOAD(&node->next);
+                     node != OFC_NULL && node->element == OFC_NULL;
+                     node = OFC_ATOMIC_LOAD(&node->next));
+                if (node != OFC_NULL)
+                    qReturn = node->element;
+            }
+        } else {
+            ofc_lock(pWaitQueue->lock);
+            qReturn = ofc_queue_next(pWaitQueue->hQueue, qElement);
+            ofc_unlock(pWaitQueue->lock);
+        }
         ofc_handle_unlock(qHandle);
     }
     return (qReturn);
@@ -215,14 +410,25 @@ ofc_waitq_next(OFC_HANDLE qHandle, OFC_VOID *qElement) {
 OFC_CORE_LIB OFC_VOID
 ofc_waitq_unlink(OFC_HANDLE qHandle, OFC_VOID *qElement) {
     WAIT_QUEUE *pWaitQueue;
+    struct waitq_node *node;
 
     pWaitQueue = ofc_handle_lock(qHandle);
     if (pWaitQueue != OFC_NULL) {
-        ofc_lock(pWaitQueue->lock);
-        ofc_queue_unlink(pWaitQueue->hQueue, qElement);
-        if (ofc_queue_empty(pWaitQueue->hQueue))
-            ofc_event_reset(pWaitQueue->hEvent);
-        ofc_unlock(pWaitQueue->lock);
+        if (pWaitQueue->mpsc) {
+            if (qElement != OFC_NULL) {
+                node = ofc_waitq_mpsc_find(pWaitQueue, qElement);
+                if (node != OFC_NULL) {
+                    node->element = OFC_NULL;
+                    ofc_waitq_mpsc_release(pWaitQueue);
+                }
+            }
+        } else {
+            ofc_lock(pWaitQueue->lock);
+            ofc_queue_unlink(pWaitQueue->hQueue, qElement);
+            if (ofc_queue_empty(pWaitQueue->hQueue))
+                ofc_event_reset(pWaitQueue->hEvent);
+            ofc_unlock(pWaitQueue->lock);
+        }
         ofc_handle_unlock(qHandle);
     }
 }
@@ -234,11 +440,17 @@ ofc_waitq_clear(OFC_HANDLE qHandle) {
 
     pWaitQueue = ofc_handle_lock(qHandle);
     if (pWaitQueue != OFC_NULL) {
-        ofc_lock(pWaitQueue->lock);
-        for (entry = ofc_dequeue(pWaitQueue->hQueue);
-             entry != OFC_NULL;
-             entry = ofc_dequeue(pWaitQueue->hQueue));
-        ofc_unlock(pWaitQueue->lock);
+        if (pWaitQueue->mpsc) {
+            for (entry = ofc_waitq_mpsc_pop(pWaitQueue);
+                 entry != OFC_NULL;
+                 entry = ofc_waitq_mpsc_pop(pWaitQueue));
+        } else {
+            ofc_lock(pWaitQueue->lock);
+            for (entry = ofc_dequeue(pWaitQueue->hQueue);
+                 entry != OFC_NULL;
+                 entry = ofc_dequeue(pWaitQueue->hQueue));
+            ofc_unlock(pWaitQueue->lock);
+        }
 
         ofc_handle_unlock(qHandle);
     }
@@ -280,7 +492,17 @@ ofc_waitq_block(OFC_HANDLE waitq) {
 
     pWaitQueue = ofc_handle_lock(waitq);
     if (pWaitQueue != OFC_NULL) {
-        if (ofc_queue_empty(pWaitQueue->hQueue))
+        if (pWaitQueue->mpsc) {
+            /*
+             * Wait until an element can actually be dequeued
+             */
+            while (ofc_waitq_mpsc_first(pWaitQueue) == OFC_NULL) {
+                if (OFC_ATOMIC_LOAD(&pWaitQueue->count) == 0)
+                    ofc_event_wait(pWaitQueue->hEvent);
+                else
+                    ofc_sleep(0);
+            }
+        } else if (ofc_queue_empty(pWaitQueue->hQueue))
             ofc_event_wait(pWaitQueue->hEvent);
         ofc_handle_unlock(waitq);
     }
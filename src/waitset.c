@@ -10,7 +10,10 @@
 #include "ofc/handle.h"
 #include "ofc/queue.h"
 #include "ofc/waitset.h"
+#include "ofc/timer.h"
+#include "ofc/thread.h"
 #include "ofc/libc.h"
+#include "ofc/uring.h"
 #include "ofc/impl/waitsetimpl.h"
 
 #include "ofc/heap.h"
@@ -91,7 +94,189 @@
  * to new platforms.  We provide PSPs for all three platforms so a 
  * developer should be able to use the techniques available to design a 
  * scheme that works for the target platform.
+ *
+ * Incremental Mode
+ *
+ * By default the scheduler clears the wait set and has every app re-add
+ * its events whenever a significant event occurs, and every app clears and
+ * re-adds its own events after each dispatch.  The platform layer sees a
+ * fresh set each time and typically rebuilds its poll list on every wait.
+ *
+ * When built with OFC_SCHED_INCREMENTAL, registrations persist.  Clearing
+ * an app's events (ofc_waitset_clear_app_deferred) only marks them stale.
+ * Re-adding a stale event revives it without involving the platform
+ * layer.  Events still stale when the set is next waited on are removed
+ * and ofc_waitset_remove_impl is called for each.  The platform layer thus
+ * sees an add when interest starts and a remove when it ends, which maps
+ * directly onto epoll_ctl on Linux.  Registrations are found through two
+ * small hash tables, keyed by app and by event, so re-arming an app costs
+ * in proportion to that app's events rather than the size of the set.
+ * Every registration is also on an intrusive list of the set's members,
+ * which takes the place of hHandleQueue.  That queue is left empty, as
+ * keeping it would cost a scan of the set on every add and remove.
+ */
+
+/*
+ * Timers in the set are kept on its timing wheel
+ */
+static OFC_VOID
+ofc_waitset_arm(WAIT_SET *pWaitSet, OFC_HANDLE hEvent) {
+    if (ofc_handle_get_type(hEvent) == OFC_HANDLE_TIMER)
+        ofc_timer_wheel_arm(pWaitSet->wheel, hEvent);
+}
+
+static OFC_VOID
+ofc_waitset_disarm(WAIT_SET *pWaitSet, OFC_HANDLE hEvent) {
+    if (ofc_handle_get_type(hEvent) == OFC_HANDLE_TIMER)
+        ofc_timer_wheel_cancel(pWaitSet->wheel, hEvent);
+}
+
+#if defined(OFC_SCHED_INCREMENTAL)
+#define WAITSET_BUCKETS 256
+
+struct waitset_reg {
+    OFC_IQUEUE_LINK app_link;    /* On the app hash chain */
+    OFC_IQUEUE_LINK event_link;    /* On the event hash chain */
+    OFC_IQUEUE_LINK stale_link;    /* On the stale list while stale */
+    OFC_IQUEUE_LINK member_link;    /* On the list of the set's members */
+    OFC_HANDLE hApp;
+    OFC_HANDLE hEvent;
+};
+
+struct waitset_registry {
+    OFC_IQUEUE apps[WAITSET_BUCKETS];
+    OFC_IQUEUE events[WAITSET_BUCKETS];
+    OFC_IQUEUE stale;
+    OFC_IQUEUE members;
+};
+
+static OFC_SLAB ofc_waitset_reg_slab =
+  OFC_SLAB_INIT("Wait Registration", sizeof(struct waitset_reg));
+
+static OFC_UINT
+ofc_waitset_bucket(OFC_HANDLE handle) {
+    return ((OFC_UINT) (((OFC_DWORD_PTR) handle * 0x9E3779B1U) >> 16) %
+            WAITSET_BUCKETS);
+}
+
+static struct waitset_registry *
+ofc_waitset_registry_create(OFC_VOID) {
+    struct waitset_registry *registry;
+    OFC_INT i;
+
+    registry = ofc_malloc(sizeof(struct waitset_registry));
+    for (i = 0; i < WAITSET_BUCKETS; i++) {
+        ofc_iqueue_init(&registry->apps[i]);
+        ofc_iqueue_init(&registry->events[i]);
+    }
+    ofc_iqueue_init(&registry->stale);
+    ofc_iqueue_init(&registry->members);
+    return (registry);
+}
+
+static struct waitset_reg *
+ofc_waitset_find(struct waitset_registry *registry, OFC_HANDLE hEvent) {
+    OFC_IQUEUE *chain;
+    OFC_IQUEUE_LINK *link;
+    struct waitset_reg *reg;
+
+    reg = OFC_NULL;
+    chain = &registry->events[ofc_waitset_bucket(hEvent)];
+    for (link = ofc_iqueue_first(chain);
+         link != OFC_NULL && reg == OFC_NULL;
+         link = ofc_iqueue_next(chain, link)) {
+        reg = OFC_IQUEUE_ENTRY(link, struct waitset_reg, event_link);
+        if (reg->hEvent != hEvent)
+            reg = OFC_NULL;
+    }
+    return (reg);
+}
+
+/*
+ * Remove a registration and tell the platform layer
+ */
+static OFC_VOID
+ofc_waitset_drop(OFC_HANDLE hSet, WAIT_SET *pWaitSet,
+                 struct waitset_reg *reg) {
+    struct waitset_registry *registry;
+
+    registry = pWaitSet->registry;
+    ofc_iqueue_unlink(&registry->apps[ofc_waitset_bucket(reg->hApp)],
+                      &reg->app_link);
+    ofc_iqueue_unlink(&registry->events[ofc_waitset_bucket(reg->hEvent)],
+                      &reg->event_link);
+    if (ofc_iqueue_linked(&reg->stale_link))
+        ofc_iqueue_unlink(&registry->stale, &reg->stale_link);
+    ofc_iqueue_unlink(&registry->members, &reg->member_link);
+
+    ofc_waitset_remove_impl(hSet, reg->hEvent);
+    ofc_waitset_disarm(pWaitSet, reg->hEvent);
+    ofc_handle_set_app(reg->hEvent, OFC_HANDLE_NULL, OFC_HANDLE_NULL);
+    ofc_slab_free(&ofc_waitset_reg_slab, reg);
+}
+
+/*
+ * Drop every registration of an app, or mark them stale if deferred
+ */
+static OFC_VOID
+ofc_waitset_clear_app_reg(OFC_HANDLE hSet, WAIT_SET *pWaitSet,
+                          OFC_HANDLE hApp, OFC_BOOL deferred) {
+    struct waitset_registry *registry;
+    OFC_IQUEUE *chain;
+    OFC_IQUEUE_LINK *link;
+    OFC_IQUEUE_LINK *next;
+    struct waitset_reg *reg;
+
+    registry = pWaitSet->registry;
+    chain = &registry->apps[ofc_waitset_bucket(hApp)];
+    for (link = ofc_iqueue_first(chain); link != OFC_NULL; link = next) {
+        next = ofc_iqueue_next(chain, link);
+        reg = OFC_IQUEUE_ENTRY(link, struct waitset_reg, app_link);
+        if (reg->hApp == hApp) {
+            if (!deferred)
+                ofc_waitset_drop(hSet, pWaitSet, reg);
+            else if (!ofc_iqueue_linked(&reg->stale_link))
+                ofc_iqueue_enqueue(&registry->stale, &reg->stale_link);
+        }
+    }
+}
+
+/*
+ * Drop whatever interest was not renewed since the last wait
  */
+static OFC_VOID
+ofc_waitset_sweep(OFC_HANDLE hSet) {
+    WAIT_SET *pWaitSet;
+    struct waitset_registry *registry;
+    OFC_IQUEUE_LINK *link;
+
+    pWaitSet = ofc_handle_lock(hSet);
+    if (pWaitSet != OFC_NULL) {
+        registry = pWaitSet->registry;
+        for (link = ofc_iqueue_first(&registry->stale);
+             link != OFC_NULL;
+             link = ofc_iqueue_first(&registry->stale))
+            ofc_waitset_drop(hSet, pWaitSet,
+                             OFC_IQUEUE_ENTRY(link, struct waitset_reg,
+                                              stale_link));
+        ofc_handle_unlock(hSet);
+    }
+}
+
+static OFC_VOID
+ofc_waitset_clear_reg(OFC_HANDLE hSet, WAIT_SET *pWaitSet) {
+    struct waitset_registry *registry;
+    OFC_IQUEUE_LINK *link;
+
+    registry = pWaitSet->registry;
+    for (link = ofc_iqueue_first(&registry->members);
+         link != OFC_NULL;
+         link = ofc_iqueue_first(&registry->members))
+        ofc_waitset_drop(hSet, pWaitSet,
+                         OFC_IQUEUE_ENTRY(link, struct waitset_reg,
+                                          member_link));
+}
+#endif
 
 OFC_CORE_LIB OFC_HANDLE
 ofc_waitset_create(OFC_VOID) {
@@ -100,6 +285,15 @@ ofc_waitset_create(OFC_VOID) {
 
     pWaitSet = ofc_malloc(sizeof(WAIT_SET));
     pWaitSet->hHandleQueue = ofc_queue_create();
+    pWaitSet->registry = OFC_NULL;
+    pWaitSet->wheel = ofc_timer_wheel_create();
+#if defined(OFC_SCHED_INCREMENTAL)
+    pWaitSet->registry = ofc_waitset_registry_create();
+#endif
+    /*
+     * Before the platform set up, so it can poll the ring
+     */
+    pWaitSet->uring = ofc_uring_create();
     ofc_waitset_create_impl(pWaitSet);
     handle = ofc_handle_create(OFC_HANDLE_WAIT_SET, pWaitSet);
     /* extra for create */
@@ -110,17 +304,24 @@ ofc_waitset_create(OFC_VOID) {
 OFC_CORE_LIB OFC_VOID
 ofc_waitset_clear(OFC_HANDLE handle) {
     WAIT_SET *pWaitSet;
+#if !defined(OFC_SCHED_INCREMENTAL)
     OFC_HANDLE hEventHandle;
+#endif
 
     pWaitSet = ofc_handle_lock(handle);
     if (pWaitSet != OFC_NULL) {
+#if defined(OFC_SCHED_INCREMENTAL)
+        ofc_waitset_clear_reg(handle, pWaitSet);
+#else
         for (hEventHandle =
                      (OFC_HANDLE) ofc_dequeue(pWaitSet->hHandleQueue);
              hEventHandle != OFC_HANDLE_NULL;
              hEventHandle =
                      (OFC_HANDLE) ofc_dequeue(pWaitSet->hHandleQueue)) {
+            ofc_waitset_disarm(pWaitSet, hEventHandle);
             ofc_handle_set_app(hEventHandle, OFC_HANDLE_NULL, OFC_HANDLE_NULL);
         }
+#endif
         ofc_handle_unlock(handle);
     }
 }
@@ -128,11 +329,16 @@ ofc_waitset_clear(OFC_HANDLE handle) {
 OFC_CORE_LIB OFC_VOID
 ofc_waitset_clear_app(OFC_HANDLE handle, OFC_HANDLE hApp) {
     WAIT_SET *pWaitSet;
+#if !defined(OFC_SCHED_INCREMENTAL)
     OFC_HANDLE hEventHandle;
     OFC_HANDLE hNext;
+#endif
 
     pWaitSet = ofc_handle_lock(handle);
     if (pWaitSet != OFC_NULL) {
+#if defined(OFC_SCHED_INCREMENTAL)
+        ofc_waitset_clear_app_reg(handle, pWaitSet, hApp, OFC_FALSE);
+#else
         for (hEventHandle =
                      (OFC_HANDLE) ofc_queue_first(pWaitSet->hHandleQueue);
              hEventHandle != OFC_HANDLE_NULL;) {
@@ -142,34 +348,62 @@ ofc_waitset_clear_app(OFC_HANDLE handle, OFC_HANDLE hApp) {
             if (ofc_handle_get_app(hEventHandle) == hApp) {
                 ofc_queue_unlink(pWaitSet->hHandleQueue,
                                  (OFC_VOID *) hEventHandle);
+                ofc_waitset_disarm(pWaitSet, hEventHandle);
                 ofc_handle_set_app(hEventHandle,
                                    OFC_HANDLE_NULL, OFC_HANDLE_NULL);
             }
 
             hEventHandle = hNext;
         }
+#endif
+        ofc_handle_unlock(handle);
+    }
+}
+
+OFC_CORE_LIB OFC_VOID
+ofc_waitset_clear_app_deferred(OFC_HANDLE handle, OFC_HANDLE hApp) {
+#if defined(OFC_SCHED_INCREMENTAL)
+    WAIT_SET *pWaitSet;
+
+    pWaitSet = ofc_handle_lock(handle);
+    if (pWaitSet != OFC_NULL) {
+        ofc_waitset_clear_app_reg(handle, pWaitSet, hApp, OFC_TRUE);
         ofc_handle_unlock(handle);
     }
+#else
+    ofc_waitset_clear_app(handle, hApp);
+#endif
 }
 
 OFC_CORE_LIB OFC_VOID
 ofc_waitset_destroy(OFC_HANDLE handle) {
     WAIT_SET *pWaitSet;
+#if !defined(OFC_SCHED_INCREMENTAL)
     OFC_HANDLE hEventHandle;
+#endif
 
     pWaitSet = ofc_handle_lock(handle);
     if (pWaitSet != OFC_NULL) {
+#if defined(OFC_SCHED_INCREMENTAL)
+        ofc_waitset_clear_reg(handle, pWaitSet);
+        ofc_free(pWaitSet->registry);
+#else
         for (hEventHandle =
                      (OFC_HANDLE) ofc_dequeue(pWaitSet->hHandleQueue);
              hEventHandle != OFC_HANDLE_NULL;
              hEventHandle =
                      (OFC_HANDLE) ofc_dequeue(pWaitSet->hHandleQueue)) {
+            ofc_waitset_disarm(pWaitSet, hEventHandle);
             ofc_handle_set_app(hEventHandle, OFC_HANDLE_NULL, OFC_HANDLE_NULL);
         }
+#endif
         ofc_queue_destroy(pWaitSet->hHandleQueue);
+        ofc_timer_wheel_destroy(pWaitSet->wheel);
         ofc_handle_destroy(handle);
         ofc_handle_unlock(handle);
         ofc_waitset_destroy_impl(pWaitSet);
+        ofc_uring_drain(pWaitSet->uring);
+        ofc_uring_destroy(pWaitSet->uring);
         ofc_free(pWaitSet);
         /* second unlock to balance extra on create */
         ofc_handle_unlock(handle);
@@ -179,12 +413,54 @@ ofc_waitset_destroy(OFC_HANDLE handle) {
 OFC_CORE_LIB OFC_VOID
 ofc_waitset_add(OFC_HANDLE hSet, OFC_HANDLE hApp, OFC_HANDLE hEvent) {
     WAIT_SET *pWaitSet;
+#if defined(OFC_SCHED_INCREMENTAL)
+    struct waitset_registry *registry;
+    struct waitset_reg *reg;
+#endif
 
     pWaitSet = ofc_handle_lock(hSet);
     if (pWaitSet != OFC_NULL) {
+#if defined(OFC_SCHED_INCREMENTAL)
+        registry = pWaitSet->registry;
+        reg = ofc_waitset_find(registry, hEvent);
+        if (reg != OFC_NULL && reg->hApp != hApp) {
+            /*
+             * The event has changed hands.  Start over.
+             */
+            ofc_waitset_drop(hSet, pWaitSet, reg);
+            reg = OFC_NULL;
+        }
+
+        if (reg != OFC_NULL) {
+            /*
+             * Still registered.  Just revive it if it was stale.
+             */
+            if (ofc_iqueue_linked(&reg->stale_link))
+                ofc_iqueue_unlink(&registry->stale, &reg->stale_link);
+        } else {
+            reg = ofc_slab_alloc(&ofc_waitset_reg_slab);
+            reg->hApp = hApp;
+            reg->hEvent = hEvent;
+            ofc_iqueue_link_init(&reg->stale_link);
+            ofc_iqueue_link_init(&reg->app_link);
+            ofc_iqueue_link_init(&reg->event_link);
+            ofc_iqueue_link_init(&reg->member_link);
+            ofc_iqueue_enqueue(&registry->apps[ofc_waitset_bucket(hApp)],
+                               &reg->app_link);
+            ofc_iqueue_enqueue(&registry->events[ofc_waitset_bucket(hEvent)],
+                               &reg->event_link);
+            ofc_iqueue_enqueue(&registry->members, &reg->member_link);
+
+            ofc_waitset_add_impl(hSet, hApp, hEvent);
+            ofc_handle_set_app(hEvent, hApp, hSet);
+            ofc_waitset_arm(pWaitSet, hEvent);
+        }
+#else
         ofc_waitset_add_impl(hSet, hApp, hEvent);
         ofc_handle_set_app(hEvent, hApp, hSet);
+        ofc_waitset_arm(pWaitSet, hEvent);
         ofc_enqueue(pWaitSet->hHandleQueue, (OFC_VOID *) hEvent);
+#endif
         ofc_handle_unlock(hSet);
     }
 }
@@ -192,11 +468,21 @@ ofc_waitset_add(OFC_HANDLE hSet, OFC_HANDLE hApp, OFC_HANDLE hEvent) {
 OFC_CORE_LIB OFC_VOID
 ofc_waitset_remove(OFC_HANDLE hSet, OFC_HANDLE hEvent) {
     WAIT_SET *pWaitSet;
+#if defined(OFC_SCHED_INCREMENTAL)
+    struct waitset_reg *reg;
+#endif
 
     pWaitSet = ofc_handle_lock(hSet);
     if (pWaitSet != OFC_NULL) {
+#if defined(OFC_SCHED_INCREMENTAL)
+        reg = ofc_waitset_find(pWaitSet->registry, hEvent);
+        if (reg != OFC_NULL)
+            ofc_waitset_drop(hSet, pWaitSet, reg);
+#else
         ofc_queue_unlink(pWaitSet->hHandleQueue, (OFC_VOID *) hEvent);
+        ofc_waitset_disarm(pWaitSet, hEvent);
         ofc_handle_set_app(hEvent, OFC_HANDLE_NULL, OFC_HANDLE_NULL);
+#endif
         ofc_handle_unlock(hSet);
     }
 }
@@ -206,22 +492,115 @@ ofc_waitset_wake(OFC_HANDLE handle) {
     ofc_waitset_wake_impl(handle);
 }
 
+/*
+ * Pass overlapped file I/O queued since the last wait to the kernel and
+ * complete what has finished.  Completions signal the apps' queues,
+ * which are in the set, so the wait that follows returns them.
+ */
+static OFC_VOID
+ofc_waitset_service(OFC_HANDLE handle) {
+    WAIT_SET *pWaitSet;
+
+    pWaitSet = ofc_handle_lock(handle);
+    if (pWaitSet != OFC_NULL) {
+        ofc_uring_service(pWaitSet->uring);
+        ofc_handle_unlock(handle);
+    }
+}
+
 OFC_CORE_LIB OFC_HANDLE
 ofc_waitset_wait(OFC_HANDLE handle) {
+#if defined(OFC_SCHED_INCREMENTAL)
+    ofc_waitset_sweep(handle);
+#endif
+    ofc_waitset_service(handle);
     return (ofc_waitset_wait_impl(handle));
 }
 
+OFC_CORE_LIB OFC_INT
+ofc_waitset_wait_many(OFC_HANDLE handle, OFC_HANDLE *ready, OFC_INT max) {
+    OFC_INT count;
+
+    count = 0;
+    if (max > 0) {
+#if defined(OFC_SCHED_INCREMENTAL)
+        ofc_waitset_sweep(handle);
+#endif
+        ofc_waitset_service(handle);
+#if defined(OFC_WAITSET_WAIT_MANY)
+        count = ofc_waitset_wait_many_impl(handle, ready, max);
+#else
+        /*
+         * The platform can only report one event per wait
+         */
+        ready[0] = ofc_waitset_wait_impl(handle);
+        if (ready[0] != OFC_HANDLE_NULL)
+            count = 1;
+#endif
+    }
+    return (count);
+}
+
+OFC_CORE_LIB OFC_MSTIME
+ofc_waitset_next_timeout(OFC_HANDLE handle) {
+    WAIT_SET *pWaitSet;
+    OFC_MSTIME ret;
+
+    ret = OFC_INFINITE;
+    pWaitSet = ofc_handle_lock(handle);
+    if (pWaitSet != OFC_NULL) {
+        ret = ofc_timer_wheel_next(pWaitSet->wheel);
+        /*
+         * In case the platform does not poll the ring
+         */
+        if (ofc_uring_inflight(pWaitSet->uring) > 0 &&
+            (ret == OFC_INFINITE || ret > OFC_URING_POLL))
+            ret = OFC_URING_POLL;
+        ofc_handle_unlock(handle);
+    }
+    return (ret);
+}
+
+OFC_CORE_LIB OFC_INT
+ofc_waitset_expired(OFC_HANDLE handle, OFC_HANDLE *expired, OFC_INT max) {
+    WAIT_SET *pWaitSet;
+    OFC_INT ret;
+
+    ret = 0;
+    pWaitSet = ofc_handle_lock(handle);
+    if (pWaitSet != OFC_NULL) {
+        ret = ofc_timer_wheel_expire(pWaitSet->wheel, expired, max);
+        ofc_handle_unlock(handle);
+    }
+    return (ret);
+}
+
 #if defined(OFC_HANDLE_PERF)
 OFC_CORE_LIB OFC_VOID 
 ofc_waitset_log_measure(OFC_HANDLE handle) 
 {
   WAIT_SET *pWaitSet ;
+#if defined(OFC_SCHED_INCREMENTAL)
+  struct waitset_registry *registry ;
+  OFC_IQUEUE_LINK *link ;
+#else
   OFC_HANDLE hEventHandle ;
+#endif
 
   pWaitSet = ofc_handle_lock (handle) ;
   if (pWaitSet != OFC_NULL)
     {
       ofc_handle_print_interval_header() ;
+#if defined(OFC_SCHED_INCREMENTAL)
+      registry = pWaitSet->registry ;
+      for (link = ofc_iqueue_first (&registry->members) ;
+       link != OFC_NULL ;
+       link = ofc_iqueue_next (&registry->members, link))
+    {
+      ofc_handle_print_interval
+        ("", OFC_IQUEUE_ENTRY(link, struct waitset_reg, member_link)->hEvent) ;
+    }
+#else
       for (hEventHandle = 
          (OFC_HANDLE) ofc_queue_first (pWaitSet->hHandleQueue) ;
        hEventHandle != OFC_HANDLE_NULL ;
@@ -230,6 +609,7 @@ ofc_waitset_log_measure(OFC_HANDLE handle)
     {
       ofc_handle_print_interval("", hEventHandle) ;
     }
+#endif
       ofc_handle_unlock(handle) ;
     }
 }
@@ -20,6 +20,8 @@ static void runAllTests(void) {
     RUN_TEST_GROUP(stream);
     RUN_TEST_GROUP(path);
     RUN_TEST_GROUP(iovec);
+    RUN_TEST_GROUP(message);
+    RUN_TEST_GROUP(libc);
 #if defined(OFC_FS_DARWIN)
     RUN_TEST_GROUP(fs_darwin);
 #endif
@@ -35,6 +37,9 @@ static void runAllTests(void) {
 #if defined(OFC_PERSIST)
     RUN_TEST_GROUP(subpersist);
 #endif
+#if defined(OFC_FILE_URING)
+    RUN_TEST_GROUP(uring);
+#endif
 }
 
 int main(int argc, const char *argv[]) {
@@ -23,6 +23,7 @@
 #include "ofc/framework.h"
 #include "ofc/env.h"
 #include "ofc/persist.h"
+#include "ofc/thread.h"
 
 /**
  * \defgroup test_dg Datagram Test Application
@@ -821,10 +822,89 @@ TEST(dg, test_dg) {
     }
 }
 
+/**
+ * Port the batch test receives on
+ */
+#define DGRAM_BATCH_TEST_PORT 7544
+/**
+ * Number of datagrams sent in the batch test
+ */
+#define DGRAM_BATCH_TEST_COUNT 6
+/**
+ * Number of messages passed to each batch read
+ */
+#define DGRAM_BATCH_TEST_READ 4
+
+/**
+ * Send datagrams to ourselves over loopback and receive them with batch
+ * reads, each of which may take several
+ */
+TEST(dg, test_dg_batch) {
+    OFC_IPADDR ip;
+    OFC_HANDLE hServer;
+    OFC_HANDLE hClient;
+    OFC_MESSAGE *send_msg;
+    OFC_MESSAGE *recv_msg[DGRAM_BATCH_TEST_COUNT];
+    OFC_CHAR data[32];
+    OFC_INT received;
+    OFC_INT total;
+    OFC_INT tries;
+    OFC_INT i;
+
+    ofc_pton("127.0.0.1", &ip);
+    hServer = ofc_socket_datagram(&ip, DGRAM_BATCH_TEST_PORT);
+    TEST_ASSERT_TRUE_MESSAGE(hServer != OFC_HANDLE_NULL,
+                             "Couldn't create batch server socket");
+    hClient = ofc_socket_datagram(&ip, 0);
+    TEST_ASSERT_TRUE_MESSAGE(hClient != OFC_HANDLE_NULL,
+                             "Couldn't create batch client socket");
+
+    for (i = 0; i < DGRAM_BATCH_TEST_COUNT; i++) {
+        ofc_snprintf(data, sizeof(data), "Batch Datagram %d", i);
+        send_msg = ofc_datagram_create(MSG_ALLOC_HEAP, ofc_strlen(data) + 1,
+                                       OFC_NULL, &ip, DGRAM_BATCH_TEST_PORT);
+        ofc_strncpy(ofc_message_data(send_msg), data, ofc_strlen(data) + 1);
+        ofc_socket_write(hClient, send_msg);
+        TEST_ASSERT_TRUE_MESSAGE(ofc_message_done(send_msg),
+                                 "Couldn't send batch datagram");
+        ofc_message_destroy(send_msg);
+        recv_msg[i] = ofc_message_create(MSG_ALLOC_HEAP, 1000, OFC_NULL);
+    }
+
+    total = 0;
+    for (tries = 0; total < DGRAM_BATCH_TEST_COUNT && tries < 100; tries++) {
+        received = ofc_socket_read_batch(hServer, &recv_msg[total],
+                                         OFC_MIN(DGRAM_BATCH_TEST_READ,
+                                                 DGRAM_BATCH_TEST_COUNT -
+                                                 total));
+        TEST_ASSERT_TRUE_MESSAGE(received >= 0, "Batch read failed");
+        total += received;
+        if (received == 0)
+            ofc_sleep(10);
+    }
+    TEST_ASSERT_TRUE_MESSAGE(total == DGRAM_BATCH_TEST_COUNT,
+                             "Not every datagram was received");
+
+    for (i = 0; i < DGRAM_BATCH_TEST_COUNT; i++) {
+        ofc_snprintf(data, sizeof(data), "Batch Datagram %d", i);
+        TEST_ASSERT_TRUE_MESSAGE(ofc_message_offset(recv_msg[i]) ==
+                                 ofc_strlen(data) + 1,
+                                 "Batch datagram has the wrong length");
+        TEST_ASSERT_TRUE_MESSAGE(ofc_strcmp(ofc_message_data(recv_msg[i]),
+                                            data) == 0,
+                                 "Batch datagram has the wrong data");
+        ofc_message_destroy(recv_msg[i]);
+    }
+
+    ofc_socket_destroy(hClient);
+    ofc_socket_destroy(hServer);
+}
+
 /** \} */
 
 TEST_GROUP_RUNNER(dg) {
     RUN_TEST_CASE(dg, test_dg);
+    RUN_TEST_CASE(dg, test_dg_batch);
 }
 
 #if !defined(NO_MAIN)
@@ -21,6 +21,7 @@
 
 #include "ofc/heap.h"
 #include "ofc/file.h"
+#include "ofc/message.h"
 
 #define OFC_FS_TEST_INTERVAL 1000
 #define OFC_FILE_TEST_COUNT 1
@@ -67,6 +68,13 @@ static OFC_DWORD OfcFSTestApp(OFC_PATH *path);
 #define FS_TEST_RENAMETO TSTR("directory\\new.me")
 #define FS_TEST_RENAMETO_ROOT TSTR("new.me")
 #define FS_TEST_FLUSH TSTR("flush.me")
+#define FS_TEST_SCATTER TSTR("scatter.me")
+#define FS_TEST_CACHE TSTR("cache.me")
+#define FS_TEST_META_MAP TSTR("metacache")
+#define FS_TEST_META_DEVICE TSTR("metacache:")
+#define FS_TEST_META_DIR TSTR("metadir")
+#define FS_TEST_META TSTR("meta.me")
+#define FS_TEST_META_MOVED TSTR("meta.moved")
 #define FS_TEST_DIRECTORY TSTR("directory")
 #define FS_TEST_SETEOF TSTR("seteof.txt")
 #define FS_TEST_GETEX TSTR("getex.txt")
@@ -2126,6 +2134,746 @@ static OFC_BOOL OfcFlushTest(OFC_CTCHAR *device)
   return (ret);
 }
 
+/*
+ * Scatter/Gather Test
+ *
+ * Write three buffers with one gather, then read the file back into
+ * buffers of different sizes with one scatter.  Then do the same through
+ * messages made of two segments, split in different places.
+ */
+#define SCATTER_TEST_SIZE 1000
+#define SCATTER_TEST_HEADER 100
+#define SCATTER_TEST_OFFSET 3
+
+static OFC_BOOL OfcScatterGatherMessage(OFC_CTCHAR *filename,
+                                        OFC_CHAR *wbuf)
+{
+  OFC_HANDLE scatter_file;
+  OFC_DWORD dwLastError;
+  OFC_MESSAGE *msg;
+  OFC_BOOL status;
+  OFC_INT i;
+  OFC_DWORD dwBytes;
+  OFC_BOOL ret;
+
+  ret = OFC_TRUE;
+  msg = ofc_message_create_scatter(SCATTER_TEST_HEADER,
+                                   SCATTER_TEST_SIZE - SCATTER_TEST_HEADER,
+                                   OFC_NULL);
+  for (i = 0; i < SCATTER_TEST_SIZE; i++)
+    ofc_message_put_u8(msg, i, wbuf[i]);
+
+  scatter_file = OfcCreateFile(filename,
+                               OFC_GENERIC_WRITE,
+                               OFC_FILE_SHARE_READ,
+                               OFC_NULL,
+                               OFC_CREATE_ALWAYS,
+                               OFC_FILE_ATTRIBUTE_NORMAL,
+                               OFC_HANDLE_NULL);
+  if (scatter_file == OFC_INVALID_HANDLE_VALUE)
+    {
+      ofc_printf("Failed to create scatter file %A, %s(%d)\n",
+                 filename,
+                 ofc_get_error_string(OfcGetLastError()),
+                 OfcGetLastError());
+      ret = OFC_FALSE;
+    }
+  else
+    {
+      status = OfcWriteFileMessage(scatter_file, msg, 0, SCATTER_TEST_SIZE,
+                                   &dwBytes, OFC_HANDLE_NULL);
+      if (status != OFC_TRUE || dwBytes != SCATTER_TEST_SIZE)
+        {
+          dwLastError = OfcGetLastError();
+          ofc_printf("Message Write to Scatter File Failed with %s(%d)\n",
+                     ofc_get_error_string(dwLastError),
+                     dwLastError);
+          ret = OFC_FALSE;
+        }
+      OfcCloseHandle(scatter_file);
+    }
+  ofc_message_destroy(msg);
+
+  if (ret == OFC_TRUE)
+    {
+      /*
+       * Read into a range that starts part way into the first segment
+       * and is split at a different place
+       */
+      msg = ofc_message_create_scatter(7, SCATTER_TEST_SIZE, OFC_NULL);
+      for (i = 0; i < 7 + SCATTER_TEST_SIZE; i++)
+        ofc_message_put_u8(msg, i, 0);
+
+      scatter_file = OfcCreateFile(filename,
+                                   OFC_GENERIC_READ,
+                                   OFC_FILE_SHARE_READ,
+                                   OFC_NULL,
+                                   OFC_OPEN_EXISTING,
+                                   OFC_FILE_ATTRIBUTE_NORMAL,
+                                   OFC_HANDLE_NULL);
+      if (scatter_file == OFC_INVALID_HANDLE_VALUE)
+        {
+          ofc_printf("Failed to open scatter file %A, %s(%d)\n",
+                     filename,
+                     ofc_get_error_string(OfcGetLastError()),
+                     OfcGetLastError());
+          ret = OFC_FALSE;
+        }
+      else
+        {
+          status = OfcReadFileMessage(scatter_file, msg, SCATTER_TEST_OFFSET,
+                                      SCATTER_TEST_SIZE, &dwBytes,
+                                      OFC_HANDLE_NULL);
+          if (status != OFC_TRUE || dwBytes != SCATTER_TEST_SIZE)
+            {
+              dwLastError = OfcGetLastError();
+              ofc_printf("Message Read from Scatter File Failed with %s(%d)\n",
+                         ofc_get_error_string(dwLastError),
+                         dwLastError);
+              ret = OFC_FALSE;
+            }
+          else
+            {
+              for (i = 0; i < SCATTER_TEST_SIZE &&
+                     ofc_message_get_u8(msg, SCATTER_TEST_OFFSET + i) ==
+                     (OFC_UCHAR) wbuf[i]; i++);
+              if (i < SCATTER_TEST_SIZE ||
+                  ofc_message_get_u8(msg, SCATTER_TEST_OFFSET - 1) != 0 ||
+                  ofc_message_get_u8(msg, SCATTER_TEST_OFFSET +
+                                     SCATTER_TEST_SIZE) != 0)
+                {
+                  ofc_printf("Scatter File Message Read Doesn't Match Write\n");
+                  ret = OFC_FALSE;
+                }
+            }
+          if (ret == OFC_TRUE)
+            {
+              /*
+               * A range past the end of the message maps to nothing
+               */
+              status = OfcReadFileMessage(scatter_file, msg,
+                                          7 + SCATTER_TEST_SIZE,
+                                          SCATTER_TEST_SIZE, &dwBytes,
+                                          OFC_HANDLE_NULL);
+              if (status != OFC_FALSE ||
+                  OfcGetLastError() != OFC_ERROR_INVALID_PARAMETER)
+                {
+                  ofc_printf("Message Read Past End Didn't Fail\n");
+                  ret = OFC_FALSE;
+                }
+            }
+          OfcCloseHandle(scatter_file);
+        }
+      ofc_message_destroy(msg);
+    }
+  return (ret);
+}
+
+static OFC_BOOL OfcScatterGatherTest(OFC_CTCHAR *device)
+{
+  OFC_HANDLE scatter_file;
+  OFC_DWORD dwLastError;
+  OFC_CHAR *wbuf;
+  OFC_CHAR *rbuf;
+  OFC_IOVEC iovec[3];
+  OFC_BOOL status;
+  OFC_INT i;
+  OFC_TCHAR *filename;
+  OFC_DWORD dwBytes;
+  OFC_BOOL ret;
+
+  ret = OFC_TRUE;
+  filename = MakeFilename(device, FS_TEST_SCATTER);
+  wbuf = ofc_malloc(SCATTER_TEST_SIZE);
+  /*
+   * Room for the last buffer of the scatter, which asks for more
+   */
+  rbuf = ofc_malloc(2 * SCATTER_TEST_SIZE);
+  for (i = 0; i < SCATTER_TEST_SIZE; i++)
+    wbuf[i] = (OFC_CHAR) ('a' + i % 26);
+  ofc_memset(rbuf, 0, 2 * SCATTER_TEST_SIZE);
+
+  scatter_file = OfcCreateFile(filename,
+                               OFC_GENERIC_WRITE,
+                               OFC_FILE_SHARE_READ,
+                               OFC_NULL,
+                               OFC_CREATE_ALWAYS,
+                               OFC_FILE_ATTRIBUTE_NORMAL,
+                               OFC_HANDLE_NULL);
+
+  if (scatter_file == OFC_INVALID_HANDLE_VALUE)
+    {
+      ofc_printf("Failed to create scatter file %A, %s(%d)\n",
+                 filename,
+		 ofc_get_error_string(OfcGetLastError()),
+		 OfcGetLastError());
+      ret = OFC_FALSE;
+    }
+  else
+    {
+      iovec[0].iov_base = wbuf;
+      iovec[0].iov_len = 100;
+      iovec[1].iov_base = wbuf + 100;
+      iovec[1].iov_len = 1;
+      iovec[2].iov_base = wbuf + 101;
+      iovec[2].iov_len = SCATTER_TEST_SIZE - 101;
+      status = OfcWriteFileGather(scatter_file, iovec, 3, &dwBytes,
+                                  OFC_HANDLE_NULL);
+      if (status != OFC_TRUE || dwBytes != SCATTER_TEST_SIZE)
+        {
+          dwLastError = OfcGetLastError();
+          ofc_printf("Gather to Scatter File Failed with %s(%d)\n",
+		     ofc_get_error_string(dwLastError),
+                     dwLastError);
+          ret = OFC_FALSE;
+        }
+      OfcCloseHandle(scatter_file);
+    }
+
+  if (ret == OFC_TRUE)
+    {
+      scatter_file = OfcCreateFile(filename,
+                                   OFC_GENERIC_READ,
+                                   OFC_FILE_SHARE_READ,
+                                   OFC_NULL,
+                                   OFC_OPEN_EXISTING,
+                                   OFC_FILE_ATTRIBUTE_NORMAL,
+                                   OFC_HANDLE_NULL);
+      if (scatter_file == OFC_INVALID_HANDLE_VALUE)
+        {
+          ofc_printf("Failed to open scatter file %A, %s(%d)\n",
+                     filename,
+                     ofc_get_error_string(OfcGetLastError()),
+                     OfcGetLastError());
+          ret = OFC_FALSE;
+        }
+      else
+        {
+          iovec[0].iov_base = rbuf;
+          iovec[0].iov_len = 7;
+          iovec[1].iov_base = rbuf + 7;
+          iovec[1].iov_len = 500;
+          /*
+           * Ask for more than is there
+           */
+          iovec[2].iov_base = rbuf + 507;
+          iovec[2].iov_len = SCATTER_TEST_SIZE;
+          status = OfcReadFileScatter(scatter_file, iovec, 3, &dwBytes,
+                                      OFC_HANDLE_NULL);
+          if (status != OFC_TRUE || dwBytes != SCATTER_TEST_SIZE)
+            {
+              dwLastError = OfcGetLastError();
+              ofc_printf("Scatter from Scatter File Failed with %s(%d)\n",
+                         ofc_get_error_string(dwLastError),
+                         dwLastError);
+              ret = OFC_FALSE;
+            }
+          else if (ofc_memcmp(wbuf, rbuf, SCATTER_TEST_SIZE) != 0)
+            {
+              ofc_printf("Scatter File Read Doesn't Match Write\n");
+              ret = OFC_FALSE;
+            }
+          OfcCloseHandle(scatter_file);
+        }
+      if (ret == OFC_TRUE)
+        ret = OfcScatterGatherMessage(filename, wbuf);
+      OfcDeleteFile(filename);
+    }
+
+  if (ret == OFC_TRUE)
+    ofc_printf("Scatter/Gather Test Succeeded\n");
+  ofc_free(rbuf);
+  ofc_free(wbuf);
+  ofc_free(filename);
+  return (ret);
+}
+
+/*
+ * Small sequential writes and reads, as the file cache sees them, with
+ * an overwrite in the middle that the read-ahead has to notice
+ */
+#define CACHE_TEST_RECORD 100
+#define CACHE_TEST_RECORDS 1000
+
+static OFC_BOOL OfcCacheTest(OFC_CTCHAR *device)
+{
+  OFC_HANDLE cache_file;
+  OFC_HANDLE reader;
+  OFC_DWORD dwLastError;
+  OFC_CHAR *wbuf;
+  OFC_CHAR *rbuf;
+  OFC_BOOL status;
+  OFC_INT i;
+  OFC_TCHAR *filename;
+  OFC_DWORD dwBytes;
+  OFC_DWORD pos;
+  OFC_BOOL ret;
+#if defined(OFC_FILE_CACHE)
+  OFC_FILE_CACHE_STATS before;
+  OFC_FILE_CACHE_STATS after;
+
+  OfcFileGetCacheStats(&before);
+#endif
+
+  ret = OFC_TRUE;
+  filename = MakeFilename(device, FS_TEST_CACHE);
+  wbuf = ofc_malloc(CACHE_TEST_RECORD * CACHE_TEST_RECORDS);
+  rbuf = ofc_malloc(CACHE_TEST_RECORD * CACHE_TEST_RECORDS);
+  for (i = 0; i < CACHE_TEST_RECORD * CACHE_TEST_RECORDS; i++)
+    wbuf[i] = (OFC_CHAR) ('a' + i % 23);
+  ofc_memset(rbuf, 0, CACHE_TEST_RECORD * CACHE_TEST_RECORDS);
+
+  /*
+   * Not sharing write access, so the handle may be cached
+   */
+  cache_file = OfcCreateFile(filename,
+                             OFC_GENERIC_READ | OFC_GENERIC_WRITE,
+                             0,
+                             OFC_NULL,
+                             OFC_CREATE_ALWAYS,
+                             OFC_FILE_ATTRIBUTE_NORMAL,
+                             OFC_HANDLE_NULL);
+
+  if (cache_file == OFC_INVALID_HANDLE_VALUE)
+    {
+      ofc_printf("Failed to create cache file %A, %s(%d)\n",
+                 filename,
+		 ofc_get_error_string(OfcGetLastError()),
+		 OfcGetLastError());
+      ret = OFC_FALSE;
+    }
+  else
+    {
+      for (i = 0; i < CACHE_TEST_RECORDS && ret == OFC_TRUE; i++)
+        {
+          status = OfcWriteFile(cache_file, wbuf + i * CACHE_TEST_RECORD,
+                                CACHE_TEST_RECORD, &dwBytes,
+                                OFC_HANDLE_NULL);
+          if (status != OFC_TRUE || dwBytes != CACHE_TEST_RECORD)
+            {
+              dwLastError = OfcGetLastError();
+              ofc_printf("Write to Cache File Failed with %s(%d)\n",
+                         ofc_get_error_string(dwLastError),
+                         dwLastError);
+              ret = OFC_FALSE;
+            }
+        }
+
+      if (ret == OFC_TRUE)
+        {
+          pos = OfcSetFilePointer(cache_file, 0, OFC_NULL, OFC_FILE_BEGIN);
+          for (i = 0; i < CACHE_TEST_RECORDS && ret == OFC_TRUE; i++)
+            {
+              status = OfcReadFile(cache_file,
+                                   rbuf + i * CACHE_TEST_RECORD,
+                                   CACHE_TEST_RECORD, &dwBytes,
+                                   OFC_HANDLE_NULL);
+              if (status != OFC_TRUE || dwBytes != CACHE_TEST_RECORD)
+                {
+                  dwLastError = OfcGetLastError();
+                  ofc_printf("Read from Cache File Failed with %s(%d)\n",
+                             ofc_get_error_string(dwLastError),
+                             dwLastError);
+                  ret = OFC_FALSE;
+                }
+            }
+          if (ret == OFC_TRUE &&
+              ofc_memcmp(wbuf, rbuf,
+                         CACHE_TEST_RECORD * CACHE_TEST_RECORDS) != 0)
+            {
+              ofc_printf("Cache File Read Doesn't Match Write\n");
+              ret = OFC_FALSE;
+            }
+        }
+
+      if (ret == OFC_TRUE)
+        {
+          /*
+           * Two sequential reads start read-ahead past the second
+           * record.  Overwrite part of the second and read both back.
+           */
+          ofc_memset(wbuf + CACHE_TEST_RECORD + 10, '*', 20);
+          pos = OfcSetFilePointer(cache_file, 0, OFC_NULL, OFC_FILE_BEGIN);
+          status = OfcReadFile(cache_file, rbuf, CACHE_TEST_RECORD,
+                               &dwBytes, OFC_HANDLE_NULL);
+          if (status == OFC_TRUE)
+            status = OfcReadFile(cache_file, rbuf, CACHE_TEST_RECORD,
+                                 &dwBytes, OFC_HANDLE_NULL);
+          pos = OfcSetFilePointer(cache_file, -(CACHE_TEST_RECORD - 10),
+                                  OFC_NULL, OFC_FILE_CURRENT);
+          if (status == OFC_TRUE && pos == CACHE_TEST_RECORD + 10)
+            status = OfcWriteFile(cache_file, wbuf + pos, 20, &dwBytes,
+                                  OFC_HANDLE_NULL);
+          else
+            status = OFC_FALSE;
+          if (status == OFC_TRUE)
+            {
+              OfcSetFilePointer(cache_file, 0, OFC_NULL, OFC_FILE_BEGIN);
+              status = OfcReadFile(cache_file, rbuf,
+                                   CACHE_TEST_RECORD * 2, &dwBytes,
+                                   OFC_HANDLE_NULL);
+            }
+          if (status != OFC_TRUE || dwBytes != CACHE_TEST_RECORD * 2 ||
+              ofc_memcmp(wbuf, rbuf, CACHE_TEST_RECORD * 2) != 0)
+            {
+              ofc_printf("Cache File Overwrite Not Seen\n");
+              ret = OFC_FALSE;
+            }
+        }
+
+      if (!OfcCloseHandle(cache_file))
+        {
+          dwLastError = OfcGetLastError();
+          ofc_printf("Close of Cache File Failed with %s(%d)\n",
+                     ofc_get_error_string(dwLastError),
+                     dwLastError);
+          ret = OFC_FALSE;
+        }
+      OfcDeleteFile(filename);
+    }
+
+  if (ret == OFC_TRUE)
+    {
+      /*
+       * Sharing read access, so a write has to reach the file before
+       * it returns for another opener to read it
+       */
+      cache_file = OfcCreateFile(filename,
+                                 OFC_GENERIC_READ | OFC_GENERIC_WRITE,
+                                 OFC_FILE_SHARE_READ,
+                                 OFC_NULL,
+                                 OFC_CREATE_ALWAYS,
+                                 OFC_FILE_ATTRIBUTE_NORMAL,
+                                 OFC_HANDLE_NULL);
+      if (cache_file == OFC_INVALID_HANDLE_VALUE)
+        ret = OFC_FALSE;
+      else
+        {
+          status = OfcWriteFile(cache_file, wbuf, CACHE_TEST_RECORD,
+                                &dwBytes, OFC_HANDLE_NULL);
+          if (status == OFC_TRUE)
+            status = OfcWriteFile(cache_file, wbuf + CACHE_TEST_RECORD,
+                                  CACHE_TEST_RECORD, &dwBytes,
+                                  OFC_HANDLE_NULL);
+          reader = OfcCreateFile(filename,
+                                 OFC_GENERIC_READ,
+                                 OFC_FILE_SHARE_READ | OFC_FILE_SHARE_WRITE,
+                                 OFC_NULL,
+                                 OFC_OPEN_EXISTING,
+                                 OFC_FILE_ATTRIBUTE_NORMAL,
+                                 OFC_HANDLE_NULL);
+          if (status == OFC_TRUE && reader != OFC_INVALID_HANDLE_VALUE)
+            status = OfcReadFile(reader, rbuf, CACHE_TEST_RECORD * 2,
+                                 &dwBytes, OFC_HANDLE_NULL);
+          else
+            status = OFC_FALSE;
+          if (status != OFC_TRUE || dwBytes != CACHE_TEST_RECORD * 2 ||
+              ofc_memcmp(wbuf, rbuf, CACHE_TEST_RECORD * 2) != 0)
+            {
+              ofc_printf("Shared Cache File Write Not Seen\n");
+              ret = OFC_FALSE;
+            }
+          if (reader != OFC_INVALID_HANDLE_VALUE)
+            OfcCloseHandle(reader);
+          OfcCloseHandle(cache_file);
+        }
+      OfcDeleteFile(filename);
+    }
+
+#if defined(OFC_FILE_CACHE)
+  OfcFileGetCacheStats(&after);
+  ofc_printf("Cache hits %lu, misses %lu, coalesced %lu, flushes %lu\n",
+             after.hits - before.hits, after.misses - before.misses,
+             after.coalesced - before.coalesced,
+             after.flushes - before.flushes);
+  if (ret == OFC_TRUE &&
+      (after.hits == before.hits || after.coalesced == before.coalesced))
+    {
+      ofc_printf("Cache File Was Not Cached\n");
+      ret = OFC_FALSE;
+    }
+#endif
+
+  if (ret == OFC_TRUE)
+    ofc_printf("Read-Ahead/Write-Behind Test Succeeded\n");
+  ofc_free(rbuf);
+  ofc_free(wbuf);
+  ofc_free(filename);
+  return (ret);
+}
+
+/*
+ * Metadata cache test.  A map onto the test directory has its metadata
+ * cached, so the second lookup of a name is served from the cache until
+ * something changes the name or its directory.
+ */
+#define META_TEST_SIZE 1000
+
+/*
+ * Get the size of a file, and whether the cache served it
+ */
+static OFC_BOOL MetaCacheLookup(OFC_CTCHAR *filename, OFC_BOOL *found,
+                                OFC_DWORD *size)
+{
+  OFC_WIN32_FILE_ATTRIBUTE_DATA fadFile;
+  OFC_FILE_CACHE_STATS before;
+  OFC_FILE_CACHE_STATS after;
+
+  OfcFileGetCacheStats(&before);
+  *found = OfcGetFileAttributesEx(filename, OfcGetFileExInfoStandard,
+                                  &fadFile);
+  OfcFileGetCacheStats(&after);
+  *size = 0;
+  if (*found == OFC_TRUE)
+    *size = fadFile.nFileSizeLow;
+  return (after.meta_hits != before.meta_hits);
+}
+
+/*
+ * List a directory to the end, summing the names and sizes so two
+ * listings can be compared, and say whether the cache served it
+ */
+static OFC_BOOL MetaCacheList(OFC_CTCHAR *pattern, OFC_INT *count,
+                              OFC_UINT32 *sum)
+{
+  OFC_HANDLE list_handle;
+  OFC_WIN32_FIND_DATA find_data;
+  OFC_FILE_CACHE_STATS before;
+  OFC_FILE_CACHE_STATS after;
+  OFC_BOOL more;
+  OFC_BOOL status;
+  OFC_INT i;
+
+  *count = 0;
+  *sum = 0;
+  more = OFC_FALSE;
+  OfcFileGetCacheStats(&before);
+  list_handle = OfcFindFirstFile(pattern, &find_data, &more);
+  if (list_handle != OFC_INVALID_HANDLE_VALUE)
+    {
+      status = OFC_TRUE;
+      while (status == OFC_TRUE)
+        {
+          (*count)++;
+          for (i = 0; find_data.cFileName[i] != TCHAR_EOS; i++)
+            *sum = *sum * 31 + (OFC_UINT32) find_data.cFileName[i];
+          *sum += find_data.nFileSizeLow;
+          status = OFC_FALSE;
+          if (more)
+            status = OfcFindNextFile(list_handle, &find_data, &more);
+        }
+      OfcFindClose(list_handle);
+    }
+  OfcFileGetCacheStats(&after);
+  return (after.meta_hits != before.meta_hits);
+}
+
+static OFC_VOID MetaCacheExpect(OFC_BOOL *ret, OFC_BOOL ok,
+                                OFC_CHAR *what)
+{
+  if (*ret == OFC_TRUE && ok == OFC_FALSE)
+    {
+      ofc_printf("Metadata Cache %s\n", what);
+      *ret = OFC_FALSE;
+    }
+}
+
+static OFC_BOOL OfcMetaCacheTest(OFC_CTCHAR *device)
+{
+#if (OFC_FILE_META_CACHE > 0)
+  OFC_PATH *path;
+  OFC_LPTSTR mapped;
+  OFC_FST_TYPE type;
+  OFC_TCHAR *dirname;
+  OFC_TCHAR *filename;
+  OFC_TCHAR *movename;
+  OFC_TCHAR *pattern;
+  OFC_HANDLE meta_file;
+  OFC_CHAR *wbuf;
+  OFC_DWORD dwBytes;
+  OFC_DWORD size;
+  OFC_BOOL found;
+  OFC_BOOL hit;
+  OFC_INT count;
+  OFC_INT listed;
+  OFC_UINT32 sum;
+  OFC_UINT32 listed_sum;
+  OFC_BOOL ret;
+
+  ret = OFC_TRUE;
+  /*
+   * Map a device onto the test directory and cache metadata under it
+   */
+  ofc_path_mapW(device, &mapped, &type);
+  ofc_free(mapped);
+  path = ofc_path_createW(device);
+  if (ofc_path_add_mapW(FS_TEST_META_MAP, TSTR("Metadata Cache Test"),
+                        path, type, OFC_FALSE) == OFC_FALSE)
+    {
+      ofc_printf("Failed to add metadata cache map\n");
+      ofc_path_delete(path);
+      return (OFC_FALSE);
+    }
+  ofc_path_set_map_cacheW(FS_TEST_META_MAP, OFC_TRUE);
+
+  dirname = MakeFilename(FS_TEST_META_DEVICE, FS_TEST_META_DIR);
+  filename = MakeFilename(dirname, FS_TEST_META);
+  movename = MakeFilename(dirname, FS_TEST_META_MOVED);
+  pattern = MakeFilename(dirname, TSTR("*"));
+  wbuf = ofc_malloc(META_TEST_SIZE);
+  ofc_memset(wbuf, 'm', META_TEST_SIZE);
+
+  OfcCreateDirectory(dirname, OFC_NULL);
+
+  /*
+   * A name that is not there is remembered, until it is created
+   */
+  hit = MetaCacheLookup(filename, &found, &size);
+  MetaCacheExpect(&ret, found == OFC_FALSE, "Found a Missing File");
+  hit = MetaCacheLookup(filename, &found, &size);
+  MetaCacheExpect(&ret, hit == OFC_TRUE && found == OFC_FALSE,
+                  "Did Not Cache a Missing File");
+
+  meta_file = OfcCreateFile(filename,
+                            OFC_GENERIC_READ | OFC_GENERIC_WRITE,
+                            0,
+                            OFC_NULL,
+                            OFC_CREATE_ALWAYS,
+                            OFC_FILE_ATTRIBUTE_NORMAL,
+                            OFC_HANDLE_NULL);
+  if (meta_file == OFC_INVALID_HANDLE_VALUE)
+    {
+      ofc_printf("Failed to create metadata cache file %A, %s(%d)\n",
+                 filename,
+                 ofc_get_error_string(OfcGetLastError()),
+                 OfcGetLastError());
+      ret = OFC_FALSE;
+    }
+  else
+    {
+      hit = MetaCacheLookup(filename, &found, &size);
+      MetaCacheExpect(&ret, hit == OFC_FALSE && found == OFC_TRUE,
+                      "Kept a Missing File After Create");
+      hit = MetaCacheLookup(filename, &found, &size);
+      MetaCacheExpect(&ret, hit == OFC_TRUE && found == OFC_TRUE,
+                      "Did Not Cache Attributes");
+
+      /*
+       * A listing read to the end is replayed as it was read
+       */
+      hit = MetaCacheList(pattern, &listed, &listed_sum);
+      MetaCacheExpect(&ret, hit == OFC_FALSE && listed > 0,
+                      "Listing Was Not Read");
+      hit = MetaCacheList(pattern, &count, &sum);
+      MetaCacheExpect(&ret, hit == OFC_TRUE && count == listed &&
+                      sum == listed_sum, "Did Not Replay a Listing");
+
+      /*
+       * Writing and truncating forget the file and its directory
+       */
+      OfcWriteFile(meta_file, wbuf, META_TEST_SIZE, &dwBytes,
+                   OFC_HANDLE_NULL);
+      hit = MetaCacheLookup(filename, &found, &size);
+      MetaCacheExpect(&ret, hit == OFC_FALSE, "Kept Attributes After Write");
+      hit = MetaCacheList(pattern, &count, &sum);
+      MetaCacheExpect(&ret, hit == OFC_FALSE, "Kept a Listing After Write");
+      MetaCacheLookup(filename, &found, &size);
+      MetaCacheList(pattern, &count, &sum);
+
+      OfcSetFilePointer(meta_file, META_TEST_SIZE / 2, OFC_NULL,
+                        OFC_FILE_BEGIN);
+      if (OfcSetEndOfFile(meta_file) == OFC_FALSE)
+        {
+          ofc_printf("Set End of File Failed, %s(%d)\n",
+                     ofc_get_error_string(OfcGetLastError()),
+                     OfcGetLastError());
+          ret = OFC_FALSE;
+        }
+      hit = MetaCacheLookup(filename, &found, &size);
+      MetaCacheExpect(&ret, hit == OFC_FALSE &&
+                      size == META_TEST_SIZE / 2,
+                      "Kept Attributes After Set End of File");
+      hit = MetaCacheList(pattern, &count, &sum);
+      MetaCacheExpect(&ret, hit == OFC_FALSE,
+                      "Kept a Listing After Set End of File");
+      OfcCloseHandle(meta_file);
+
+      MetaCacheLookup(filename, &found, &size);
+      MetaCacheList(pattern, &count, &sum);
+      if (OfcSetFileAttributes(filename, OFC_FILE_ATTRIBUTE_NORMAL) ==
+          OFC_TRUE)
+        {
+          hit = MetaCacheLookup(filename, &found, &size);
+          MetaCacheExpect(&ret, hit == OFC_FALSE,
+                          "Kept Attributes After Set Attributes");
+          hit = MetaCacheList(pattern, &count, &sum);
+          MetaCacheExpect(&ret, hit == OFC_FALSE,
+                          "Kept a Listing After Set Attributes");
+        }
+      else
+        ofc_printf("Set File Attributes not supported, %s(%d)\n",
+                   ofc_get_error_string(OfcGetLastError()),
+                   OfcGetLastError());
+
+      /*
+       * Moving forgets both names, deleting forgets the file
+       */
+      MetaCacheLookup(filename, &found, &size);
+      MetaCacheLookup(movename, &found, &size);
+      hit = MetaCacheList(pattern, &listed, &listed_sum);
+      if (OfcMoveFile(filename, movename) == OFC_FALSE)
+        {
+          ofc_printf("Move of Metadata Cache File Failed, %s(%d)\n",
+                     ofc_get_error_string(OfcGetLastError()),
+                     OfcGetLastError());
+          ret = OFC_FALSE;
+        }
+      hit = MetaCacheLookup(filename, &found, &size);
+      MetaCacheExpect(&ret, hit == OFC_FALSE && found == OFC_FALSE,
+                      "Kept a File After Move");
+      hit = MetaCacheLookup(movename, &found, &size);
+      MetaCacheExpect(&ret, hit == OFC_FALSE && found == OFC_TRUE,
+                      "Kept a Missing File After Move");
+      hit = MetaCacheList(pattern, &count, &sum);
+      MetaCacheExpect(&ret, hit == OFC_FALSE && count == listed,
+                      "Kept a Listing After Move");
+
+      MetaCacheLookup(movename, &found, &size);
+      MetaCacheList(pattern, &listed, &listed_sum);
+      if (OfcDeleteFile(movename) == OFC_FALSE)
+        {
+          ofc_printf("Delete of Metadata Cache File Failed, %s(%d)\n",
+                     ofc_get_error_string(OfcGetLastError()),
+                     OfcGetLastError());
+          ret = OFC_FALSE;
+        }
+      hit = MetaCacheLookup(movename, &found, &size);
+      MetaCacheExpect(&ret, hit == OFC_FALSE && found == OFC_FALSE,
+                      "Kept a File After Delete");
+      hit = MetaCacheList(pattern, &count, &sum);
+      MetaCacheExpect(&ret, hit == OFC_FALSE && count == listed - 1,
+                      "Kept a Listing After Delete");
+    }
+
+  OfcDeleteFile(filename);
+  OfcDeleteFile(movename);
+  OfcRemoveDirectory(dirname);
+  ofc_path_delete_mapW(FS_TEST_META_MAP);
+
+  if (ret == OFC_TRUE)
+    ofc_printf("Metadata Cache Test Succeeded\n");
+  ofc_free(wbuf);
+  ofc_free(pattern);
+  ofc_free(movename);
+  ofc_free(filename);
+  ofc_free(dirname);
+  return (ret);
+#else
+  ofc_printf("Metadata Cache Not Built\n");
+  return (OFC_TRUE);
+#endif
+}
+
 /*
  * Create directory test
  */
@@ -3282,6 +4030,24 @@ OFC_INT test_file(OFC_LPCSTR test_root)
           ofc_printf("  *** Flush File Test Failed ***\n");
           test_result = OFC_FALSE;
         }
+      ofc_printf("  Scatter/Gather Test\n");
+      if (OfcScatterGatherTest(device) == OFC_FALSE)
+        {
+          ofc_printf("  *** Scatter/Gather Test Failed ***\n");
+          test_result = OFC_FALSE;
+        }
+      ofc_printf("  Read-Ahead/Write-Behind Test\n");
+      if (OfcCacheTest(device) == OFC_FALSE)
+        {
+          ofc_printf("  *** Read-Ahead/Write-Behind Test Failed ***\n");
+          test_result = OFC_FALSE;
+        }
+      ofc_printf("  Metadata Cache Test\n");
+      if (OfcMetaCacheTest(device) == OFC_FALSE)
+        {
+          ofc_printf("  *** Metadata Cache Test Failed ***\n");
+          test_result = OFC_FALSE;
+        }
       ofc_printf("  Create Directory Test\n");
       if (OfcCreateDirectoryTest(device) == OFC_FALSE)
         {
@@ -14,6 +14,8 @@
 #include "ofc/process.h"
 #include "ofc/framework.h"
 #include "ofc/iovec.h"
+#include "ofc/buffer.h"
+#include "ofc/time.h"
 
 #if defined(__APPLE__)
 #include <stdio.h>
@@ -285,14 +287,155 @@ TEST(iovec, test_iovec) {
                        "IOVEC: Bad iovec");
         }
     }
+
+  /*
+   * Filling a caller's array should describe the same regions, and stop
+   * when the array is full
+   */
+  {
+    OFC_IOVEC fill[8];
+    OFC_INT filled;
+
+    filled = ofc_iovec_fill(list, 50, ofc_iovec_length(list)-50, fill, 8);
+    ofc_assert (filled == veclen, "IOVEC: Bad fill");
+    for (int i = 0; i < filled; i++)
+      {
+        ofc_assert(fill[i].iov_base == iovec[i].iov_base, "IOVEC: Bad fill");
+        ofc_assert(fill[i].iov_len == iovec[i].iov_len, "IOVEC: Bad fill");
+      }
+    filled = ofc_iovec_fill(list, 50, ofc_iovec_length(list)-50, fill, 2);
+    ofc_assert (filled == 2, "IOVEC: Bad fill");
+  }
   
   ofc_free(iovec);
   
   ofc_iovec_destroy(list);
 }          
     
+/*
+ * Marshal a message of 10k four byte fields spread over 64 segments, the
+ * way a large multi segment response is built and then parsed.
+ */
+#define IOVEC_BENCH_SEGMENTS 64
+#define IOVEC_BENCH_FIELDS_PER_SEGMENT 160
+#define IOVEC_BENCH_FIELDS \
+  (IOVEC_BENCH_SEGMENTS * IOVEC_BENCH_FIELDS_PER_SEGMENT)
+#define IOVEC_BENCH_PASSES 10
+
+TEST(iovec, test_iovec_marshal) {
+  OFC_IOMAP list = ofc_iovec_new();
+  OFC_UCHAR *data;
+  OFC_UINT32 *field;
+  OFC_NSTIME start;
+  OFC_NSTIME elapsed;
+  OFC_INT pass;
+  OFC_INT i;
+
+  start = ofc_time_get_ns();
+  for (i = 0; i < IOVEC_BENCH_SEGMENTS; i++)
+    {
+      data = ofc_iovec_append(list, IOVEC_ALLOC_HEAP, OFC_NULL,
+                              IOVEC_BENCH_FIELDS_PER_SEGMENT *
+                              sizeof(OFC_UINT32));
+      ofc_assert(data != OFC_NULL, "IOVEC: Bad append");
+    }
+  ofc_assert(ofc_iovec_length(list) ==
+             IOVEC_BENCH_FIELDS * sizeof(OFC_UINT32),
+             "IOVEC: Bad length");
+
+  for (pass = 0; pass < IOVEC_BENCH_PASSES; pass++)
+    {
+      /*
+       * Put every field in order, then get them back in reverse so the
+       * lookups can't all be satisfied by the last segment hit
+       */
+      for (i = 0; i < IOVEC_BENCH_FIELDS; i++)
+        {
+          field = (OFC_UINT32 *)
+            ofc_iovec_lookup(list, i * sizeof(OFC_UINT32),
+                             sizeof(OFC_UINT32));
+          ofc_assert(field != OFC_NULL, "IOVEC: Bad lookup");
+          *field = i + pass;
+        }
+      for (i = IOVEC_BENCH_FIELDS - 1; i >= 0; i--)
+        {
+          field = (OFC_UINT32 *)
+            ofc_iovec_lookup(list, i * sizeof(OFC_UINT32),
+                             sizeof(OFC_UINT32));
+          ofc_assert(field != OFC_NULL, "IOVEC: Bad lookup");
+          ofc_assert(*field == (OFC_UINT32) (i + pass), "IOVEC: Bad data");
+        }
+    }
+  elapsed = ofc_time_get_ns() - start;
+
+  ofc_printf("Marshalled %d fields over %d segments %d times in %lu us\n",
+             IOVEC_BENCH_FIELDS, IOVEC_BENCH_SEGMENTS, IOVEC_BENCH_PASSES,
+             (OFC_ULONG) (elapsed / OFC_NS_PER_US));
+
+  ofc_iovec_destroy(list);
+}
+
+/*
+ * Attach one pool buffer to two maps and make sure it stays valid until
+ * both are destroyed, then comes back from the pool on the next
+ * allocation of the same class.  Growing a map over a shared buffer
+ * must not write into the other map's view, and small requests stay
+ * off the pool.
+ */
+TEST(iovec, test_iovec_shared) {
+  OFC_IOMAP first;
+  OFC_IOMAP second;
+  OFC_UCHAR *buffer;
+  OFC_UCHAR *data;
+  OFC_INT i;
+
+  data = ofc_buffer_alloc(40);
+  ofc_assert(ofc_buffer_size(data) == 40, "IOVEC: Small buffer pooled");
+  ofc_buffer_release(data);
+
+  buffer = ofc_buffer_alloc(3000);
+  ofc_assert(buffer != OFC_NULL, "IOVEC: Bad buffer alloc");
+  ofc_assert(ofc_buffer_size(buffer) == 3000, "IOVEC: Bad buffer size");
+  for (i = 0; i < 2000; i++)
+    buffer[i] = (OFC_UCHAR) i;
+
+  first = ofc_iovec_new();
+  ofc_iovec_append(first, IOVEC_ALLOC_HEAP, OFC_NULL, 16);
+  data = ofc_iovec_attach(first, 16, buffer, 100, 500);
+  ofc_assert(data == buffer + 100, "IOVEC: Bad attach");
+
+  second = ofc_iovec_new();
+  data = ofc_iovec_attach(second, 0, buffer, 0, 1000);
+  ofc_assert(data == buffer, "IOVEC: Bad attach");
+
+  ofc_buffer_release(buffer);
+
+  ofc_iovec_realloc(second, 2000);
+  data = ofc_iovec_lookup(second, 0, 2000);
+  ofc_assert(data != OFC_NULL && data != buffer, "IOVEC: Grew shared buffer");
+  ofc_assert(data[999] == (OFC_UCHAR) 999, "IOVEC: Bad grown data");
+  ofc_memset(data + 1000, 0xff, 1000);
+  ofc_assert(buffer[1000] != 0xff, "IOVEC: Grow wrote shared buffer");
+  ofc_iovec_realloc(second, 1000);
+
+  data = ofc_iovec_lookup(first, 16, 500);
+  ofc_assert(data != OFC_NULL && data[0] == 100, "IOVEC: Bad shared data");
+  ofc_iovec_destroy(first);
+
+  data = ofc_iovec_lookup(second, 999, 1);
+  ofc_assert(data != OFC_NULL && *data == (OFC_UCHAR) 999,
+             "IOVEC: Bad shared data");
+  ofc_iovec_destroy(second);
+
+  data = ofc_buffer_alloc(3000);
+  ofc_assert(data == buffer, "IOVEC: Buffer not recycled");
+  ofc_buffer_release(data);
+}
+
 TEST_GROUP_RUNNER(iovec) {
     RUN_TEST_CASE(iovec, test_iovec);
+    RUN_TEST_CASE(iovec, test_iovec_marshal);
+    RUN_TEST_CASE(iovec, test_iovec_shared);
 }
 
 #if !defined(NO_MAIN)
@@ -0,0 +1,380 @@
+/* Copyright (c) 2021 Connected Way, LLC. All rights reserved.
+ * Use of this source code is governed by a Creative Commons
+ * Attribution-NoDerivatives 4.0 International license that can be
+ * found in the LICENSE file.
+ */
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "ofc/core.h"
+#include "ofc/types.h"
+#include "ofc/config.h"
+#include "ofc/libc.h"
+#include "ofc/libc_simd.h"
+#include "ofc/log.h"
+#include "ofc/heap.h"
+#include "ofc/process.h"
+#include "ofc/framework.h"
+#include "ofc/time.h"
+
+static OFC_INT test_startup(OFC_VOID) {
+#if defined(INIT_ON_LOAD)
+  volatile OFC_VOID *init = ofc_framework_init;
+#else
+    ofc_framework_init();
+#endif
+    return (0);
+}
+
+static OFC_VOID test_shutdown(OFC_VOID) {
+#if !defined(INIT_ON_LOAD)
+    ofc_framework_shutdown();
+    ofc_framework_destroy();
+#endif
+}
+
+TEST_GROUP(libc);
+
+TEST_SETUP(libc) {
+    TEST_ASSERT_FALSE_MESSAGE(test_startup(), "Failed to Startup Framework");
+}
+
+TEST_TEAR_DOWN(libc) {
+    test_shutdown();
+}
+
+/*
+ * Longest string exercised.  Strings are placed at every alignment in
+ * a buffer a little bigger than this.
+ */
+#define LIBC_TEST_MAX 300
+#define LIBC_TEST_ALIGN 16
+
+static OFC_UINT32 libc_test_seed = 1;
+
+static OFC_UINT32 libc_test_rand(OFC_VOID) {
+  libc_test_seed = libc_test_seed * 1103515245 + 12345;
+  return ((libc_test_seed >> 16) & 0x7FFF);
+}
+
+/*
+ * Fill a string with letters of mixed case and a few other characters
+ */
+static OFC_VOID libc_test_fill(OFC_TCHAR *str, OFC_SIZET len) {
+  static const OFC_CHAR chars[] = "abcdefxyzABCDEFXYZ019_\\.@[`{";
+  OFC_SIZET i;
+
+  for (i = 0; i < len; i++)
+    str[i] = chars[libc_test_rand() % (sizeof(chars) - 1)];
+  str[len] = TCHAR_EOS;
+}
+
+static OFC_INT libc_test_sign(OFC_INT v) {
+  return (v < 0 ? -1 : v > 0 ? 1 : 0);
+}
+
+/*
+ * Every kernel table must give the same answers as the scalar one
+ */
+TEST(libc, test_libc_simd) {
+  const OFC_LIBC_OPS *scalar;
+  const OFC_LIBC_OPS *ops;
+  OFC_TCHAR *abuf;
+  OFC_TCHAR *bbuf;
+  OFC_TCHAR *a;
+  OFC_TCHAR *b;
+  OFC_CHAR *cbuf;
+  OFC_CHAR *dbuf;
+  OFC_CHAR *c;
+  OFC_CHAR *d;
+  OFC_SIZET len;
+  OFC_SIZET i;
+  OFC_INT align;
+  OFC_INT impl;
+  OFC_INT expect;
+
+  scalar = ofc_libc_get_ops(OFC_LIBC_SCALAR);
+  abuf = ofc_malloc((LIBC_TEST_MAX + LIBC_TEST_ALIGN + 1) * sizeof(OFC_TCHAR));
+  bbuf = ofc_malloc((LIBC_TEST_MAX + LIBC_TEST_ALIGN + 1) * sizeof(OFC_TCHAR));
+  cbuf = ofc_malloc(LIBC_TEST_MAX + LIBC_TEST_ALIGN + 1);
+  dbuf = ofc_malloc(LIBC_TEST_MAX + LIBC_TEST_ALIGN + 1);
+
+  for (impl = OFC_LIBC_SCALAR + 1; impl < OFC_LIBC_IMPL_MAX; impl++)
+    {
+      ops = ofc_libc_get_ops(impl);
+      if (ops == OFC_NULL)
+        continue;
+
+      ofc_printf("Checking %s string kernels\n", ops->name);
+      for (len = 0; len <= LIBC_TEST_MAX; len++)
+        {
+          for (align = 0; align < LIBC_TEST_ALIGN; align++)
+            {
+              a = abuf + (align % 4);
+              b = bbuf + (align / 4);
+              c = cbuf + align;
+              d = dbuf + (LIBC_TEST_ALIGN - 1 - align);
+
+              libc_test_fill(a, len);
+              ofc_tstrcpy(b, a);
+              ops->tstr_nupr(b, len);
+              scalar->tstr_nupr(a, len);
+              ofc_assert(ofc_memcmp(a, b, (len + 1) * sizeof(OFC_TCHAR)) == 0,
+                         "tstrnupr mismatch");
+
+              libc_test_fill(a, len);
+              ofc_assert(ops->tstr_len(a) == len, "tstrlen mismatch");
+
+              ops->tstr_narrow(c, a, len);
+              c[len] = '\0';
+              for (i = 0; i < len; i++)
+                ofc_assert(c[i] == (OFC_CHAR) a[i], "tstr2cstr mismatch");
+              ofc_assert(ops->str_nlen(c, len + 5) == len &&
+                         ops->str_nlen(c, len / 2) == len / 2,
+                         "strnlen mismatch");
+
+              /* Include characters with the top bit set */
+              for (i = 0; i < len; i += 7)
+                c[i] = (OFC_CHAR) (0x80 | i);
+              ops->cstr_widen(b, c, len);
+              for (i = 0; i < len; i++)
+                ofc_assert(b[i] == (OFC_TCHAR) c[i], "cstr2tstr mismatch");
+
+              ops->mem_copy(d, c, len);
+              ofc_assert(ops->mem_compare(d, c, len) == 0,
+                         "memcpy mismatch");
+              if (len > 0)
+                {
+                  i = libc_test_rand() % len;
+                  d[i]++;
+                  ofc_assert(ops->mem_compare(d, c, len) != 0,
+                             "memcmp mismatch");
+                }
+
+              /*
+               * Same string in a different case, then with one change
+               */
+              libc_test_fill(a, len);
+              ofc_tstrcpy(b, a);
+              for (i = 0; i < len; i += 3)
+                if (OFC_TISLOWER(b[i]))
+                  b[i] = OFC_TTOUPPER(b[i]);
+              ofc_assert(ops->tstr_casecmp(a, b) == 0, "tstrcasecmp mismatch");
+              if (len > 0)
+                {
+                  i = libc_test_rand() % len;
+                  b[i] = libc_test_rand() & 1 ? TCHAR_EOS : TCHAR('~');
+                  expect = libc_test_sign(scalar->tstr_casecmp(a, b));
+                  ofc_assert(libc_test_sign(ops->tstr_casecmp(a, b)) == expect &&
+                             libc_test_sign(ops->tstr_casecmp(b, a)) == -expect,
+                             "tstrcasecmp mismatch");
+                }
+            }
+        }
+    }
+
+  ofc_free(abuf);
+  ofc_free(bbuf);
+  ofc_free(cbuf);
+  ofc_free(dbuf);
+}
+
+/*
+ * Time each kernel table on short, medium and long strings
+ */
+#define LIBC_BENCH_ITERATIONS (1024 * 1024)
+
+static const OFC_SIZET libc_bench_lengths[] = {8, 64, 1024};
+
+static OFC_VOID libc_bench(const OFC_LIBC_OPS *ops, OFC_SIZET len,
+                           OFC_TCHAR *a, OFC_TCHAR *b,
+                           OFC_CHAR *c, OFC_CHAR *d) {
+  OFC_NSTIME start;
+  OFC_NSTIME elapsed[6];
+  OFC_INT iterations;
+  volatile OFC_SIZET sink;
+  OFC_INT i;
+
+  iterations = (OFC_INT) (LIBC_BENCH_ITERATIONS / len);
+  sink = 0;
+
+  start = ofc_time_get_ns();
+  for (i = 0; i < iterations; i++)
+    sink += ops->tstr_len(a);
+  elapsed[0] = ofc_time_get_ns() - start;
+
+  start = ofc_time_get_ns();
+  for (i = 0; i < iterations; i++)
+    sink += ops->str_nlen(c, len + 1);
+  elapsed[1] = ofc_time_get_ns() - start;
+
+  start = ofc_time_get_ns();
+  for (i = 0; i < iterations; i++)
+    sink += ops->tstr_casecmp(a, b);
+  elapsed[2] = ofc_time_get_ns() - start;
+
+  start = ofc_time_get_ns();
+  for (i = 0; i < iterations; i++)
+    sink += ops->mem_compare(c, d, len);
+  elapsed[3] = ofc_time_get_ns() - start;
+
+  start = ofc_time_get_ns();
+  for (i = 0; i < iterations; i++)
+    ops->tstr_narrow(d, a, len);
+  elapsed[4] = ofc_time_get_ns() - start;
+
+  start = ofc_time_get_ns();
+  for (i = 0; i < iterations; i++)
+    ops->cstr_widen(b, c, len);
+  elapsed[5] = ofc_time_get_ns() - start;
+
+  for (i = 0; i < 6; i++)
+    elapsed[i] /= iterations;
+  ofc_printf("%-8s %6d %9lu %9lu %9lu %9lu %9lu %9lu\n",
+             ops->name, (OFC_INT) len,
+             (OFC_ULONG) elapsed[0], (OFC_ULONG) elapsed[1],
+             (OFC_ULONG) elapsed[2], (OFC_ULONG) elapsed[3],
+             (OFC_ULONG) elapsed[4], (OFC_ULONG) elapsed[5]);
+}
+
+TEST(libc, test_libc_bench) {
+  const OFC_LIBC_OPS *ops;
+  OFC_TCHAR *a;
+  OFC_TCHAR *b;
+  OFC_CHAR *c;
+  OFC_CHAR *d;
+  OFC_SIZET len;
+  OFC_SIZET i;
+  OFC_INT impl;
+
+  ofc_printf("%-8s %6s %9s %9s %9s %9s %9s %9s  (ns per call)\n",
+             "kernel", "length", "tstrlen", "strnlen", "casecmp",
+             "memcmp", "narrow", "widen");
+  for (i = 0; i < sizeof(libc_bench_lengths) / sizeof(OFC_SIZET); i++)
+    {
+      len = libc_bench_lengths[i];
+      a = ofc_malloc((len + 1) * sizeof(OFC_TCHAR));
+      b = ofc_malloc((len + 1) * sizeof(OFC_TCHAR));
+      c = ofc_malloc(len + 1);
+      d = ofc_malloc(len + 1);
+
+      for (impl = OFC_LIBC_SCALAR; impl < OFC_LIBC_IMPL_MAX; impl++)
+        {
+          ops = ofc_libc_get_ops(impl);
+          if (ops == OFC_NULL)
+            continue;
+          libc_test_fill(a, len);
+          ofc_tstrcpy(b, a);
+          ofc_tstrnupr(b, len);
+          ops->tstr_narrow(c, a, len);
+          c[len] = '\0';
+          ofc_memcpy(d, c, len + 1);
+          libc_bench(ops, len, a, b, c, d);
+        }
+
+      ofc_free(a);
+      ofc_free(b);
+      ofc_free(c);
+      ofc_free(d);
+    }
+}
+
+/*
+ * Wrap the trace ring with every kind of argument, dump it, and compare
+ * the cost of a trace record with formatting the same line
+ */
+#define LIBC_TRACE_ITERATIONS (256 * 1024)
+
+TEST(libc, test_libc_trace) {
+  OFC_CHAR obuf[128];
+  OFC_NSTIME start;
+  OFC_NSTIME traced;
+  OFC_NSTIME formatted;
+  OFC_INT i;
+
+  for (i = 0; i < OFC_TRACE_RECORDS + 10; i++)
+    {
+      ofc_trace("Record %d of %u: %-6s|%S|%c|%*d\n",
+                i, OFC_TRACE_RECORDS + 10, "abc", TSTR("wide"), 'z', 5, -i);
+      ofc_trace("%.*s|0x%08lx|%p|%%|%A\n",
+                2, "truncated", (OFC_ULONG) i << 4, &obuf, TASTR("tastr"));
+    }
+  ofc_trace("More arguments than recorded: %d %d %d %d %d %d %d %d\n",
+            1, 2, 3, 4, 5, 6, 7, 8);
+  ofc_trace("A string longer than the record keeps: %s %s\n",
+            "0123456789012345678901234567890123456789"
+            "0123456789012345678901234567890123456789", OFC_NULL);
+  ofc_dump_trace();
+
+  start = ofc_time_get_ns();
+  for (i = 0; i < LIBC_TRACE_ITERATIONS; i++)
+    ofc_trace("Reading 0x%08x length %d from %s\n", i, 4096, "file");
+  traced = ofc_time_get_ns() - start;
+
+  start = ofc_time_get_ns();
+  for (i = 0; i < LIBC_TRACE_ITERATIONS; i++)
+    ofc_snprintf(obuf, sizeof(obuf), "Reading 0x%08x length %d from %s\n",
+                 i, 4096, "file");
+  formatted = ofc_time_get_ns() - start;
+
+  ofc_printf("trace %lu ns, snprintf %lu ns per record\n",
+             (OFC_ULONG) (traced / LIBC_TRACE_ITERATIONS),
+             (OFC_ULONG) (formatted / LIBC_TRACE_ITERATIONS));
+}
+
+/*
+ * Disabled levels cost nothing and a noisy call site is rate limited
+ */
+TEST(libc, test_libc_log) {
+  OFC_LOG_STATS before;
+  OFC_LOG_STATS after;
+  OFC_UINT threshold;
+  OFC_UINT32 admitted;
+  OFC_INT i;
+
+  threshold = ofc_log_threshold;
+  ofc_log_set_threshold(OFC_LOG_WARN);
+
+  ofc_log_get_stats(&before);
+  for (i = 0; i < 100; i++)
+    ofc_log(OFC_LOG_DEBUG, "Disabled message %d\n", i);
+  ofc_log_get_stats(&after);
+  ofc_assert(after.queued == before.queued &&
+             after.written == before.written &&
+             after.suppressed == before.suppressed,
+             "Disabled log level was processed");
+
+  for (i = 0; i < 3 * OFC_LOG_RATE; i++)
+    ofc_log(OFC_LOG_WARN, "Rate limited message %d\n", i);
+  ofc_log_flush();
+  ofc_log_get_stats(&after);
+
+  admitted = 3 * OFC_LOG_RATE - (after.suppressed - before.suppressed);
+  ofc_assert(after.suppressed > before.suppressed,
+             "Call site was not rate limited");
+  ofc_assert((after.written - before.written) +
+             (after.dropped - before.dropped) >= admitted,
+             "Log messages were lost");
+
+  ofc_log_dump_stats();
+  ofc_log_set_threshold(threshold);
+}
+
+TEST_GROUP_RUNNER(libc) {
+    RUN_TEST_CASE(libc, test_libc_simd);
+    RUN_TEST_CASE(libc, test_libc_bench);
+    RUN_TEST_CASE(libc, test_libc_trace);
+    RUN_TEST_CASE(libc, test_libc_log);
+}
+
+#if !defined(NO_MAIN)
+static void runAllTests(void)
+{
+  RUN_TEST_GROUP(libc);
+}
+
+int main(int argc, const char *argv[])
+{
+  return UnityMain(argc, argv, runAllTests);
+}
+#endif
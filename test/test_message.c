@@ -0,0 +1,221 @@
+/* Copyright (c) 2021 Connected Way, LLC. All rights reserved.
+ * Use of this source code is governed by a Creative Commons
+ * Attribution-NoDerivatives 4.0 International license that can be
+ * found in the LICENSE file.
+ */
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "ofc/core.h"
+#include "ofc/types.h"
+#include "ofc/config.h"
+#include "ofc/libc.h"
+#include "ofc/heap.h"
+#include "ofc/framework.h"
+#include "ofc/byteorder.h"
+#include "ofc/message.h"
+#include "ofc/dce.h"
+
+static OFC_INT test_startup(OFC_VOID) {
+#if defined(INIT_ON_LOAD)
+  volatile OFC_VOID *init = ofc_framework_init;
+#else
+    ofc_framework_init();
+#endif
+    return (0);
+}
+
+static OFC_VOID test_shutdown(OFC_VOID) {
+#if !defined(INIT_ON_LOAD)
+    ofc_framework_shutdown();
+    ofc_framework_destroy();
+#endif
+}
+
+TEST_GROUP(message);
+
+TEST_SETUP(message) {
+    TEST_ASSERT_FALSE_MESSAGE(test_startup(), "Failed to Startup Framework");
+}
+
+TEST_TEAR_DOWN(message) {
+    test_shutdown();
+}
+
+TEST(message, test_byteorder) {
+    OFC_UCHAR buf[16];
+    OFC_INT i;
+
+    /*
+     * Every offset, so each access is unaligned at least once
+     */
+    for (i = 0; i < 8; i++) {
+        ofc_memset(buf, 0, sizeof(buf));
+        ofc_store_be16(buf + i, 0x0102);
+        TEST_ASSERT_TRUE(buf[i] == 0x01 && buf[i + 1] == 0x02);
+        TEST_ASSERT_TRUE(ofc_load_be16(buf + i) == 0x0102);
+        TEST_ASSERT_TRUE(ofc_load_le16(buf + i) == 0x0201);
+
+        ofc_store_le16(buf + i, 0x0102);
+        TEST_ASSERT_TRUE(buf[i] == 0x02 && buf[i + 1] == 0x01);
+        TEST_ASSERT_TRUE(ofc_load_le16(buf + i) == 0x0102);
+
+        ofc_store_be32(buf + i, 0x01020304);
+        TEST_ASSERT_TRUE(buf[i] == 0x01 && buf[i + 3] == 0x04);
+        TEST_ASSERT_TRUE(ofc_load_be32(buf + i) == 0x01020304);
+        TEST_ASSERT_TRUE(ofc_load_le32(buf + i) == 0x04030201);
+
+        ofc_store_le32(buf + i, 0x01020304);
+        TEST_ASSERT_TRUE(buf[i] == 0x04 && buf[i + 3] == 0x01);
+        TEST_ASSERT_TRUE(ofc_load_le32(buf + i) == 0x01020304);
+
+#if defined(OFC_64BIT_INTEGER)
+        ofc_store_be64(buf + i, 0x0102030405060708ULL);
+        TEST_ASSERT_TRUE(buf[i] == 0x01 && buf[i + 7] == 0x08);
+        TEST_ASSERT_TRUE(ofc_load_be64(buf + i) == 0x0102030405060708ULL);
+        TEST_ASSERT_TRUE(ofc_load_le64(buf + i) == 0x0807060504030201ULL);
+
+        ofc_store_le64(buf + i, 0x0102030405060708ULL);
+        TEST_ASSERT_TRUE(buf[i] == 0x08 && buf[i + 7] == 0x01);
+        TEST_ASSERT_TRUE(ofc_load_le64(buf + i) == 0x0102030405060708ULL);
+#endif
+        /* Neighbours untouched */
+        if (i > 0)
+            TEST_ASSERT_TRUE(buf[i - 1] == 0);
+    }
+}
+
+#define MESSAGE_TEST_HEADER 16
+#define MESSAGE_TEST_PAYLOAD 64
+
+TEST(message, test_message_window) {
+    OFC_MESSAGE *msg;
+    OFC_UCHAR *window;
+
+    msg = ofc_message_create_scatter(MESSAGE_TEST_HEADER,
+                                     MESSAGE_TEST_PAYLOAD, OFC_NULL);
+    TEST_ASSERT_TRUE_MESSAGE(msg != OFC_NULL, "Couldn't create message");
+
+    window = ofc_message_window(msg, 0, MESSAGE_TEST_HEADER);
+    TEST_ASSERT_TRUE_MESSAGE(window != OFC_NULL, "No window on header");
+    TEST_ASSERT_TRUE(window == ofc_message_get_pointer(msg, 0));
+
+    window = ofc_message_window(msg, MESSAGE_TEST_HEADER,
+                                MESSAGE_TEST_PAYLOAD);
+    TEST_ASSERT_TRUE_MESSAGE(window != OFC_NULL, "No window on payload");
+    ofc_memset(window, 0x5a, MESSAGE_TEST_PAYLOAD);
+    TEST_ASSERT_TRUE(ofc_message_get_u8(msg, MESSAGE_TEST_HEADER + 10) ==
+                     0x5a);
+
+    /*
+     * A range across the segments, or past the end, has no window
+     */
+    TEST_ASSERT_TRUE(ofc_message_window(msg, MESSAGE_TEST_HEADER - 2, 4) ==
+                     OFC_NULL);
+    TEST_ASSERT_TRUE(ofc_message_window(msg, MESSAGE_TEST_HEADER +
+                                        MESSAGE_TEST_PAYLOAD - 2, 4) ==
+                     OFC_NULL);
+
+    /*
+     * The offset is relative to the base
+     */
+    ofc_message_set_base(msg, MESSAGE_TEST_HEADER);
+    TEST_ASSERT_TRUE(ofc_message_window(msg, 0, MESSAGE_TEST_PAYLOAD) ==
+                     ofc_message_get_pointer(msg, 0));
+    TEST_ASSERT_TRUE(ofc_message_window(msg, 0, MESSAGE_TEST_PAYLOAD + 1) ==
+                     OFC_NULL);
+
+    ofc_message_destroy(msg);
+}
+
+/*
+ * Push a request, bind and result header from offset 16
+ */
+#define DCE_TEST_START 16
+#define DCE_TEST_END (DCE_TEST_START + DCE_REQ_SIZE + DCE_BIND_SIZE + \
+                      DCE_RESULT_SIZE)
+#define DCE_TEST_LENGTH 64
+
+static OFC_VOID dce_test_push(OFC_MESSAGE *msg) {
+    OFC_UUID uuid;
+    OFC_INT i;
+
+    for (i = 0; i < OFC_UUID_LEN; i++)
+        uuid[i] = (OFC_UCHAR) (0xa0 + i);
+
+    ofc_message_set_endian(msg, MSG_ENDIAN_LITTLE);
+    ofc_message_fifo_set(msg, DCE_TEST_START,
+                         DCE_TEST_LENGTH - DCE_TEST_START);
+    of_dce_push_request_header(msg, 0x11223344, 0x5566, 0x7788);
+    of_dce_push_bind_header(msg, 0x1234, 0x5678, 0x9abcdef0);
+    of_dce_push_result(msg, 0x0102, 0x0304, &uuid, 0x0506);
+}
+
+TEST(message, test_dce_straddle) {
+    OFC_MESSAGE *ref;
+    OFC_MESSAGE *msg;
+    OFC_INT header_len;
+    OFC_INT i;
+    OFC_UINT32 alloc_hint;
+    OFC_UINT16 context_id;
+    OFC_UINT16 opnum;
+
+    ref = ofc_message_create(MSG_ALLOC_HEAP, DCE_TEST_LENGTH, OFC_NULL);
+    TEST_ASSERT_TRUE_MESSAGE(ref != OFC_NULL, "Couldn't create message");
+    ofc_memset(ofc_message_data(ref), 0, DCE_TEST_LENGTH);
+    dce_test_push(ref);
+    TEST_ASSERT_TRUE(ofc_message_fifo_get(ref) == DCE_TEST_END);
+
+    /*
+     * Split the message at every point in the headers, so each header
+     * straddles the segments at every field
+     */
+    for (header_len = DCE_TEST_START + 1; header_len < DCE_TEST_END;
+         header_len++) {
+        msg = ofc_message_create_scatter(header_len,
+                                         DCE_TEST_LENGTH - header_len,
+                                         OFC_NULL);
+        TEST_ASSERT_TRUE_MESSAGE(msg != OFC_NULL, "Couldn't create message");
+        for (i = 0; i < DCE_TEST_LENGTH; i++)
+            ofc_message_put_u8(msg, i, 0);
+
+        dce_test_push(msg);
+        TEST_ASSERT_TRUE_MESSAGE(ofc_message_fifo_get(msg) == DCE_TEST_END,
+                                 "Fifo not advanced over headers");
+        for (i = 0; i < DCE_TEST_LENGTH; i++)
+            TEST_ASSERT_TRUE_MESSAGE(ofc_message_get_u8(msg, i) ==
+                                     ofc_message_get_u8(ref, i),
+                                     "Split header encoded differently");
+
+        ofc_message_fifo_set(msg, DCE_TEST_START,
+                             DCE_TEST_LENGTH - DCE_TEST_START);
+        of_dce_pop_request_header(msg, &alloc_hint, &context_id, &opnum);
+        TEST_ASSERT_TRUE(alloc_hint == 0x11223344);
+        TEST_ASSERT_TRUE(context_id == 0x5566);
+        TEST_ASSERT_TRUE(opnum == 0x7788);
+        TEST_ASSERT_TRUE_MESSAGE(ofc_message_fifo_get(msg) ==
+                                 DCE_TEST_START + DCE_REQ_SIZE,
+                                 "Fifo not advanced over request");
+        ofc_message_destroy(msg);
+    }
+
+    ofc_message_destroy(ref);
+}
+
+TEST_GROUP_RUNNER(message) {
+    RUN_TEST_CASE(message, test_byteorder);
+    RUN_TEST_CASE(message, test_message_window);
+    RUN_TEST_CASE(message, test_dce_straddle);
+}
+
+#if !defined(NO_MAIN)
+static void runAllTests(void)
+{
+  RUN_TEST_GROUP(message);
+}
+
+int main(int argc, const char *argv[])
+{
+  return UnityMain(argc, argv, runAllTests);
+}
+#endif
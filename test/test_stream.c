@@ -24,6 +24,8 @@
 #include "ofc/framework.h"
 #include "ofc/env.h"
 #include "ofc/persist.h"
+#include "ofc/file.h"
+#include "ofc/thread.h"
 
 extern OFC_CHAR config_path[OFC_MAX_PATH+1];
 
@@ -1350,8 +1352,178 @@ TEST(stream, test_stream) {
 #endif
 }
 
+/*
+ * Send a local file on a loopback connection through the buffered
+ * sendfile path, reading from the other end only when the sender stalls
+ */
+#define STREAM_SENDFILE_PORT 7543
+#define STREAM_SENDFILE_SIZE (1024 * 1024 + 1234)
+#define STREAM_SENDFILE_POS 12345
+#if !defined(STREAM_SENDFILE_NAME)
+#define STREAM_SENDFILE_NAME TSTR("stream_sendfile.tmp")
+#endif
+
+static OFC_UCHAR StreamSendfileByte(OFC_SIZET offset) {
+    return ((OFC_UCHAR) (offset * 7 + offset / 251));
+}
+
+/*
+ * Connect to a listening socket on loopback, and accept the connection
+ */
+static OFC_VOID StreamSendfilePair(OFC_HANDLE *hListen, OFC_HANDLE *hClient,
+                                   OFC_HANDLE *hServer) {
+    OFC_IPADDR ip;
+    OFC_INT i;
+
+    ip.ip_version = OFC_FAMILY_IP;
+    ip.u.ipv4.addr = OFC_INADDR_LOOPBACK;
+    *hListen = ofc_socket_listen(&ip, STREAM_SENDFILE_PORT);
+    TEST_ASSERT_TRUE_MESSAGE(*hListen != OFC_HANDLE_NULL,
+                             "Couldn't listen on loopback");
+    *hClient = ofc_socket_connect(&ip, STREAM_SENDFILE_PORT);
+    TEST_ASSERT_TRUE_MESSAGE(*hClient != OFC_HANDLE_NULL,
+                             "Couldn't connect on loopback");
+    *hServer = OFC_HANDLE_NULL;
+    for (i = 0; i < 500 && (*hServer == OFC_HANDLE_NULL ||
+                            !ofc_socket_connected(*hClient)); i++) {
+        if (*hServer == OFC_HANDLE_NULL)
+            *hServer = ofc_socket_accept(*hListen);
+        ofc_sleep(10);
+    }
+    TEST_ASSERT_TRUE_MESSAGE(*hServer != OFC_HANDLE_NULL,
+                             "Connection not accepted");
+    /*
+     * Small buffers, so the socket fills part way through a chunk
+     */
+    ofc_socket_set_send_size(*hClient, 16384);
+    ofc_socket_set_recv_size(*hServer, 16384);
+}
+
+/*
+ * Read what has arrived, checking it against the file
+ */
+static OFC_SIZET StreamSendfileDrain(OFC_HANDLE hServer, OFC_SIZET received) {
+    OFC_MESSAGE *msg;
+    OFC_UCHAR *data;
+    OFC_SIZET len;
+    OFC_SIZET i;
+
+    do {
+        msg = ofc_message_create(MSG_ALLOC_HEAP, OFC_SOCKET_SENDFILE_CHUNK,
+                                 OFC_NULL);
+        len = 0;
+        if (ofc_socket_read(hServer, msg))
+            len = ofc_message_offset(msg);
+        data = ofc_message_data(msg);
+        for (i = 0; i < len; i++)
+            TEST_ASSERT_TRUE_MESSAGE(data[i] ==
+                                     StreamSendfileByte(received + i),
+                                     "File arrived corrupted");
+        received += len;
+        ofc_message_destroy(msg);
+    } while (len > 0);
+    return (received);
+}
+
+TEST(stream, test_sendfile) {
+    OFC_HANDLE hFile;
+    OFC_HANDLE hListen;
+    OFC_HANDLE hClient;
+    OFC_HANDLE hServer;
+    OFC_SENDFILE *xfer;
+    OFC_UCHAR *buf;
+    OFC_DWORD dwBytes;
+    OFC_LONG high;
+    OFC_SIZET received;
+    OFC_SIZET drained;
+    OFC_SIZET i;
+    OFC_INT stalls;
+    OFC_INT partial;
+
+    hFile = OfcCreateFile(STREAM_SENDFILE_NAME,
+                          OFC_GENERIC_READ | OFC_GENERIC_WRITE,
+                          0, OFC_NULL, OFC_CREATE_ALWAYS,
+                          OFC_FILE_ATTRIBUTE_NORMAL |
+                          OFC_FILE_FLAG_DELETE_ON_CLOSE,
+                          OFC_HANDLE_NULL);
+    TEST_ASSERT_TRUE_MESSAGE(hFile != OFC_INVALID_HANDLE_VALUE,
+                             "Couldn't create file to send");
+    buf = ofc_malloc(STREAM_SENDFILE_SIZE);
+    for (i = 0; i < STREAM_SENDFILE_SIZE; i++)
+        buf[i] = StreamSendfileByte(i);
+    TEST_ASSERT_TRUE(OfcWriteFile(hFile, buf, STREAM_SENDFILE_SIZE,
+                                  &dwBytes, OFC_HANDLE_NULL));
+    ofc_free(buf);
+
+    StreamSendfilePair(&hListen, &hClient, &hServer);
+
+    /*
+     * Park the file somewhere the transfer must not disturb, and take
+     * the buffered path even if the platform could send it directly
+     */
+    OfcSetFilePointer(hFile, STREAM_SENDFILE_POS, OFC_NULL, OFC_FILE_BEGIN);
+    xfer = ofc_socket_sendfile_create(hFile, 0, STREAM_SENDFILE_SIZE);
+    xfer->fd = -1;
+
+    received = 0;
+    stalls = 0;
+    partial = 0;
+    while (xfer->count > 0) {
+        if (!ofc_socket_sendfile(hClient, xfer)) {
+            /*
+             * The connection is full.  Resuming part way through the
+             * buffer is what the buffered path has to get right.
+             */
+            stalls++;
+            if (xfer->sent > 0 && xfer->sent < xfer->buffered)
+                partial++;
+            drained = StreamSendfileDrain(hServer, received);
+            if (drained == received)
+                ofc_sleep(1);
+            received = drained;
+        }
+    }
+    for (i = 0; i < 1000 && received < STREAM_SENDFILE_SIZE; i++) {
+        drained = StreamSendfileDrain(hServer, received);
+        if (drained == received)
+            ofc_sleep(10);
+        received = drained;
+    }
+
+    ofc_printf("Sendfile stalled %d times, %d part way through a chunk\n",
+               stalls, partial);
+    TEST_ASSERT_FALSE_MESSAGE(xfer->failed, "Sendfile failed");
+    TEST_ASSERT_TRUE_MESSAGE(received == STREAM_SENDFILE_SIZE,
+                             "File not all received");
+    high = 0;
+    TEST_ASSERT_TRUE_MESSAGE(OfcSetFilePointer(hFile, 0, &high,
+                                               OFC_FILE_CURRENT) ==
+                             STREAM_SENDFILE_POS,
+                             "Sendfile moved the file's position");
+    ofc_socket_sendfile_destroy(xfer);
+
+    /*
+     * A file shorter than the transfer fails it
+     */
+    xfer = ofc_socket_sendfile_create(hFile, STREAM_SENDFILE_SIZE - 10, 100);
+    xfer->fd = -1;
+    for (i = 0; i < 100 && xfer->count > 0; i++) {
+        if (!ofc_socket_sendfile(hClient, xfer))
+            StreamSendfileDrain(hServer, STREAM_SENDFILE_SIZE - 10);
+    }
+    TEST_ASSERT_TRUE_MESSAGE(xfer->count == 0 && xfer->failed,
+                             "Sendfile past the end of the file didn't fail");
+    ofc_socket_sendfile_destroy(xfer);
+
+    ofc_socket_destroy(hServer);
+    ofc_socket_destroy(hClient);
+    ofc_socket_destroy(hListen);
+    OfcCloseHandle(hFile);
+}
+
 TEST_GROUP_RUNNER(stream) {
     RUN_TEST_CASE(stream, test_stream);
+    RUN_TEST_CASE(stream, test_sendfile);
 }
 
 #if !defined(NO_MAIN)
@@ -18,6 +18,8 @@
 #include "ofc/libc.h"
 #include "ofc/heap.h"
 #include "ofc/event.h"
+#include "ofc/thread.h"
+#include "ofc/time.h"
 
 extern OFC_CHAR config_path[OFC_MAX_PATH+1];
 
@@ -165,8 +167,98 @@ TEST(timer, test_timer) {
     }
 }
 
+#define TIMER_WHEEL_COUNT 1000
+#define TIMER_WHEEL_SPREAD 500
+
+TEST(timer, test_timer_wheel) {
+    OFC_TIMER_WHEEL *wheel;
+    OFC_HANDLE *timers;
+    OFC_HANDLE expired[16];
+    OFC_MSTIME next;
+    OFC_MSTIME start;
+    OFC_INT fired;
+    OFC_INT count;
+    OFC_INT i;
+
+    wheel = ofc_timer_wheel_create();
+    TEST_ASSERT_EQUAL_INT(OFC_INFINITE, ofc_timer_wheel_next(wheel));
+
+    timers = ofc_malloc(sizeof(OFC_HANDLE) * TIMER_WHEEL_COUNT);
+    for (i = 0; i < TIMER_WHEEL_COUNT; i++) {
+        timers[i] = ofc_timer_create("WHEEL");
+        ofc_timer_set(timers[i], 50 + (i * 7919) % TIMER_WHEEL_SPREAD);
+        ofc_timer_wheel_arm(wheel, timers[i]);
+    }
+    /*
+     * Canceled timers must never come back
+     */
+    for (i = 0; i < TIMER_WHEEL_COUNT; i += 4)
+        ofc_timer_wheel_cancel(wheel, timers[i]);
+
+    next = ofc_timer_wheel_next(wheel);
+    TEST_ASSERT_TRUE(next >= 0 && next <= 50);
+
+    fired = 0;
+    start = ofc_time_get_now();
+    while (next != OFC_INFINITE &&
+           ofc_time_get_now() - start < TIMER_WHEEL_SPREAD * 4) {
+        ofc_sleep(next);
+        count = ofc_timer_wheel_expire(wheel, expired, 16);
+        for (i = 0; i < count; i++) {
+            TEST_ASSERT_EQUAL_INT(0, ofc_timer_get_wait_time(expired[i]));
+            fired++;
+        }
+        next = ofc_timer_wheel_next(wheel);
+    }
+    TEST_ASSERT_EQUAL_INT(TIMER_WHEEL_COUNT - TIMER_WHEEL_COUNT / 4, fired);
+
+    for (i = 0; i < TIMER_WHEEL_COUNT; i++)
+        ofc_timer_destroy(timers[i]);
+    ofc_free(timers);
+    ofc_timer_wheel_destroy(wheel);
+}
+
+/*
+ * Timers outlive the wheel they were on, expired or still armed
+ */
+TEST(timer, test_timer_wheel_destroy) {
+    OFC_TIMER_WHEEL *wheel;
+    OFC_HANDLE hArmed;
+    OFC_HANDLE hExpired;
+    OFC_HANDLE expired[2];
+    OFC_INT count;
+
+    wheel = ofc_timer_wheel_create();
+    hArmed = ofc_timer_create("WHEEL ARMED");
+    hExpired = ofc_timer_create("WHEEL EXPIRED");
+    ofc_timer_set(hArmed, 60000);
+    ofc_timer_set(hExpired, 0);
+    ofc_timer_wheel_arm(wheel, hArmed);
+    ofc_timer_wheel_arm(wheel, hExpired);
+
+    count = 0;
+    while (count == 0) {
+        ofc_sleep(ofc_timer_wheel_next(wheel));
+        count = ofc_timer_wheel_expire(wheel, expired, 2);
+    }
+    TEST_ASSERT_EQUAL_INT(1, count);
+    TEST_ASSERT_TRUE(expired[0] == hExpired);
+
+    ofc_timer_wheel_destroy(wheel);
+    /*
+     * Both let go of the destroyed wheel
+     */
+    ofc_timer_set(hExpired, 10);
+    ofc_timer_set(hArmed, 10);
+    ofc_timer_set(hArmed, 20);
+    ofc_timer_destroy(hExpired);
+    ofc_timer_destroy(hArmed);
+}
+
 TEST_GROUP_RUNNER(timer) {
     RUN_TEST_CASE(timer, test_timer);
+    RUN_TEST_CASE(timer, test_timer_wheel);
+    RUN_TEST_CASE(timer, test_timer_wheel_destroy);
 }
 
 #if !defined(NO_MAIN)
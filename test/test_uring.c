@@ -0,0 +1,271 @@
+/* Copyright (c) 2021 Connected Way, LLC. All rights reserved.
+ * Use of this source code is governed by a Creative Commons
+ * Attribution-NoDerivatives 4.0 International license that can be
+ * found in the LICENSE file.
+ */
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "ofc/core.h"
+#include "ofc/types.h"
+#include "ofc/config.h"
+#include "ofc/libc.h"
+#include "ofc/heap.h"
+#include "ofc/handle.h"
+#include "ofc/waitq.h"
+#include "ofc/waitset.h"
+#include "ofc/file.h"
+#include "ofc/thread.h"
+#include "ofc/framework.h"
+#include "ofc/uring.h"
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+OFC_VOID test_shutdown(OFC_VOID);
+OFC_INT test_startup(OFC_VOID);
+
+#define URING_TEST_IOS 8
+#define URING_TEST_SIZE 4096
+
+TEST_GROUP(uring);
+
+TEST_SETUP(uring) {
+    TEST_ASSERT_FALSE_MESSAGE(test_startup(), "Failed to Startup Framework");
+}
+
+TEST_TEAR_DOWN(uring) {
+    test_shutdown();
+}
+
+/*
+ * Count the completions posted to the queue that moved a whole buffer
+ */
+static OFC_INT
+uring_test_dequeue(OFC_HANDLE hQueue) {
+    OFC_HANDLE hOverlapped;
+    OFC_OVERLAPPED *overlapped;
+    OFC_INT count;
+
+    count = 0;
+    for (hOverlapped = (OFC_HANDLE) ofc_waitq_dequeue(hQueue);
+         hOverlapped != OFC_HANDLE_NULL;
+         hOverlapped = (OFC_HANDLE) ofc_waitq_dequeue(hQueue)) {
+        overlapped = ofc_handle_lock(hOverlapped);
+        if (overlapped != OFC_NULL) {
+            if (overlapped->status &&
+                overlapped->dwLen == URING_TEST_SIZE)
+                count++;
+            ofc_handle_unlock(hOverlapped);
+        }
+    }
+    return (count);
+}
+
+/*
+ * Service the set until every I/O queued has been posted to the queue
+ */
+static OFC_INT
+uring_test_collect(WAIT_SET *pWaitSet, OFC_HANDLE hQueue) {
+    OFC_INT count;
+    OFC_INT i;
+
+    count = 0;
+    i = 0;
+    while (count < URING_TEST_IOS && i < 10000) {
+        ofc_uring_service(pWaitSet->uring);
+        count += uring_test_dequeue(hQueue);
+        if (count < URING_TEST_IOS) {
+            ofc_sleep(1);
+            i++;
+        }
+    }
+    return (count);
+}
+
+/*
+ * Service the set until one I/O completes and return its error
+ */
+static OFC_DWORD
+uring_test_error(WAIT_SET *pWaitSet, OFC_HANDLE hQueue) {
+    OFC_HANDLE hOverlapped;
+    OFC_OVERLAPPED *overlapped;
+    OFC_DWORD error;
+    OFC_INT i;
+
+    error = OFC_ERROR_SUCCESS;
+    hOverlapped = OFC_HANDLE_NULL;
+    for (i = 0; hOverlapped == OFC_HANDLE_NULL && i < 10000; i++) {
+        ofc_uring_service(pWaitSet->uring);
+        hOverlapped = (OFC_HANDLE) ofc_waitq_dequeue(hQueue);
+        if (hOverlapped == OFC_HANDLE_NULL)
+            ofc_sleep(1);
+    }
+    overlapped = ofc_handle_lock(hOverlapped);
+    if (overlapped != OFC_NULL) {
+        if (!overlapped->status)
+            error = overlapped->dwError;
+        ofc_handle_unlock(hOverlapped);
+    }
+    return (error);
+}
+
+typedef struct {
+    OFC_INT fd[2];
+    OFC_CHAR *buf;
+} URING_TEST_WRITER;
+
+/*
+ * Fill the pipe once the wait set has had time to start destroying
+ */
+static OFC_DWORD
+uring_test_writer(OFC_HANDLE hThread, OFC_VOID *context) {
+    URING_TEST_WRITER *writer;
+
+    writer = context;
+    ofc_sleep(100);
+    if (write(writer->fd[1], writer->buf, URING_TEST_SIZE) !=
+        URING_TEST_SIZE)
+        ofc_printf("Couldn't write to pipe\n");
+    return (0);
+}
+
+TEST(uring, test_uring) {
+    OFC_HANDLE hSet;
+    OFC_HANDLE hWriter;
+    URING_TEST_WRITER writer;
+    OFC_HANDLE hQueue;
+    WAIT_SET *pWaitSet;
+    OFC_OVERLAPPED overlapped[URING_TEST_IOS];
+    OFC_HANDLE hOverlapped[URING_TEST_IOS];
+    OFC_CHAR *wbuf;
+    OFC_CHAR *rbuf;
+    OFC_CHAR filename[] = "/tmp/ofc_uringXXXXXX";
+    OFC_INT fd;
+    OFC_INT i;
+
+    hSet = ofc_waitset_create();
+    pWaitSet = ofc_handle_lock(hSet);
+    TEST_ASSERT_TRUE_MESSAGE(pWaitSet != OFC_NULL, "No Wait Set");
+
+    if (pWaitSet->uring == OFC_NULL) {
+        ofc_printf("io_uring not available, skipping\n");
+    } else {
+        fd = mkstemp(filename);
+        TEST_ASSERT_TRUE_MESSAGE(fd >= 0, "Couldn't create test file");
+        unlink(filename);
+
+        hQueue = ofc_waitq_create();
+        wbuf = ofc_malloc(URING_TEST_IOS * URING_TEST_SIZE);
+        rbuf = ofc_malloc(URING_TEST_IOS * URING_TEST_SIZE);
+        for (i = 0; i < URING_TEST_IOS * URING_TEST_SIZE; i++)
+            wbuf[i] = (OFC_CHAR) (i * 7);
+        ofc_memset(rbuf, 0, URING_TEST_IOS * URING_TEST_SIZE);
+
+        ofc_memset(overlapped, 0, sizeof(overlapped));
+        for (i = 0; i < URING_TEST_IOS; i++) {
+            overlapped[i].response_queue = hQueue;
+            overlapped[i].offset = i * URING_TEST_SIZE;
+            hOverlapped[i] = ofc_handle_create(OFC_HANDLE_FSLINUX_OVERLAPPED,
+                                               &overlapped[i]);
+            ofc_handle_set_app(hOverlapped[i], OFC_HANDLE_NULL, hSet);
+        }
+
+        /*
+         * Issue every write before servicing, so they go in one submit
+         */
+        for (i = 0; i < URING_TEST_IOS; i++)
+            TEST_ASSERT_TRUE_MESSAGE
+                    (ofc_uring_write(hOverlapped[i], fd,
+                                     wbuf + i * URING_TEST_SIZE,
+                                     URING_TEST_SIZE),
+                     "Ring refused a write");
+        TEST_ASSERT_TRUE(ofc_uring_inflight(pWaitSet->uring) ==
+                         URING_TEST_IOS);
+        TEST_ASSERT_TRUE_MESSAGE(uring_test_collect(pWaitSet, hQueue) ==
+                                 URING_TEST_IOS, "Writes didn't complete");
+
+        for (i = 0; i < URING_TEST_IOS; i++)
+            TEST_ASSERT_TRUE_MESSAGE
+                    (ofc_uring_read(hOverlapped[i], fd,
+                                    rbuf + i * URING_TEST_SIZE,
+                                    URING_TEST_SIZE),
+                     "Ring refused a read");
+        TEST_ASSERT_TRUE_MESSAGE(uring_test_collect(pWaitSet, hQueue) ==
+                                 URING_TEST_IOS, "Reads didn't complete");
+        TEST_ASSERT_TRUE_MESSAGE(ofc_memcmp(wbuf, rbuf,
+                                            URING_TEST_IOS *
+                                            URING_TEST_SIZE) == 0,
+                                 "Read doesn't match write");
+        TEST_ASSERT_TRUE(ofc_uring_inflight(pWaitSet->uring) == 0);
+
+        /*
+         * A failed read carries its error rather than looking short
+         */
+        TEST_ASSERT_TRUE_MESSAGE(pipe(writer.fd) == 0, "Couldn't create pipe");
+        TEST_ASSERT_TRUE_MESSAGE(ofc_uring_read(hOverlapped[0], writer.fd[1],
+                                                rbuf, URING_TEST_SIZE),
+                                 "Ring refused a read");
+        TEST_ASSERT_TRUE_MESSAGE(uring_test_error(pWaitSet, hQueue) ==
+                                 OFC_ERROR_INVALID_HANDLE,
+                                 "Read of write end didn't fail");
+
+        /*
+         * Destroying the set with a read in flight has to wait for it,
+         * since it is reading into our buffer.  A read of an empty pipe
+         * stays in flight until the writer gets to it.
+         */
+        writer.buf = wbuf;
+        ofc_memset(rbuf, 0, URING_TEST_SIZE);
+        TEST_ASSERT_TRUE_MESSAGE(ofc_uring_read(hOverlapped[0], writer.fd[0],
+                                                rbuf, URING_TEST_SIZE),
+                                 "Ring refused a read");
+        ofc_uring_service(pWaitSet->uring);
+        hWriter = ofc_thread_create(&uring_test_writer,
+                                    OFC_THREAD_THREAD_TEST, 0, &writer,
+                                    OFC_THREAD_JOIN, OFC_HANDLE_NULL);
+        ofc_handle_unlock(hSet);
+        ofc_waitset_destroy(hSet);
+        hSet = OFC_HANDLE_NULL;
+        ofc_thread_wait(hWriter);
+        TEST_ASSERT_TRUE_MESSAGE(uring_test_dequeue(hQueue) == 1,
+                                 "Destroy didn't wait for the read");
+        TEST_ASSERT_TRUE_MESSAGE(ofc_memcmp(wbuf, rbuf,
+                                            URING_TEST_SIZE) == 0,
+                                 "Pipe read doesn't match write");
+        close(writer.fd[0]);
+        close(writer.fd[1]);
+
+        for (i = 0; i < URING_TEST_IOS; i++) {
+            ofc_handle_set_app(hOverlapped[i], OFC_HANDLE_NULL,
+                               OFC_HANDLE_NULL);
+            ofc_handle_destroy(hOverlapped[i]);
+        }
+        ofc_free(rbuf);
+        ofc_free(wbuf);
+        ofc_waitq_destroy(hQueue);
+        close(fd);
+    }
+
+    if (hSet != OFC_HANDLE_NULL) {
+        ofc_handle_unlock(hSet);
+        ofc_waitset_destroy(hSet);
+    }
+}
+
+TEST_GROUP_RUNNER(uring) {
+    RUN_TEST_CASE(uring, test_uring);
+}
+
+#if !defined(NO_MAIN)
+static void runAllTests(void)
+{
+  RUN_TEST_GROUP(uring);
+}
+
+int main(int argc, const char *argv[])
+{
+  return UnityMain(argc, argv, runAllTests);
+}
+#endif
@@ -20,6 +20,7 @@
 #include "ofc/env.h"
 #include "ofc/persist.h"
 #include "ofc/event.h"
+#include "ofc/thread.h"
 
 extern OFC_CHAR config_path[OFC_MAX_PATH+1];
 
@@ -193,8 +194,112 @@ TEST(waitq, test_waitq) {
     }
 }
 
+/*
+ * Several producers enqueue to an MPSC queue while the test thread
+ * blocks and dequeues.  Each producer's elements must arrive in order.
+ */
+#define WAITQ_MPSC_PRODUCERS 4
+#define WAITQ_MPSC_ELEMENTS 10000
+
+typedef struct {
+    OFC_INT producer;
+    OFC_INT seq;
+} WAITQ_MPSC_ELEMENT;
+
+typedef struct {
+    OFC_HANDLE hThread;
+    OFC_HANDLE hWaitQueue;
+    OFC_INT producer;
+    WAITQ_MPSC_ELEMENT *elements;
+} WAITQ_MPSC_PRODUCER;
+
+static OFC_DWORD WaitQueueMpscProducer(OFC_HANDLE hThread,
+                                       OFC_VOID *context) {
+    WAITQ_MPSC_PRODUCER *producer;
+    OFC_INT i;
+
+    producer = context;
+    for (i = 0; i < WAITQ_MPSC_ELEMENTS; i++) {
+        producer->elements[i].producer = producer->producer;
+        producer->elements[i].seq = i;
+        ofc_waitq_enqueue(producer->hWaitQueue, &producer->elements[i]);
+    }
+    return (0);
+}
+
+TEST(waitq, test_waitq_mpsc) {
+    OFC_HANDLE hWaitQueue;
+    WAITQ_MPSC_PRODUCER producers[WAITQ_MPSC_PRODUCERS];
+    OFC_INT next[WAITQ_MPSC_PRODUCERS];
+    WAITQ_MPSC_ELEMENT local[3];
+    WAITQ_MPSC_ELEMENT *element;
+    OFC_INT i;
+
+    hWaitQueue = ofc_waitq_create_mpsc();
+    TEST_ASSERT_TRUE_MESSAGE(hWaitQueue != OFC_HANDLE_NULL,
+                             "Couldn't create MPSC wait queue");
+
+    /*
+     * An unlinked element is skipped, and OFC_NULL is not an element
+     */
+    for (i = 0; i < 3; i++)
+        ofc_waitq_enqueue(hWaitQueue, &local[i]);
+    ofc_waitq_unlink(hWaitQueue, &local[1]);
+    ofc_waitq_enqueue(hWaitQueue, OFC_NULL);
+    TEST_ASSERT_TRUE(ofc_waitq_first(hWaitQueue) == &local[0]);
+    TEST_ASSERT_TRUE(ofc_waitq_next(hWaitQueue, &local[0]) == &local[2]);
+    ofc_waitq_block(hWaitQueue);
+    TEST_ASSERT_TRUE(ofc_waitq_dequeue(hWaitQueue) == &local[0]);
+    ofc_waitq_block(hWaitQueue);
+    TEST_ASSERT_TRUE(ofc_waitq_dequeue(hWaitQueue) == &local[2]);
+    TEST_ASSERT_TRUE(ofc_waitq_dequeue(hWaitQueue) == OFC_NULL);
+    TEST_ASSERT_TRUE_MESSAGE(ofc_waitq_empty(hWaitQueue),
+                             "Unlinked or OFC_NULL element counted");
+
+    /*
+     * A queue holding only a tombstone is empty, so the first block below
+     * waits for a producer rather than spinning on the tombstone
+     */
+    ofc_waitq_enqueue(hWaitQueue, &local[0]);
+    ofc_waitq_unlink(hWaitQueue, &local[0]);
+    TEST_ASSERT_TRUE(ofc_waitq_empty(hWaitQueue));
+
+    for (i = 0; i < WAITQ_MPSC_PRODUCERS; i++) {
+        next[i] = 0;
+        producers[i].hWaitQueue = hWaitQueue;
+        producers[i].producer = i;
+        producers[i].elements =
+                ofc_malloc(sizeof(WAITQ_MPSC_ELEMENT) * WAITQ_MPSC_ELEMENTS);
+        producers[i].hThread =
+                ofc_thread_create(&WaitQueueMpscProducer,
+                                  OFC_THREAD_THREAD_TEST, i,
+                                  &producers[i],
+                                  OFC_THREAD_JOIN,
+                                  OFC_HANDLE_NULL);
+    }
+
+    for (i = 0; i < WAITQ_MPSC_PRODUCERS * WAITQ_MPSC_ELEMENTS; i++) {
+        ofc_waitq_block(hWaitQueue);
+        element = ofc_waitq_dequeue(hWaitQueue);
+        TEST_ASSERT_TRUE_MESSAGE(element != OFC_NULL,
+                                 "Woken with nothing to dequeue");
+        TEST_ASSERT_TRUE_MESSAGE(element->seq == next[element->producer],
+                                 "Producer's elements out of order");
+        next[element->producer]++;
+    }
+    TEST_ASSERT_TRUE(ofc_waitq_dequeue(hWaitQueue) == OFC_NULL);
+    TEST_ASSERT_TRUE(ofc_waitq_empty(hWaitQueue));
+
+    for (i = 0; i < WAITQ_MPSC_PRODUCERS; i++) {
+        ofc_thread_wait(producers[i].hThread);
+        ofc_free(producers[i].elements);
+    }
+    ofc_waitq_destroy(hWaitQueue);
+}
+
 TEST_GROUP_RUNNER(waitq) {
     RUN_TEST_CASE(waitq, test_waitq);
+    RUN_TEST_CASE(waitq, test_waitq_mpsc);
 }
 
 #if !defined(NO_MAIN)